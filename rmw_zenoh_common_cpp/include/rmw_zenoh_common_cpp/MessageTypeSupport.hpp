@@ -27,7 +27,10 @@ namespace rmw_zenoh_common_cpp
 class MessageTypeSupport : public TypeSupport
 {
 public:
-  explicit MessageTypeSupport(const message_type_support_callbacks_t * members);
+  explicit MessageTypeSupport(
+    const message_type_support_callbacks_t * members,
+    const rosidl_message_type_support_t * introspection = nullptr,
+    bool serialize_with_plan = true);
 };
 
 }  // namespace rmw_zenoh_common_cpp
@@ -25,17 +25,27 @@
 #include <fastcdr/Cdr.h>
 #include <cassert>
 #include <string>
+#include <vector>
 
 #include "rosidl_typesupport_zenoh_cpp/message_type_support.h"
 
 namespace rmw_zenoh_common_cpp
 {
 
+class SerializationPlan;
+
 class TypeSupport
 {
 public:
   size_t getEstimatedSerializedSize(const void * ros_message);
 
+  // Whether every message of the type serializes to at most getMaxSerializedSize() bytes
+  bool isBounded() const {return max_size_bound_;}
+
+  // Upper bound on the serialized size (including encapsulation) if the type is bounded.
+  // Otherwise this is only the size of the bounded part of the type.
+  size_t getMaxSerializedSize() const {return type_size_;}
+
   bool serializeROSmessage(
     const void * ros_message,
     eprosima::fastcdr::Cdr & ser,
@@ -46,13 +56,34 @@ public:
     void * ros_message,
     const void * impl) const;
 
+  // Whether messages of the type can be loaned out with views into the CDR buffer, in which case
+  // getPlan() gives their size, initialization and finalization
+  bool canLoanMessages() const;
+  const SerializationPlan * getPlan() const {return plan_;}
+
+  // Like deserializeROSmessage(), but with sequences of primitives left pointing into the CDR
+  // buffer where they can be (see SerializationPlan::deserialize_view())
+  bool deserializeLoanedROSmessage(
+    eprosima::fastcdr::Cdr & deser,
+    void * ros_message,
+    std::vector<void *> & views,
+    const void * impl) const;
+
 protected:
   TypeSupport();
 
-  void set_members(const message_type_support_callbacks_t * members);
+  // The introspection type support of the type (in the language of members), if given, is used
+  // to serialize with a SerializationPlan instead of the callbacks where possible, if
+  // serialize_with_plan is set. C messages can be loaned out with the plan either way.
+  void set_members(
+    const message_type_support_callbacks_t * members,
+    const rosidl_message_type_support_t * introspection = nullptr,
+    bool serialize_with_plan = true);
 
 private:
   const message_type_support_callbacks_t * members_;
+  const SerializationPlan * plan_;
+  bool serialize_with_plan_;
   bool has_data_;
   bool max_size_bound_;
 
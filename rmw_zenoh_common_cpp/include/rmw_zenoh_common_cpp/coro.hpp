@@ -0,0 +1,513 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// C++20 coroutine extension of rmw_zenoh_common_cpp, built into the rmw_zenoh_coro library with
+// the RMW_ZENOH_BUILD_COROUTINES CMake option.
+//
+// Service calls and subscriptions are awaited without a wait set: the awaiting coroutine is
+// suspended until the response or message is handed over on the Zenoh thread that received it,
+// and is then resumed on one of the threads running its Executor. Thousands of calls can be in
+// flight on a handful of threads, without any of them polling.
+//
+//   rmw_zenoh_common_cpp::coro::Task<> orchestrate(Client<example_interfaces::srv::AddTwoInts> & c)
+//   {
+//     auto response = co_await c.call(request);
+//     if (response.ret == RMW_RET_OK) {...}
+//   }
+//
+//   rmw_zenoh_common_cpp::coro::spawn(executor, orchestrate(client));
+//   executor.run();  // On as many threads as wanted
+
+#ifndef RMW_ZENOH_COMMON_CPP__CORO_HPP_
+#define RMW_ZENOH_COMMON_CPP__CORO_HPP_
+
+#if !defined(__cpp_impl_coroutine)
+#error "rmw_zenoh_common_cpp/coro.hpp needs C++20 coroutines"
+#endif
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "rmw/rmw.h"
+
+#include "rmw_zenoh_common_cpp/rmw_zenoh_common.h"
+#include "rmw_zenoh_common_cpp/rmw_zenoh_extensions.h"
+
+namespace rmw_zenoh_common_cpp
+{
+namespace coro
+{
+
+/// EXECUTOR ===================================================================
+// Queue of the coroutines ready to be resumed, run by any number of threads
+class Executor
+{
+public:
+  Executor();
+  ~Executor();
+
+  Executor(const Executor &) = delete;
+  Executor & operator=(const Executor &) = delete;
+
+  // Queue a coroutine to be resumed by one of the threads running the executor
+  void post(std::coroutine_handle<> handle);
+
+  // Resume the queued coroutines on the calling thread, until stop() is called
+  void run();
+
+  // Make run() return on every thread. Coroutines still queued are not resumed.
+  void stop();
+
+  // Awaitable that moves the awaiting coroutine to the threads running the executor
+  auto schedule()
+  {
+    struct Awaiter
+    {
+      Executor & executor;
+      bool await_ready() const noexcept {return false;}
+      void await_suspend(std::coroutine_handle<> handle) {executor.post(handle);}
+      void await_resume() const noexcept {}
+    };
+    return Awaiter{*this};
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable ready_condition_;
+  std::deque<std::coroutine_handle<>> ready_;
+  bool stopped_;
+};
+
+/// RESULT =====================================================================
+// Outcome of an awaited operation: the value is only meaningful if ret is RMW_RET_OK
+template<typename T>
+struct Result
+{
+  rmw_ret_t ret = RMW_RET_ERROR;
+  T value{};
+};
+
+/// TASK =======================================================================
+// Coroutine that starts when it is awaited, and resumes its awaiter when it returns.
+//
+// NOTE: Like the rest of rmw_zenoh_common_cpp, coroutines are not expected to throw; an exception
+// escaping one terminates the process.
+template<typename T = void>
+class Task;
+
+namespace detail
+{
+struct PromiseBase
+{
+  struct FinalAwaiter
+  {
+    bool await_ready() const noexcept {return false;}
+
+    template<typename PromiseT>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseT> handle) noexcept
+    {
+      std::coroutine_handle<> continuation = handle.promise().continuation;
+      return continuation ? continuation : std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept {return {};}
+  FinalAwaiter final_suspend() const noexcept {return {};}
+  void unhandled_exception() const noexcept {std::terminate();}
+
+  std::coroutine_handle<> continuation;
+};
+
+template<typename T>
+struct Promise : PromiseBase
+{
+  Task<T> get_return_object();
+  void return_value(T value) {result.emplace(std::move(value));}
+
+  std::optional<T> result;
+};
+
+template<>
+struct Promise<void>: PromiseBase
+{
+  Task<void> get_return_object();
+  void return_void() const noexcept {}
+};
+}  // namespace detail
+
+template<typename T>
+class Task
+{
+public:
+  using promise_type = detail::Promise<T>;
+
+  explicit Task(std::coroutine_handle<promise_type> handle)
+  : handle_(handle) {}
+
+  Task(Task && other) noexcept
+  : handle_(std::exchange(other.handle_, nullptr)) {}
+
+  Task & operator=(Task && other) noexcept
+  {
+    if (this != &other) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+
+  ~Task()
+  {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  bool await_ready() const noexcept {return !handle_ || handle_.done();}
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+  {
+    handle_.promise().continuation = awaiter;
+    return handle_;
+  }
+
+  T await_resume()
+  {
+    if constexpr (!std::is_void<T>::value) {
+      return std::move(*handle_.promise().result);
+    }
+  }
+
+private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail
+{
+template<typename T>
+Task<T> Promise<T>::get_return_object()
+{
+  return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object()
+{
+  return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+// Coroutine that runs on its own and frees itself when it returns
+struct Detached
+{
+  struct promise_type
+  {
+    Detached get_return_object() const noexcept {return {};}
+    std::suspend_never initial_suspend() const noexcept {return {};}
+    std::suspend_never final_suspend() const noexcept {return {};}
+    void return_void() const noexcept {}
+    void unhandled_exception() const noexcept {std::terminate();}
+  };
+};
+}  // namespace detail
+
+/// SPAWN ======================================================================
+// Run a task on the threads of an executor, without awaiting it
+inline detail::Detached spawn(Executor & executor, Task<> task)
+{
+  co_await executor.schedule();
+  co_await task;
+}
+
+/// CLIENT =====================================================================
+// Awaitable calls of a service, with the requests sent by a zenoh client (created as usual, with
+// the C++ type support of the service).
+//
+// The client's response callback is taken over (see rmw_zenoh_set_client_response_callback()),
+// and rmw_take_response must not be used on it, since the responses are taken as they arrive and
+// handed to the calls that are waiting for them. Calls still waiting when the Client is destroyed
+// complete with RMW_RET_ERROR, and calls of a Client whose callback could not be set complete
+// with status() right away.
+template<typename ServiceT>
+class Client
+{
+public:
+  using Request = typename ServiceT::Request;
+  using Response = typename ServiceT::Response;
+
+  Client(const rmw_client_t * client, Executor & executor)
+  : client_(client), executor_(executor)
+  {
+    status_ = rmw_zenoh_common_set_client_response_callback(
+      client_, &Client::on_response, this, client_ ? client_->implementation_identifier : nullptr);
+  }
+
+  ~Client()
+  {
+    if (status_ == RMW_RET_OK) {
+      rmw_zenoh_common_set_client_response_callback(
+        client_, nullptr, nullptr, client_->implementation_identifier);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::unordered_map<int64_t, CallAwaiter *> calls;
+    calls.swap(calls_);
+    lock.unlock();
+
+    for (auto & call : calls) {
+      call.second->result.ret = RMW_RET_ERROR;
+      executor_.post(call.second->handle);
+    }
+  }
+
+  Client(const Client &) = delete;
+  Client & operator=(const Client &) = delete;
+
+  struct CallAwaiter
+  {
+    Client & client;
+    const Request & request;
+    Result<Response> result;
+    std::coroutine_handle<> handle;
+
+    bool await_ready() const noexcept {return false;}
+
+    bool await_suspend(std::coroutine_handle<> awaiter)
+    {
+      handle = awaiter;
+      if (client.status_ != RMW_RET_OK) {
+        result.ret = client.status_;
+        return false;
+      }
+
+      int64_t sequence_id;
+      result.ret = rmw_zenoh_common_send_request(
+        client.client_, &request, &sequence_id, client.client_->implementation_identifier);
+      if (result.ret != RMW_RET_OK) {
+        return false;
+      }
+
+      // The response may have been taken before the call could be registered
+      std::lock_guard<std::mutex> lock(client.mutex_);
+      for (auto it = client.early_responses_.begin(); it != client.early_responses_.end(); ++it) {
+        if (it->first == sequence_id) {
+          result.value = std::move(it->second);
+          client.early_responses_.erase(it);
+          return false;
+        }
+      }
+      client.calls_.emplace(sequence_id, this);
+      return true;
+    }
+
+    Result<Response> await_resume() {return std::move(result);}
+  };
+
+  // Send a request, and complete with its response. The request must stay valid until the call
+  // completes (which it does, as a temporary of the co_await expression).
+  CallAwaiter call(const Request & request) {return CallAwaiter{*this, request, {}, {}};}
+
+  // Number of calls waiting for their response
+  size_t in_flight()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return calls_.size();
+  }
+
+  // RMW_RET_OK, or why the client's responses cannot be awaited
+  rmw_ret_t status() const {return status_;}
+
+private:
+  // Take the queued responses, on the thread that received them, and resume their calls
+  static void on_response(void * arg)
+  {
+    auto * self = static_cast<Client *>(arg);
+    while (true) {
+      Response response;
+      rmw_service_info_t info;
+      bool taken = false;
+      rmw_ret_t ret = rmw_zenoh_common_take_response(
+        self->client_, &info, &response, &taken, self->client_->implementation_identifier);
+      if (ret != RMW_RET_OK || !taken) {
+        return;
+      }
+
+      // Responses to the other clients of the service in the process are kept for a while too,
+      // and dropped once enough newer ones came
+      std::unique_lock<std::mutex> lock(self->mutex_);
+      auto it = self->calls_.find(info.request_id.sequence_number);
+      if (it == self->calls_.end()) {
+        self->early_responses_.emplace_back(info.request_id.sequence_number, std::move(response));
+        if (self->early_responses_.size() > kEarlyResponses) {
+          self->early_responses_.pop_front();
+        }
+        continue;
+      }
+      CallAwaiter * call = it->second;
+      self->calls_.erase(it);
+      lock.unlock();
+
+      call->result.ret = RMW_RET_OK;
+      call->result.value = std::move(response);
+      self->executor_.post(call->handle);
+    }
+  }
+
+  const rmw_client_t * client_;
+  Executor & executor_;
+  rmw_ret_t status_;
+
+  // Responses taken before their call was registered (it is only once the request is sent that
+  // its sequence number is known), newest last
+  static constexpr size_t kEarlyResponses = 64;
+
+  // Calls waiting for their response, by the sequence number of their request, and the responses
+  // that came before their call was registered
+  std::mutex mutex_;
+  std::unordered_map<int64_t, CallAwaiter *> calls_;
+  std::deque<std::pair<int64_t, Response>> early_responses_;
+};
+
+/// SUBSCRIPTION ===============================================================
+// Awaitable messages of a zenoh subscription (created as usual, with the C++ type support of the
+// message).
+//
+// The subscription's direct dispatch callback is taken over (see
+// rmw_zenoh_set_subscription_callback()), so rmw_take no longer sees its messages. Messages are
+// handed to the coroutines awaiting next() in the order they awaited it, and queued (up to depth
+// of them, dropping the oldest) while none is. Coroutines still awaiting when the Subscription is
+// destroyed complete with RMW_RET_ERROR.
+template<typename MessageT>
+class Subscription
+{
+public:
+  Subscription(const rmw_subscription_t * subscription, Executor & executor, size_t depth = 10)
+  : subscription_(subscription), executor_(executor), depth_(depth > 0 ? depth : 1)
+  {
+    status_ = rmw_zenoh_common_set_subscription_callback(
+      subscription_, &Subscription::on_message, &message_, this,
+      subscription_ ? subscription_->implementation_identifier : nullptr);
+  }
+
+  ~Subscription()
+  {
+    if (status_ == RMW_RET_OK) {
+      rmw_zenoh_common_set_subscription_callback(
+        subscription_, nullptr, nullptr, nullptr, subscription_->implementation_identifier);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::deque<NextAwaiter *> waiters;
+    waiters.swap(waiters_);
+    lock.unlock();
+
+    for (NextAwaiter * waiter : waiters) {
+      waiter->result.ret = RMW_RET_ERROR;
+      executor_.post(waiter->handle);
+    }
+  }
+
+  Subscription(const Subscription &) = delete;
+  Subscription & operator=(const Subscription &) = delete;
+
+  struct NextAwaiter
+  {
+    Subscription & subscription;
+    Result<MessageT> result;
+    std::coroutine_handle<> handle;
+
+    bool await_ready() const noexcept {return false;}
+
+    bool await_suspend(std::coroutine_handle<> awaiter)
+    {
+      handle = awaiter;
+
+      std::lock_guard<std::mutex> lock(subscription.mutex_);
+      if (subscription.status_ != RMW_RET_OK) {
+        result.ret = subscription.status_;
+        return false;
+      }
+      if (!subscription.messages_.empty()) {
+        result.ret = RMW_RET_OK;
+        result.value = std::move(subscription.messages_.front());
+        subscription.messages_.pop_front();
+        return false;
+      }
+      subscription.waiters_.push_back(this);
+      return true;
+    }
+
+    Result<MessageT> await_resume() {return std::move(result);}
+  };
+
+  // Complete with the next message of the subscription
+  NextAwaiter next() {return NextAwaiter{*this, {}, {}};}
+
+  // RMW_RET_OK, or why the subscription's messages cannot be awaited
+  rmw_ret_t status() const {return status_;}
+
+private:
+  // Hand the message deserialized into message_ over, on the thread that received it
+  static void on_message(const void *, void * arg)
+  {
+    auto * self = static_cast<Subscription *>(arg);
+
+    // The dispatcher deserializes the next message over whatever is left of this one
+    std::unique_lock<std::mutex> lock(self->mutex_);
+    if (self->waiters_.empty()) {
+      self->messages_.push_back(std::move(self->message_));
+      if (self->messages_.size() > self->depth_) {
+        self->messages_.pop_front();
+      }
+      return;
+    }
+
+    NextAwaiter * waiter = self->waiters_.front();
+    self->waiters_.pop_front();
+    lock.unlock();
+
+    waiter->result.ret = RMW_RET_OK;
+    waiter->result.value = std::move(self->message_);
+    self->executor_.post(waiter->handle);
+  }
+
+  const rmw_subscription_t * subscription_;
+  Executor & executor_;
+  size_t depth_;
+  rmw_ret_t status_;
+
+  // Storage the subscription's messages are deserialized into
+  MessageT message_;
+
+  // Messages no coroutine was waiting for, oldest first, and the coroutines waiting for one
+  std::mutex mutex_;
+  std::deque<MessageT> messages_;
+  std::deque<NextAwaiter *> waiters_;
+};
+
+}  // namespace coro
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // RMW_ZENOH_COMMON_CPP__CORO_HPP_
@@ -16,6 +16,14 @@
 #define RMW_ZENOH_COMMON_CPP__RMW_CONTEXT_IMPL_HPP_
 
 #ifdef __cplusplus
+namespace rmw_zenoh_common_cpp
+{
+class ReceiveBufferPool;
+class Config;
+class TokenBucket;
+class OverloadDetector;
+}  // namespace rmw_zenoh_common_cpp
+
 extern "C"
 {
 #endif
@@ -29,6 +37,19 @@ struct rmw_context_impl_t
 {
   zn_session_t * session;
   bool is_shutdown;
+
+  // Shared by every subscription, service and client of the context to hold received samples
+  rmw_zenoh_common_cpp::ReceiveBufferPool * rx_buffer_pool;
+
+  // Settings loaded from RMW_ZENOH_CONFIG_FILE (empty if it is not set)
+  rmw_zenoh_common_cpp::Config * config;
+
+  // Bandwidth limit shared by all the publishers of the context (nullptr if there is none)
+  rmw_zenoh_common_cpp::TokenBucket * session_bucket;
+
+  // Decides which samples to shed when the receive path is overloaded (nullptr if it is not
+  // watched)
+  rmw_zenoh_common_cpp::OverloadDetector * rx_overload;
 };
 
 #ifdef __cplusplus
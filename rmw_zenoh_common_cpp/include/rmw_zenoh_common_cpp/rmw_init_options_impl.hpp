@@ -19,6 +19,9 @@ struct rmw_init_options_impl_t
 {
   char * session_locator;  // Zenoh session TCP locator
   char * mode;  // Zenoh session mode
+  bool rx_pool_huge_pages;  // Back the largest receive buffer size classes with huge pages
+  bool serialization_plans;  // Serialize messages with SerializationPlans, not the callbacks
+  char * config_file;  // Path of the rmw_zenoh config file (nullptr if there is none)
 };
 
 #endif  // RMW_ZENOH_COMMON_CPP__RMW_INIT_OPTIONS_IMPL_HPP_
@@ -18,9 +18,17 @@
 #include "rmw/rmw.h"
 #include "rmw_zenoh_common_cpp/zenoh-net-interface.h"
 
+namespace rmw_zenoh_common_cpp
+{
+class EntityArena;
+}  // namespace rmw_zenoh_common_cpp
+
 struct rmw_node_impl_t
 {
   rmw_guard_condition_t * graph_guard_condition_;
+
+  // Holds the node, and the metadata of its publishers and subscriptions
+  rmw_zenoh_common_cpp::EntityArena * arena_;
 };
 
 #endif  // RMW_ZENOH_COMMON_CPP__RMW_NODE_IMPL_HPP_
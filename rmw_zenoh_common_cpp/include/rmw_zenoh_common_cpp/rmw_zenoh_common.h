@@ -22,11 +22,24 @@ extern "C"
 
 #include "rmw/event.h"
 
+#include "rmw_zenoh_common_cpp/rmw_zenoh_extensions.h"
+
 rmw_ret_t
 rmw_zenoh_common_init_pre(
   const rmw_init_options_t * options, rmw_context_t * context,
   const char * const eclipse_zenoh_identifier);
 
+rmw_ret_t
+rmw_zenoh_common_init_post(rmw_context_t * context, const char * const eclipse_zenoh_identifier);
+
+// The threads started by Zenoh between these two calls (on the same thread) are registered under
+// the given thread class, to be configured by rmw_zenoh_common_init_post
+void
+rmw_zenoh_common_threads_begin(void);
+
+void
+rmw_zenoh_common_threads_end(const char * thread_class);
+
 rmw_node_t *
 rmw_zenoh_common_create_node(
   rmw_context_t * context,
@@ -139,6 +152,30 @@ rmw_zenoh_common_take(
   rmw_subscription_allocation_t * allocation,
   const char * const eclipse_zenoh_identifier);
 
+rmw_ret_t
+rmw_zenoh_common_init_publisher_allocation(
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  rmw_publisher_allocation_t * allocation,
+  const char * const eclipse_zenoh_identifier);
+
+rmw_ret_t
+rmw_zenoh_common_fini_publisher_allocation(
+  rmw_publisher_allocation_t * allocation,
+  const char * const eclipse_zenoh_identifier);
+
+rmw_ret_t
+rmw_zenoh_common_init_subscription_allocation(
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  rmw_subscription_allocation_t * allocation,
+  const char * const eclipse_zenoh_identifier);
+
+rmw_ret_t
+rmw_zenoh_common_fini_subscription_allocation(
+  rmw_subscription_allocation_t * allocation,
+  const char * const eclipse_zenoh_identifier);
+
 rmw_ret_t
 rmw_zenoh_common_subscription_event_init(
   rmw_event_t * event,
@@ -155,13 +192,22 @@ rmw_zenoh_common_take_with_info(
   rmw_subscription_allocation_t * allocation,
   const char * const eclipse_zenoh_identifier);
 
+rmw_ret_t
+rmw_zenoh_common_take_loaned_message(
+  const rmw_subscription_t * subscription,
+  void ** loaned_message,
+  bool * taken,
+  rmw_subscription_allocation_t * allocation,
+  const char * const eclipse_zenoh_identifier);
+
 rmw_ret_t
 rmw_zenoh_common_take_loaned_message_with_info(
   const rmw_subscription_t * subscription,
   void ** loaned_message,
   bool * taken,
   rmw_message_info_t * message_info,
-  rmw_subscription_allocation_t * allocation);
+  rmw_subscription_allocation_t * allocation,
+  const char * const eclipse_zenoh_identifier);
 
 rmw_client_t *
 rmw_zenoh_common_create_client(
@@ -252,7 +298,78 @@ rmw_zenoh_common_destroy_client(
 rmw_ret_t
 rmw_zenoh_common_return_loaned_message_from_subscription(
   const rmw_subscription_t * subscription,
-  void * loaned_message);
+  void * loaned_message,
+  const char * const eclipse_zenoh_identifier);
+
+rmw_ret_t
+rmw_zenoh_common_create_subscriptions(
+  const rmw_node_t * node,
+  const rmw_zenoh_subscription_request_t * requests,
+  size_t count,
+  rmw_subscription_t ** subscriptions,
+  const char * const eclipse_zenoh_identifier);
+
+rmw_ret_t
+rmw_zenoh_common_create_publishers(
+  const rmw_node_t * node,
+  const rmw_zenoh_publisher_request_t * requests,
+  size_t count,
+  rmw_publisher_t ** publishers,
+  const char * const eclipse_zenoh_identifier);
+
+rmw_ret_t
+rmw_zenoh_common_get_publisher_shaping_stats(
+  const rmw_publisher_t * publisher,
+  rmw_zenoh_publisher_shaping_stats_t * stats,
+  const char * const eclipse_zenoh_identifier);
+
+rmw_ret_t
+rmw_zenoh_common_query_history(
+  const rmw_node_t * node,
+  const char * topic_name,
+  const rmw_zenoh_history_query_t * query,
+  rmw_time_t timeout,
+  rmw_zenoh_history_t * history,
+  const char * const eclipse_zenoh_identifier);
+
+rmw_ret_t
+rmw_zenoh_common_get_subscription_latency(
+  const rmw_subscription_t * subscription,
+  rmw_zenoh_subscription_latency_t * latency,
+  const char * const eclipse_zenoh_identifier);
+
+rmw_ret_t
+rmw_zenoh_common_get_subscription_losses(
+  const rmw_subscription_t * subscription,
+  rmw_zenoh_subscription_losses_t * losses,
+  const char * const eclipse_zenoh_identifier);
+
+rmw_ret_t
+rmw_zenoh_common_set_subscription_callback(
+  const rmw_subscription_t * subscription,
+  rmw_zenoh_subscription_callback_t callback,
+  void * ros_message,
+  void * user_data,
+  const char * const eclipse_zenoh_identifier);
+
+rmw_ret_t
+rmw_zenoh_common_set_client_response_callback(
+  const rmw_client_t * client,
+  rmw_zenoh_client_response_callback_t callback,
+  void * user_data,
+  const char * const eclipse_zenoh_identifier);
+
+rmw_ret_t
+rmw_zenoh_common_set_client_request_timeout(
+  const rmw_client_t * client,
+  rmw_time_t timeout,
+  const char * const eclipse_zenoh_identifier);
+
+rmw_ret_t
+rmw_zenoh_common_get_service_expired_requests(
+  const rmw_service_t * service,
+  uint64_t * count,
+  const char * const eclipse_zenoh_identifier);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,337 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Zenoh specific extensions to the rmw API.
+//
+// These are not part of rmw, so they can only be used by code that links against
+// rmw_zenoh_common_cpp directly. The ones that take an entity (a node, publisher, subscription,
+// client or service) are defined by rmw_zenoh_cpp and rmw_zenoh_pico_cpp, like the rmw API, and
+// return RMW_RET_INCORRECT_RMW_IMPLEMENTATION for entities created by another implementation.
+
+#ifndef RMW_ZENOH_COMMON_CPP__RMW_ZENOH_EXTENSIONS_H_
+#define RMW_ZENOH_COMMON_CPP__RMW_ZENOH_EXTENSIONS_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rmw/ret_types.h"
+#include "rmw/serialized_message.h"
+#include "rmw/types.h"
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+
+/// PAYLOAD CODECS =============================================================
+// A payload codec, to be selected per topic with `codec=<name>` in the RMW_ZENOH_CONFIG_FILE.
+//
+// The codec ID goes over the wire, so the codec must be registered under the same ID and name in
+// every process that publishes or subscribes to a topic using it. ID 0 means "no codec", and the
+// IDs below 16 are reserved for the codecs built into rmw_zenoh.
+typedef struct rmw_zenoh_codec_t
+{
+  uint8_t id;
+  const char * name;
+
+  // Upper bound on the encoded size of raw_length bytes
+  size_t (* max_encoded_size)(size_t raw_length, void * state);
+
+  // Upper bound on the decoded size of encoded_length bytes (received messages claiming more are
+  // dropped)
+  size_t (* max_decoded_size)(size_t encoded_length, void * state);
+
+  // Encode raw into out. Returns the encoded size, or 0 if it does not fit into out_capacity.
+  size_t (* encode)(
+    const uint8_t * raw, size_t raw_length, uint8_t * out, size_t out_capacity, void * state);
+
+  // Decode in into exactly raw_length bytes at raw. Returns false if the input is malformed.
+  bool (* decode)(
+    const uint8_t * in, size_t in_length, uint8_t * raw, size_t raw_length, void * state);
+
+  // Passed to every callback
+  void * state;
+} rmw_zenoh_codec_t;
+
+// Register a payload codec.
+//
+// Must be called before creating any publisher or subscription that uses the codec. The codec
+// struct is copied, but the name and state must outlive every context using the codec.
+rmw_ret_t
+rmw_zenoh_register_codec(const rmw_zenoh_codec_t * codec);
+
+/// BANDWIDTH SHAPING ==========================================================
+// What happens to messages published over a bandwidth limit
+typedef enum rmw_zenoh_rate_limit_mode_t
+{
+  // Drop the message (counted in rmw_zenoh_publisher_shaping_stats_t)
+  RMW_ZENOH_RATE_LIMIT_DROP,
+  // Delay the publishing thread until the message can be sent
+  RMW_ZENOH_RATE_LIMIT_BLOCK,
+} rmw_zenoh_rate_limit_mode_t;
+
+// Publisher options, which override the RMW_ZENOH_CONFIG_FILE settings of the publisher's topic
+// when passed as the rmw_specific_publisher_payload of its rmw_publisher_options_t.
+//
+// The struct is only read while the publisher is being created.
+typedef struct rmw_zenoh_publisher_options_t
+{
+  // Bandwidth limit of the publisher, in bytes per second (0 for no limit)
+  uint64_t rate_limit;
+
+  // Bytes the publisher can send in a burst (0 for one second worth of rate_limit)
+  uint64_t burst;
+
+  // Also applies to the session's bandwidth limit
+  rmw_zenoh_rate_limit_mode_t rate_limit_mode;
+} rmw_zenoh_publisher_options_t;
+
+typedef struct rmw_zenoh_publisher_shaping_stats_t
+{
+  // Messages dropped for going over the publisher's or the session's bandwidth limit
+  uint64_t dropped_messages;
+  uint64_t dropped_bytes;
+
+  // Messages the publishing thread was delayed for, and the total delay
+  uint64_t delayed_messages;
+  uint64_t delay_ns;
+} rmw_zenoh_publisher_shaping_stats_t;
+
+// Get the bandwidth shaping counters of a publisher (all zeros if it has no bandwidth limit)
+rmw_ret_t
+rmw_zenoh_get_publisher_shaping_stats(
+  const rmw_publisher_t * publisher,
+  rmw_zenoh_publisher_shaping_stats_t * stats);
+
+/// BATCH CREATION =============================================================
+// One subscription or publisher to create in a batch, with the arguments of
+// rmw_create_subscription or rmw_create_publisher
+typedef struct rmw_zenoh_subscription_request_t
+{
+  const rosidl_message_type_support_t * type_support;
+  const char * topic_name;
+  const rmw_qos_profile_t * qos_profile;
+  const rmw_subscription_options_t * subscription_options;
+} rmw_zenoh_subscription_request_t;
+
+typedef struct rmw_zenoh_publisher_request_t
+{
+  const rosidl_message_type_support_t * type_support;
+  const char * topic_name;
+  const rmw_qos_profile_t * qos_profile;
+  const rmw_publisher_options_t * publisher_options;
+} rmw_zenoh_publisher_request_t;
+
+// Create the subscriptions of a node in one pass, putting them in subscriptions (in the order of
+// the requests). Either all of them are created, or none: on failure, the ones already created
+// are destroyed and the error of the one that failed is kept.
+//
+// Their metadata is carved out of the node's arena one after the other, and subscriptions to the
+// same topic share a single Zenoh subscriber.
+rmw_ret_t
+rmw_zenoh_create_subscriptions(
+  const rmw_node_t * node,
+  const rmw_zenoh_subscription_request_t * requests,
+  size_t count,
+  rmw_subscription_t ** subscriptions);
+
+// Same as rmw_zenoh_create_subscriptions, for publishers
+rmw_ret_t
+rmw_zenoh_create_publishers(
+  const rmw_node_t * node,
+  const rmw_zenoh_publisher_request_t * requests,
+  size_t count,
+  rmw_publisher_t ** publishers);
+
+/// HISTORY QUERIES ============================================================
+// Samples to fetch from the history kept by the publishers of a topic (with `history=<n>` in the
+// RMW_ZENOH_CONFIG_FILE). Timestamps are nanoseconds since the epoch, and the range includes both
+// ends.
+typedef struct rmw_zenoh_history_query_t
+{
+  // Only the last n samples in the range (0 for all of them)
+  size_t last;
+
+  // Publication time range (0 for no lower or upper bound)
+  int64_t since;
+  int64_t until;
+} rmw_zenoh_history_query_t;
+
+typedef struct rmw_zenoh_history_sample_t
+{
+  // The message as published (CDR), to be deserialized with rmw_deserialize
+  rmw_serialized_message_t serialized_message;
+
+  // Publication timestamp, and sequence number of the sample at its publisher
+  int64_t timestamp;
+  uint64_t sequence;
+} rmw_zenoh_history_sample_t;
+
+typedef struct rmw_zenoh_history_t
+{
+  // Samples of every publisher of the topic, oldest first
+  rmw_zenoh_history_sample_t * samples;
+  size_t size;
+
+  rcutils_allocator_t allocator;
+} rmw_zenoh_history_t;
+
+rmw_zenoh_history_t
+rmw_zenoh_get_zero_initialized_history(void);
+
+// Fetch samples from the history of a topic, without subscribing to it.
+//
+// Waits up to timeout for the replies of the topic's publishers. If they are not all in by then,
+// RMW_RET_TIMEOUT is returned along with the samples received so far. The history is allocated
+// with the node's allocator, and must be finalized with rmw_zenoh_history_fini.
+rmw_ret_t
+rmw_zenoh_query_history(
+  const rmw_node_t * node,
+  const char * topic_name,
+  const rmw_zenoh_history_query_t * query,
+  rmw_time_t timeout,
+  rmw_zenoh_history_t * history);
+
+rmw_ret_t
+rmw_zenoh_history_fini(rmw_zenoh_history_t * history);
+
+/// LATENCY BUDGETS ============================================================
+// Latencies of the samples a subscription took, on a topic with a latency budget (with
+// `latency_budget=<ms>` in the RMW_ZENOH_CONFIG_FILE). Latencies are in nanoseconds, from the
+// publication of the samples to their take, and percentiles are within 1/16 of their value.
+typedef struct rmw_zenoh_subscription_latency_t
+{
+  // Budget of the 99th percentile, and the sliding window it is computed over
+  int64_t budget;
+  int64_t window;
+
+  // Samples taken in the window, and their latency percentiles (0 if there are none)
+  uint64_t count;
+  int64_t p50;
+  int64_t p90;
+  int64_t p99;
+
+  // Whether the 99th percentile is over the budget, and the number of times it went over it
+  bool breached;
+  uint64_t breaches;
+
+  // Samples taken over the budget, and the highest latency taken, since the subscription was
+  // created
+  uint64_t over_budget;
+  int64_t max;
+} rmw_zenoh_subscription_latency_t;
+
+// Get the latencies of a subscription. Returns RMW_RET_UNSUPPORTED if its topic has no latency
+// budget.
+//
+// Breaches of the budget are also reported through the RMW_EVENT_REQUESTED_DEADLINE_MISSED event
+// of the subscription.
+rmw_ret_t
+rmw_zenoh_get_subscription_latency(
+  const rmw_subscription_t * subscription,
+  rmw_zenoh_subscription_latency_t * latency);
+
+/// SUBSCRIPTION LOSSES ========================================================
+// Samples a subscription lost before they could be taken
+typedef struct rmw_zenoh_subscription_losses_t
+{
+  // Shed because the receive path was overloaded (see `rx_overload_delay`, `rx_overload_bytes`
+  // and the `priority` of topics in the RMW_ZENOH_CONFIG_FILE)
+  uint64_t shed;
+
+  // Pushed out of the subscription's full message queue by newer samples
+  uint64_t overflowed;
+} rmw_zenoh_subscription_losses_t;
+
+// Get the number of samples a subscription lost, since it was created
+rmw_ret_t
+rmw_zenoh_get_subscription_losses(
+  const rmw_subscription_t * subscription,
+  rmw_zenoh_subscription_losses_t * losses);
+
+/// DIRECT DISPATCH ============================================================
+// Samples of a subscription can be handed to a callback on the thread that receives them, instead
+// of being queued for rmw_take, to skip the wait set and the executor.
+//
+// While a callback is set:
+// - It is called on the Zenoh thread that received the sample, once the sample is decoded and
+//   matched to the subscription, so it should return quickly: the thread receives nothing else in
+//   the meantime.
+// - It is never called concurrently for the same subscription.
+// - The subscription's message queue, reorder window and readiness are bypassed, so rmw_take and
+//   rmw_wait see no samples.
+//
+// The message it is given is only valid during the call. It is either the caller's message,
+// deserialized into before every call, or (if no message is given) one whose sequences of
+// primitives are borrowed from the sample buffer, for subscriptions that can loan messages.
+//
+// A callback must not publish to a topic the subscription is on from the same session. Nor can it
+// set the callback of its own subscription or destroy it, since both wait for the call in
+// progress: they fail with RMW_RET_ERROR when called from the callback.
+typedef void (* rmw_zenoh_subscription_callback_t)(const void * ros_message, void * user_data);
+
+// Set the callback of a subscription, with the message to deserialize into (NULL to borrow one)
+// and the argument to pass to it. A NULL callback goes back to queueing samples.
+//
+// Once this returns, the previous callback is not running and is not called again. Samples
+// already queued stay in the queue.
+//
+// Returns RMW_RET_UNSUPPORTED if no message is given and the subscription cannot loan messages,
+// and RMW_RET_ERROR if called from the subscription's callback.
+rmw_ret_t
+rmw_zenoh_set_subscription_callback(
+  const rmw_subscription_t * subscription,
+  rmw_zenoh_subscription_callback_t callback,
+  void * ros_message,
+  void * user_data);
+
+/// RESPONSE NOTIFICATION ======================================================
+// A client can have a callback called whenever a response is queued for it, on the Zenoh thread
+// that received it, to take responses without waiting on a wait set. The callback may take the
+// response with rmw_take_response, but must not set the callback of any client, nor create or
+// destroy clients. Responses to the requests of other clients of the service in the process are
+// queued (and notified) too, as they are for rmw_take_response.
+typedef void (* rmw_zenoh_client_response_callback_t)(void * user_data);
+
+// Set the response callback of a client (NULL for none). Once this returns, the previous callback
+// is not running and is not called again.
+rmw_ret_t
+rmw_zenoh_set_client_response_callback(
+  const rmw_client_t * client,
+  rmw_zenoh_client_response_callback_t callback,
+  void * user_data);
+
+/// REQUEST DEADLINES ==========================================================
+// Requests sent by a client can carry a deadline, after which servers discard them without
+// handling them. The deadline is the time the request is sent plus the client's request timeout,
+// which defaults to the `request_timeout=<ms>` of the service in the RMW_ZENOH_CONFIG_FILE.
+// Deadlines are checked against the server's clock, so the clocks of the hosts must be in sync.
+
+// Set the request timeout of a client, for the requests it sends from now on (zero for no
+// deadline, as are timeouts too long to be added to the current time like RMW_DURATION_INFINITE)
+rmw_ret_t
+rmw_zenoh_set_client_request_timeout(const rmw_client_t * client, rmw_time_t timeout);
+
+// Get the number of requests a service server discarded for being past their deadline
+rmw_ret_t
+rmw_zenoh_get_service_expired_requests(const rmw_service_t * service, uint64_t * count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RMW_ZENOH_COMMON_CPP__RMW_ZENOH_EXTENSIONS_H_
@@ -0,0 +1,195 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RMW_ZENOH_COMMON_CPP__TRACE_FORMAT_HPP_
+#define RMW_ZENOH_COMMON_CPP__TRACE_FORMAT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// TRACE FORMAT ===============================================================
+// Calls to the rmw entry points, recorded to the file named by RMW_ZENOH_TRACE_FILE.
+//
+// File layout (host byte order):
+//   0: magic "RZTR"
+//   4: format version (uint16)
+//   6: reserved (uint16, 0)
+//   8: start of the trace (int64, nanoseconds since the epoch)
+// then one record per call:
+//   0: event (uint8, TraceEvent)
+//   1: ID of the entity, numbered from 1 in order of creation (uint32)
+//   5: time of the call (int64, nanoseconds since the start of the trace, on the steady clock)
+//  13: value (uint64, see TraceEvent)
+// and for the creation events only, the name of the entity:
+//  21: length of the name (uint16)
+//  23: name (not terminated)
+enum class TraceEvent : uint8_t
+{
+  // Value: ID of the node of the entity (0 for nodes). Name: fully qualified name of the node, or
+  // the name of the topic or service.
+  kCreateNode = 1,
+  kCreatePublisher = 2,
+  kCreateSubscription = 3,
+  kCreateClient = 4,
+  kCreateService = 5,
+
+  // Value: 0
+  kDestroyNode = 6,
+  kDestroyPublisher = 7,
+  kDestroySubscription = 8,
+  kDestroyClient = 9,
+  kDestroyService = 10,
+
+  // Value: size of the serialized message, request or response. Takes are only recorded if they
+  // took something.
+  kPublish = 11,
+  kTake = 12,
+  kSendRequest = 13,
+  kTakeRequest = 14,
+  kSendResponse = 15,
+  kTakeResponse = 16,
+
+  // Entity: 0 (wait sets are not numbered). Value: nanoseconds the call blocked for. Recorded when
+  // the call returns, with the time it was made at.
+  kWait = 17
+};
+
+constexpr char kTraceMagic[4] = {'R', 'Z', 'T', 'R'};
+constexpr uint16_t kTraceVersion = 1;
+constexpr size_t kTraceHeaderSize = 16;
+constexpr size_t kTraceRecordSize = 21;
+
+inline bool trace_event_creates(TraceEvent event)
+{
+  return event >= TraceEvent::kCreateNode && event <= TraceEvent::kCreateService;
+}
+
+struct TraceRecord
+{
+  TraceEvent event;
+  uint32_t entity;
+  int64_t time;
+  uint64_t value;
+  std::string name;
+};
+
+/// TRACE READER ===============================================================
+// Reads the records of a trace back, in the order they were recorded. That is the order of their
+// times, except for waits, which are recorded when they return with the time they started at.
+class TraceReader
+{
+public:
+  TraceReader()
+  : file_(nullptr), start_(0), records_(0) {}
+
+  ~TraceReader()
+  {
+    if (file_) {
+      fclose(file_);
+    }
+  }
+
+  TraceReader(const TraceReader &) = delete;
+  TraceReader & operator=(const TraceReader &) = delete;
+
+  // Returns false, with the reason in error, if the file cannot be read as a trace
+  bool open(const char * path, std::string & error)
+  {
+    path_ = path;
+    file_ = fopen(path, "rb");
+    if (!file_) {
+      error = std::string("cannot open ") + path;
+      return false;
+    }
+
+    unsigned char header[kTraceHeaderSize];
+    uint16_t version;
+    if (fread(header, 1, sizeof(header), file_) != sizeof(header) ||
+      memcmp(header, kTraceMagic, sizeof(kTraceMagic)) != 0)
+    {
+      error = std::string(path) + " is not an rmw_zenoh trace";
+      return false;
+    }
+    memcpy(&version, header + 4, sizeof(version));
+    if (version != kTraceVersion) {
+      error = std::string(path) + " is a trace of version " + std::to_string(version) +
+        " instead of " + std::to_string(kTraceVersion);
+      return false;
+    }
+    memcpy(&start_, header + 8, sizeof(start_));
+    return true;
+  }
+
+  // Read the next record. Returns false at the end of the trace, with the reason in error if the
+  // trace ends in the middle of a record (left empty at the end of the last one).
+  bool next(TraceRecord & record, std::string & error)
+  {
+    error.clear();
+    unsigned char bytes[kTraceRecordSize];
+    size_t read = fread(bytes, 1, sizeof(bytes), file_);
+    if (read != sizeof(bytes)) {
+      if (read > 0) {
+        error = truncated(read);
+      }
+      return false;
+    }
+    record.event = static_cast<TraceEvent>(bytes[0]);
+    memcpy(&record.entity, bytes + 1, sizeof(record.entity));
+    memcpy(&record.time, bytes + 5, sizeof(record.time));
+    memcpy(&record.value, bytes + 13, sizeof(record.value));
+
+    record.name.clear();
+    if (trace_event_creates(record.event)) {
+      uint16_t length;
+      read = fread(&length, 1, sizeof(length), file_);
+      if (read != sizeof(length)) {
+        error = truncated(sizeof(bytes) + read);
+        return false;
+      }
+      record.name.resize(length);
+      read = length > 0 ? fread(&record.name[0], 1, length, file_) : 0;
+      if (read != length) {
+        error = truncated(sizeof(bytes) + sizeof(length) + read);
+        return false;
+      }
+    }
+    ++records_;
+    return true;
+  }
+
+  // Start of the trace, in nanoseconds since the epoch
+  int64_t start() const {return start_;}
+
+private:
+  std::string truncated(size_t read) const
+  {
+    return path_ + " is truncated: record " + std::to_string(records_ + 1) + " ends after " +
+           std::to_string(read) + " bytes";
+  }
+
+  std::string path_;
+  FILE * file_;
+  int64_t start_;
+  size_t records_;  // Read so far
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // RMW_ZENOH_COMMON_CPP__TRACE_FORMAT_HPP_
@@ -0,0 +1,71 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rmw_zenoh_common_cpp/coro.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+namespace coro
+{
+
+Executor::Executor()
+: stopped_(false)
+{}
+
+Executor::~Executor()
+{
+  stop();
+}
+
+/// POST =======================================================================
+void Executor::post(std::coroutine_handle<> handle)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_.push_back(handle);
+  }
+  ready_condition_.notify_one();
+}
+
+/// RUN ========================================================================
+void Executor::run()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    ready_condition_.wait(lock, [this] {return stopped_ || !ready_.empty();});
+    if (stopped_) {
+      return;
+    }
+
+    std::coroutine_handle<> handle = ready_.front();
+    ready_.pop_front();
+
+    lock.unlock();
+    handle.resume();
+    lock.lock();
+  }
+}
+
+/// STOP =======================================================================
+void Executor::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  ready_condition_.notify_all();
+}
+
+}  // namespace coro
+}  // namespace rmw_zenoh_common_cpp
@@ -28,6 +28,8 @@
 #include "rmw/rmw.h"
 #include "rmw_zenoh_common_cpp/TypeSupport.hpp"
 
+#include "receive_buffer_pool.hpp"
+
 extern "C"
 {
 #include "rmw_zenoh_common_cpp/zenoh-net-interface.h"
@@ -59,6 +61,11 @@ struct rmw_client_data_t
     zn_queryable_to_client_data;
   // *INDENT-ON*
 
+  /// INSTANCE MEMBERS =========================================================
+  // Set the function called after a response is queued (nullptr for none). Once this returns, the
+  // previous function is not running and is not called again.
+  void set_response_callback(void (* callback)(void *), void * arg);
+
   /// TYPE SUPPORT =============================================================
   const void * request_type_support_impl_;
   const void * response_type_support_impl_;
@@ -78,11 +85,14 @@ struct rmw_client_data_t
   const char * zn_request_topic_key_;
   size_t zn_request_topic_id_;
 
+  // Availability queryable (see rmw_zenoh_common_create_client)
+  zn_queryable_t * zn_availability_queryable_;
+
   /// ROS ======================================================================
   const rmw_node_t * node_;
 
   // Instanced response message queue
-  std::deque<std::shared_ptr<std::vector<unsigned char>>> zn_response_message_queue_;
+  std::deque<rmw_zenoh_common_cpp::ReceiveBufferPtr> zn_response_message_queue_;
   std::mutex response_queue_mutex_;
 
   // Instanced availability query Zenoh responses
@@ -91,6 +101,14 @@ struct rmw_client_data_t
 
   size_t client_id_;
   size_t queue_depth_;
+
+  // Requests are given a deadline this many nanoseconds after they are sent (0 for none)
+  std::atomic<int64_t> request_timeout_;
+
+  // Called with its argument after a response is queued, on the thread that received it (nullptr
+  // for none). Guarded by the mutex of the response callback.
+  void (* response_callback_)(void *);
+  void * response_callback_arg_;
 };
 
 #endif  // IMPL__CLIENT_IMPL_HPP_
@@ -0,0 +1,406 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "codec.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "rcutils/logging_macros.h"
+
+namespace rmw_zenoh_common_cpp
+{
+
+namespace
+{
+/// LZ CODEC ===================================================================
+// Byte oriented LZ77 codec, using the LZ4 block format.
+//
+// Every sequence is a token byte (literal length in the high nibble, match length - 4 in the low
+// nibble, with 15 meaning "more length bytes follow"), the literals, and a 16 bit little endian
+// match offset. The last sequence only has literals. Matches are found with a single probe into a
+// small hash table of 4 byte prefixes, which trades some ratio for speed.
+class LzCodec : public Codec
+{
+public:
+  uint8_t id() const override {return kCodecLz;}
+  const char * name() const override {return "lz";}
+
+  size_t max_encoded_size(size_t raw_length) const override
+  {
+    return raw_length + raw_length / 255 + 16;
+  }
+
+  // Every input byte adds at most 255 bytes of output (a match length byte)
+  size_t max_decoded_size(size_t encoded_length) const override
+  {
+    return encoded_length * 255;
+  }
+
+  size_t encode(
+    const unsigned char * raw, size_t raw_length,
+    unsigned char * out, size_t out_capacity) const override;
+
+  bool decode(
+    const unsigned char * in, size_t in_length,
+    unsigned char * raw, size_t raw_length) const override;
+
+private:
+  static constexpr size_t kMinMatch = 4;
+  static constexpr size_t kMaxOffset = 65535;
+  static constexpr int kHashLog = 12;
+
+  // The format wants the last match to start at least 12 bytes before the end of the input,
+  // and the last 5 bytes to always be literals
+  static constexpr size_t kMatchSearchLimit = 12;
+  static constexpr size_t kLastLiterals = 5;
+
+  static uint32_t read32(const unsigned char * p)
+  {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+  }
+
+  static uint32_t hash(uint32_t sequence)
+  {
+    return (sequence * 2654435761U) >> (32 - kHashLog);
+  }
+
+  // Append a length continuation (for lengths of 15 or more) to out
+  static unsigned char * write_length(unsigned char * op, size_t length)
+  {
+    for (; length >= 255; length -= 255) {
+      *op++ = 255;
+    }
+    *op++ = static_cast<unsigned char>(length);
+    return op;
+  }
+};
+
+size_t LzCodec::encode(
+  const unsigned char * raw, size_t raw_length,
+  unsigned char * out, size_t out_capacity) const
+{
+  unsigned char * op = out;
+  unsigned char * const op_end = out + out_capacity;
+
+  size_t anchor = 0;
+
+  if (raw_length > kMatchSearchLimit) {
+    uint32_t table[1 << kHashLog] = {};
+
+    const size_t search_limit = raw_length - kMatchSearchLimit;
+    const size_t match_limit = raw_length - kLastLiterals;
+
+    size_t ip = 0;
+    while (ip < search_limit) {
+      uint32_t sequence = read32(raw + ip);
+      uint32_t h = hash(sequence);
+      size_t ref = table[h];
+      table[h] = static_cast<uint32_t>(ip);
+
+      if (ref >= ip || ip - ref > kMaxOffset || read32(raw + ref) != sequence) {
+        // Skip faster through data that does not seem to compress
+        ip += 1 + ((ip - anchor) >> 6);
+        continue;
+      }
+
+      // Extend the match backwards over the pending literals, then forwards
+      while (ip > anchor && ref > 0 && raw[ip - 1] == raw[ref - 1]) {
+        --ip;
+        --ref;
+      }
+      size_t match_length = kMinMatch;
+      while (ip + match_length < match_limit && raw[ip + match_length] == raw[ref + match_length]) {
+        ++match_length;
+      }
+
+      // Emit the sequence, if it fits (token, literal length, literals, offset, match length)
+      size_t literal_length = ip - anchor;
+      if (static_cast<size_t>(op_end - op) <
+        1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1)
+      {
+        return 0;
+      }
+
+      size_t match_code = match_length - kMinMatch;
+      unsigned char * token = op++;
+      *token = static_cast<unsigned char>(
+        (std::min<size_t>(literal_length, 15) << 4) | std::min<size_t>(match_code, 15));
+      if (literal_length >= 15) {
+        op = write_length(op, literal_length - 15);
+      }
+      memcpy(op, raw + anchor, literal_length);
+      op += literal_length;
+
+      size_t offset = ip - ref;
+      *op++ = static_cast<unsigned char>(offset);
+      *op++ = static_cast<unsigned char>(offset >> 8);
+      if (match_code >= 15) {
+        op = write_length(op, match_code - 15);
+      }
+
+      ip += match_length;
+      anchor = ip;
+    }
+  }
+
+  // Last literals
+  size_t literal_length = raw_length - anchor;
+  if (static_cast<size_t>(op_end - op) < 1 + literal_length / 255 + 1 + literal_length) {
+    return 0;
+  }
+  *op++ = static_cast<unsigned char>(std::min<size_t>(literal_length, 15) << 4);
+  if (literal_length >= 15) {
+    op = write_length(op, literal_length - 15);
+  }
+  memcpy(op, raw + anchor, literal_length);
+  op += literal_length;
+
+  return static_cast<size_t>(op - out);
+}
+
+bool LzCodec::decode(
+  const unsigned char * in, size_t in_length,
+  unsigned char * raw, size_t raw_length) const
+{
+  size_t ip = 0;
+  size_t op = 0;
+
+  // Read a length continuation, failing on truncated input
+  auto read_length = [&](size_t & length) {
+      unsigned char byte;
+      do {
+        if (ip >= in_length) {
+          return false;
+        }
+        byte = in[ip++];
+        length += byte;
+      } while (byte == 255);
+      return true;
+    };
+
+  while (ip < in_length) {
+    unsigned char token = in[ip++];
+
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !read_length(literal_length)) {
+      return false;
+    }
+    if (literal_length > in_length - ip || literal_length > raw_length - op) {
+      return false;
+    }
+    memcpy(raw + op, in + ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+
+    if (ip == in_length) {
+      break;  // Last sequence
+    }
+
+    if (in_length - ip < 2) {
+      return false;
+    }
+    size_t offset = in[ip] | (in[ip + 1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > op) {
+      return false;
+    }
+
+    size_t match_length = token & 15;
+    if (match_length == 15 && !read_length(match_length)) {
+      return false;
+    }
+    match_length += kMinMatch;
+    if (match_length > raw_length - op) {
+      return false;
+    }
+
+    // Matches may overlap with their own output (runs), in which case they are copied bytewise
+    const unsigned char * match = raw + op - offset;
+    if (offset >= match_length) {
+      memcpy(raw + op, match, match_length);
+    } else {
+      for (size_t i = 0; i < match_length; ++i) {
+        raw[op + i] = match[i];
+      }
+    }
+    op += match_length;
+  }
+
+  return op == raw_length;
+}
+
+constexpr size_t LzCodec::kMinMatch;
+constexpr size_t LzCodec::kMaxOffset;
+constexpr int LzCodec::kHashLog;
+constexpr size_t LzCodec::kMatchSearchLimit;
+constexpr size_t LzCodec::kLastLiterals;
+
+/// REGISTRY ===================================================================
+// Codecs are looked up by ID for every received sample, so the table is read without locking
+struct CodecRegistry
+{
+  CodecRegistry()
+  {
+    static LzCodec lz_codec;
+    codecs[kCodecLz].store(&lz_codec);
+  }
+
+  std::mutex mutex;  // Serializes registrations
+  std::atomic<const Codec *> codecs[256] = {};
+};
+
+CodecRegistry & registry()
+{
+  static CodecRegistry registry;
+  return registry;
+}
+}  // namespace
+
+const Codec * find_codec(uint8_t id)
+{
+  return registry().codecs[id].load(std::memory_order_acquire);
+}
+
+const Codec * find_codec(const std::string & name)
+{
+  CodecRegistry & reg = registry();
+  for (auto & entry : reg.codecs) {
+    const Codec * codec = entry.load(std::memory_order_acquire);
+    if (codec && name == codec->name()) {
+      return codec;
+    }
+  }
+  return nullptr;
+}
+
+bool register_codec(const Codec * codec)
+{
+  CodecRegistry & reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+
+  if (codec->id() == kCodecNone || find_codec(codec->id()) || find_codec(codec->name())) {
+    return false;
+  }
+  reg.codecs[codec->id()].store(codec, std::memory_order_release);
+  return true;
+}
+
+/// PAYLOAD ENCODER ============================================================
+constexpr size_t PayloadEncoder::kMaxBypass;
+
+PayloadEncoder::PayloadEncoder(const Codec * codec, size_t min_size, double max_ratio)
+: codec_(codec),
+  min_size_(min_size),
+  max_ratio_(max_ratio),
+  bypass_left_(0),
+  next_bypass_(1)
+{}
+
+size_t PayloadEncoder::encode(const unsigned char * raw, size_t raw_length, size_t header_room)
+{
+  if (raw_length == 0 || raw_length < min_size_) {
+    return 0;
+  }
+
+  if (bypass_left_ > 0) {
+    --bypass_left_;
+    return 0;
+  }
+
+  // Anything that does not beat the ratio is not worth sending encoded, so it does not need to fit
+  size_t max_length = static_cast<size_t>(static_cast<double>(raw_length) * max_ratio_);
+  size_t capacity = std::min(max_length, codec_->max_encoded_size(raw_length));
+
+  if (buffer_.size() < header_room + capacity) {
+    buffer_.resize(header_room + capacity);
+  }
+
+  size_t encoded_length = codec_->encode(raw, raw_length, buffer_.data() + header_room, capacity);
+  if (encoded_length == 0 || encoded_length > max_length) {
+    bypass_left_ = next_bypass_;
+    next_bypass_ = std::min(next_bypass_ * 2, kMaxBypass);
+    return 0;
+  }
+
+  next_bypass_ = 1;
+  return encoded_length;
+}
+
+/// DECODE SAMPLE ==============================================================
+ReceiveBufferPtr decode_sample(
+  const unsigned char * sample, size_t length, ReceiveBufferPool & pool, const char * topic,
+  SampleHeader & header)
+{
+  size_t header_size;
+  if (!read_sample_header(sample, length, header, header_size)) {
+    RCUTILS_LOG_ERROR_NAMED(
+      "rmw_zenoh_common_cpp",
+      "Dropping message with a missing or incompatible sample header for %s", topic);
+    return ReceiveBufferPtr();
+  }
+
+  const unsigned char * payload = sample + header_size;
+  size_t payload_length = length - header_size;
+
+  const Codec * codec = nullptr;
+  if (header.codec != kCodecNone) {
+    codec = find_codec(header.codec);
+    if (!codec) {
+      RCUTILS_LOG_ERROR_NAMED(
+        "rmw_zenoh_common_cpp",
+        "Dropping message encoded with unknown codec %u for %s", header.codec, topic);
+      return ReceiveBufferPtr();
+    }
+  } else if (payload_length != header.raw_length) {
+    RCUTILS_LOG_ERROR_NAMED(
+      "rmw_zenoh_common_cpp", "Dropping truncated message for %s", topic);
+    return ReceiveBufferPtr();
+  }
+
+  // The raw length comes off the wire, so it is only trusted as far as the payload can back it
+  if (codec && header.raw_length > codec->max_decoded_size(payload_length)) {
+    RCUTILS_LOG_ERROR_NAMED(
+      "rmw_zenoh_common_cpp",
+      "Dropping message of %zu bytes claiming to decode to %u bytes with codec %s for %s",
+      payload_length, header.raw_length, codec->name(), topic);
+    return ReceiveBufferPtr();
+  }
+
+  ReceiveBufferPtr buffer = pool.acquire(header.raw_length);
+  if (!buffer) {
+    RCUTILS_LOG_ERROR_NAMED(
+      "rmw_zenoh_common_cpp",
+      "Could not get a receive buffer of %u bytes, dropping message for %s",
+      header.raw_length,
+      topic);
+    return ReceiveBufferPtr();
+  }
+
+  if (!codec) {
+    memcpy(buffer->data(), payload, payload_length);
+  } else if (!codec->decode(payload, payload_length, buffer->data(), header.raw_length)) {
+    RCUTILS_LOG_ERROR_NAMED(
+      "rmw_zenoh_common_cpp",
+      "Dropping message that could not be decoded with codec %s for %s", codec->name(), topic);
+    return ReceiveBufferPtr();
+  }
+
+  return buffer;
+}
+
+}  // namespace rmw_zenoh_common_cpp
@@ -0,0 +1,123 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__CODEC_HPP_
+#define IMPL__CODEC_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "receive_buffer_pool.hpp"
+#include "sample_header.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+
+constexpr uint8_t kCodecNone = 0;
+constexpr uint8_t kCodecLz = 1;
+
+// IDs below this are reserved for the built-in codecs
+constexpr uint8_t kFirstUserCodecId = 16;
+
+/// CODEC ======================================================================
+// A payload codec. Implementations must be stateless (or internally synchronized), since one
+// instance is shared by every publisher and subscription in the process.
+class Codec
+{
+public:
+  virtual ~Codec() = default;
+
+  virtual uint8_t id() const = 0;
+  virtual const char * name() const = 0;
+
+  // Upper bound on the encoded size of raw_length bytes
+  virtual size_t max_encoded_size(size_t raw_length) const = 0;
+
+  // Upper bound on the decoded size of encoded_length bytes. Received samples claiming to decode
+  // to more are dropped before any buffer is acquired for them.
+  virtual size_t max_decoded_size(size_t encoded_length) const = 0;
+
+  // Encode raw into out. Returns the encoded size, or 0 if it does not fit into out_capacity.
+  virtual size_t encode(
+    const unsigned char * raw, size_t raw_length,
+    unsigned char * out, size_t out_capacity) const = 0;
+
+  // Decode in into exactly raw_length bytes at raw. Returns false if the input is malformed.
+  virtual bool decode(
+    const unsigned char * in, size_t in_length,
+    unsigned char * raw, size_t raw_length) const = 0;
+};
+
+/// CODEC REGISTRY =============================================================
+// Look up a codec. Returns nullptr if no codec is registered under the ID or name.
+const Codec * find_codec(uint8_t id);
+const Codec * find_codec(const std::string & name);
+
+// Register a codec for the lifetime of the process. Fails if its ID or name is already taken.
+bool register_codec(const Codec * codec);
+
+/// PAYLOAD ENCODER ============================================================
+// Per-publisher encoding stage in front of zn_write.
+//
+// Samples smaller than the minimum size are sent as is. So are samples that did not compress to
+// at most max_ratio of their size: after such a sample, compression is skipped for a number of
+// samples that doubles every time it fails again (up to kMaxBypass), so topics carrying data that
+// does not compress do not pay for trying on every sample.
+class PayloadEncoder
+{
+public:
+  static constexpr size_t kMaxBypass = 1024;
+
+  PayloadEncoder(const Codec * codec, size_t min_size, double max_ratio);
+
+  const Codec * codec() const {return codec_;}
+
+  // Held by the publisher while it encodes and writes a sample, since it uses buffer()
+  std::mutex & mutex() {return mutex_;}
+
+  // Encode raw into buffer(), after header_room bytes left free for the caller.
+  // Returns the encoded size, or 0 if the sample should be sent without encoding.
+  size_t encode(const unsigned char * raw, size_t raw_length, size_t header_room);
+
+  unsigned char * buffer() {return buffer_.data();}
+
+private:
+  const Codec * codec_;
+  size_t min_size_;
+  double max_ratio_;
+
+  // Samples left to send without trying to encode them, and the bypass after the next failure
+  size_t bypass_left_;
+  size_t next_bypass_;
+
+  std::mutex mutex_;
+  std::vector<unsigned char> buffer_;
+};
+
+/// DECODE SAMPLE ==============================================================
+// Strip the sample header off a received sample (into header) and decode its payload into a
+// pooled buffer. For delta samples the payload is the delta, which is applied by DeltaStreams.
+//
+// Returns an empty pointer (after logging why) if the sample is malformed, uses an unknown codec,
+// or no buffer could be acquired.
+ReceiveBufferPtr decode_sample(
+  const unsigned char * sample, size_t length, ReceiveBufferPool & pool, const char * topic,
+  SampleHeader & header);
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__CODEC_HPP_
@@ -0,0 +1,372 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "config.hpp"
+
+#include <sched.h>
+
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace rmw_zenoh_common_cpp
+{
+
+namespace
+{
+bool parse_uint64(const std::string & value, uint64_t & out)
+{
+  if (value.empty() || value[0] == '-') {
+    return false;
+  }
+  char * end = nullptr;
+  errno = 0;
+  unsigned long long parsed = strtoull(value.c_str(), &end, 10);  // NOLINT(runtime/int)
+  if (errno != 0 || *end != '\0') {
+    return false;
+  }
+  out = static_cast<uint64_t>(parsed);
+  return true;
+}
+
+bool parse_size(const std::string & value, size_t & out)
+{
+  uint64_t parsed;
+  if (!parse_uint64(value, parsed)) {
+    return false;
+  }
+  out = static_cast<size_t>(parsed);
+  return true;
+}
+
+bool parse_bool(const std::string & value, bool & out)
+{
+  if (value == "true") {
+    out = true;
+  } else if (value == "false") {
+    out = false;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool parse_int(const std::string & value, int & out)
+{
+  if (value.empty()) {
+    return false;
+  }
+  char * end = nullptr;
+  errno = 0;
+  long parsed = strtol(value.c_str(), &end, 10);  // NOLINT(runtime/int)
+  if (errno != 0 || *end != '\0' || parsed < INT_MIN || parsed > INT_MAX) {
+    return false;
+  }
+  out = static_cast<int>(parsed);
+  return true;
+}
+
+// Comma separated CPU numbers and ranges, like "0,2-3" (below CPU_SETSIZE)
+bool parse_cpus(const std::string & value, std::vector<int> & out)
+{
+  out.clear();
+  if (!value.empty() && value.back() == ',') {
+    // getline() does not return the empty item after a trailing comma
+    return false;
+  }
+  std::istringstream items(value);
+  std::string item;
+  while (std::getline(items, item, ',')) {
+    size_t dash = item.find('-', 1);
+    int first;
+    int last;
+    if (!parse_int(item.substr(0, dash), first) ||
+      !parse_int(dash == std::string::npos ? item : item.substr(dash + 1), last) ||
+      first < 0 || last < first || last >= CPU_SETSIZE)
+    {
+      return false;
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      out.push_back(cpu);
+    }
+  }
+  return !out.empty();
+}
+
+bool parse_double(const std::string & value, double & out)
+{
+  if (value.empty()) {
+    return false;
+  }
+  char * end = nullptr;
+  errno = 0;
+  out = strtod(value.c_str(), &end);
+  return errno == 0 && *end == '\0' && std::isfinite(out);
+}
+
+// Check the priority of a class of threads against the range of its scheduling policy (1 to 99
+// for fifo and rr on Linux, only 0 for other). Without a policy, the priority is not used.
+bool check_priority(const ThreadConfig & config, std::string & what)
+{
+  if (config.policy.empty()) {
+    if (config.priority != 0) {
+      what = "priority " + std::to_string(config.priority) + " without a policy";
+      return false;
+    }
+    return true;
+  }
+  int policy = config.policy == "fifo" ? SCHED_FIFO :
+    config.policy == "rr" ? SCHED_RR : SCHED_OTHER;
+  int min = sched_get_priority_min(policy);
+  int max = sched_get_priority_max(policy);
+  if (config.priority < min || config.priority > max) {
+    what = "priority " + std::to_string(config.priority) + " is out of the range of policy " +
+      config.policy + " (" + std::to_string(min) + " to " + std::to_string(max) + ")";
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+/// LOAD =======================================================================
+bool Config::load(const char * path, std::string & error)
+{
+  std::ifstream file(path);
+  if (!file) {
+    error = std::string("could not open ") + path;
+    return false;
+  }
+
+  std::string line;
+  for (size_t line_number = 1; std::getline(file, line); ++line_number) {
+    // Strip comments
+    size_t comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.erase(comment);
+    }
+
+    std::istringstream words(line);
+    std::string section;
+    std::string name;
+    if (!(words >> section)) {
+      continue;  // Blank line
+    }
+
+    auto fail = [&](const std::string & what) {
+        error = std::string(path) + ":" + std::to_string(line_number) + ": " + what;
+        return false;
+      };
+
+    // Every section but the session one is about something named
+    if (section != "session" && !(words >> name)) {
+      return fail("expected a name after '" + section + "'");
+    }
+
+    Settings settings;
+    std::string word;
+    while (words >> word) {
+      size_t equals = word.find('=');
+      if (equals == std::string::npos || equals == 0) {
+        return fail("expected <key>=<value>, got '" + word + "'");
+      }
+      settings.emplace_back(word.substr(0, equals), word.substr(equals + 1));
+    }
+
+    if (section == "topic") {
+      // Check the settings up front, so mistakes are reported at init instead of being ignored
+      TopicConfig scratch;
+      for (const auto & setting : settings) {
+        if (!apply(scratch, setting.first, setting.second)) {
+          return fail("invalid topic setting '" + setting.first + "=" + setting.second + "'");
+        }
+      }
+
+      add_rule(topic_rules_, name, std::move(settings));
+    } else if (section == "service") {
+      ServiceConfig scratch;
+      for (const auto & setting : settings) {
+        if (!apply(scratch, setting.first, setting.second)) {
+          return fail("invalid service setting '" + setting.first + "=" + setting.second + "'");
+        }
+      }
+      add_rule(service_rules_, name, std::move(settings));
+    } else if (section == "session") {
+      for (const auto & setting : settings) {
+        if (!apply(session_, setting.first, setting.second)) {
+          return fail("invalid session setting '" + setting.first + "=" + setting.second + "'");
+        }
+      }
+    } else if (section == "thread") {
+      ThreadConfig & config = threads_[name];
+      for (const auto & setting : settings) {
+        if (!apply(config, setting.first, setting.second)) {
+          return fail("invalid thread setting '" + setting.first + "=" + setting.second + "'");
+        }
+      }
+    } else {
+      return fail("unknown section '" + section + "'");
+    }
+  }
+
+  // The policy and priority of a class of threads may be set on different lines
+  for (const auto & thread : threads_) {
+    std::string what;
+    if (!check_priority(thread.second, what)) {
+      error = std::string(path) + ": thread " + thread.first + ": " + what;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/// RULES ======================================================================
+void Config::add_rule(std::vector<Rule> & rules, const std::string & name, Settings settings)
+{
+  Rule rule;
+  rule.is_prefix = name.back() == '*';
+  rule.pattern = rule.is_prefix ? name.substr(0, name.size() - 1) : name;
+  rule.settings = std::move(settings);
+  rules.push_back(std::move(rule));
+}
+
+template<typename ConfigT>
+ConfigT Config::match(const std::vector<Rule> & rules, const std::string & name)
+{
+  ConfigT config;
+  for (const auto & rule : rules) {
+    bool matches = rule.is_prefix ?
+      name.compare(0, rule.pattern.size(), rule.pattern) == 0 :
+      name == rule.pattern;
+    if (matches) {
+      for (const auto & setting : rule.settings) {
+        apply(config, setting.first, setting.second);
+      }
+    }
+  }
+  return config;
+}
+
+/// TOPIC ======================================================================
+TopicConfig Config::topic(const std::string & topic_name) const
+{
+  return match<TopicConfig>(topic_rules_, topic_name);
+}
+
+/// SERVICE ====================================================================
+ServiceConfig Config::service(const std::string & service_name) const
+{
+  return match<ServiceConfig>(service_rules_, service_name);
+}
+
+/// THREAD =====================================================================
+const ThreadConfig * Config::thread(const std::string & thread_class) const
+{
+  auto it = threads_.find(thread_class);
+  return it == threads_.end() ? nullptr : &it->second;
+}
+
+/// APPLY ======================================================================
+bool Config::apply(TopicConfig & config, const std::string & key, const std::string & value)
+{
+  if (key == "codec") {
+    config.codec = value;
+    return !value.empty();
+  } else if (key == "codec_min_size") {
+    return parse_size(value, config.codec_min_size);
+  } else if (key == "codec_max_ratio") {
+    return parse_double(value, config.codec_max_ratio) && config.codec_max_ratio > 0.0;
+  } else if (key == "delta") {
+    return parse_bool(value, config.delta);
+  } else if (key == "keyframe_interval") {
+    return parse_size(value, config.keyframe_interval) && config.keyframe_interval > 0;
+  } else if (key == "rate_limit") {
+    return parse_uint64(value, config.rate_limit);
+  } else if (key == "burst") {
+    return parse_uint64(value, config.burst);
+  } else if (key == "rate_limit_mode") {
+    config.rate_limit_block = value == "block";
+    return value == "block" || value == "drop";
+  } else if (key == "history") {
+    return parse_size(value, config.history);
+  } else if (key == "history_duration") {
+    return parse_uint64(value, config.history_duration);
+  } else if (key == "reorder_window") {
+    return parse_uint64(value, config.reorder_window);
+  } else if (key == "latency_budget") {
+    return parse_double(value, config.latency_budget) && config.latency_budget >= 0.0;
+  } else if (key == "latency_window") {
+    return parse_uint64(value, config.latency_window) && config.latency_window > 0;
+  } else if (key == "deduplicate") {
+    return parse_bool(value, config.deduplicate);
+  } else if (key == "priority") {
+    if (value == "low") {
+      config.priority = TopicPriority::kLow;
+    } else if (value == "normal") {
+      config.priority = TopicPriority::kNormal;
+    } else if (value == "high") {
+      config.priority = TopicPriority::kHigh;
+    } else {
+      return false;
+    }
+    return true;
+  } else if (key == "key") {
+    config.key = value;
+    return !value.empty();
+  }
+  return false;
+}
+
+bool Config::apply(ServiceConfig & config, const std::string & key, const std::string & value)
+{
+  if (key == "request_timeout") {
+    return parse_uint64(value, config.request_timeout);
+  }
+  return false;
+}
+
+bool Config::apply(SessionConfig & config, const std::string & key, const std::string & value)
+{
+  if (key == "rate_limit") {
+    return parse_uint64(value, config.rate_limit);
+  } else if (key == "burst") {
+    return parse_uint64(value, config.burst);
+  } else if (key == "rx_overload_delay") {
+    return parse_double(value, config.rx_overload_delay) && config.rx_overload_delay >= 0.0;
+  } else if (key == "rx_overload_bytes") {
+    return parse_uint64(value, config.rx_overload_bytes);
+  }
+  return false;
+}
+
+bool Config::apply(ThreadConfig & config, const std::string & key, const std::string & value)
+{
+  if (key == "cpus") {
+    return parse_cpus(value, config.cpus);
+  } else if (key == "policy") {
+    config.policy = value;
+    return value == "other" || value == "fifo" || value == "rr";
+  } else if (key == "priority") {
+    return parse_int(value, config.priority) && config.priority >= 0;
+  } else if (key == "name") {
+    config.name = value;
+    return !value.empty();
+  }
+  return false;
+}
+
+}  // namespace rmw_zenoh_common_cpp
@@ -0,0 +1,223 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__CONFIG_HPP_
+#define IMPL__CONFIG_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// TOPIC PRIORITY =============================================================
+// Priority class of a topic on the receive path. When it is overloaded, the samples of the low
+// priority topics are shed first, then those of the normal ones. High priority samples are never
+// shed.
+enum class TopicPriority : uint8_t
+{
+  kLow = 0,
+  kNormal = 1,
+  kHigh = 2
+};
+
+/// TOPIC CONFIG ===============================================================
+// Settings of the publishers and subscriptions on a topic
+struct TopicConfig
+{
+  // Payload codec of published samples ("none" to publish plain CDR)
+  std::string codec = "none";
+
+  // Samples smaller than this are published without encoding them
+  size_t codec_min_size = 512;
+
+  // Samples that do not encode to at most this fraction of their size are published as is
+  double codec_max_ratio = 0.9;
+
+  // Publish samples as deltas against the previous sample, with periodic keyframes
+  bool delta = false;
+
+  // Every this many samples a keyframe is published, even if a delta would be smaller
+  size_t keyframe_interval = 30;
+
+  // Bandwidth limit of each publisher, in bytes per second (0 for no limit)
+  uint64_t rate_limit = 0;
+
+  // Bytes a publisher can send in a burst (0 for one second worth of rate_limit)
+  uint64_t burst = 0;
+
+  // Whether messages over the publisher's or session's bandwidth limit are dropped, or delay the
+  // publishing thread until they can be sent
+  bool rate_limit_block = false;
+
+  // Field of the messages holding their instance key (empty if the topic is not keyed), with '.'
+  // separating nested field names. Subscriptions keep their history depth per instance.
+  std::string key;
+
+  // Samples each publisher keeps to answer history queries (0 to not answer them), and how long
+  // they are kept for, in milliseconds (0 to keep them until they are pushed out)
+  size_t history = 0;
+  uint64_t history_duration = 0;
+
+  // Publishers stamp their samples, and subscriptions hold them for this many milliseconds to
+  // take them in the order they were published in (0 to take them as they arrive)
+  uint64_t reorder_window = 0;
+
+  // Publishers stamp their samples, and subscriptions raise a requested deadline missed event when
+  // the 99th percentile of the latencies of the samples they took over the last latency_window
+  // milliseconds goes over this many milliseconds (0 to not track latencies)
+  double latency_budget = 0.0;
+  uint64_t latency_window = 1000;
+
+  // Publishers number their samples, so subscriptions can drop the copies of a sample that reach
+  // them over redundant paths
+  bool deduplicate = false;
+
+  // Priority class of the samples received on the topic
+  TopicPriority priority = TopicPriority::kNormal;
+};
+
+/// SERVICE CONFIG =============================================================
+// Settings of the clients and servers of a service
+struct ServiceConfig
+{
+  // Clients give their requests a deadline this many milliseconds after they are sent, and servers
+  // discard the requests they take past their deadline (0 for no deadline)
+  uint64_t request_timeout = 0;
+};
+
+/// SESSION CONFIG =============================================================
+// Settings of a context's Zenoh session
+struct SessionConfig
+{
+  // Bandwidth limit of all the publishers of the session together, in bytes per second
+  // (0 for no limit)
+  uint64_t rate_limit = 0;
+
+  // Bytes the session can send in a burst (0 for one second worth of rate_limit)
+  uint64_t burst = 0;
+
+  // The receive path is overloaded when received samples wait longer than this many milliseconds
+  // to be taken (0 to not watch), or when the receive buffers in use take more than this many
+  // bytes (0 to not watch)
+  double rx_overload_delay = 0.0;
+  uint64_t rx_overload_bytes = 0;
+};
+
+/// THREAD CONFIG ==============================================================
+// Settings of a class of middleware threads (see threads.hpp). Anything left unset is left as the
+// thread was started.
+struct ThreadConfig
+{
+  // CPUs the threads may run on (empty to leave their affinity alone)
+  std::vector<int> cpus;
+
+  // Scheduling policy ("other", "fifo" or "rr", empty to leave it alone) and priority, within the
+  // range of the policy (1 to 99 for fifo and rr on Linux, 0 for other)
+  std::string policy;
+  int priority = 0;
+
+  // Thread name, shortened to 15 characters (with a "-<n>" suffix if there are several threads)
+  std::string name;
+};
+
+/// CONFIG =====================================================================
+// Settings loaded from the file named by the RMW_ZENOH_CONFIG_FILE environment variable.
+//
+// The file is made of lines of the form
+//
+//   <section> <name> <key>=<value> [<key>=<value> ...]
+//
+// Blank lines and everything after a '#' are ignored. The supported sections are:
+//  - topic: Settings of a topic (see TopicConfig). The name is a fully qualified topic name, or
+//           a prefix followed by '*' to match every topic starting with the prefix. All the lines
+//           matching a topic apply, in the order they appear in the file.
+//  - service: Settings of a service (see ServiceConfig). The name is a fully qualified service
+//             name, or a prefix followed by '*', matched like topic names.
+//  - session: Settings of the session (see SessionConfig). These lines have no name.
+//  - thread: Settings of a class of middleware threads (see ThreadConfig). The name is the thread
+//            class.
+//
+// For example:
+//
+//   session rate_limit=1000000
+//   topic * codec=lz
+//   topic /map codec_min_size=0 delta=true keyframe_interval=100
+//   topic /points rate_limit=250000 rate_limit_mode=drop
+//   topic /diagnostics history=500 history_duration=5000
+//   topic /control/* latency_budget=30 latency_window=2000 priority=high
+//   service /plan_path request_timeout=500
+//   thread read cpus=3 policy=fifo priority=80 name=zn_rx
+class Config
+{
+public:
+  // Load a config file. Returns false, with a description of the problem in error, if the file
+  // cannot be read or is malformed.
+  bool load(const char * path, std::string & error);
+
+  // Get the settings of a topic
+  TopicConfig topic(const std::string & topic_name) const;
+
+  // Get the settings of a service
+  ServiceConfig service(const std::string & service_name) const;
+
+  // Get the settings of the session
+  const SessionConfig & session() const {return session_;}
+
+  // Get the settings of a class of threads (nullptr if there are none)
+  const ThreadConfig * thread(const std::string & thread_class) const;
+
+private:
+  using Settings = std::vector<std::pair<std::string, std::string>>;
+
+  // Settings of the topics or services matching a pattern
+  struct Rule
+  {
+    std::string pattern;
+    bool is_prefix;
+    Settings settings;
+  };
+
+  // Apply one setting of a topic line. Returns false if the key or value is not valid.
+  static bool apply(TopicConfig & config, const std::string & key, const std::string & value);
+
+  // Apply one setting of a service line. Returns false if the key or value is not valid.
+  static bool apply(ServiceConfig & config, const std::string & key, const std::string & value);
+
+  // Apply one setting of a session line. Returns false if the key or value is not valid.
+  static bool apply(SessionConfig & config, const std::string & key, const std::string & value);
+
+  // Apply one setting of a thread line. Returns false if the key or value is not valid.
+  static bool apply(ThreadConfig & config, const std::string & key, const std::string & value);
+
+  // Settings of the rules matching a name, applied in order over the defaults
+  template<typename ConfigT>
+  static ConfigT match(const std::vector<Rule> & rules, const std::string & name);
+
+  // Add a rule for a topic or service line
+  static void add_rule(std::vector<Rule> & rules, const std::string & name, Settings settings);
+
+  std::vector<Rule> topic_rules_;
+  std::vector<Rule> service_rules_;
+  SessionConfig session_;
+  std::map<std::string, ThreadConfig> threads_;
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__CONFIG_HPP_
@@ -0,0 +1,355 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "delta.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+
+#include "rcutils/logging_macros.h"
+
+#include "codec.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+
+namespace
+{
+// Changed bytes separated by fewer unchanged bytes than this are sent in the same run, since
+// starting a new run costs at least two bytes
+constexpr size_t kMinUnchangedRun = 3;
+
+unsigned char * write_varint(unsigned char * op, unsigned char * op_end, size_t value)
+{
+  do {
+    if (op == op_end) {
+      return nullptr;
+    }
+    unsigned char byte = value & 0x7f;
+    value >>= 7;
+    *op++ = static_cast<unsigned char>(byte | (value ? 0x80 : 0));
+  } while (value);
+  return op;
+}
+
+bool read_varint(const unsigned char * in, size_t in_length, size_t & ip, size_t & value)
+{
+  value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (ip >= in_length) {
+      return false;
+    }
+    unsigned char byte = in[ip++];
+    value |= static_cast<size_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Byte i of the previous message, zero-extended
+inline unsigned char prev_at(const unsigned char * prev, size_t prev_length, size_t i)
+{
+  return i < prev_length ? prev[i] : 0;
+}
+
+// Whether byte i of the next message can be sent as unchanged (never past the previous message)
+inline bool unchanged_at(
+  const unsigned char * prev, size_t prev_length, const unsigned char * next, size_t i)
+{
+  return i < prev_length && next[i] == prev[i];
+}
+}  // namespace
+
+/// DELTA FORMAT ===============================================================
+size_t encode_delta(
+  const unsigned char * prev, size_t prev_length,
+  const unsigned char * next, size_t next_length,
+  unsigned char * out, size_t out_capacity)
+{
+  unsigned char * op = out;
+  unsigned char * const op_end = out + out_capacity;
+
+  op = write_varint(op, op_end, next_length);
+  if (!op) {
+    return 0;
+  }
+
+  size_t i = 0;
+  while (i < next_length) {
+    // Unchanged bytes
+    size_t unchanged_start = i;
+    while (i < next_length && unchanged_at(prev, prev_length, next, i)) {
+      ++i;
+    }
+    size_t unchanged = i - unchanged_start;
+
+    // Changed bytes, absorbing unchanged gaps too short to be worth their own entry
+    size_t changed_start = i;
+    size_t changed_end = i;
+    while (i < next_length) {
+      if (!unchanged_at(prev, prev_length, next, i)) {
+        changed_end = ++i;
+        continue;
+      }
+      size_t gap_end = i;
+      while (gap_end < next_length && gap_end - i < kMinUnchangedRun &&
+        unchanged_at(prev, prev_length, next, gap_end))
+      {
+        ++gap_end;
+      }
+      if (gap_end - i >= kMinUnchangedRun || gap_end == next_length) {
+        break;
+      }
+      i = gap_end;
+    }
+    i = changed_end;
+    size_t changed = changed_end - changed_start;
+
+    op = write_varint(op, op_end, unchanged);
+    op = op ? write_varint(op, op_end, changed) : nullptr;
+    if (!op || static_cast<size_t>(op_end - op) < changed) {
+      return 0;
+    }
+    for (size_t j = changed_start; j < changed_end; ++j) {
+      *op++ = next[j] ^ prev_at(prev, prev_length, j);
+    }
+  }
+
+  return static_cast<size_t>(op - out);
+}
+
+bool read_delta_target_length(
+  const unsigned char * delta, size_t delta_length, size_t prev_length, size_t & length)
+{
+  size_t ip = 0;
+  return read_varint(delta, delta_length, ip, length) &&
+         length <= prev_length + (delta_length - ip);
+}
+
+bool decode_delta(
+  const unsigned char * prev, size_t prev_length,
+  const unsigned char * delta, size_t delta_length,
+  unsigned char * out, size_t target_length)
+{
+  size_t ip = 0;
+  size_t length;
+  if (!read_varint(delta, delta_length, ip, length) || length != target_length) {
+    return false;
+  }
+
+  size_t op = 0;
+  while (op < target_length) {
+    size_t unchanged;
+    size_t changed;
+    if (!read_varint(delta, delta_length, ip, unchanged) ||
+      !read_varint(delta, delta_length, ip, changed))
+    {
+      return false;
+    }
+    if (unchanged + changed == 0 ||
+      unchanged > target_length - op ||
+      changed > target_length - op - unchanged ||
+      changed > delta_length - ip)
+    {
+      return false;
+    }
+
+    // Copy the unchanged bytes that exist in the previous message, the rest are zeros
+    size_t copied = op < prev_length ? std::min(unchanged, prev_length - op) : 0;
+    if (copied > 0) {
+      memcpy(out + op, prev + op, copied);
+    }
+    memset(out + op + copied, 0, unchanged - copied);
+    op += unchanged;
+
+    for (size_t j = 0; j < changed; ++j, ++op) {
+      out[op] = delta[ip++] ^ prev_at(prev, prev_length, op);
+    }
+  }
+
+  return ip == delta_length;
+}
+
+/// DELTA ENCODER ==============================================================
+DeltaEncoder::DeltaEncoder(size_t keyframe_interval)
+: keyframe_interval_(std::max<size_t>(keyframe_interval, 1)),
+  since_keyframe_(0),
+  sequence_(0),
+  has_last_sample_(false),
+  last_has_instance_(false),
+  last_instance_(0)
+{
+  random_sample_gid(gid_);
+}
+
+size_t DeltaEncoder::encode(
+  const unsigned char * raw, size_t raw_length, size_t header_room, SampleHeader & header)
+{
+  ++sequence_;
+
+  size_t delta_length = 0;
+  if (has_last_sample_ && since_keyframe_ + 1 < keyframe_interval_ && raw_length > 0) {
+    // A delta that is not smaller than the sample is sent as a keyframe, so it only has to fit that
+    if (buffer_.size() < header_room + raw_length) {
+      buffer_.resize(header_room + raw_length);
+    }
+    delta_length = encode_delta(
+      last_sample_.data(), last_sample_.size(),
+      raw, raw_length,
+      buffer_.data() + header_room, raw_length - 1);
+  }
+
+  since_keyframe_ = delta_length > 0 ? since_keyframe_ + 1 : 0;
+
+  last_sample_.assign(raw, raw + raw_length);
+  has_last_sample_ = true;
+  last_has_instance_ = (header.flags & kSampleFlagInstance) != 0;
+  last_instance_ = header.instance;
+
+  header.flags |= kSampleFlagStream;
+  if (delta_length > 0) {
+    header.flags |= kSampleFlagDelta;
+  }
+  memcpy(header.gid, gid_, kSampleGidSize);
+  header.sequence = sequence_;
+
+  return delta_length;
+}
+
+SampleHeader DeltaEncoder::keyframe_header() const
+{
+  SampleHeader header;
+  header.version = kSampleHeaderVersion;
+  header.codec = kCodecNone;
+  header.flags = kSampleFlagStream;
+  header.raw_length = static_cast<uint32_t>(last_sample_.size());
+  memcpy(header.gid, gid_, kSampleGidSize);
+  header.sequence = sequence_;
+  header.instance = last_instance_;
+  if (last_has_instance_) {
+    header.flags |= kSampleFlagInstance;
+  }
+  return header;
+}
+
+/// DELTA STREAMS ==============================================================
+constexpr std::chrono::milliseconds DeltaStreams::kKeyframeRequestPeriod;
+constexpr std::chrono::seconds DeltaStreams::kStreamTimeout;
+
+ReceiveBufferPtr DeltaStreams::apply(
+  const SampleHeader & header,
+  ReceiveBufferPtr payload,
+  ReceiveBufferPool & pool,
+  const char * topic,
+  bool & request_keyframe)
+{
+  request_keyframe = false;
+
+  Clock::time_point now = Clock::now();
+  evict(now);
+
+  Gid gid;
+  std::copy(header.gid, header.gid + kSampleGidSize, gid.begin());
+  Stream & stream = streams_[gid];
+  stream.last_seen = now;
+
+  // KEYFRAME ==================================================================
+  if (!(header.flags & kSampleFlagDelta)) {
+    // Keyframes answering a query can be older than what was already delivered
+    if (stream.has_base && header.sequence <= stream.sequence) {
+      return ReceiveBufferPtr();
+    }
+    stream.has_base = true;
+    stream.sequence = header.sequence;
+    stream.base = payload;
+    return payload;
+  }
+
+  // DELTA =====================================================================
+  if (stream.has_base && header.sequence <= stream.sequence) {
+    return ReceiveBufferPtr();  // Duplicate
+  }
+
+  auto missing_base = [&]() {
+      if (now - stream.last_request >= kKeyframeRequestPeriod) {
+        stream.last_request = now;
+        request_keyframe = true;
+      }
+      return ReceiveBufferPtr();
+    };
+
+  if (!stream.has_base || header.sequence != stream.sequence + 1) {
+    RCUTILS_LOG_DEBUG_NAMED(
+      "rmw_zenoh_common_cpp",
+      "Dropping delta %" PRIu64 " without its base for %s",
+      header.sequence,
+      topic);
+    return missing_base();
+  }
+
+  // The target length comes off the wire, so it is checked against what the delta can decode to
+  // before a buffer is acquired for it
+  size_t target_length;
+  if (!read_delta_target_length(
+      payload->data(), payload->size(), stream.base->size(), target_length))
+  {
+    RCUTILS_LOG_ERROR_NAMED("rmw_zenoh_common_cpp", "Dropping malformed delta for %s", topic);
+    return missing_base();
+  }
+
+  ReceiveBufferPtr message = pool.acquire(target_length);
+  if (!message) {
+    RCUTILS_LOG_ERROR_NAMED(
+      "rmw_zenoh_common_cpp",
+      "Could not get a receive buffer of %zu bytes, dropping message for %s",
+      target_length,
+      topic);
+    return missing_base();
+  }
+
+  if (!decode_delta(
+      stream.base->data(), stream.base->size(),
+      payload->data(), payload->size(),
+      message->data(), target_length))
+  {
+    RCUTILS_LOG_ERROR_NAMED("rmw_zenoh_common_cpp", "Dropping malformed delta for %s", topic);
+    stream.has_base = false;
+    return missing_base();
+  }
+
+  stream.sequence = header.sequence;
+  stream.base = message;
+  return message;
+}
+
+void DeltaStreams::evict(Clock::time_point now)
+{
+  if (now - last_eviction_ < kStreamTimeout) {
+    return;
+  }
+  last_eviction_ = now;
+
+  for (auto it = streams_.begin(); it != streams_.end(); ) {
+    if (now - it->second.last_seen >= kStreamTimeout) {
+      it = streams_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace rmw_zenoh_common_cpp
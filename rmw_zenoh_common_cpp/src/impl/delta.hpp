@@ -0,0 +1,160 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__DELTA_HPP_
+#define IMPL__DELTA_HPP_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "receive_buffer_pool.hpp"
+#include "sample_header.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+
+// Suffix of the key publishers of delta encoded topics answer keyframe queries on
+constexpr char kKeyframeKeySuffix[] = "/keyframe";
+
+/// DELTA FORMAT ===============================================================
+// A delta describes a serialized message as the XOR of it with the previous message of the same
+// stream (zero-extended to the new length), run length encoded:
+//
+//   varint target length
+//   repeated: varint unchanged byte count, varint changed byte count, changed bytes XOR previous
+//
+// Varints are unsigned LEB128. The runs must cover the target length exactly. Bytes past the end
+// of the previous message are always sent as changed bytes, so a delta never decodes to more than
+// the previous message's length plus its own.
+
+// Encode next against prev into out. Returns the delta size, or 0 if it does not fit out_capacity.
+size_t encode_delta(
+  const unsigned char * prev, size_t prev_length,
+  const unsigned char * next, size_t next_length,
+  unsigned char * out, size_t out_capacity);
+
+// Read the length of the message a delta against a previous message of prev_length bytes decodes
+// to. Returns false if the delta is malformed, or claims more than it can decode to.
+bool read_delta_target_length(
+  const unsigned char * delta, size_t delta_length, size_t prev_length, size_t & length);
+
+// Apply a delta to prev, writing the target_length bytes of the message to out.
+// Returns false if the delta is malformed.
+bool decode_delta(
+  const unsigned char * prev, size_t prev_length,
+  const unsigned char * delta, size_t delta_length,
+  unsigned char * out, size_t target_length);
+
+/// DELTA ENCODER ==============================================================
+// Publisher side state of a delta encoded stream.
+//
+// Every sample gets the next sequence number of the stream. Every keyframe_interval-th sample,
+// and every sample whose delta would not be smaller than the sample itself, is sent whole as a
+// keyframe. The last sample sent is kept to compute the next delta and to answer keyframe queries.
+class DeltaEncoder
+{
+public:
+  explicit DeltaEncoder(size_t keyframe_interval);
+
+  // Held by the publisher while it encodes and writes a sample, since it uses buffer()
+  std::mutex & mutex() {return mutex_;}
+
+  // Take the next sample of the stream, and fill the stream extension of its header. If it is
+  // sent as a delta, kSampleFlagDelta is set, the delta is written to buffer() after header_room
+  // bytes left free for the caller, and its size is returned. Returns 0 if the sample should be
+  // sent whole as a keyframe. The instance extension of the header is kept for keyframe_header().
+  size_t encode(
+    const unsigned char * raw, size_t raw_length, size_t header_room, SampleHeader & header);
+
+  unsigned char * buffer() {return buffer_.data();}
+
+  // Header of the last sample passed to encode(), sent whole as a keyframe
+  SampleHeader keyframe_header() const;
+
+  // The last sample passed to encode() (empty if there was none)
+  const std::vector<unsigned char> & last_sample() const {return last_sample_;}
+  bool has_last_sample() const {return has_last_sample_;}
+
+private:
+  size_t keyframe_interval_;
+  size_t since_keyframe_;
+
+  uint8_t gid_[kSampleGidSize];
+  uint64_t sequence_;
+
+  std::vector<unsigned char> last_sample_;
+  bool has_last_sample_;
+  bool last_has_instance_;
+  uint64_t last_instance_;
+
+  std::mutex mutex_;
+  std::vector<unsigned char> buffer_;
+};
+
+/// DELTA STREAMS ==============================================================
+// Subscriber side state of the delta encoded streams of a topic, keyed by publisher stream GID.
+//
+// Reconstructs each stream's messages from keyframes and deltas. A delta whose base was missed
+// (the subscription joined late, or a sample was lost) is dropped, and the caller is asked to
+// query the publishers for a keyframe. Keyframe requests are throttled per stream.
+class DeltaStreams
+{
+public:
+  // Minimum time between keyframe requests for a stream
+  static constexpr std::chrono::milliseconds kKeyframeRequestPeriod{1000};
+
+  // Streams are forgotten once nothing was received from them for this long
+  static constexpr std::chrono::seconds kStreamTimeout{60};
+
+  // Take a sample of a stream (header must have kSampleFlagStream set), with its payload as
+  // decoded by the codec stage. Returns the message to deliver, or an empty pointer if the sample
+  // is dropped (stale or duplicate keyframes, and deltas that cannot be applied).
+  //
+  // Sets request_keyframe if a keyframe should be queried for the topic.
+  ReceiveBufferPtr apply(
+    const SampleHeader & header,
+    ReceiveBufferPtr payload,
+    ReceiveBufferPool & pool,
+    const char * topic,
+    bool & request_keyframe);
+
+private:
+  using Clock = std::chrono::steady_clock;
+  using Gid = std::array<uint8_t, kSampleGidSize>;
+
+  struct Stream
+  {
+    bool has_base = false;
+    uint64_t sequence = 0;
+    ReceiveBufferPtr base;
+
+    Clock::time_point last_seen;
+    Clock::time_point last_request;
+  };
+
+  // Forget the streams that timed out
+  void evict(Clock::time_point now);
+
+  std::map<Gid, Stream> streams_;
+  Clock::time_point last_eviction_;
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__DELTA_HPP_
@@ -0,0 +1,132 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "direct_dispatch.hpp"
+
+#include <fastcdr/Cdr.h>
+#include <fastcdr/FastBuffer.h>
+
+#include "rcutils/logging_macros.h"
+
+#include "serialization_plan.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+
+DirectDispatcher::DirectDispatcher(
+  const TypeSupport * type_support, const void * type_support_impl,
+  const char * topic_name, rcutils_allocator_t allocator)
+: type_support_(type_support),
+  type_support_impl_(type_support_impl),
+  topic_name_(topic_name),
+  allocator_(allocator),
+  active_(false),
+  dispatching_thread_(std::thread::id()),
+  callback_(nullptr),
+  user_data_(nullptr),
+  ros_message_(nullptr),
+  borrowed_message_(nullptr)
+{}
+
+DirectDispatcher::~DirectDispatcher()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_borrowed();
+}
+
+/// SET ========================================================================
+bool DirectDispatcher::set(Callback callback, void * ros_message, void * user_data)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (callback && !ros_message && !borrowed_message_) {
+    if (!type_support_->canLoanMessages()) {
+      return false;
+    }
+    const SerializationPlan * plan = type_support_->getPlan();
+    borrowed_message_ = allocator_.allocate(plan->message_size(), allocator_.state);
+    if (!borrowed_message_) {
+      return false;
+    }
+    plan->init_message(borrowed_message_);
+  } else if (!callback || ros_message) {
+    free_borrowed();
+  }
+
+  callback_ = callback;
+  user_data_ = user_data;
+  ros_message_ = ros_message;
+  active_.store(callback != nullptr, std::memory_order_release);
+  return true;
+}
+
+/// DISPATCH ===================================================================
+void DirectDispatcher::dispatch(const ReceiveBufferPtr & sample)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!callback_) {
+    return;
+  }
+
+  eprosima::fastcdr::FastBuffer fastbuffer(
+    reinterpret_cast<char *>(sample->data()),
+    sample->size());
+
+  eprosima::fastcdr::Cdr deser(
+    fastbuffer,
+    eprosima::fastcdr::Cdr::DEFAULT_ENDIAN,
+    eprosima::fastcdr::Cdr::DDS_CDR);
+
+  if (ros_message_) {
+    if (!type_support_->deserializeROSmessage(deser, ros_message_, type_support_impl_)) {
+      RCUTILS_LOG_ERROR_NAMED(
+        "rmw_zenoh_common_cpp", "Could not deserialize message for %s", topic_name_);
+      return;
+    }
+    call(ros_message_);
+    return;
+  }
+
+  // The views point into the sample buffer, which the caller holds on to for the call
+  views_.clear();
+  bool deserialized = type_support_->deserializeLoanedROSmessage(
+    deser, borrowed_message_, views_, type_support_impl_);
+  if (deserialized) {
+    call(borrowed_message_);
+  } else {
+    RCUTILS_LOG_ERROR_NAMED(
+      "rmw_zenoh_common_cpp", "Could not deserialize message for %s", topic_name_);
+  }
+  SerializationPlan::release_views(views_);
+}
+
+void DirectDispatcher::call(const void * ros_message)
+{
+  dispatching_thread_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+  callback_(ros_message, user_data_);
+  dispatching_thread_.store(std::thread::id(), std::memory_order_relaxed);
+}
+
+/// FREE BORROWED ==============================================================
+void DirectDispatcher::free_borrowed()
+{
+  if (!borrowed_message_) {
+    return;
+  }
+  type_support_->getPlan()->fini_message(borrowed_message_);
+  allocator_.deallocate(borrowed_message_, allocator_.state);
+  borrowed_message_ = nullptr;
+}
+
+}  // namespace rmw_zenoh_common_cpp
@@ -0,0 +1,98 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__DIRECT_DISPATCH_HPP_
+#define IMPL__DIRECT_DISPATCH_HPP_
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rcutils/allocator.h"
+
+#include "rmw_zenoh_common_cpp/TypeSupport.hpp"
+
+#include "receive_buffer_pool.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// DIRECT DISPATCHER ==========================================================
+// Hands the samples of a subscription to a callback on the thread that received them, instead of
+// queueing them for rmw_take.
+//
+// The message given to the callback is either the caller's, deserialized into before every call,
+// or a message owned by the dispatcher whose sequences of primitives are borrowed from the sample
+// buffer (for types that can be loaned). Either is only valid during the call.
+//
+// Calls are serialized by the dispatcher's mutex, and the dispatcher is reference counted by the
+// threads about to dispatch to it, so set() with no callback returns only once no call is in
+// progress, and no call starts after it. So set() must not be called from the callback, which
+// in_callback() tells.
+class DirectDispatcher
+{
+public:
+  using Callback = void (*)(const void * ros_message, void * user_data);
+
+  // The type support and topic name must stay valid while a callback is set
+  DirectDispatcher(
+    const TypeSupport * type_support, const void * type_support_impl,
+    const char * topic_name, rcutils_allocator_t allocator);
+  ~DirectDispatcher();
+
+  // Set the callback (nullptr to stop dispatching), with the message to deserialize into
+  // (nullptr to borrow one). Returns false if a message cannot be borrowed for the type, or
+  // allocated.
+  bool set(Callback callback, void * ros_message, void * user_data);
+
+  // Whether a callback is set
+  bool active() const {return active_.load(std::memory_order_acquire);}
+
+  // Whether the calling thread is in a call of the callback (where set() would deadlock)
+  bool in_callback() const
+  {
+    return dispatching_thread_.load(std::memory_order_relaxed) == std::this_thread::get_id();
+  }
+
+  // Deserialize a sample and call the callback with it, if one is still set
+  void dispatch(const ReceiveBufferPtr & sample);
+
+private:
+  // Call the callback, noting the thread it is called on. Must be called with mutex_ held.
+  void call(const void * ros_message);
+
+  // Free the borrowed message. Must be called with mutex_ held.
+  void free_borrowed();
+
+  const TypeSupport * type_support_;
+  const void * type_support_impl_;
+  const char * topic_name_;
+  rcutils_allocator_t allocator_;
+
+  std::mutex mutex_;
+  std::atomic<bool> active_;
+  std::atomic<std::thread::id> dispatching_thread_;
+  Callback callback_;
+  void * user_data_;
+
+  // The caller's message, or the borrowed one and the fields of it viewing the sample buffer
+  void * ros_message_;
+  void * borrowed_message_;
+  std::vector<void *> views_;
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__DIRECT_DISPATCH_HPP_
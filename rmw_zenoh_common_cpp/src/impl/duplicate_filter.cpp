@@ -0,0 +1,114 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "duplicate_filter.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace rmw_zenoh_common_cpp
+{
+
+namespace
+{
+void set_bit(std::array<uint64_t, DuplicateFilter::kWindow / 64> & bits, uint64_t sequence)
+{
+  size_t bit = static_cast<size_t>(sequence % DuplicateFilter::kWindow);
+  bits[bit / 64] |= uint64_t(1) << (bit % 64);
+}
+
+void clear_bit(std::array<uint64_t, DuplicateFilter::kWindow / 64> & bits, uint64_t sequence)
+{
+  size_t bit = static_cast<size_t>(sequence % DuplicateFilter::kWindow);
+  bits[bit / 64] &= ~(uint64_t(1) << (bit % 64));
+}
+
+bool test_bit(const std::array<uint64_t, DuplicateFilter::kWindow / 64> & bits, uint64_t sequence)
+{
+  size_t bit = static_cast<size_t>(sequence % DuplicateFilter::kWindow);
+  return (bits[bit / 64] >> (bit % 64)) & 1;
+}
+}  // namespace
+
+/// SAMPLE SEQUENCER ===========================================================
+SampleSequencer::SampleSequencer()
+: sequence_(0)
+{
+  random_sample_gid(gid_);
+}
+
+void SampleSequencer::stamp(SampleHeader & header)
+{
+  header.flags |= kSampleFlagSequence;
+  memcpy(header.publisher_gid, gid_, kSampleGidSize);
+  header.publisher_sequence = sequence_.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+/// DUPLICATE FILTER ===========================================================
+constexpr size_t DuplicateFilter::kWindow;
+constexpr std::chrono::seconds DuplicateFilter::kPublisherTimeout;
+
+bool DuplicateFilter::duplicate(const SampleHeader & header)
+{
+  Clock::time_point now = Clock::now();
+  evict(now);
+
+  Gid gid;
+  std::copy(header.publisher_gid, header.publisher_gid + kSampleGidSize, gid.begin());
+  Publisher & publisher = publishers_[gid];
+  publisher.last_seen = now;
+
+  uint64_t sequence = header.publisher_sequence;
+
+  // Newer than anything received: slide the window up to it
+  if (sequence > publisher.highest) {
+    if (sequence - publisher.highest >= kWindow) {
+      publisher.received.fill(0);
+    } else {
+      for (uint64_t skipped = publisher.highest + 1; skipped < sequence; ++skipped) {
+        clear_bit(publisher.received, skipped);
+      }
+    }
+    set_bit(publisher.received, sequence);
+    publisher.highest = sequence;
+    return false;
+  }
+
+  // Within the window: a duplicate if its bit is already set
+  if (publisher.highest - sequence < kWindow && !test_bit(publisher.received, sequence)) {
+    set_bit(publisher.received, sequence);
+    return false;
+  }
+
+  ++duplicates_;
+  return true;
+}
+
+void DuplicateFilter::evict(Clock::time_point now)
+{
+  if (now - last_eviction_ < kPublisherTimeout) {
+    return;
+  }
+  last_eviction_ = now;
+
+  for (auto it = publishers_.begin(); it != publishers_.end(); ) {
+    if (now - it->second.last_seen >= kPublisherTimeout) {
+      it = publishers_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace rmw_zenoh_common_cpp
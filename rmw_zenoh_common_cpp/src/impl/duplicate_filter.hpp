@@ -0,0 +1,92 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__DUPLICATE_FILTER_HPP_
+#define IMPL__DUPLICATE_FILTER_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+#include "sample_header.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// SAMPLE SEQUENCER ===========================================================
+// Publisher side of duplicate suppression: gives the samples of a publisher a random GID and
+// consecutive sequence numbers, sent in the sequence extension of their headers.
+class SampleSequencer
+{
+public:
+  SampleSequencer();
+
+  // Set kSampleFlagSequence and fill the sequence extension of the next sample's header
+  void stamp(SampleHeader & header);
+
+private:
+  uint8_t gid_[kSampleGidSize];
+  std::atomic<uint64_t> sequence_;
+};
+
+/// DUPLICATE FILTER ===========================================================
+// Subscriber side of duplicate suppression on a topic: remembers which of the last kWindow
+// sequence numbers of every publisher were received, in a bitmap sliding along with the highest
+// sequence number seen.
+//
+// Samples arriving more than kWindow sequence numbers behind the newest of their publisher cannot
+// be told apart from duplicates, and are dropped as well. Publishers are forgotten once nothing
+// was received from them for kPublisherTimeout, which is how publishers that went away are
+// cleaned up.
+class DuplicateFilter
+{
+public:
+  static constexpr size_t kWindow = 1024;
+  static constexpr std::chrono::seconds kPublisherTimeout{60};
+
+  // Whether a sample (header must have kSampleFlagSequence set) was already received. Samples
+  // that were not are marked as received.
+  bool duplicate(const SampleHeader & header);
+
+  // Number of publishers being tracked
+  size_t publisher_count() const {return publishers_.size();}
+
+  // Samples dropped as duplicates so far
+  uint64_t duplicates() const {return duplicates_;}
+
+private:
+  using Clock = std::chrono::steady_clock;
+  using Gid = std::array<uint8_t, kSampleGidSize>;
+
+  struct Publisher
+  {
+    uint64_t highest = 0;  // Highest sequence number received (0 before the first sample)
+    std::array<uint64_t, kWindow / 64> received{};  // Bit sequence % kWindow
+    Clock::time_point last_seen;
+  };
+
+  // Forget the publishers that timed out
+  void evict(Clock::time_point now);
+
+  std::map<Gid, Publisher> publishers_;
+  Clock::time_point last_eviction_;
+  uint64_t duplicates_ = 0;
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__DUPLICATE_FILTER_HPP_
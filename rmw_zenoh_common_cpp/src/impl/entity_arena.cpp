@@ -0,0 +1,129 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "entity_arena.hpp"
+
+#include <cstring>
+
+namespace rmw_zenoh_common_cpp
+{
+
+constexpr size_t EntityArena::kAlignment;
+constexpr size_t EntityArena::kChunkSize;
+constexpr size_t EntityArena::kMaxPooledSize;
+constexpr size_t EntityArena::kNumSizeClasses;
+
+EntityArena::EntityArena(const rcutils_allocator_t & allocator)
+: allocator_(allocator),
+  chunks_(nullptr),
+  cursor_(nullptr),
+  remaining_(0)
+{
+  for (auto & free_list : free_lists_) {
+    free_list = nullptr;
+  }
+}
+
+EntityArena::~EntityArena()
+{
+  Chunk * chunk = chunks_;
+  while (chunk) {
+    Chunk * next = chunk->next;
+    allocator_.deallocate(chunk, allocator_.state);
+    chunk = next;
+  }
+}
+
+/// ALLOCATE ===================================================================
+unsigned char * EntityArena::add_chunk(size_t size)
+{
+  auto * chunk = static_cast<Chunk *>(
+    allocator_.allocate(header_size() + size, allocator_.state));
+  if (!chunk) {
+    return nullptr;
+  }
+  chunk->next = chunks_;
+  chunks_ = chunk;
+  return reinterpret_cast<unsigned char *>(chunk) + header_size();
+}
+
+void * EntityArena::allocate(size_t size)
+{
+  size = round_up(size > 0 ? size : 1);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (size > kMaxPooledSize) {
+    return add_chunk(size);
+  }
+
+  FreeBlock *& free_list = free_lists_[size / kAlignment - 1];
+  if (free_list) {
+    FreeBlock * block = free_list;
+    free_list = block->next;
+    return block;
+  }
+
+  if (remaining_ < size) {
+    // The rest of the current chunk is left unused
+    cursor_ = add_chunk(kChunkSize);
+    if (!cursor_) {
+      remaining_ = 0;
+      return nullptr;
+    }
+    remaining_ = kChunkSize;
+  }
+
+  void * block = cursor_;
+  cursor_ += size;
+  remaining_ -= size;
+  return block;
+}
+
+void EntityArena::deallocate(void * block, size_t size)
+{
+  if (!block) {
+    return;
+  }
+  size = round_up(size > 0 ? size : 1);
+  if (size > kMaxPooledSize) {
+    return;  // Handed back with the arena
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  FreeBlock *& free_list = free_lists_[size / kAlignment - 1];
+  auto * free_block = static_cast<FreeBlock *>(block);
+  free_block->next = free_list;
+  free_list = free_block;
+}
+
+/// STRINGS ====================================================================
+char * EntityArena::strdup(const char * string)
+{
+  size_t size = strlen(string) + 1;
+  auto * copy = static_cast<char *>(allocate(size));
+  if (copy) {
+    memcpy(copy, string, size);
+  }
+  return copy;
+}
+
+void EntityArena::deallocate_string(const char * string)
+{
+  if (string) {
+    deallocate(const_cast<char *>(string), strlen(string) + 1);
+  }
+}
+
+}  // namespace rmw_zenoh_common_cpp
@@ -0,0 +1,89 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__ENTITY_ARENA_HPP_
+#define IMPL__ENTITY_ARENA_HPP_
+
+#include <cstddef>
+#include <mutex>
+
+#include "rcutils/allocator.h"
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// ENTITY ARENA ===============================================================
+// Per-node arena holding the metadata of the node and its entities (handles, names, data structs
+// and type supports).
+//
+// Blocks are carved out of large chunks taken from the context's allocator, so creating an entity
+// does not go to the heap once the node has a few chunks. Blocks given back when an entity is
+// destroyed are kept on a free list per size and reused by the next entity that needs a block of
+// that size, so create/destroy cycles do not grow the arena nor fragment the heap. Destroying the
+// arena hands all of its chunks back at once, without walking the blocks.
+class EntityArena
+{
+public:
+  explicit EntityArena(const rcutils_allocator_t & allocator);
+  ~EntityArena();
+
+  EntityArena(const EntityArena &) = delete;
+  EntityArena & operator=(const EntityArena &) = delete;
+
+  // Get a block of at least size bytes, aligned for any type (nullptr if out of memory)
+  void * allocate(size_t size);
+
+  // Give back a block, with the size it was allocated with
+  void deallocate(void * block, size_t size);
+
+  // Copy a string into the arena, and give the copy back
+  char * strdup(const char * string);
+  void deallocate_string(const char * string);
+
+private:
+  static constexpr size_t kAlignment = alignof(std::max_align_t);
+  static constexpr size_t kChunkSize = 16 * 1024;
+
+  // Bigger blocks get a chunk of their own, which is not reused before the arena is destroyed
+  static constexpr size_t kMaxPooledSize = kChunkSize / 4;
+  static constexpr size_t kNumSizeClasses = kMaxPooledSize / kAlignment;
+
+  struct Chunk
+  {
+    Chunk * next;
+  };
+
+  struct FreeBlock
+  {
+    FreeBlock * next;
+  };
+
+  static size_t round_up(size_t size) {return (size + kAlignment - 1) & ~(kAlignment - 1);}
+  static size_t header_size() {return round_up(sizeof(Chunk));}
+
+  // Take a new chunk with room for size bytes of blocks (nullptr if out of memory)
+  unsigned char * add_chunk(size_t size);
+
+  rcutils_allocator_t allocator_;
+
+  std::mutex mutex_;
+  Chunk * chunks_;
+  unsigned char * cursor_;  // Free space at the end of the last pooled chunk
+  size_t remaining_;
+  FreeBlock * free_lists_[kNumSizeClasses];
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__ENTITY_ARENA_HPP_
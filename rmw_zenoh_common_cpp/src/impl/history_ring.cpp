@@ -0,0 +1,209 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "history_ring.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+
+namespace rmw_zenoh_common_cpp
+{
+
+namespace
+{
+void write_uint64(uint64_t value, unsigned char * dst)
+{
+  for (size_t i = 0; i < 8; ++i) {
+    dst[i] = static_cast<unsigned char>(value >> (8 * i));
+  }
+}
+
+uint64_t read_uint64(const unsigned char * src)
+{
+  uint64_t value = 0;
+  for (size_t i = 0; i < 8; ++i) {
+    value |= static_cast<uint64_t>(src[i]) << (8 * i);
+  }
+  return value;
+}
+
+bool parse_int64(const std::string & value, int64_t & out)
+{
+  if (value.empty() || value[0] == '-') {
+    return false;
+  }
+  char * end = nullptr;
+  errno = 0;
+  long long parsed = strtoll(value.c_str(), &end, 10);  // NOLINT(runtime/int)
+  if (errno != 0 || *end != '\0') {
+    return false;
+  }
+  out = static_cast<int64_t>(parsed);
+  return true;
+}
+}  // namespace
+
+/// HISTORY QUERY ==============================================================
+std::string format_history_query(const HistoryQuery & query)
+{
+  std::string predicate;
+  auto add = [&predicate](const char * key, const std::string & value) {
+      predicate += (predicate.empty() ? "" : "&") + std::string(key) + "=" + value;
+    };
+  if (query.last > 0) {
+    add("last", std::to_string(query.last));
+  }
+  if (query.since > 0) {
+    add("since", std::to_string(query.since));
+  }
+  if (query.until > 0) {
+    add("until", std::to_string(query.until));
+  }
+  return predicate;
+}
+
+bool parse_history_query(const std::string & predicate, HistoryQuery & query)
+{
+  query = HistoryQuery();
+
+  size_t begin = 0;
+  while (begin < predicate.size()) {
+    size_t end = predicate.find('&', begin);
+    if (end == std::string::npos) {
+      end = predicate.size();
+    }
+    std::string part = predicate.substr(begin, end - begin);
+    begin = end + 1;
+
+    size_t equals = part.find('=');
+    if (equals == std::string::npos) {
+      return false;
+    }
+    std::string key = part.substr(0, equals);
+    std::string value = part.substr(equals + 1);
+
+    int64_t parsed = 0;
+    if (!parse_int64(value, parsed)) {
+      return false;
+    }
+    if (key == "last") {
+      query.last = static_cast<size_t>(parsed);
+    } else if (key == "since") {
+      query.since = parsed;
+    } else if (key == "until") {
+      query.until = parsed;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// HISTORY REPLY ==============================================================
+void write_history_reply_header(int64_t timestamp, uint64_t sequence, unsigned char * dst)
+{
+  write_uint64(static_cast<uint64_t>(timestamp), dst);
+  write_uint64(sequence, dst + 8);
+}
+
+bool read_history_reply_header(
+  const unsigned char * src, size_t length, int64_t & timestamp, uint64_t & sequence)
+{
+  if (length < kHistoryReplyHeaderSize) {
+    return false;
+  }
+  timestamp = static_cast<int64_t>(read_uint64(src));
+  sequence = read_uint64(src + 8);
+  return true;
+}
+
+/// HISTORY RING ===============================================================
+HistoryRing::HistoryRing(size_t depth, int64_t max_age)
+: max_age_(max_age),
+  slots_(std::max<size_t>(depth, 1)),
+  first_(0),
+  size_(0),
+  next_sequence_(0)
+{}
+
+void HistoryRing::push(int64_t timestamp, const unsigned char * data, size_t length)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  Entry * entry = nullptr;
+  if (size_ < slots_.size()) {
+    entry = &slots_[(first_ + size_) % slots_.size()];
+    ++size_;
+  } else {
+    // Overwrite the oldest sample
+    entry = &slots_[first_];
+    first_ = (first_ + 1) % slots_.size();
+  }
+  entry->timestamp = timestamp;
+  entry->sequence = next_sequence_++;
+  entry->data.assign(data, data + length);
+
+  // Drop the samples that aged out (the ones left behind by a clock set back are skipped by
+  // queries instead)
+  while (max_age_ > 0 && size_ > 1 && at(0).timestamp < timestamp - max_age_) {
+    first_ = (first_ + 1) % slots_.size();
+    --size_;
+  }
+}
+
+std::vector<std::vector<unsigned char>> HistoryRing::query(
+  const HistoryQuery & query, int64_t now) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  int64_t since = query.since;
+  if (max_age_ > 0) {
+    since = std::max(since, now - max_age_);
+  }
+
+  // Publication timestamps follow the system clock, which can be set back, so the samples in
+  // the range are searched for in the whole ring rather than taken as a contiguous run
+  std::vector<size_t> matches;
+  matches.reserve(size_);
+  for (size_t i = 0; i < size_; ++i) {
+    int64_t timestamp = at(i).timestamp;
+    if (timestamp >= since && (query.until <= 0 || timestamp <= query.until)) {
+      matches.push_back(i);
+    }
+  }
+  size_t first = 0;
+  if (query.last > 0 && matches.size() > query.last) {
+    first = matches.size() - query.last;
+  }
+
+  std::vector<std::vector<unsigned char>> replies(matches.size() - first);
+  for (size_t i = first; i < matches.size(); ++i) {
+    const Entry & entry = at(matches[i]);
+    std::vector<unsigned char> & reply = replies[i - first];
+    reply.resize(kHistoryReplyHeaderSize + entry.data.size());
+    write_history_reply_header(entry.timestamp, entry.sequence, reply.data());
+    std::copy(entry.data.begin(), entry.data.end(), reply.begin() + kHistoryReplyHeaderSize);
+  }
+  return replies;
+}
+
+size_t HistoryRing::size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_;
+}
+
+}  // namespace rmw_zenoh_common_cpp
@@ -0,0 +1,106 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef IMPL__HISTORY_RING_HPP_
+#define IMPL__HISTORY_RING_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rmw_zenoh_common_cpp
+{
+
+// Suffix of the key publishers keeping a history answer history queries on
+constexpr char kHistoryKeySuffix[] = "/history";
+
+/// HISTORY QUERY ==============================================================
+// Samples asked for by a history query. Carried as the query predicate, in the form
+//
+//   last=<n>&since=<ns>&until=<ns>
+//
+// with every part optional. Timestamps are nanoseconds since the epoch (system clock), and the
+// range includes both ends.
+struct HistoryQuery
+{
+  size_t last = 0;  // Only the last n samples in the range (0 for all of them)
+  int64_t since = 0;
+  int64_t until = 0;  // 0 for no upper bound
+};
+
+std::string format_history_query(const HistoryQuery & query);
+
+// Returns false if the predicate is malformed
+bool parse_history_query(const std::string & predicate, HistoryQuery & query);
+
+/// HISTORY REPLY ==============================================================
+// Every sample is sent in a reply of its own, with the serialized message (CDR, as published)
+// after a header.
+//
+// Wire layout (little endian):
+//   0: publication timestamp (int64, nanoseconds since the epoch)
+//   8: sequence number of the sample at its publisher (uint64)
+constexpr size_t kHistoryReplyHeaderSize = 16;
+
+void write_history_reply_header(int64_t timestamp, uint64_t sequence, unsigned char * dst);
+
+// Returns false if the reply is too short
+bool read_history_reply_header(
+  const unsigned char * src, size_t length, int64_t & timestamp, uint64_t & sequence);
+
+/// HISTORY RING ===============================================================
+// Last samples published by a publisher, kept serialized to answer history queries.
+//
+// The ring holds at most depth samples, and drops the ones older than max_age. The storage of a
+// slot is reused by the samples that replace it, so a publisher with a steady message size stops
+// allocating once the ring has gone around once.
+class HistoryRing
+{
+public:
+  // max_age in nanoseconds (0 for no limit)
+  HistoryRing(size_t depth, int64_t max_age);
+
+  // Keep a sample published at timestamp (system clock, which may go backwards)
+  void push(int64_t timestamp, const unsigned char * data, size_t length);
+
+  // Replies for the samples matching a query, in publication order, as of now
+  std::vector<std::vector<unsigned char>> query(const HistoryQuery & query, int64_t now) const;
+
+  size_t size() const;
+
+private:
+  struct Entry
+  {
+    int64_t timestamp;
+    uint64_t sequence;
+    std::vector<unsigned char> data;
+  };
+
+  const Entry & at(size_t index) const {return slots_[(first_ + index) % slots_.size()];}
+
+  int64_t max_age_;
+
+  mutable std::mutex mutex_;
+  std::vector<Entry> slots_;
+  size_t first_;
+  size_t size_;
+  uint64_t next_sequence_;
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__HISTORY_RING_HPP_
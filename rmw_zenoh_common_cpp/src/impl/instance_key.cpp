@@ -0,0 +1,209 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "instance_key.hpp"
+
+#include <string>
+
+#include "rosidl_runtime_c/string.h"
+
+#include "rosidl_typesupport_introspection_c/field_types.h"
+#include "rosidl_typesupport_introspection_c/identifier.h"
+#include "rosidl_typesupport_introspection_c/message_introspection.h"
+
+#include "rosidl_typesupport_introspection_cpp/field_types.hpp"
+#include "rosidl_typesupport_introspection_cpp/identifier.hpp"
+#include "rosidl_typesupport_introspection_cpp/message_introspection.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+
+namespace
+{
+// NOTE: The C and C++ introspection type supports use the same field type IDs
+static_assert(
+  rosidl_typesupport_introspection_c__ROS_TYPE_STRING ==
+  rosidl_typesupport_introspection_cpp::ROS_TYPE_STRING &&
+  rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE ==
+  rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE,
+  "introspection field type IDs differ between C and C++");
+
+constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+constexpr uint64_t kFnvPrime = 1099511628211ULL;
+
+// FNV-1a
+uint64_t hash_bytes(const void * data, size_t length)
+{
+  const unsigned char * bytes = static_cast<const unsigned char *>(data);
+  uint64_t hash = kFnvOffsetBasis;
+  for (size_t i = 0; i < length; ++i) {
+    hash = (hash ^ bytes[i]) * kFnvPrime;
+  }
+  return hash;
+}
+
+// Whether a field type is hashed as an integer
+bool is_integer_field(uint8_t type_id)
+{
+  switch (type_id) {
+    case rosidl_typesupport_introspection_c__ROS_TYPE_CHAR:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_BOOLEAN:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_OCTET:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT8:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT8:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT16:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT16:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT32:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT32:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT64:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT64:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Walk the dotted field path through the (C or C++) introspection members of the type, adding
+// up the offsets of the nested fields
+template<typename MessageMembersT>
+bool find_field(
+  const MessageMembersT * members,
+  const std::string & field,
+  uint8_t & type_id,
+  size_t & offset,
+  std::string & error)
+{
+  offset = 0;
+  size_t begin = 0;
+  while (true) {
+    size_t end = field.find('.', begin);
+    std::string name = end == std::string::npos ?
+      field.substr(begin) : field.substr(begin, end - begin);
+
+    decltype(members->members_) member = nullptr;
+    for (uint32_t i = 0; i < members->member_count_; ++i) {
+      if (name == members->members_[i].name_) {
+        member = &members->members_[i];
+        break;
+      }
+    }
+    if (!member) {
+      error = "message " + std::string(members->message_namespace_) + "::" +
+        members->message_name_ + " has no field '" + name + "'";
+      return false;
+    }
+    if (member->is_array_) {
+      error = "array field '" + name + "' cannot be a key";
+      return false;
+    }
+
+    offset += member->offset_;
+
+    if (end == std::string::npos) {
+      type_id = member->type_id_;
+      if (type_id != rosidl_typesupport_introspection_c__ROS_TYPE_STRING &&
+        !is_integer_field(type_id))
+      {
+        error = "field '" + name + "' is not an integer, boolean, char or string";
+        return false;
+      }
+      return true;
+    }
+
+    if (member->type_id_ != rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE) {
+      error = "field '" + name + "' is not a message";
+      return false;
+    }
+    members = static_cast<const MessageMembersT *>(member->members_->data);
+    begin = end + 1;
+  }
+}
+}  // namespace
+
+/// INIT =======================================================================
+bool InstanceKey::init(
+  const rosidl_message_type_support_t * type_supports,
+  bool is_cpp,
+  const std::string & field,
+  std::string & error)
+{
+  is_cpp_ = is_cpp;
+
+  const char * identifier = is_cpp ?
+    rosidl_typesupport_introspection_cpp::typesupport_identifier :
+    rosidl_typesupport_introspection_c__identifier;
+  const rosidl_message_type_support_t * introspection =
+    get_message_typesupport_handle(type_supports, identifier);
+  if (!introspection) {
+    error = "no introspection type support for the message type";
+    return false;
+  }
+
+  if (is_cpp) {
+    return find_field(
+      static_cast<const rosidl_typesupport_introspection_cpp::MessageMembers *>(
+        introspection->data),
+      field, type_id_, offset_, error);
+  }
+  return find_field(
+    static_cast<const rosidl_typesupport_introspection_c__MessageMembers *>(introspection->data),
+    field, type_id_, offset_, error);
+}
+
+/// GET ========================================================================
+uint64_t InstanceKey::get(const void * ros_message) const
+{
+  const unsigned char * value = static_cast<const unsigned char *>(ros_message) + offset_;
+
+  if (type_id_ == rosidl_typesupport_introspection_c__ROS_TYPE_STRING) {
+    if (is_cpp_) {
+      const auto * string = reinterpret_cast<const std::string *>(value);
+      return hash_bytes(string->data(), string->size());
+    }
+    const auto * string = reinterpret_cast<const rosidl_runtime_c__String *>(value);
+    return hash_bytes(string->data, string->size);
+  }
+
+  // Integers are hashed by value, so the key does not depend on the width of the field
+  int64_t integer = 0;
+  switch (type_id_) {
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT8:
+      integer = *reinterpret_cast<const int8_t *>(value);
+      break;
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT16:
+      integer = *reinterpret_cast<const int16_t *>(value);
+      break;
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT32:
+      integer = *reinterpret_cast<const int32_t *>(value);
+      break;
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT64:
+      integer = *reinterpret_cast<const int64_t *>(value);
+      break;
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT16:
+      integer = *reinterpret_cast<const uint16_t *>(value);
+      break;
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT32:
+      integer = *reinterpret_cast<const uint32_t *>(value);
+      break;
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT64:
+      integer = static_cast<int64_t>(*reinterpret_cast<const uint64_t *>(value));
+      break;
+    default:  // Single byte types (and bool, which is a byte in both C and C++)
+      integer = *value;
+      break;
+  }
+  return hash_bytes(&integer, sizeof(integer));
+}
+
+}  // namespace rmw_zenoh_common_cpp
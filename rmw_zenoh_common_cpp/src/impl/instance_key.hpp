@@ -0,0 +1,56 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__INSTANCE_KEY_HPP_
+#define IMPL__INSTANCE_KEY_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// INSTANCE KEY ===============================================================
+// Reads the instance key of messages of a keyed topic out of a field of the message.
+//
+// The field is given by its name, with '.' separating the names of nested message fields (for
+// example "header.frame_id"). It must be an integer, boolean, char or string field, and not an
+// array. The key is a 64 bit hash of the field's value.
+class InstanceKey
+{
+public:
+  // Look up the field in the introspection type support of the message type (for the same
+  // language as the type support the publisher uses). Returns false, with a description of the
+  // problem in error, if the field does not exist or cannot be used as a key.
+  bool init(
+    const rosidl_message_type_support_t * type_supports,
+    bool is_cpp,
+    const std::string & field,
+    std::string & error);
+
+  // Hash the key field of a message
+  uint64_t get(const void * ros_message) const;
+
+private:
+  bool is_cpp_ = false;
+  uint8_t type_id_ = 0;
+  size_t offset_ = 0;
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__INSTANCE_KEY_HPP_
@@ -0,0 +1,154 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "latency_monitor.hpp"
+
+#include <algorithm>
+
+namespace rmw_zenoh_common_cpp
+{
+
+constexpr size_t LatencyMonitor::kSlices;
+constexpr size_t LatencyMonitor::kBuckets;
+
+LatencyMonitor::LatencyMonitor(int64_t budget, int64_t window)
+: budget_(budget),
+  window_(std::max<int64_t>(window, kSlices)),
+  slice_length_(window_ / static_cast<int64_t>(kSlices)),
+  slices_(kSlices),
+  total_count_(0),
+  head_slice_(0),
+  breached_(false),
+  breaches_(0),
+  over_budget_(0),
+  max_latency_(0)
+{
+  for (Histogram & slice : slices_) {
+    slice.fill(0);
+  }
+  total_.fill(0);
+}
+
+/// BUCKETS ====================================================================
+size_t LatencyMonitor::bucket(int64_t latency)
+{
+  // Samples stamped after they were taken (by a clock that is ahead) count as 0
+  uint64_t us = latency > 0 ? static_cast<uint64_t>(latency) / 1000 : 0;
+  us = std::min<uint64_t>(us, (uint64_t(1) << kMaxExponent) - 1);
+  if (us < (uint64_t(1) << kSubBucketBits)) {
+    return static_cast<size_t>(us);
+  }
+
+  int exponent = kSubBucketBits;
+  while ((us >> (exponent + 1)) != 0) {
+    ++exponent;
+  }
+  uint64_t sub_bucket = (us >> (exponent - kSubBucketBits)) & ((1 << kSubBucketBits) - 1);
+  return (static_cast<size_t>(exponent - kSubBucketBits + 1) << kSubBucketBits) + sub_bucket;
+}
+
+int64_t LatencyMonitor::bucket_limit(size_t bucket)
+{
+  if (bucket < (size_t(1) << kSubBucketBits)) {
+    return static_cast<int64_t>(bucket + 1) * 1000;
+  }
+  int exponent = static_cast<int>(bucket >> kSubBucketBits) + kSubBucketBits - 1;
+  uint64_t sub_bucket = bucket & ((1 << kSubBucketBits) - 1);
+  uint64_t width = uint64_t(1) << (exponent - kSubBucketBits);
+  uint64_t lower = ((uint64_t(1) << kSubBucketBits) + sub_bucket) * width;
+  return static_cast<int64_t>(lower + width) * 1000;
+}
+
+/// ADVANCE ====================================================================
+void LatencyMonitor::advance(int64_t now)
+{
+  int64_t slice = now / slice_length_;
+  if (slice <= head_slice_) {
+    return;
+  }
+
+  if (slice - head_slice_ >= static_cast<int64_t>(kSlices)) {
+    for (Histogram & histogram : slices_) {
+      histogram.fill(0);
+    }
+    total_.fill(0);
+    total_count_ = 0;
+  } else {
+    for (int64_t s = head_slice_ + 1; s <= slice; ++s) {
+      Histogram & expired = slices_[static_cast<size_t>(s) % kSlices];
+      for (size_t b = 0; b < kBuckets; ++b) {
+        total_[b] -= expired[b];
+        total_count_ -= expired[b];
+      }
+      expired.fill(0);
+    }
+  }
+  head_slice_ = slice;
+}
+
+/// RECORD =====================================================================
+bool LatencyMonitor::record(int64_t latency, int64_t now)
+{
+  advance(now);
+
+  size_t b = bucket(latency);
+  ++slices_[static_cast<size_t>(head_slice_) % kSlices][b];
+  ++total_[b];
+  ++total_count_;
+
+  max_latency_ = std::max(max_latency_, latency);
+  if (latency > budget_) {
+    ++over_budget_;
+  }
+
+  bool breached = percentile(0.99, now) > budget_;
+  bool became_breached = breached && !breached_;
+  breached_ = breached;
+  if (became_breached) {
+    ++breaches_;
+  }
+  return became_breached;
+}
+
+/// PERCENTILE =================================================================
+int64_t LatencyMonitor::percentile(double p, int64_t now)
+{
+  advance(now);
+  if (total_count_ == 0) {
+    return 0;
+  }
+
+  // Rank of the sample at the percentile, counting from 1
+  uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(total_count_) + 0.999999);
+  rank = std::min<uint64_t>(std::max<uint64_t>(rank, 1), total_count_);
+
+  uint64_t seen = 0;
+  for (size_t b = 0; b < kBuckets; ++b) {
+    seen += total_[b];
+    if (seen >= rank) {
+      // The bucket's limit is exclusive, and no latency over the highest one is recorded
+      return std::min(bucket_limit(b), std::max<int64_t>(max_latency_, 0));
+    }
+  }
+  return bucket_limit(kBuckets - 1);
+}
+
+/// COUNT ======================================================================
+uint64_t LatencyMonitor::count(int64_t now)
+{
+  advance(now);
+  return total_count_;
+}
+
+}  // namespace rmw_zenoh_common_cpp
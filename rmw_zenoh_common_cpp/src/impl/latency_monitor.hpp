@@ -0,0 +1,96 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__LATENCY_MONITOR_HPP_
+#define IMPL__LATENCY_MONITOR_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// LATENCY MONITOR ============================================================
+// Latencies of the samples taken by a subscription, from the source timestamps of the samples,
+// over a sliding window, checked against a latency budget.
+//
+// Latencies are counted in a histogram of fixed buckets: one per microsecond up to 16 us, then 16
+// per power of two, so a percentile is never off by more than 1/16 of its value. The window is
+// split in slices with a histogram each; the histogram of the window is the sum of those of its
+// slices, and the oldest slice is taken out of it as the window slides.
+//
+// The budget is breached when the 99th percentile of the window goes over it, and stays breached
+// until it is back under.
+class LatencyMonitor
+{
+public:
+  // budget and window in nanoseconds
+  LatencyMonitor(int64_t budget, int64_t window);
+
+  // Count the latency of a sample taken at now (both in nanoseconds).
+  // Returns true if the budget became breached.
+  bool record(int64_t latency, int64_t now);
+
+  // Latency at or under which a fraction p of the samples of the window at now are, in
+  // nanoseconds (rounded up to the bucket it falls in, 0 if the window has no samples)
+  int64_t percentile(double p, int64_t now);
+
+  // Samples in the window at now
+  uint64_t count(int64_t now);
+
+  int64_t budget() const {return budget_;}
+  int64_t window() const {return window_;}
+
+  // Whether the budget is breached, and the number of times it became breached
+  bool breached() const {return breached_;}
+  uint64_t breaches() const {return breaches_;}
+
+  // Samples over the budget, and the highest latency seen (in nanoseconds), since creation
+  uint64_t over_budget() const {return over_budget_;}
+  int64_t max_latency() const {return max_latency_;}
+
+private:
+  static constexpr size_t kSlices = 10;
+  static constexpr int kSubBucketBits = 4;
+  static constexpr int kMaxExponent = 36;  // Latencies are capped at 2^36 us (about 19 hours)
+  static constexpr size_t kBuckets = (kMaxExponent - kSubBucketBits + 1) << kSubBucketBits;
+
+  using Histogram = std::array<uint32_t, kBuckets>;
+
+  static size_t bucket(int64_t latency);
+  static int64_t bucket_limit(size_t bucket);
+
+  // Take the slices that have left the window at now out of it
+  void advance(int64_t now);
+
+  int64_t budget_;
+  int64_t window_;
+  int64_t slice_length_;
+
+  std::vector<Histogram> slices_;
+  Histogram total_;
+  uint64_t total_count_;
+  int64_t head_slice_;  // Number of the newest slice (time / slice length)
+
+  bool breached_;
+  uint64_t breaches_;
+  uint64_t over_budget_;
+  int64_t max_latency_;
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__LATENCY_MONITOR_HPP_
@@ -0,0 +1,111 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "overload_detector.hpp"
+
+#include <algorithm>
+
+#include "rcutils/logging_macros.h"
+
+namespace rmw_zenoh_common_cpp
+{
+
+constexpr int64_t OverloadDetector::kSlice;
+constexpr double OverloadDetector::kRecovery;
+
+OverloadDetector::OverloadDetector(int64_t max_delay, size_t max_bytes)
+: max_delay_(max_delay),
+  max_bytes_(max_bytes),
+  slice_start_(0),
+  slice_max_delay_(0),
+  previous_max_delay_(0),
+  level_(0)
+{}
+
+/// RECORD DELAY ===============================================================
+void OverloadDetector::record_delay(int64_t delay, int64_t now)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  roll(now);
+  slice_max_delay_ = std::max(slice_max_delay_, delay);
+}
+
+/// SHED =======================================================================
+bool OverloadDetector::shed(TopicPriority priority, size_t bytes_in_use, int64_t now)
+{
+  if (priority == TopicPriority::kHigh) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  roll(now);
+
+  double load = 0.0;
+  if (max_delay_ > 0) {
+    int64_t delay = std::max(slice_max_delay_, previous_max_delay_);
+    load = static_cast<double>(delay) / static_cast<double>(max_delay_);
+  }
+  if (max_bytes_ > 0) {
+    load = std::max(load, static_cast<double>(bytes_in_use) / static_cast<double>(max_bytes_));
+  }
+
+  int level = level_;
+  if (load >= 2.0) {
+    level = 2;
+  } else if (load >= 1.0) {
+    level = std::max(level, 1);
+  }
+  while (level > 0 && load < kRecovery * level) {
+    --level;
+  }
+
+  if (level != level_) {
+    if (level > level_) {
+      RCUTILS_LOG_WARN_NAMED(
+        "rmw_zenoh_common_cpp",
+        "Receive path overloaded (load %.2f), shedding %s priority samples",
+        load,
+        level == 1 ? "low" : "low and normal");
+    } else {
+      RCUTILS_LOG_INFO_NAMED(
+        "rmw_zenoh_common_cpp",
+        "Receive path load down to %.2f, %s",
+        load,
+        level == 0 ? "no longer shedding samples" : "shedding low priority samples only");
+    }
+    level_ = level;
+  }
+
+  return static_cast<int>(priority) < level_;
+}
+
+int OverloadDetector::level() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return level_;
+}
+
+/// ROLL =======================================================================
+void OverloadDetector::roll(int64_t now)
+{
+  if (now - slice_start_ < kSlice) {
+    return;
+  }
+  // A slice with no samples taken in it counts as no delay
+  previous_max_delay_ = now - slice_start_ < 2 * kSlice ? slice_max_delay_ : 0;
+  slice_max_delay_ = 0;
+  slice_start_ = now;
+}
+
+}  // namespace rmw_zenoh_common_cpp
@@ -0,0 +1,71 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__OVERLOAD_DETECTOR_HPP_
+#define IMPL__OVERLOAD_DETECTOR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "config.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// OVERLOAD DETECTOR ==========================================================
+// Watches the receive path of a context, and decides which priority classes of samples to shed
+// when it is overloaded.
+//
+// The load is the higher of two ratios: the queue delay (the longest time a sample waited to be
+// taken over the last one or two kSlice) over its threshold, and the bytes of receive buffers in
+// use over theirs. Low priority samples are shed from a load of 1, and normal priority ones too
+// from a load of 2. Shedding of a class stops once the load drops under kRecovery times the load
+// it started at, so the level does not flap around a threshold.
+class OverloadDetector
+{
+public:
+  static constexpr int64_t kSlice = 100000000;  // 100 ms
+  static constexpr double kRecovery = 0.8;
+
+  // max_delay in nanoseconds and max_bytes in bytes (0 to not watch either)
+  OverloadDetector(int64_t max_delay, size_t max_bytes);
+
+  // Count the time a sample waited between being received and taken, at now (steady clock)
+  void record_delay(int64_t delay, int64_t now);
+
+  // Whether a sample of a priority class received at now (steady clock) should be shed, with
+  // bytes_in_use bytes of receive buffers in use
+  bool shed(TopicPriority priority, size_t bytes_in_use, int64_t now);
+
+  // Priority classes being shed: 0 for none, 1 for low, 2 for low and normal
+  int level() const;
+
+private:
+  // Start a new slice if the current one is over. Must be called with mutex_ held.
+  void roll(int64_t now);
+
+  const int64_t max_delay_;
+  const size_t max_bytes_;
+
+  mutable std::mutex mutex_;
+  int64_t slice_start_;
+  int64_t slice_max_delay_;
+  int64_t previous_max_delay_;
+  int level_;
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__OVERLOAD_DETECTOR_HPP_
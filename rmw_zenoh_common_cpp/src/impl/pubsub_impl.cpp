@@ -14,6 +14,8 @@
 
 #include "pubsub_impl.hpp"
 
+#include <algorithm>
+#include <cinttypes>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -23,6 +25,7 @@
 
 #include "rmw_zenoh_common_cpp/TypeSupport.hpp"
 #include "rcutils/logging_macros.h"
+#include "rcutils/time.h"
 
 std::mutex sub_callback_mutex;
 
@@ -34,50 +37,438 @@ std::atomic<size_t> rmw_subscription_data_t::subscription_id_counter(0);
 // Map of Zenoh topic key expression to subscription data
 std::unordered_map<std::string, std::vector<rmw_subscription_data_t *>>
   rmw_subscription_data_t::zn_topic_to_sub_data;
-// *INDENT-ON*
 
+// Map of Zenoh topic key expression to delta encoded stream state
+std::unordered_map<std::string, rmw_zenoh_common_cpp::DeltaStreams>
+  rmw_subscription_data_t::zn_topic_to_delta_streams;
 
-/// ZENOH MESSAGE SUBSCRIPTION CALLBACK (static method) ========================
-void rmw_subscription_data_t::zn_sub_callback(const zn_sample_t * sample, const void *)
-{
-  std::lock_guard<std::mutex> guard(sub_callback_mutex);
+// Map of Zenoh topic key expression to duplicate filter
+std::unordered_map<std::string, rmw_zenoh_common_cpp::DuplicateFilter>
+  rmw_subscription_data_t::zn_topic_to_duplicate_filter;
+// *INDENT-ON*
 
-  // NOTE(CH3): We unfortunately have to do this copy construction since we shouldn't be using
-  // char * as keys to the unordered_map
-  std::string key(sample->key.val, sample->key.len);
 
-  // Vector to store the byte array (so we have a copyable container instead of a pointer)
-  std::vector<unsigned char> byte_vec(sample->value.val, sample->value.val + sample->value.len);
+namespace
+{
+using DispatcherList = std::vector<std::shared_ptr<rmw_zenoh_common_cpp::DirectDispatcher>>;
 
-  // Get shared pointer to byte array vector
-  // NOTE(CH3): We use a shared pointer to avoid copies and to leverage on the smart pointer's
-  // reference counting
-  auto byte_vec_ptr = std::make_shared<std::vector<unsigned char>>(std::move(byte_vec));
+/// HANDLE SAMPLE ==============================================================
+// Decode a sample received on a topic and push it to the message queues of its subscriptions.
+//
+// The subscriptions with a direct dispatch callback are added to dispatchers instead, with the
+// sample in dispatched, for the caller to call them once sub_callback_mutex is released (so the
+// callbacks can publish, and create or destroy entities).
+//
+// Returns the session to query a keyframe of the topic with, if the sample was a delta that could
+// not be applied (nullptr otherwise). The query is left to the caller, so it is not sent while
+// holding sub_callback_mutex.
+zn_session_t * handle_sample(
+  const std::string & key,
+  const unsigned char * data,
+  size_t length,
+  rmw_zenoh_common_cpp::ReceiveBufferPool & pool,
+  DispatcherList & dispatchers,
+  rmw_zenoh_common_cpp::ReceiveBufferPtr & dispatched)
+{
+  std::lock_guard<std::mutex> guard(sub_callback_mutex);
 
   auto map_iter = rmw_subscription_data_t::zn_topic_to_sub_data.find(key);
 
   // If the key was not found in the map, it means that there are no RMW subscriptions listening
   // on this topic, so this message can be dropped without issue
-  if (map_iter != rmw_subscription_data_t::zn_topic_to_sub_data.end()) {
-    // Push shared pointer to message bytes to all associated subscription message queues
+  if (map_iter == rmw_subscription_data_t::zn_topic_to_sub_data.end()) {
+    return nullptr;
+  }
+
+  // Shed the samples of the lower priority topics first when the receive path is overloaded. The
+  // subscriptions on a topic share its config, so the first one has the priority of all of them.
+  rmw_subscription_data_t * first = map_iter->second.front();
+  rcutils_time_point_value_t receive_time = 0;
+  if (first->overload_detector_) {
+    rcutils_steady_time_now(&receive_time);
+    if (first->overload_detector_->shed(first->priority_, pool.bytes_in_use(), receive_time)) {
+      for (auto it = map_iter->second.begin(); it != map_iter->second.end(); ++it) {
+        std::lock_guard<std::mutex> lock((*it)->message_queue_mutex_);
+        ++(*it)->shed_samples_;
+      }
+      return nullptr;
+    }
+  }
+
+  // Drop samples of another message type before spending anything on them
+  rmw_zenoh_common_cpp::SampleHeader header;
+  size_t header_size;
+  bool typed = false;
+  bool has_header = rmw_zenoh_common_cpp::read_sample_header(data, length, header, header_size);
+  if (has_header && (header.flags & rmw_zenoh_common_cpp::kSampleFlagType)) {
+    typed = true;
+    bool accepted = false;
     for (auto it = map_iter->second.begin(); it != map_iter->second.end(); ++it) {
-      std::unique_lock<std::mutex> lock((*it)->message_queue_mutex_);
-
-      if ((*it)->zn_message_queue_.size() >= (*it)->queue_depth_) {
-        // Log warning if message is discarded due to hitting the queue depth
-        RCUTILS_LOG_WARN_NAMED(
-          "rmw_zenoh_common_cpp",
-          "Message queue depth of %ld reached, discarding oldest message "
-          "for subscription for %s (ID: %ld)",
-          (*it)->queue_depth_,
-          key.c_str(),
-          (*it)->subscription_id_);
-
-        (*it)->zn_message_queue_.pop_back();
+      std::lock_guard<std::mutex> lock((*it)->message_queue_mutex_);
+      accepted = (*it)->accepts_type(header.type_hash) || accepted;
+    }
+    if (!accepted) {
+      return nullptr;
+    }
+  }
+
+  // Drop the copies of a sample that came over redundant paths, before decoding them. The filter
+  // is shared by the subscriptions on the topic, since they all get the same samples.
+  if (has_header && (header.flags & rmw_zenoh_common_cpp::kSampleFlagSequence) &&
+    rmw_subscription_data_t::zn_topic_to_duplicate_filter[key].duplicate(header))
+  {
+    RCUTILS_LOG_DEBUG_NAMED(
+      "rmw_zenoh_common_cpp",
+      "Dropping duplicate of message %" PRIu64 " for %s",
+      header.publisher_sequence,
+      key.c_str());
+    return nullptr;
+  }
+
+  // Decode the sample out of Zenoh's buffer ONCE, into a pooled buffer
+  // NOTE: The buffer's reference count is intrusive, so handing it to every subscription queue
+  // below does not allocate
+  rmw_zenoh_common_cpp::ReceiveBufferPtr buffer = rmw_zenoh_common_cpp::decode_sample(
+    data, length, pool, key.c_str(), header);
+  if (!buffer) {
+    return nullptr;
+  }
+
+  // Reconstruct samples of delta encoded streams
+  if (header.flags & rmw_zenoh_common_cpp::kSampleFlagStream) {
+    bool request_keyframe;
+    buffer = rmw_subscription_data_t::zn_topic_to_delta_streams[key].apply(
+      header, buffer, pool, key.c_str(), request_keyframe);
+    if (!buffer) {
+      return request_keyframe ? map_iter->second.front()->zn_session_ : nullptr;
+    }
+  }
+
+  // Push the pooled buffer to all associated subscription message queues (through their reorder
+  // buffers, for samples stamped by their publishers)
+  uint64_t instance = (header.flags & rmw_zenoh_common_cpp::kSampleFlagInstance) ?
+    header.instance : 0;
+  bool stamped = (header.flags & rmw_zenoh_common_cpp::kSampleFlagTimestamp) != 0;
+  if (stamped) {
+    buffer->set_source_timestamp(header.timestamp);
+  }
+  buffer->set_receive_time(receive_time);
+  rcutils_time_point_value_t now = 0;
+  for (auto it = map_iter->second.begin(); it != map_iter->second.end(); ++it) {
+    std::lock_guard<std::mutex> lock((*it)->message_queue_mutex_);
+
+    // Already counted above if incompatible
+    if (typed && (*it)->type_hash_ != 0 && (*it)->type_hash_ != header.type_hash) {
+      continue;
+    }
+
+    // Direct dispatch skips the reorder buffer too, since nothing would release it
+    if ((*it)->direct_dispatcher_->active()) {
+      (*it)->record_latency(buffer);
+      dispatchers.push_back((*it)->direct_dispatcher_);
+      dispatched = buffer;
+      continue;
+    }
+
+    rmw_zenoh_common_cpp::ReorderBuffer * reorder_buffer = (*it)->reorder_buffer_;
+    if (reorder_buffer && stamped) {
+      if (now == 0) {
+        rcutils_steady_time_now(&now);
       }
-      (*it)->zn_message_queue_.push_front(byte_vec_ptr);
+      if (reorder_buffer->push(buffer, instance, header.timestamp, now)) {
+        (*it)->release_reordered_samples(now);
+        continue;
+      }
+      RCUTILS_LOG_DEBUG_NAMED(
+        "rmw_zenoh_common_cpp",
+        "Message for %s (ID: %zu) arrived too late to be reordered",
+        key.c_str(),
+        (*it)->subscription_id_);
+    }
+    (*it)->enqueue(buffer, instance);
+  }
+
+  return nullptr;
+}
+
+/// REQUEST KEYFRAME ===========================================================
+// Ask the publishers of a delta encoded topic for their last sample
+void request_keyframe(zn_session_t * session, const std::string & key, const void * arg)
+{
+  RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "Requesting a keyframe for %s", key.c_str());
+
+  // Every publisher replies on the same key, so the replies must not be consolidated
+  zn_query_consolidation_t consolidation;
+  consolidation.first_routers = zn_consolidation_mode_t_NONE;
+  consolidation.last_router = zn_consolidation_mode_t_NONE;
+  consolidation.reception = zn_consolidation_mode_t_NONE;
+
+  std::string keyframe_key = key + rmw_zenoh_common_cpp::kKeyframeKeySuffix;
+  zn_query(
+    session,
+    zn_rname(keyframe_key.c_str()),
+    "",
+    zn_query_target_default(),
+    consolidation,
+    rmw_subscription_data_t::zn_keyframe_reply_callback,
+    const_cast<void *>(arg));
+}
+
+/// DISPATCH SAMPLE ============================================================
+// Call the direct dispatch callbacks handle_sample() left to the caller
+void dispatch_sample(
+  DispatcherList & dispatchers,
+  rmw_zenoh_common_cpp::ReceiveBufferPtr & dispatched)
+{
+  if (dispatchers.empty()) {
+    return;
+  }
+
+  // A callback that publishes to a local subscription gets back here on this thread, so the list
+  // is set aside while it is called
+  DispatcherList pending;
+  pending.swap(dispatchers);
+  for (auto & dispatcher : pending) {
+    dispatcher->dispatch(dispatched);
+  }
+  dispatched.reset();
 
-      (*it)->message_queue_mutex_.unlock();
+  // Keep the storage of the list for the next sample
+  pending.clear();
+  if (dispatchers.capacity() < pending.capacity()) {
+    dispatchers.swap(pending);
+  }
+}
+}  // namespace
+
+/// ENQUEUE ====================================================================
+void rmw_subscription_data_t::enqueue(
+  const rmw_zenoh_common_cpp::ReceiveBufferPtr & sample, uint64_t instance)
+{
+  if (!zn_message_queue_.push(sample, instance)) {
+    ++overflowed_samples_;
+
+    // Log warning if message is discarded due to hitting the queue depth
+    if (zn_message_queue_.keyed()) {
+      RCUTILS_LOG_WARN_NAMED(
+        "rmw_zenoh_common_cpp",
+        "Message queue depth of %zu reached for instance %016" PRIx64 ", discarding its oldest "
+        "message for subscription for %s (ID: %zu)",
+        zn_message_queue_.depth(),
+        instance,
+        topic_name_,
+        subscription_id_);
+    } else {
+      RCUTILS_LOG_WARN_NAMED(
+        "rmw_zenoh_common_cpp",
+        "Message queue depth of %zu reached, discarding oldest message "
+        "for subscription for %s (ID: %zu)",
+        zn_message_queue_.depth(),
+        topic_name_,
+        subscription_id_);
     }
   }
+  ready_claims_.set_available(zn_message_queue_.size());
+}
+
+/// ACCEPTS TYPE ===============================================================
+bool rmw_subscription_data_t::accepts_type(uint64_t type_hash)
+{
+  if (type_hash_ == 0 || type_hash == type_hash_) {
+    return true;
+  }
+
+  // Raise the incompatible QoS event once per incompatible type
+  if (incompatible_types_.insert(type_hash).second) {
+    RCUTILS_LOG_WARN_NAMED(
+      "rmw_zenoh_common_cpp",
+      "Dropping messages for %s (ID: %zu) of a message type with hash %016" PRIx64 " instead of "
+      "%016" PRIx64 ": the publisher and subscription disagree on the type or its definition",
+      topic_name_,
+      subscription_id_,
+      type_hash,
+      type_hash_);
+  }
+  return false;
+}
+
+/// RELEASE REORDERED SAMPLES ==================================================
+void rmw_subscription_data_t::release_reordered_samples(int64_t now)
+{
+  if (!reorder_buffer_ || reorder_buffer_->empty()) {
+    return;
+  }
+  if (now == 0) {
+    rcutils_steady_time_now(&now);
+  }
+
+  rmw_zenoh_common_cpp::ReceiveBufferPtr sample;
+  uint64_t instance;
+  while (reorder_buffer_->pop(now, sample, instance)) {
+    enqueue(sample, instance);
+  }
+}
+
+/// RECORD LATENCY =============================================================
+void rmw_subscription_data_t::record_latency(const rmw_zenoh_common_cpp::ReceiveBufferPtr & sample)
+{
+  if (!latency_monitor_ || sample->source_timestamp() == 0) {
+    return;
+  }
+
+  // Source timestamps are taken from the system clock of the publisher
+  rcutils_time_point_value_t now;
+  if (rcutils_system_time_now(&now) != RCUTILS_RET_OK) {
+    return;
+  }
+
+  if (latency_monitor_->record(now - sample->source_timestamp(), now)) {
+    RCUTILS_LOG_WARN_NAMED(
+      "rmw_zenoh_common_cpp",
+      "99th percentile latency of %.3f ms over the last %" PRId64 " ms is over the budget of "
+      "%.3f ms for subscription for %s (ID: %zu)",
+      static_cast<double>(latency_monitor_->percentile(0.99, now)) / 1e6,
+      latency_monitor_->window() / 1000000,
+      static_cast<double>(latency_monitor_->budget()) / 1e6,
+      topic_name_,
+      subscription_id_);
+  }
+}
+
+/// RECORD QUEUE DELAY =========================================================
+void rmw_subscription_data_t::record_queue_delay(
+  const rmw_zenoh_common_cpp::ReceiveBufferPtr & sample)
+{
+  // Samples held back in a reorder buffer wait on purpose
+  if (!overload_detector_ || reorder_buffer_ || sample->receive_time() == 0) {
+    return;
+  }
+
+  rcutils_time_point_value_t now;
+  if (rcutils_steady_time_now(&now) != RCUTILS_RET_OK) {
+    return;
+  }
+  overload_detector_->record_delay(now - sample->receive_time(), now);
+}
+
+/// ZENOH MESSAGE SUBSCRIPTION CALLBACK (static method) ========================
+void rmw_subscription_data_t::zn_sub_callback(const zn_sample_t * sample, const void * arg)
+{
+  // NOTE(CH3): We unfortunately have to do this copy construction since we shouldn't be using
+  // char * as keys to the unordered_map
+  //
+  // The string is kept per thread so its storage gets reused from sample to sample
+  static thread_local std::string key;
+  key.assign(sample->key.val, sample->key.len);
+
+  auto * pool = static_cast<rmw_zenoh_common_cpp::ReceiveBufferPool *>(const_cast<void *>(arg));
+
+  static thread_local DispatcherList dispatchers;
+  rmw_zenoh_common_cpp::ReceiveBufferPtr dispatched;
+  zn_session_t * session = handle_sample(
+    key, reinterpret_cast<const unsigned char *>(sample->value.val), sample->value.len, *pool,
+    dispatchers, dispatched);
+  dispatch_sample(dispatchers, dispatched);
+  if (session) {
+    request_keyframe(session, key, arg);
+  }
+}
+
+/// ZENOH KEYFRAME REPLY CALLBACK (static method) ==============================
+void rmw_subscription_data_t::zn_keyframe_reply_callback(
+  const zn_source_info_t *, const zn_sample_t * sample, const void * arg)
+{
+  if (!sample) {
+    return;
+  }
+
+  // Replies come on <topic>/keyframe
+  static thread_local std::string key;
+  key.assign(sample->key.val, sample->key.len);
+
+  const size_t suffix_length = sizeof(rmw_zenoh_common_cpp::kKeyframeKeySuffix) - 1;
+  if (key.size() <= suffix_length ||
+    key.compare(
+      key.size() - suffix_length, suffix_length, rmw_zenoh_common_cpp::kKeyframeKeySuffix) != 0)
+  {
+    return;
+  }
+  key.resize(key.size() - suffix_length);
+
+  auto * pool = static_cast<rmw_zenoh_common_cpp::ReceiveBufferPool *>(const_cast<void *>(arg));
+
+  // A keyframe reply is never a delta, so it never needs another keyframe
+  static thread_local DispatcherList dispatchers;
+  rmw_zenoh_common_cpp::ReceiveBufferPtr dispatched;
+  handle_sample(
+    key, reinterpret_cast<const unsigned char *>(sample->value.val), sample->value.len, *pool,
+    dispatchers, dispatched);
+  dispatch_sample(dispatchers, dispatched);
+}
+
+/// ZENOH KEYFRAME QUERYABLE CALLBACK (static method) ==========================
+void rmw_publisher_data_t::zn_keyframe_queryable_callback(zn_query_t * query, const void * arg)
+{
+  auto * publisher_data = static_cast<const rmw_publisher_data_t *>(arg);
+  rmw_zenoh_common_cpp::DeltaEncoder * delta_encoder = publisher_data->delta_encoder_;
+
+  z_string_t resource = zn_query_res_name(query);
+  std::string res(resource.val, resource.len);
+
+  // Reply with the last sample as a keyframe, as plain CDR
+  std::vector<unsigned char> reply;
+  {
+    std::lock_guard<std::mutex> lock(delta_encoder->mutex());
+    if (!delta_encoder->has_last_sample()) {
+      return;
+    }
+
+    const std::vector<unsigned char> & last_sample = delta_encoder->last_sample();
+
+    rmw_zenoh_common_cpp::SampleHeader header = delta_encoder->keyframe_header();
+    if (publisher_data->type_hash_ != 0) {
+      header.flags |= rmw_zenoh_common_cpp::kSampleFlagType;
+      header.type_hash = publisher_data->type_hash_;
+    }
+
+    reply.resize(rmw_zenoh_common_cpp::kMaxSampleHeaderSize + last_sample.size());
+    size_t header_size = rmw_zenoh_common_cpp::write_sample_header(header, reply.data());
+    std::copy(last_sample.begin(), last_sample.end(), reply.begin() + header_size);
+    reply.resize(header_size + last_sample.size());
+  }
+
+  zn_send_reply(query, res.c_str(), reply.data(), reply.size());
+}
+
+/// ZENOH HISTORY QUERYABLE CALLBACK (static method) ===========================
+void rmw_publisher_data_t::zn_history_queryable_callback(zn_query_t * query, const void * arg)
+{
+  auto * publisher_data = static_cast<const rmw_publisher_data_t *>(arg);
+
+  z_string_t resource = zn_query_res_name(query);
+  std::string res(resource.val, resource.len);
+
+  z_string_t predicate = zn_query_predicate(query);
+  rmw_zenoh_common_cpp::HistoryQuery history_query;
+  if (!rmw_zenoh_common_cpp::parse_history_query(
+      std::string(predicate.val, predicate.len), history_query))
+  {
+    RCUTILS_LOG_WARN_NAMED(
+      "rmw_zenoh_common_cpp",
+      "Ignoring history query on %s with malformed predicate '%.*s'",
+      res.c_str(),
+      static_cast<int>(predicate.len),
+      predicate.val);
+    return;
+  }
+
+  rcutils_time_point_value_t now = 0;
+  rcutils_system_time_now(&now);
+
+  // Every sample goes in a reply of its own, oldest first
+  std::vector<std::vector<unsigned char>> replies =
+    publisher_data->history_->query(history_query, now);
+  for (const auto & reply : replies) {
+    zn_send_reply(query, res.c_str(), reply.data(), reply.size());
+  }
 }
@@ -23,21 +23,46 @@
 #include <deque>
 #include <mutex>
 #include <atomic>
+#include <unordered_set>
+
+#include "rcutils/allocator.h"
 
 #include "rmw/rmw.h"
 #include "rmw_zenoh_common_cpp/TypeSupport.hpp"
+#include "rmw_zenoh_common_cpp/rmw_node_impl.hpp"
+
+#include "codec.hpp"
+#include "delta.hpp"
+#include "direct_dispatch.hpp"
+#include "duplicate_filter.hpp"
+#include "entity_arena.hpp"
+#include "history_ring.hpp"
+#include "instance_key.hpp"
+#include "latency_monitor.hpp"
+#include "overload_detector.hpp"
+#include "ready_claims.hpp"
+#include "receive_buffer_pool.hpp"
+#include "reorder_buffer.hpp"
+#include "sample_queue.hpp"
+#include "shaping.hpp"
 
 extern "C"
 {
 #include "rmw_zenoh_common_cpp/zenoh-net-interface.h"
 }
 
-struct rmw_node_impl_t
-{
-};
-
 struct rmw_publisher_data_t
 {
+  /// STATIC MEMBERS ===============================================================================
+  // Answers keyframe queries of subscriptions with the last sample published.
+  // The callback argument is the rmw_publisher_data_t.
+  static void zn_keyframe_queryable_callback(zn_query_t * query, const void * arg);
+
+  // Answers history queries with the samples of the publisher's history ring that match the
+  // query predicate (see HistoryQuery). The callback argument is the rmw_publisher_data_t.
+  static void zn_history_queryable_callback(zn_query_t * query, const void * arg);
+
+  /// INSTANCE MEMBERS =============================================================================
   const void * type_support_impl_;
   const char * typesupport_identifier_;
 
@@ -46,15 +71,80 @@ struct rmw_publisher_data_t
   size_t zn_topic_id_;
   zn_session_t * zn_session_;
 
+  // Payload codec stage (nullptr if samples are published as plain CDR)
+  rmw_zenoh_common_cpp::PayloadEncoder * encoder_;
+
+  // Delta stage, and the queryable for its keyframes (nullptr if delta encoding is off)
+  rmw_zenoh_common_cpp::DeltaEncoder * delta_encoder_;
+  zn_queryable_t * zn_keyframe_queryable_;
+
+  // Bandwidth limit (nullptr if neither the publisher nor its session has one)
+  rmw_zenoh_common_cpp::PublisherShaper * shaper_;
+
+  // Reads the instance key of published messages (nullptr if the topic is not keyed)
+  rmw_zenoh_common_cpp::InstanceKey * instance_key_;
+
+  // Whether samples carry their source timestamp, for the subscriptions to reorder them or to
+  // track their latency
+  bool timestamp_samples_;
+
+  // Hash of the message type, sent with every sample (0 if it cannot be derived)
+  uint64_t type_hash_;
+
+  // Numbers the samples for duplicate suppression (nullptr if the topic is not deduplicated)
+  rmw_zenoh_common_cpp::SampleSequencer * sequencer_;
+
+  // Last samples published, and the queryable for history queries (nullptr if the topic keeps no
+  // history)
+  rmw_zenoh_common_cpp::HistoryRing * history_;
+  zn_queryable_t * zn_history_queryable_;
+
   const rmw_node_t * node_;
 };
 
+// Data behind an rmw_publisher_allocation_t
+//
+// Holds a serialization buffer sized for the largest message of the type, so publishing with the
+// allocation does not touch the heap. For types that are not fully bounded the buffer starts at the
+// size of the bounded part and grows to the largest message published with it.
+struct rmw_publisher_allocation_data_t
+{
+  const void * type_support_impl_;
+
+  char * buffer_;
+  size_t capacity_;
+  bool bounded_;
+
+  rcutils_allocator_t allocator_;
+};
+
+// Data behind an rmw_subscription_allocation_t
+//
+// Receive buffers for the maximum message size are reserved in the context's receive buffer pool
+// the first time the allocation is used with a subscription (enough to fill its queue), so takes
+// after that do not touch the heap.
+struct rmw_subscription_allocation_data_t
+{
+  const void * type_support_impl_;
+
+  size_t max_serialized_size_;
+  bool bounded_;
+
+  // Subscription the receive buffers were last reserved for
+  const void * reserved_for_;
+};
+
 // Functionally a struct. But with a method for handling incoming Zenoh messages
 struct rmw_subscription_data_t
 {
   /// STATIC MEMBERS ===============================================================================
+  // The callback argument is the rmw_zenoh_common_cpp::ReceiveBufferPool of the declaring context
   static void zn_sub_callback(const zn_sample_t * sample, const void * arg);
 
+  // Handles the replies to keyframe queries like samples (same callback argument)
+  static void zn_keyframe_reply_callback(
+    const zn_source_info_t * info, const zn_sample_t * sample, const void * arg);
+
   // Counter to give subscriptions unique IDs
   static std::atomic<size_t> subscription_id_counter;
 
@@ -62,24 +152,101 @@ struct rmw_subscription_data_t
   // Map of Zenoh topic key expression to subscription data struct instances
   static std::unordered_map<std::string, std::vector<rmw_subscription_data_t *>>
     zn_topic_to_sub_data;
+
+  // Map of Zenoh topic key expression to the state of the delta encoded streams on the topic
+  static std::unordered_map<std::string, rmw_zenoh_common_cpp::DeltaStreams>
+    zn_topic_to_delta_streams;
+
+  // Map of Zenoh topic key expression to the samples received from the numbered publishers on the
+  // topic, to drop their duplicates
+  static std::unordered_map<std::string, rmw_zenoh_common_cpp::DuplicateFilter>
+    zn_topic_to_duplicate_filter;
   // *INDENT-ON*
 
   /// INSTANCE MEMBERS =============================================================================
+  // Push a sample to the message queue. Must be called with message_queue_mutex_ held.
+  void enqueue(const rmw_zenoh_common_cpp::ReceiveBufferPtr & sample, uint64_t instance);
+
+  // Whether the subscription takes samples of a type. Samples of another type are counted as
+  // incompatible. Must be called with message_queue_mutex_ held.
+  bool accepts_type(uint64_t type_hash);
+
+  // Move the samples of the reorder buffer that are due at now (steady clock, 0 for the current
+  // time) to the message queue. Must be called with message_queue_mutex_ held.
+  void release_reordered_samples(int64_t now = 0);
+
+  // Count the latency of a sample being taken, if the topic has a latency budget. Must be called
+  // with message_queue_mutex_ held.
+  void record_latency(const rmw_zenoh_common_cpp::ReceiveBufferPtr & sample);
+
+  // Count the time a sample waited to be taken, if the receive path is watched for overload
+  void record_queue_delay(const rmw_zenoh_common_cpp::ReceiveBufferPtr & sample);
+
   const void * type_support_impl_;
   const char * typesupport_identifier_;
 
   rmw_zenoh_common_cpp::TypeSupport * type_support_;
   const rmw_node_t * node_;
+  const char * topic_name_;
 
   zn_session_t * zn_session_;
   zn_subscriber_t * zn_subscriber_;
 
-  // Instanced message queue
-  std::deque<std::shared_ptr<std::vector<unsigned char>>> zn_message_queue_;
+  // Instanced message queue (of pooled sample buffers shared with the other subscriptions), with
+  // its history kept per instance on keyed topics
+  rmw_zenoh_common_cpp::SampleQueue zn_message_queue_;
   std::mutex message_queue_mutex_;
 
+  // Readiness of the message queue, claimed one message per waiter
+  rmw_zenoh_common_cpp::ReadyClaims ready_claims_;
+
+  // Hash of the message type (0 if it cannot be derived, in which case samples are not checked)
+  uint64_t type_hash_;
+
+  // Type hashes of the samples dropped for not matching the subscription's type, and the number
+  // of them reported through the incompatible QoS event so far. Guarded by message_queue_mutex_.
+  std::unordered_set<uint64_t> incompatible_types_;
+  size_t incompatible_types_reported_;
+
+  // Holds stamped samples to put them in timestamp order before they are queued (nullptr if the
+  // topic has no reorder window). Guarded by message_queue_mutex_.
+  rmw_zenoh_common_cpp::ReorderBuffer * reorder_buffer_;
+
+  // Latencies of the stamped samples taken, checked against the topic's latency budget (nullptr if
+  // the topic has none), and the number of breaches of the budget reported through the requested
+  // deadline missed event so far. Guarded by message_queue_mutex_.
+  rmw_zenoh_common_cpp::LatencyMonitor * latency_monitor_;
+  uint64_t latency_breaches_reported_;
+
+  // Overload detector of the context's receive path (nullptr if it is not watched), and the
+  // priority class of the topic's samples on it
+  rmw_zenoh_common_cpp::OverloadDetector * overload_detector_;
+  rmw_zenoh_common_cpp::TopicPriority priority_;
+
+  // Samples lost to overload shedding, and pushed out of the full message queue. Guarded by
+  // message_queue_mutex_.
+  uint64_t shed_samples_;
+  uint64_t overflowed_samples_;
+
+  // Callback the samples are handed to on the thread that received them, instead of the message
+  // queue, while one is set. Shared with the receiving threads about to call it.
+  std::shared_ptr<rmw_zenoh_common_cpp::DirectDispatcher> direct_dispatcher_;
+
   size_t subscription_id_;
   size_t queue_depth_;
+
+  // Messages loaned out by take_loaned_message, with the sample buffers their sequence views point
+  // into (which stay pinned until the message is returned)
+  struct LoanedMessage
+  {
+    rmw_zenoh_common_cpp::ReceiveBufferPtr buffer;
+    std::vector<void *> views;
+  };
+  std::unordered_map<void *, LoanedMessage> loaned_messages_;
+  std::mutex loaned_messages_mutex_;
 };
 
+// Guards the static topic maps of rmw_subscription_data_t against the Zenoh receiving thread.
+extern std::mutex sub_callback_mutex;
+
 #endif  // IMPL__PUBSUB_IMPL_HPP_
@@ -0,0 +1,64 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ready_claims.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+
+constexpr std::chrono::milliseconds ReadyClaims::kClaimLifetime;
+
+void ReadyClaims::expire(int64_t now) const
+{
+  if (claims_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  int64_t lifetime = std::chrono::duration_cast<Clock::duration>(kClaimLifetime).count();
+  if (now - last_claim_.load(std::memory_order_relaxed) > lifetime) {
+    claims_.store(0, std::memory_order_relaxed);
+  }
+}
+
+bool ReadyClaims::unclaimed() const
+{
+  expire(Clock::now().time_since_epoch().count());
+  return available_.load(std::memory_order_acquire) > claims_.load(std::memory_order_acquire);
+}
+
+bool ReadyClaims::claim()
+{
+  int64_t now = Clock::now().time_since_epoch().count();
+  expire(now);
+
+  size_t claims = claims_.load(std::memory_order_acquire);
+  do {
+    if (claims >= available_.load(std::memory_order_acquire)) {
+      return false;
+    }
+  } while (!claims_.compare_exchange_weak(claims, claims + 1, std::memory_order_acq_rel));
+
+  last_claim_.store(now, std::memory_order_relaxed);
+  return true;
+}
+
+void ReadyClaims::release()
+{
+  size_t claims = claims_.load(std::memory_order_acquire);
+  while (claims > 0 &&
+    !claims_.compare_exchange_weak(claims, claims - 1, std::memory_order_acq_rel))
+  {
+  }
+}
+
+}  // namespace rmw_zenoh_common_cpp
@@ -0,0 +1,65 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__READY_CLAIMS_HPP_
+#define IMPL__READY_CLAIMS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// READY CLAIMS ===============================================================
+// Readiness of an entity's queue, handed out to waiters one queued item at a time.
+//
+// A wait that finds the entity ready claims one of its items, and the claim is given back by the
+// next take. So with several threads waiting on the entity, each queued item wakes exactly one of
+// them, and the rest keep waiting for the next item instead of racing to take the same one.
+//
+// Claims whose waiter never takes would keep the items from waking anyone else, so they lapse
+// once no claim has been made for kClaimLifetime.
+class ReadyClaims
+{
+public:
+  static constexpr std::chrono::milliseconds kClaimLifetime{100};
+
+  // Number of items in the queue. Set under the queue's mutex whenever it changes.
+  void set_available(size_t count) {available_.store(count, std::memory_order_release);}
+
+  // Whether the queue has items no waiter has claimed
+  bool unclaimed() const;
+
+  // Claim an item for a waiter. Returns false if every item is already claimed.
+  bool claim();
+
+  // Give back a claim (if any is held), when taking from the queue
+  void release();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  // Drop the claims if they have lapsed
+  void expire(int64_t now) const;
+
+  std::atomic<size_t> available_{0};
+  mutable std::atomic<size_t> claims_{0};
+  std::atomic<int64_t> last_claim_{0};  // Clock ticks
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__READY_CLAIMS_HPP_
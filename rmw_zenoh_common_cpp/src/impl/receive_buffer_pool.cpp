@@ -0,0 +1,440 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "receive_buffer_pool.hpp"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+#include "rcutils/logging_macros.h"
+
+namespace rmw_zenoh_common_cpp
+{
+
+namespace
+{
+// Alignment of the data of every buffer (a cache line, which covers any primitive type too)
+constexpr size_t kBufferAlignment = 64;
+
+// Upper bound on the bytes that are kept around in the shared free list of one size class
+constexpr size_t kMaxFreeBytesPerSizeClass = 16 * 1024 * 1024;
+
+// Upper bound on the bytes moved into a thread cache in one batch
+constexpr size_t kMaxBatchBytes = 1024 * 1024;
+constexpr size_t kMaxBatchCount = 8;
+
+// Batches a thread cache holds per size class at most, before recycled buffers spill over
+constexpr size_t kMaxCachedBatches = 2;
+}  // namespace
+
+/// THREAD CACHE ===============================================================
+// Per-thread stash of free buffers, so the receive thread only locks a size class once per batch.
+//
+// Every buffer in a thread cache holds a reference on its pool, so the cache can be flushed back
+// into the pool whenever it is convenient (on thread exit, or when another pool is used).
+struct ReceiveBufferPool::ThreadCache
+{
+  ReceiveBufferPool * pool = nullptr;
+  ReceiveBuffer * heads[kNumSizeClasses] = {};
+  size_t counts[kNumSizeClasses] = {};
+
+  ~ThreadCache()
+  {
+    flush();
+  }
+
+  void flush()
+  {
+    for (size_t i = 0; i < kNumSizeClasses; ++i) {
+      if (heads[i]) {
+        ReceiveBuffer * buffers = heads[i];
+        heads[i] = nullptr;
+        counts[i] = 0;
+        buffers->pool_->give_back(buffers);
+      }
+    }
+    pool = nullptr;
+  }
+
+  // Hand the first count buffers of a size class back to the shared free list
+  void spill(size_t size_class, size_t count)
+  {
+    ReceiveBuffer * buffers = heads[size_class];
+    ReceiveBuffer * last = buffers;
+    for (size_t i = 1; i < count && last->next_; ++i) {
+      last = last->next_;
+    }
+    heads[size_class] = last->next_;
+    last->next_ = nullptr;
+    counts[size_class] -= count;
+    pool->give_back(buffers);
+  }
+};
+
+ReceiveBufferPool::ThreadCache & ReceiveBufferPool::thread_cache()
+{
+  static thread_local ReceiveBufferPool::ThreadCache cache;
+  return cache;
+}
+
+/// RECEIVE BUFFER =============================================================
+void ReceiveBuffer::resize(size_t size)
+{
+  assert(size <= capacity_);
+  size_ = size;
+}
+
+/// RECEIVE BUFFER POINTER =====================================================
+ReceiveBufferPtr::ReceiveBufferPtr(const ReceiveBufferPtr & other)
+: buffer_(other.buffer_)
+{
+  if (buffer_) {
+    buffer_->refcount_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+ReceiveBufferPtr::ReceiveBufferPtr(ReceiveBufferPtr && other) noexcept
+: buffer_(other.buffer_)
+{
+  other.buffer_ = nullptr;
+}
+
+ReceiveBufferPtr & ReceiveBufferPtr::operator=(const ReceiveBufferPtr & other)
+{
+  if (this != &other) {
+    if (other.buffer_) {
+      other.buffer_->refcount_.fetch_add(1, std::memory_order_relaxed);
+    }
+    reset();
+    buffer_ = other.buffer_;
+  }
+  return *this;
+}
+
+ReceiveBufferPtr & ReceiveBufferPtr::operator=(ReceiveBufferPtr && other) noexcept
+{
+  if (this != &other) {
+    reset();
+    buffer_ = other.buffer_;
+    other.buffer_ = nullptr;
+  }
+  return *this;
+}
+
+ReceiveBufferPtr::~ReceiveBufferPtr()
+{
+  reset();
+}
+
+void ReceiveBufferPtr::reset()
+{
+  if (buffer_) {
+    if (buffer_->refcount_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      buffer_->pool_->recycle(buffer_);
+    }
+    buffer_ = nullptr;
+  }
+}
+
+/// RECEIVE BUFFER POOL ========================================================
+constexpr size_t ReceiveBufferPool::kMinSizeClassShift;
+constexpr size_t ReceiveBufferPool::kMaxSizeClassShift;
+constexpr size_t ReceiveBufferPool::kNumSizeClasses;
+constexpr size_t ReceiveBufferPool::kHugePageSize;
+
+ReceiveBufferPool * ReceiveBufferPool::create(const Options & options)
+{
+  return new (std::nothrow) ReceiveBufferPool(options);
+}
+
+ReceiveBufferPool::ReceiveBufferPool(const Options & options)
+: options_(options),
+  refcount_(1)
+{}
+
+ReceiveBufferPool::~ReceiveBufferPool()
+{
+  for (size_t i = 0; i < kNumSizeClasses; ++i) {
+    while (size_classes_[i].free_list) {
+      ReceiveBuffer * buffer = size_classes_[i].free_list;
+      size_classes_[i].free_list = buffer->next_;
+      free_buffer(buffer);
+    }
+  }
+}
+
+void ReceiveBufferPool::release()
+{
+  // Hand back whatever the releasing thread still has cached, since it is likely the last user
+  ThreadCache & cache = thread_cache();
+  if (cache.pool == this) {
+    cache.flush();
+  }
+  drop_ref();
+}
+
+size_t ReceiveBufferPool::size_class_for(size_t size)
+{
+  size_t size_class = 0;
+  while (size_class < kNumSizeClasses && size_class_capacity(size_class) < size) {
+    ++size_class;
+  }
+  return size_class;  // kNumSizeClasses if the size is too large to be pooled
+}
+
+size_t ReceiveBufferPool::size_class_capacity(size_t size_class)
+{
+  return size_t(1) << (size_class + kMinSizeClassShift);
+}
+
+size_t ReceiveBufferPool::batch_size(size_t size_class)
+{
+  return std::max<size_t>(
+    1, std::min(kMaxBatchCount, kMaxBatchBytes / size_class_capacity(size_class)));
+}
+
+ReceiveBufferPtr ReceiveBufferPool::acquire(size_t size)
+{
+  size_t size_class = size_class_for(size);
+  ReceiveBuffer * buffer = nullptr;
+
+  if (size_class == kNumSizeClasses) {
+    // Too large to be worth keeping around, so it goes straight to and from the heap
+    buffer = allocate_buffer(size_class, size);
+    if (!buffer) {
+      return ReceiveBufferPtr();
+    }
+    add_ref(1);
+  } else {
+    ThreadCache & cache = thread_cache();
+    if (cache.pool != this) {
+      cache.flush();
+      cache.pool = this;
+    }
+
+    if (!cache.heads[size_class]) {
+      refill(cache, size_class);
+      if (!cache.heads[size_class]) {
+        return ReceiveBufferPtr();
+      }
+    }
+
+    buffer = cache.heads[size_class];
+    cache.heads[size_class] = buffer->next_;
+    --cache.counts[size_class];
+    buffer->next_ = nullptr;
+  }
+
+  buffer->refcount_.store(1, std::memory_order_relaxed);
+  buffer->size_ = size;
+  buffer->source_timestamp_ = 0;
+  buffer->receive_time_ = 0;
+  bytes_in_use_.fetch_add(buffer->capacity_, std::memory_order_relaxed);
+  return ReceiveBufferPtr(buffer);
+}
+
+bool ReceiveBufferPool::reserve(size_t size, size_t count)
+{
+  size_t size_class = size_class_for(size);
+  if (size_class == kNumSizeClasses) {
+    return false;
+  }
+
+  SizeClass & sc = size_classes_[size_class];
+  std::lock_guard<std::mutex> lock(sc.mutex);
+
+  sc.reserved = std::max(sc.reserved, count);
+  while (sc.free_count < count) {
+    ReceiveBuffer * buffer = allocate_buffer(size_class, size_class_capacity(size_class));
+    if (!buffer) {
+      return false;
+    }
+    buffer->next_ = sc.free_list;
+    sc.free_list = buffer;
+    ++sc.free_count;
+  }
+  return true;
+}
+
+void ReceiveBufferPool::refill(ThreadCache & cache, size_t size_class)
+{
+  SizeClass & sc = size_classes_[size_class];
+  size_t wanted = batch_size(size_class);
+  size_t moved = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(sc.mutex);
+    while (moved < wanted && sc.free_list) {
+      ReceiveBuffer * buffer = sc.free_list;
+      sc.free_list = buffer->next_;
+      --sc.free_count;
+
+      buffer->next_ = cache.heads[size_class];
+      cache.heads[size_class] = buffer;
+      ++moved;
+    }
+  }
+
+  if (moved == 0) {
+    ReceiveBuffer * buffer = allocate_buffer(size_class, size_class_capacity(size_class));
+    if (!buffer) {
+      return;
+    }
+    cache.heads[size_class] = buffer;
+    moved = 1;
+  }
+
+  cache.counts[size_class] += moved;
+  add_ref(moved);
+}
+
+void ReceiveBufferPool::recycle(ReceiveBuffer * buffer)
+{
+  bytes_in_use_.fetch_sub(buffer->capacity_, std::memory_order_relaxed);
+
+  size_t size_class = buffer->size_class_;
+  if (size_class < kNumSizeClasses) {
+    // Threads that take buffers from the pool keep the ones they drop, holding on to the pool
+    // reference of the buffer like the buffers they refill with do
+    ThreadCache & cache = thread_cache();
+    if (cache.pool == this) {
+      buffer->next_ = cache.heads[size_class];
+      cache.heads[size_class] = buffer;
+      ++cache.counts[size_class];
+
+      size_t batch = batch_size(size_class);
+      if (cache.counts[size_class] > kMaxCachedBatches * batch) {
+        cache.spill(size_class, batch);
+      }
+      return;
+    }
+  }
+
+  buffer->next_ = nullptr;
+  give_back(buffer);
+}
+
+void ReceiveBufferPool::give_back(ReceiveBuffer * buffers)
+{
+  size_t count = 0;
+  ReceiveBuffer * unkept = nullptr;
+
+  if (buffers->size_class_ < kNumSizeClasses) {
+    SizeClass & sc = size_classes_[buffers->size_class_];
+    size_t max_free = std::max(
+      sc.reserved, std::max<size_t>(2, kMaxFreeBytesPerSizeClass / buffers->capacity_));
+
+    std::lock_guard<std::mutex> lock(sc.mutex);
+    while (buffers) {
+      ReceiveBuffer * buffer = buffers;
+      buffers = buffer->next_;
+      ++count;
+      if (sc.free_count < max_free) {
+        buffer->next_ = sc.free_list;
+        sc.free_list = buffer;
+        ++sc.free_count;
+      } else {
+        buffer->next_ = unkept;
+        unkept = buffer;
+      }
+    }
+  } else {
+    unkept = buffers;
+    count = 1;
+  }
+
+  while (unkept) {
+    ReceiveBuffer * buffer = unkept;
+    unkept = buffer->next_;
+    free_buffer(buffer);
+  }
+  drop_ref(count);
+}
+
+ReceiveBuffer * ReceiveBufferPool::allocate_buffer(size_t size_class, size_t capacity)
+{
+  ReceiveBuffer * buffer = new (std::nothrow) ReceiveBuffer();
+  if (!buffer) {
+    return nullptr;
+  }
+
+  void * data = nullptr;
+
+#ifdef __linux__
+  if (options_.use_huge_pages && size_class < kNumSizeClasses && capacity >= kHugePageSize) {
+    // Explicit huge pages first, then fall back to asking for transparent ones
+    data = mmap(
+      nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data == MAP_FAILED) {
+      data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (data == MAP_FAILED) {
+        data = nullptr;
+      } else {
+        madvise(data, capacity, MADV_HUGEPAGE);
+      }
+    }
+    if (data) {
+      buffer->mapped_length_ = capacity;
+    }
+  }
+#endif
+
+  if (!data && posix_memalign(&data, kBufferAlignment, capacity) != 0) {
+    data = nullptr;
+  }
+
+  if (!data) {
+    RCUTILS_LOG_ERROR_NAMED(
+      "rmw_zenoh_common_cpp", "failed to allocate a receive buffer of %zu bytes", capacity);
+    delete buffer;
+    return nullptr;
+  }
+
+  buffer->data_ = static_cast<unsigned char *>(data);
+  buffer->capacity_ = capacity;
+  buffer->size_class_ = static_cast<uint32_t>(size_class);
+  buffer->pool_ = this;
+  return buffer;
+}
+
+void ReceiveBufferPool::free_buffer(ReceiveBuffer * buffer)
+{
+#ifdef __linux__
+  if (buffer->mapped_length_) {
+    munmap(buffer->data_, buffer->mapped_length_);
+    delete buffer;
+    return;
+  }
+#endif
+  free(buffer->data_);
+  delete buffer;
+}
+
+void ReceiveBufferPool::add_ref(size_t count)
+{
+  refcount_.fetch_add(count, std::memory_order_relaxed);
+}
+
+void ReceiveBufferPool::drop_ref(size_t count)
+{
+  if (refcount_.fetch_sub(count, std::memory_order_acq_rel) == count) {
+    delete this;
+  }
+}
+
+}  // namespace rmw_zenoh_common_cpp
@@ -0,0 +1,202 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__RECEIVE_BUFFER_POOL_HPP_
+#define IMPL__RECEIVE_BUFFER_POOL_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace rmw_zenoh_common_cpp
+{
+
+class ReceiveBufferPool;
+class ReceiveBufferPtr;
+
+/// RECEIVE BUFFER =============================================================
+// A block of bytes handed out by a ReceiveBufferPool.
+//
+// The reference count is intrusive so that a single received sample can be fanned out to every
+// subscription queue on a topic without any further allocation. The buffer goes back to its pool
+// (not to the heap) when the last ReceiveBufferPtr referencing it is dropped.
+class ReceiveBuffer
+{
+public:
+  unsigned char * data() {return data_;}
+  const unsigned char * data() const {return data_;}
+
+  // Number of valid bytes
+  size_t size() const {return size_;}
+
+  // Number of usable bytes (the size class of the buffer)
+  size_t capacity() const {return capacity_;}
+
+  // Shrink or grow the number of valid bytes, up to the capacity
+  void resize(size_t size);
+
+  // Time the sample in the buffer was published at, in nanoseconds since the epoch (0 if its
+  // publisher did not stamp it)
+  int64_t source_timestamp() const {return source_timestamp_;}
+  void set_source_timestamp(int64_t timestamp) {source_timestamp_ = timestamp;}
+
+  // Time the sample in the buffer was received at, on the steady clock (0 if it was not recorded)
+  int64_t receive_time() const {return receive_time_;}
+  void set_receive_time(int64_t time) {receive_time_ = time;}
+
+private:
+  friend class ReceiveBufferPool;
+  friend class ReceiveBufferPtr;
+
+  ReceiveBuffer() = default;
+
+  std::atomic<uint32_t> refcount_{0};
+  uint32_t size_class_{0};
+
+  unsigned char * data_{nullptr};
+  size_t capacity_{0};
+  size_t size_{0};
+  int64_t source_timestamp_{0};
+  int64_t receive_time_{0};
+
+  // Length of the underlying mapping if the data was mmap'd (for huge pages), 0 otherwise
+  size_t mapped_length_{0};
+
+  ReceiveBufferPool * pool_{nullptr};
+  ReceiveBuffer * next_{nullptr};  // Free list link
+};
+
+/// RECEIVE BUFFER POINTER =====================================================
+// Intrusive smart pointer to a ReceiveBuffer. Copying only bumps the reference count.
+class ReceiveBufferPtr
+{
+public:
+  ReceiveBufferPtr() = default;
+  ReceiveBufferPtr(const ReceiveBufferPtr & other);
+  ReceiveBufferPtr(ReceiveBufferPtr && other) noexcept;
+  ReceiveBufferPtr & operator=(const ReceiveBufferPtr & other);
+  ReceiveBufferPtr & operator=(ReceiveBufferPtr && other) noexcept;
+  ~ReceiveBufferPtr();
+
+  void reset();
+
+  ReceiveBuffer * get() const {return buffer_;}
+  ReceiveBuffer * operator->() const {return buffer_;}
+  ReceiveBuffer & operator*() const {return *buffer_;}
+  explicit operator bool() const {return buffer_ != nullptr;}
+
+private:
+  friend class ReceiveBufferPool;
+
+  // Adopts a buffer whose reference count has already been set
+  explicit ReceiveBufferPtr(ReceiveBuffer * buffer)
+  : buffer_(buffer) {}
+
+  ReceiveBuffer * buffer_{nullptr};
+};
+
+/// RECEIVE BUFFER POOL ========================================================
+// Context-wide pool of receive buffers, bucketed into power-of-two size classes.
+//
+// Buffers are taken from a small thread-local cache first (so the Zenoh receive thread only
+// touches the shared free lists once per batch). Once the last reference is dropped, a buffer goes
+// back to the cache of the thread that dropped it if that thread takes buffers from the pool too,
+// and to the shared free list of its size class otherwise. Buffers larger than the largest size
+// class are allocated and freed directly.
+//
+// The pool is reference counted: the owning context holds one reference, and so does every
+// buffer that is currently outside of the shared free lists. So it is safe for a sample to
+// outlive the context that received it.
+class ReceiveBufferPool
+{
+public:
+  struct Options
+  {
+    // Back the size classes of at least kHugePageSize with huge pages (if the system allows it)
+    bool use_huge_pages;
+  };
+
+  static constexpr size_t kMinSizeClassShift = 8;  // 256 B
+  static constexpr size_t kMaxSizeClassShift = 26;  // 64 MiB
+  static constexpr size_t kNumSizeClasses = kMaxSizeClassShift - kMinSizeClassShift + 1;
+  static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+  static ReceiveBufferPool * create(const Options & options);
+
+  // Drop the owner's reference. The pool is deleted once no buffers are outstanding.
+  void release();
+
+  // Get a buffer with at least size bytes of capacity, with its size set to size
+  ReceiveBufferPtr acquire(size_t size);
+
+  // Make sure at least count free buffers that can hold size bytes exist in the pool
+  bool reserve(size_t size, size_t count);
+
+  // Maximum size that is served from a size class instead of a one-off allocation
+  static size_t max_pooled_size() {return size_t(1) << kMaxSizeClassShift;}
+
+  // Capacity of the buffers currently handed out, in bytes
+  size_t bytes_in_use() const {return bytes_in_use_.load(std::memory_order_relaxed);}
+
+private:
+  friend class ReceiveBufferPtr;
+  struct ThreadCache;
+
+  struct SizeClass
+  {
+    std::mutex mutex;
+    ReceiveBuffer * free_list = nullptr;
+    size_t free_count = 0;
+    size_t reserved = 0;  // Free buffers to keep around no matter their size
+  };
+
+  explicit ReceiveBufferPool(const Options & options);
+  ~ReceiveBufferPool();
+
+  static ThreadCache & thread_cache();
+
+  static size_t size_class_for(size_t size);
+  static size_t size_class_capacity(size_t size_class);
+
+  // Number of buffers moved between a thread cache and the shared free list at a time
+  static size_t batch_size(size_t size_class);
+
+  ReceiveBuffer * allocate_buffer(size_t size_class, size_t capacity);
+  void free_buffer(ReceiveBuffer * buffer);
+
+  // Move up to batch_size() free buffers of a size class into the calling thread's cache
+  void refill(ThreadCache & cache, size_t size_class);
+
+  // Return a buffer whose last reference was dropped
+  void recycle(ReceiveBuffer * buffer);
+
+  // Return a list of free buffers of one size class (or a single buffer too large to be pooled)
+  // to the shared free list, or to the heap past what the free list keeps. Drops the reference
+  // every buffer held on the pool.
+  void give_back(ReceiveBuffer * buffers);
+
+  void add_ref(size_t count);
+  void drop_ref(size_t count = 1);
+
+  Options options_;
+
+  std::atomic<size_t> refcount_;
+  std::atomic<size_t> bytes_in_use_{0};
+  SizeClass size_classes_[kNumSizeClasses];
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__RECEIVE_BUFFER_POOL_HPP_
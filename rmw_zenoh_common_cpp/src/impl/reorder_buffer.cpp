@@ -0,0 +1,76 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "reorder_buffer.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace rmw_zenoh_common_cpp
+{
+
+ReorderBuffer::ReorderBuffer(int64_t window)
+: window_(window),
+  next_arrival_(0),
+  has_released_(false),
+  last_released_(0),
+  late_samples_(0)
+{}
+
+bool ReorderBuffer::later(const Held & a, const Held & b)
+{
+  return a.timestamp != b.timestamp ? a.timestamp > b.timestamp : a.arrival > b.arrival;
+}
+
+/// PUSH =======================================================================
+bool ReorderBuffer::push(ReceiveBufferPtr sample, uint64_t instance, int64_t timestamp, int64_t now)
+{
+  if (has_released_ && timestamp < last_released_) {
+    ++late_samples_;
+    return false;
+  }
+
+  Held held;
+  held.timestamp = timestamp;
+  held.arrival = next_arrival_++;
+  held.sample = std::move(sample);
+  held.instance = instance;
+  held_.push_back(std::move(held));
+  std::push_heap(held_.begin(), held_.end(), later);
+
+  deadlines_.push_back(now + window_);
+  return true;
+}
+
+/// POP ========================================================================
+bool ReorderBuffer::pop(int64_t now, ReceiveBufferPtr & sample, uint64_t & instance)
+{
+  // The deadlines are in arrival order, so the first one is the earliest
+  if (deadlines_.empty() || deadlines_.front() > now) {
+    return false;
+  }
+  deadlines_.pop_front();
+
+  std::pop_heap(held_.begin(), held_.end(), later);
+  Held & held = held_.back();
+  sample = std::move(held.sample);
+  instance = held.instance;
+  has_released_ = true;
+  last_released_ = held.timestamp;
+  held_.pop_back();
+  return true;
+}
+
+}  // namespace rmw_zenoh_common_cpp
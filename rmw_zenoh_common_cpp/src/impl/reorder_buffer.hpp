@@ -0,0 +1,85 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef IMPL__REORDER_BUFFER_HPP_
+#define IMPL__REORDER_BUFFER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "receive_buffer_pool.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// REORDER BUFFER =============================================================
+// Holds the samples received by a subscription for a short window, and releases them in the order
+// of their source timestamps rather than in the order they arrived in.
+//
+// Every sample is held for at most the window. Each time the window of a held sample runs out,
+// the held sample with the earliest timestamp is released, so samples from several publishers
+// come out sorted as long as none of them is delayed by more than the window. A sample stamped
+// before one already released can no longer be put in order, and is left to the caller to deliver
+// right away.
+class ReorderBuffer
+{
+public:
+  // window in nanoseconds
+  explicit ReorderBuffer(int64_t window);
+
+  // Hold a sample stamped with timestamp, received at now (from a steady clock).
+  // Returns false if the sample is too late to be put in order, and was not held.
+  bool push(ReceiveBufferPtr sample, uint64_t instance, int64_t timestamp, int64_t now);
+
+  // Release the next sample due at now. Returns false if no sample is due.
+  bool pop(int64_t now, ReceiveBufferPtr & sample, uint64_t & instance);
+
+  bool empty() const {return held_.empty();}
+  size_t size() const {return held_.size();}
+
+  // Samples that arrived too late to be put in order
+  uint64_t late_samples() const {return late_samples_;}
+
+private:
+  struct Held
+  {
+    int64_t timestamp;
+    uint64_t arrival;  // Breaks ties between samples with the same timestamp
+    ReceiveBufferPtr sample;
+    uint64_t instance;
+  };
+
+  // Orders the heap with the earliest sample on top
+  static bool later(const Held & a, const Held & b);
+
+  int64_t window_;
+
+  // Held samples, as a heap
+  std::vector<Held> held_;
+
+  // Times at which the windows of the held samples run out, in arrival order
+  std::deque<int64_t> deadlines_;
+
+  uint64_t next_arrival_;
+  bool has_released_;
+  int64_t last_released_;
+  uint64_t late_samples_;
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__REORDER_BUFFER_HPP_
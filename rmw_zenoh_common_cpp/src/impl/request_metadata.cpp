@@ -0,0 +1,63 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "request_metadata.hpp"
+
+#include <cstring>
+#include <limits>
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// WRITE ======================================================================
+void write_request_metadata(const RequestMetadata & metadata, unsigned char * out)
+{
+  memcpy(out, &metadata.deadline, sizeof(metadata.deadline));
+  memcpy(out + sizeof(metadata.deadline), &metadata.sequence_id, sizeof(metadata.sequence_id));
+}
+
+/// READ =======================================================================
+bool read_request_metadata(
+  const unsigned char * message, size_t length, RequestMetadata & metadata)
+{
+  if (length < kRequestMetadataSize) {
+    return false;
+  }
+  const unsigned char * trailer = message + length - kRequestMetadataSize;
+  memcpy(&metadata.deadline, trailer, sizeof(metadata.deadline));
+  memcpy(&metadata.sequence_id, trailer + sizeof(metadata.deadline), sizeof(metadata.sequence_id));
+  return true;
+}
+
+/// DEADLINES ==================================================================
+int64_t request_timeout_ns(uint64_t sec, uint64_t nsec)
+{
+  constexpr uint64_t kMaxNsec = kMaxRequestTimeoutSec * 1000000000ull;
+  if (sec >= kMaxRequestTimeoutSec || nsec >= kMaxNsec) {
+    return 0;
+  }
+  // Both terms are below 2^62, so their sum fits
+  uint64_t timeout = sec * 1000000000ull + nsec;
+  return timeout >= kMaxNsec ? 0 : static_cast<int64_t>(timeout);
+}
+
+int64_t request_deadline(int64_t now, int64_t timeout_ns)
+{
+  if (timeout_ns <= 0 || now > std::numeric_limits<int64_t>::max() - timeout_ns) {
+    return 0;
+  }
+  return now + timeout_ns;
+}
+
+}  // namespace rmw_zenoh_common_cpp
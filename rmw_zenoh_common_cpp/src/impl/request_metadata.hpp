@@ -0,0 +1,65 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__REQUEST_METADATA_HPP_
+#define IMPL__REQUEST_METADATA_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// REQUEST METADATA ===========================================================
+// Trailer after the CDR of every service request message.
+//
+// Wire layout (host byte order), from the end of the CDR:
+//   0: deadline of the request (int64, nanoseconds since the epoch, 0 if it has none)
+//   8: sequence ID of the request (int64)
+struct RequestMetadata
+{
+  int64_t deadline;
+  int64_t sequence_id;
+};
+
+constexpr size_t kRequestMetadataSize = 2 * sizeof(int64_t);
+
+// Write the trailer to out, which must have room for kRequestMetadataSize bytes
+void write_request_metadata(const RequestMetadata & metadata, unsigned char * out);
+
+// Read the trailer at the end of a request message of length bytes.
+// Returns false if the message is too short to have one.
+bool read_request_metadata(
+  const unsigned char * message, size_t length, RequestMetadata & metadata);
+
+// Longest request timeout that gives requests a deadline, in seconds (about 136 years)
+constexpr uint64_t kMaxRequestTimeoutSec = 1ull << 32;
+
+// Request timeout in nanoseconds of a duration, or 0 (no deadline) if it is too long to be added
+// to the current time, like RMW_DURATION_INFINITE
+int64_t request_timeout_ns(uint64_t sec, uint64_t nsec);
+
+// Deadline of a request sent at now with a timeout in nanoseconds, or 0 if it has none (which is
+// also the case when the deadline would be past the last representable time)
+int64_t request_deadline(int64_t now, int64_t timeout_ns);
+
+// Whether a request with the given deadline has expired at now (in nanoseconds since the epoch)
+inline bool request_expired(const RequestMetadata & metadata, int64_t now)
+{
+  return metadata.deadline != 0 && now > metadata.deadline;
+}
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__REQUEST_METADATA_HPP_
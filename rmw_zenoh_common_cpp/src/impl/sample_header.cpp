@@ -0,0 +1,151 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sample_header.hpp"
+
+#include <cstring>
+#include <random>
+
+namespace rmw_zenoh_common_cpp
+{
+
+namespace
+{
+void write_uint64(uint64_t value, unsigned char * dst)
+{
+  for (size_t i = 0; i < 8; ++i) {
+    dst[i] = static_cast<unsigned char>(value >> (8 * i));
+  }
+}
+
+uint64_t read_uint64(const unsigned char * src)
+{
+  uint64_t value = 0;
+  for (size_t i = 0; i < 8; ++i) {
+    value |= static_cast<uint64_t>(src[i]) << (8 * i);
+  }
+  return value;
+}
+}  // namespace
+
+size_t sample_header_size(uint16_t flags)
+{
+  return kSampleHeaderSize +
+         ((flags & kSampleFlagStream) ? kSampleStreamExtensionSize : 0) +
+         ((flags & kSampleFlagInstance) ? kSampleInstanceExtensionSize : 0) +
+         ((flags & kSampleFlagTimestamp) ? kSampleTimestampExtensionSize : 0) +
+         ((flags & kSampleFlagType) ? kSampleTypeExtensionSize : 0) +
+         ((flags & kSampleFlagSequence) ? kSampleSequenceExtensionSize : 0);
+}
+
+size_t write_sample_header(const SampleHeader & header, unsigned char * dst)
+{
+  dst[0] = header.version;
+  dst[1] = header.codec;
+  dst[2] = static_cast<unsigned char>(header.flags);
+  dst[3] = static_cast<unsigned char>(header.flags >> 8);
+  dst[4] = static_cast<unsigned char>(header.raw_length);
+  dst[5] = static_cast<unsigned char>(header.raw_length >> 8);
+  dst[6] = static_cast<unsigned char>(header.raw_length >> 16);
+  dst[7] = static_cast<unsigned char>(header.raw_length >> 24);
+
+  unsigned char * extension = dst + kSampleHeaderSize;
+  if (header.flags & kSampleFlagStream) {
+    memcpy(extension, header.gid, kSampleGidSize);
+    write_uint64(header.sequence, extension + kSampleGidSize);
+    extension += kSampleStreamExtensionSize;
+  }
+  if (header.flags & kSampleFlagInstance) {
+    write_uint64(header.instance, extension);
+    extension += kSampleInstanceExtensionSize;
+  }
+  if (header.flags & kSampleFlagTimestamp) {
+    write_uint64(static_cast<uint64_t>(header.timestamp), extension);
+    extension += kSampleTimestampExtensionSize;
+  }
+  if (header.flags & kSampleFlagType) {
+    write_uint64(header.type_hash, extension);
+    extension += kSampleTypeExtensionSize;
+  }
+  if (header.flags & kSampleFlagSequence) {
+    memcpy(extension, header.publisher_gid, kSampleGidSize);
+    write_uint64(header.publisher_sequence, extension + kSampleGidSize);
+    extension += kSampleSequenceExtensionSize;
+  }
+
+  return static_cast<size_t>(extension - dst);
+}
+
+void random_sample_gid(uint8_t * gid)
+{
+  std::random_device device;
+  for (size_t i = 0; i < kSampleGidSize; i += 4) {
+    uint32_t value = device();
+    memcpy(gid + i, &value, 4);
+  }
+}
+
+bool read_sample_header(
+  const unsigned char * src, size_t length, SampleHeader & header, size_t & header_size)
+{
+  if (length < kSampleHeaderSize) {
+    return false;
+  }
+
+  header.version = src[0];
+  header.codec = src[1];
+  header.flags = static_cast<uint16_t>(src[2] | (src[3] << 8));
+  header.raw_length =
+    static_cast<uint32_t>(src[4]) |
+    (static_cast<uint32_t>(src[5]) << 8) |
+    (static_cast<uint32_t>(src[6]) << 16) |
+    (static_cast<uint32_t>(src[7]) << 24);
+
+  // Unknown flags may change the layout of the header, so they cannot be skipped over
+  if (header.version != kSampleHeaderVersion || (header.flags & ~kSampleKnownFlags) != 0) {
+    return false;
+  }
+
+  header_size = sample_header_size(header.flags);
+  if (length < header_size) {
+    return false;
+  }
+
+  const unsigned char * extension = src + kSampleHeaderSize;
+  if (header.flags & kSampleFlagStream) {
+    memcpy(header.gid, extension, kSampleGidSize);
+    header.sequence = read_uint64(extension + kSampleGidSize);
+    extension += kSampleStreamExtensionSize;
+  }
+  if (header.flags & kSampleFlagInstance) {
+    header.instance = read_uint64(extension);
+    extension += kSampleInstanceExtensionSize;
+  }
+  if (header.flags & kSampleFlagTimestamp) {
+    header.timestamp = static_cast<int64_t>(read_uint64(extension));
+    extension += kSampleTimestampExtensionSize;
+  }
+  if (header.flags & kSampleFlagType) {
+    header.type_hash = read_uint64(extension);
+    extension += kSampleTypeExtensionSize;
+  }
+  if (header.flags & kSampleFlagSequence) {
+    memcpy(header.publisher_gid, extension, kSampleGidSize);
+    header.publisher_sequence = read_uint64(extension + kSampleGidSize);
+  }
+
+  return true;
+}
+
+}  // namespace rmw_zenoh_common_cpp
@@ -0,0 +1,118 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__SAMPLE_HEADER_HPP_
+#define IMPL__SAMPLE_HEADER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// SAMPLE HEADER ==============================================================
+// Header in front of every message published on a topic.
+//
+// Wire layout (little endian):
+//   0: version (uint8)
+//   1: codec ID of the payload (uint8, kCodecNone if it is plain CDR)
+//   2: flags (uint16, see kSampleFlag*)
+//   4: length of the decoded payload (uint32)
+//
+// Followed, if kSampleFlagStream is set, by the stream extension:
+//   +0: stream GID of the publisher (16 bytes)
+//  +16: sequence number of the sample in the stream (uint64)
+//
+// Followed, if kSampleFlagInstance is set, by the instance extension:
+//   +0: instance key of the sample on a keyed topic (uint64)
+//
+// Followed, if kSampleFlagTimestamp is set, by the timestamp extension:
+//   +0: source timestamp of the sample (int64, nanoseconds since the epoch)
+//
+// Followed, if kSampleFlagType is set, by the type extension:
+//   +0: hash of the message type of the payload (uint64, see type_hash.hpp)
+//
+// Followed, if kSampleFlagSequence is set, by the sequence extension:
+//   +0: GID of the publisher (16 bytes)
+//  +16: sequence number of the sample among the samples of the publisher (uint64)
+//
+// The payload (encoded with the codec) follows the header.
+constexpr uint16_t kSampleFlagStream = 0x1;  // The stream extension is present
+constexpr uint16_t kSampleFlagDelta = 0x2;  // The payload is a delta against the previous sample
+constexpr uint16_t kSampleFlagInstance = 0x4;  // The instance extension is present
+constexpr uint16_t kSampleFlagTimestamp = 0x8;  // The timestamp extension is present
+constexpr uint16_t kSampleFlagType = 0x10;  // The type extension is present
+constexpr uint16_t kSampleFlagSequence = 0x20;  // The sequence extension is present
+constexpr uint16_t kSampleKnownFlags =
+  kSampleFlagStream | kSampleFlagDelta | kSampleFlagInstance | kSampleFlagTimestamp |
+  kSampleFlagType | kSampleFlagSequence;
+
+constexpr size_t kSampleGidSize = 16;
+
+struct SampleHeader
+{
+  uint8_t version;
+  uint8_t codec;
+  uint16_t flags;
+  uint32_t raw_length;
+
+  // Stream extension (only valid if kSampleFlagStream is set)
+  uint8_t gid[kSampleGidSize];
+  uint64_t sequence;
+
+  // Instance extension (only valid if kSampleFlagInstance is set)
+  uint64_t instance;
+
+  // Timestamp extension (only valid if kSampleFlagTimestamp is set)
+  int64_t timestamp;
+
+  // Type extension (only valid if kSampleFlagType is set)
+  uint64_t type_hash;
+
+  // Sequence extension (only valid if kSampleFlagSequence is set)
+  uint8_t publisher_gid[kSampleGidSize];
+  uint64_t publisher_sequence;
+};
+
+constexpr uint8_t kSampleHeaderVersion = 1;
+constexpr size_t kSampleHeaderSize = 8;
+constexpr size_t kSampleStreamExtensionSize = kSampleGidSize + 8;
+constexpr size_t kSampleInstanceExtensionSize = 8;
+constexpr size_t kSampleTimestampExtensionSize = 8;
+constexpr size_t kSampleTypeExtensionSize = 8;
+constexpr size_t kSampleSequenceExtensionSize = kSampleGidSize + 8;
+
+// Room to leave in front of a payload for the largest possible header
+constexpr size_t kMaxSampleHeaderSize =
+  kSampleHeaderSize + kSampleStreamExtensionSize + kSampleInstanceExtensionSize +
+  kSampleTimestampExtensionSize + kSampleTypeExtensionSize + kSampleSequenceExtensionSize;
+
+// Size of a header with the given flags
+size_t sample_header_size(uint16_t flags);
+
+// Write the header into the sample_header_size(header.flags) bytes at dst. Returns the size.
+size_t write_sample_header(const SampleHeader & header, unsigned char * dst);
+
+// Fill a GID with random bytes. GIDs only need to be unique between the publishers of a topic,
+// which random ones are.
+void random_sample_gid(uint8_t * gid);
+
+// Read the header from the front of a sample, and set header_size to its size.
+// Returns false if the sample is too short or was written by an incompatible version.
+bool read_sample_header(
+  const unsigned char * src, size_t length, SampleHeader & header, size_t & header_size);
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__SAMPLE_HEADER_HPP_
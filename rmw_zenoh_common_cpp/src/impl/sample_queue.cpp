@@ -0,0 +1,110 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sample_queue.hpp"
+
+#include <algorithm>
+
+namespace rmw_zenoh_common_cpp
+{
+
+SampleQueue::SampleQueue(size_t depth, bool keyed)
+: depth_(std::max<size_t>(depth, 1)),
+  keyed_(keyed),
+  size_(0),
+  next_arrival_(0)
+{}
+
+/// PUSH =======================================================================
+bool SampleQueue::push(ReceiveBufferPtr sample, uint64_t instance)
+{
+  if (!keyed_) {
+    bool room = samples_.size() < depth_;
+    if (!room) {
+      samples_.pop_front();
+    } else {
+      ++size_;
+    }
+    samples_.push_back(std::move(sample));
+    return room;
+  }
+
+  std::deque<Entry> & samples = instances_[instance];
+  bool room = samples.size() < depth_;
+  if (!room) {
+    // Its entry in the arrival order is skipped once it gets to the front
+    samples.pop_front();
+  } else {
+    ++size_;
+  }
+
+  uint64_t arrival = next_arrival_++;
+  samples.emplace_back(arrival, std::move(sample));
+  order_.emplace_back(arrival, instance);
+
+  if (order_.size() > 2 * size_ + 64) {
+    compact();
+  }
+  return room;
+}
+
+/// POP ========================================================================
+ReceiveBufferPtr SampleQueue::pop()
+{
+  if (size_ == 0) {
+    return ReceiveBufferPtr();
+  }
+
+  if (!keyed_) {
+    ReceiveBufferPtr sample = std::move(samples_.front());
+    samples_.pop_front();
+    --size_;
+    return sample;
+  }
+
+  // Skip the entries of discarded samples
+  while (true) {
+    std::pair<uint64_t, uint64_t> next = order_.front();
+    order_.pop_front();
+
+    auto it = instances_.find(next.second);
+    if (it == instances_.end() || it->second.front().first != next.first) {
+      continue;
+    }
+
+    ReceiveBufferPtr sample = std::move(it->second.front().second);
+    it->second.pop_front();
+    if (it->second.empty()) {
+      instances_.erase(it);
+    }
+    --size_;
+    return sample;
+  }
+}
+
+/// COMPACT ====================================================================
+void SampleQueue::compact()
+{
+  std::deque<std::pair<uint64_t, uint64_t>> order;
+  for (const auto & entry : order_) {
+    // Samples of an instance are discarded oldest first, so the live ones are the newest
+    auto it = instances_.find(entry.second);
+    if (it != instances_.end() && entry.first >= it->second.front().first) {
+      order.push_back(entry);
+    }
+  }
+  order_.swap(order);
+}
+
+}  // namespace rmw_zenoh_common_cpp
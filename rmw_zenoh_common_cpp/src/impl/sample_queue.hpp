@@ -0,0 +1,78 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__SAMPLE_QUEUE_HPP_
+#define IMPL__SAMPLE_QUEUE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+
+#include "receive_buffer_pool.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// SAMPLE QUEUE ===============================================================
+// KEEP_LAST history of the samples received by a subscription, taken oldest first.
+//
+// A keyed queue keeps the last depth samples of every instance, so a chatty instance cannot evict
+// the samples of the quiet ones. Otherwise, the last depth samples of the topic are kept.
+class SampleQueue
+{
+public:
+  explicit SampleQueue(size_t depth = 1, bool keyed = false);
+
+  // Add a sample of an instance (ignored if the queue is not keyed).
+  // Returns false if an older sample of the instance had to be discarded to make room.
+  bool push(ReceiveBufferPtr sample, uint64_t instance);
+
+  // Take the oldest sample (empty if there is none)
+  ReceiveBufferPtr pop();
+
+  bool empty() const {return size_ == 0;}
+  size_t size() const {return size_;}
+  size_t depth() const {return depth_;}
+  bool keyed() const {return keyed_;}
+
+  // Number of instances with samples in the queue
+  size_t instance_count() const {return keyed_ ? instances_.size() : (size_ > 0 ? 1 : 0);}
+
+private:
+  using Entry = std::pair<uint64_t, ReceiveBufferPtr>;  // Arrival number, sample
+
+  // Drop the arrival order entries of discarded samples once they outnumber the live ones
+  void compact();
+
+  size_t depth_;
+  bool keyed_;
+  size_t size_;
+
+  // Samples of an unkeyed queue, oldest first
+  std::deque<ReceiveBufferPtr> samples_;
+
+  // Samples of a keyed queue, oldest first per instance
+  std::unordered_map<uint64_t, std::deque<Entry>> instances_;
+
+  // Arrival order of the samples of a keyed queue, with the entries of discarded samples left in
+  // until they are skipped by pop() or compacted
+  std::deque<std::pair<uint64_t, uint64_t>> order_;  // Arrival number, instance
+  uint64_t next_arrival_;
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__SAMPLE_QUEUE_HPP_
@@ -0,0 +1,677 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "serialization_plan.hpp"
+
+#include <fastcdr/FastBuffer.h>
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "rcutils/logging_macros.h"
+
+#include "rosidl_runtime_c/message_initialization.h"
+#include "rosidl_runtime_c/primitives_sequence.h"
+#include "rosidl_runtime_c/string.h"
+
+#include "rosidl_runtime_cpp/message_initialization.hpp"
+
+#include "rosidl_typesupport_introspection_c/field_types.h"
+#include "rosidl_typesupport_introspection_c/message_introspection.h"
+
+#include "rosidl_typesupport_introspection_cpp/field_types.hpp"
+#include "rosidl_typesupport_introspection_cpp/identifier.hpp"
+#include "rosidl_typesupport_introspection_cpp/message_introspection.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+
+namespace
+{
+// NOTE: The C and C++ introspection type supports use the same field type IDs
+static_assert(
+  rosidl_typesupport_introspection_c__ROS_TYPE_BOOLEAN ==
+  rosidl_typesupport_introspection_cpp::ROS_TYPE_BOOLEAN &&
+  rosidl_typesupport_introspection_c__ROS_TYPE_STRING ==
+  rosidl_typesupport_introspection_cpp::ROS_TYPE_STRING &&
+  rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE ==
+  rosidl_typesupport_introspection_cpp::ROS_TYPE_MESSAGE,
+  "introspection field type IDs differ between C and C++");
+
+static_assert(sizeof(bool) == 1, "bools must be serialized as they are stored");
+
+const char kPadding[8] = {0};
+
+// Fast CDR alignment state: position from the end of the encapsulation, and size of the last
+// value written or read (values no bigger than that are not aligned)
+struct CdrState
+{
+  size_t position;
+  size_t last_size;
+};
+
+// The encapsulation ends aligned for anything
+constexpr CdrState kInitialState = {0, 1};
+
+// Padding Fast CDR puts in front of a value of the given size
+size_t align(const CdrState & state, size_t size)
+{
+  return size > state.last_size ? (size - state.position % size) & (size - 1) : 0;
+}
+
+// Index of an alignment state in the direct_states bitmask of a run.
+// Sizes are at most 8, so the position only matters modulo 8.
+size_t state_index(const CdrState & state)
+{
+  size_t last = state.last_size >= 8 ? 3 : state.last_size >= 4 ? 2 : state.last_size >= 2 ? 1 : 0;
+  return (state.position % 8) * 4 + last;
+}
+
+// Size of a primitive field type (0 if it is not one plans handle)
+size_t primitive_size(uint8_t type_id)
+{
+  switch (type_id) {
+    case rosidl_typesupport_introspection_c__ROS_TYPE_CHAR:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_BOOLEAN:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_OCTET:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT8:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT8:
+      return 1;
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT16:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT16:
+      return 2;
+    case rosidl_typesupport_introspection_c__ROS_TYPE_FLOAT:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT32:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT32:
+      return 4;
+    case rosidl_typesupport_introspection_c__ROS_TYPE_DOUBLE:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_UINT64:
+    case rosidl_typesupport_introspection_c__ROS_TYPE_INT64:
+      return 8;
+    default:  // Long doubles, wide chars, strings and messages
+      return 0;
+  }
+}
+
+// Serialized bools are 0 or 1, but anything could come off the wire
+void normalize_bools(unsigned char * values, size_t count)
+{
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = values[i] != 0;
+  }
+}
+
+// Whether Fast CDR takes an empty array as the last value written (or read), which spares a
+// following value of the same size its alignment. Fast CDR versions differ on this, so the one
+// linked in is asked: a length, an empty array of doubles and a double take 12 bytes if it does,
+// and 16 if the double is aligned.
+struct EmptyArrays
+{
+  bool set_last_size_on_write;
+  bool set_last_size_on_read;
+};
+
+const EmptyArrays & empty_arrays()
+{
+  static const EmptyArrays behavior = []() {
+      char buffer[16] = {0};
+      uint32_t length = 0;
+      double value = 0.0;
+
+      eprosima::fastcdr::FastBuffer write_buffer(buffer, sizeof(buffer));
+      eprosima::fastcdr::Cdr ser(
+        write_buffer, eprosima::fastcdr::Cdr::DEFAULT_ENDIAN, eprosima::fastcdr::Cdr::DDS_CDR);
+      ser << length;
+      ser.serializeArray(&value, 0);
+      ser << value;
+
+      eprosima::fastcdr::FastBuffer read_buffer(buffer, sizeof(buffer));
+      eprosima::fastcdr::Cdr deser(
+        read_buffer, eprosima::fastcdr::Cdr::DEFAULT_ENDIAN, eprosima::fastcdr::Cdr::DDS_CDR);
+      deser >> length;
+      deser.deserializeArray(&value, 0);
+      deser >> value;
+
+      return EmptyArrays{
+        ser.getSerializedDataLength() == 12, deser.getSerializedDataLength() == 12};
+    }();
+  return behavior;
+}
+
+/// CDR PRIMITIVES =============================================================
+void write_padding(eprosima::fastcdr::Cdr & ser, CdrState & state, size_t size)
+{
+  size_t padding = align(state, size);
+  if (padding > 0) {
+    ser.serializeArray(kPadding, padding);
+    state.position += padding;
+  }
+}
+
+void write_bytes(
+  eprosima::fastcdr::Cdr & ser, CdrState & state, const void * data, size_t length,
+  size_t size)
+{
+  ser.serializeArray(static_cast<const char *>(data), length);
+  state.position += length;
+  state.last_size = size;
+}
+
+void write_length(eprosima::fastcdr::Cdr & ser, CdrState & state, uint32_t length)
+{
+  write_padding(ser, state, sizeof(length));
+  write_bytes(ser, state, &length, sizeof(length), sizeof(length));
+}
+
+bool skip_padding(eprosima::fastcdr::Cdr & deser, CdrState & state, size_t size)
+{
+  size_t padding = align(state, size);
+  if (padding > 0) {
+    if (!deser.jump(padding)) {
+      return false;
+    }
+    state.position += padding;
+  }
+  return true;
+}
+
+void read_bytes(
+  eprosima::fastcdr::Cdr & deser, CdrState & state, void * data, size_t length, size_t size)
+{
+  deser.deserializeArray(static_cast<char *>(data), length);
+  state.position += length;
+  state.last_size = size;
+}
+
+bool read_length(eprosima::fastcdr::Cdr & deser, CdrState & state, uint32_t & length)
+{
+  if (!skip_padding(deser, state, sizeof(length))) {
+    return false;
+  }
+  read_bytes(deser, state, &length, sizeof(length), sizeof(length));
+  return true;
+}
+}  // namespace
+
+/// PLAN BUILDER ===============================================================
+class PlanBuilder
+{
+public:
+  explicit PlanBuilder(SerializationPlan & plan)
+  : plan_(plan), run_open_(false)
+  {}
+
+  // Add the fields of a (nested) message at the given offset in the top level message
+  template<typename MessageMembersT>
+  bool add_members(const MessageMembersT * members, size_t base, std::string & error)
+  {
+    for (uint32_t i = 0; i < members->member_count_; ++i) {
+      const auto & member = members->members_[i];
+      size_t offset = base + member.offset_;
+      bool is_sequence = member.is_array_ && (member.array_size_ == 0 || member.is_upper_bound_);
+      size_t count = member.is_array_ ? member.array_size_ : 1;
+
+      if (member.type_id_ == rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE) {
+        if (is_sequence) {
+          error = std::string("sequence of messages '") + member.name_ + "'";
+          return false;
+        }
+        auto nested = static_cast<const MessageMembersT *>(member.members_->data);
+        for (size_t j = 0; j < count; ++j) {
+          if (!add_members(nested, offset + j * nested->size_of_, error)) {
+            return false;
+          }
+        }
+        continue;
+      }
+
+      if (member.type_id_ == rosidl_typesupport_introspection_c__ROS_TYPE_STRING) {
+        if (member.is_array_) {
+          error = std::string("array of strings '") + member.name_ + "'";
+          return false;
+        }
+        add_op(SerializationPlan::OpKind::kString, offset);
+        continue;
+      }
+
+      size_t size = primitive_size(member.type_id_);
+      bool is_bool = member.type_id_ == rosidl_typesupport_introspection_c__ROS_TYPE_BOOLEAN;
+      if (size == 0) {
+        error = std::string("unsupported field type of '") + member.name_ + "'";
+        return false;
+      }
+
+      if (!is_sequence) {
+        add_primitive(offset, size, count, is_bool);
+        continue;
+      }
+
+      // NOTE: std::vector<bool> does not store its elements as an array
+      if (plan_.is_cpp_ && is_bool) {
+        error = std::string("sequence of bools '") + member.name_ + "'";
+        return false;
+      }
+      SerializationPlan::Op & op = add_op(SerializationPlan::OpKind::kSequence, offset);
+      op.size = size;
+      op.is_bool = is_bool;
+      op.bound = member.is_upper_bound_ ? member.array_size_ : 0;
+      set_accessors(op, member);
+    }
+    return true;
+  }
+
+  void finish()
+  {
+    close_run();
+  }
+
+  // Bitmask of the alignment states in which the CDR layout of a run matches its memory layout
+  static uint32_t find_direct_states(const std::vector<SerializationPlan::Field> & fields)
+  {
+    uint32_t states = 0;
+    for (size_t position = 0; position < 8; ++position) {
+      for (size_t last_size = 1; last_size <= 8; last_size *= 2) {
+        CdrState state = {position, last_size};
+        size_t index = state_index(state);
+
+        bool direct = true;
+        size_t start = 0;
+        for (size_t i = 0; i < fields.size() && direct; ++i) {
+          state.position += align(state, fields[i].size);
+          if (i == 0) {
+            start = state.position;
+          }
+          direct = state.position - start == fields[i].offset;
+          state.position += fields[i].size * fields[i].count;
+          state.last_size = fields[i].size;
+        }
+
+        if (direct) {
+          states |= 1u << index;
+        }
+      }
+    }
+    return states;
+  }
+
+private:
+  SerializationPlan::Op & add_op(SerializationPlan::OpKind kind, size_t offset)
+  {
+    close_run();
+
+    SerializationPlan::Op op = {};
+    op.kind = kind;
+    op.offset = offset;
+    plan_.ops_.push_back(std::move(op));
+    return plan_.ops_.back();
+  }
+
+  // Extend the open run with a primitive field if it is laid out in memory where CDR puts it, and
+  // is aligned no more strictly than the run's first field (so the run does not depend on where it
+  // starts). Otherwise start a new run with it.
+  void add_primitive(size_t offset, size_t size, size_t count, bool is_bool)
+  {
+    if (run_open_) {
+      size_t run_offset = run_.length + ((size - run_.length % size) & (size - 1));
+      if (size <= run_.fields.front().size && offset == run_.offset + run_offset) {
+        run_.fields.push_back({run_offset, size, count, is_bool});
+        run_.length = run_offset + size * count;
+        run_.has_bools = run_.has_bools || is_bool;
+        return;
+      }
+      close_run();
+    }
+
+    run_ = {};
+    run_.kind = SerializationPlan::OpKind::kCopy;
+    run_.offset = offset;
+    run_.fields.push_back({0, size, count, is_bool});
+    run_.length = size * count;
+    run_.has_bools = is_bool;
+    run_open_ = true;
+  }
+
+  void close_run()
+  {
+    if (run_open_) {
+      run_.direct_states = find_direct_states(run_.fields);
+      plan_.ops_.push_back(std::move(run_));
+      run_open_ = false;
+    }
+  }
+
+  static void set_accessors(
+    SerializationPlan::Op & op, const rosidl_typesupport_introspection_c__MessageMember & member)
+  {
+    op.size_function = member.size_function;
+    op.get_const_function = member.get_const_function;
+    op.get_function = member.get_function;
+    op.resize_function_c = member.resize_function;
+  }
+
+  static void set_accessors(
+    SerializationPlan::Op & op, const rosidl_typesupport_introspection_cpp::MessageMember & member)
+  {
+    op.size_function = member.size_function;
+    op.get_const_function = member.get_const_function;
+    op.get_function = member.get_function;
+    op.resize_function_cpp = member.resize_function;
+  }
+
+  SerializationPlan & plan_;
+
+  bool run_open_;
+  SerializationPlan::Op run_;
+};
+
+/// GET ========================================================================
+const SerializationPlan * SerializationPlan::get(
+  const rosidl_message_type_support_t * introspection)
+{
+  // Plans of the types seen so far (nullptr for those that cannot be planned), by members
+  static std::mutex plans_mutex;
+  static std::unordered_map<const void *, std::unique_ptr<SerializationPlan>> plans;
+
+  std::lock_guard<std::mutex> lock(plans_mutex);
+  auto it = plans.find(introspection->data);
+  if (it != plans.end()) {
+    return it->second.get();
+  }
+
+  std::unique_ptr<SerializationPlan> plan(new (std::nothrow) SerializationPlan());
+  if (!plan) {
+    return nullptr;
+  }
+  plan->members_ = introspection->data;
+  plan->is_cpp_ = strcmp(
+    introspection->typesupport_identifier,
+    rosidl_typesupport_introspection_cpp::typesupport_identifier) == 0;
+
+  PlanBuilder builder(*plan);
+  std::string name;
+  std::string error;
+  bool planned;
+  if (plan->is_cpp_) {
+    auto members =
+      static_cast<const rosidl_typesupport_introspection_cpp::MessageMembers *>(introspection->data);
+    name = std::string(members->message_namespace_) + "::" + members->message_name_;
+    planned = builder.add_members(members, 0, error);
+  } else {
+    auto members =
+      static_cast<const rosidl_typesupport_introspection_c__MessageMembers *>(introspection->data);
+    name = std::string(members->message_namespace_) + "__" + members->message_name_;
+    planned = builder.add_members(members, 0, error);
+  }
+  builder.finish();
+
+  if (planned) {
+    RCUTILS_LOG_DEBUG_NAMED(
+      "rmw_zenoh_common_cpp",
+      "[serialization plan] %s: %zu ops",
+      name.c_str(),
+      plan->ops_.size());
+  } else {
+    RCUTILS_LOG_DEBUG_NAMED(
+      "rmw_zenoh_common_cpp",
+      "[serialization plan] %s: using the type support callbacks (%s)",
+      name.c_str(),
+      error.c_str());
+    plan.reset();
+  }
+
+  const SerializationPlan * result = plan.get();
+  plans.emplace(introspection->data, std::move(plan));
+  return result;
+}
+
+/// SERIALIZE ==================================================================
+bool SerializationPlan::serialize(const void * ros_message, eprosima::fastcdr::Cdr & ser) const
+{
+  const auto * message = static_cast<const unsigned char *>(ros_message);
+  CdrState state = kInitialState;
+
+  for (const Op & op : ops_) {
+    const unsigned char * field = message + op.offset;
+
+    switch (op.kind) {
+      case OpKind::kCopy:
+        if (op.direct_states & (1u << state_index(state))) {
+          write_padding(ser, state, op.fields.front().size);
+          write_bytes(ser, state, field, op.length, op.fields.back().size);
+        } else {
+          for (const Field & run_field : op.fields) {
+            write_padding(ser, state, run_field.size);
+            write_bytes(
+              ser, state, field + run_field.offset, run_field.size * run_field.count,
+              run_field.size);
+          }
+        }
+        break;
+
+      case OpKind::kString: {
+          // NOTE: Like Fast CDR, strings end at their first null character
+          const char * data;
+          if (is_cpp_) {
+            data = reinterpret_cast<const std::string *>(field)->c_str();
+          } else {
+            data = reinterpret_cast<const rosidl_runtime_c__String *>(field)->data;
+            if (!data) {
+              return false;
+            }
+          }
+          size_t length = strlen(data) + 1;
+          write_length(ser, state, static_cast<uint32_t>(length));
+          write_bytes(ser, state, data, length, 1);
+          break;
+        }
+
+      case OpKind::kSequence: {
+          size_t count = op.size_function(field);
+          if (op.bound > 0 && count > op.bound) {
+            return false;
+          }
+          write_length(ser, state, static_cast<uint32_t>(count));
+          if (count > 0) {
+            write_padding(ser, state, op.size);
+            write_bytes(ser, state, op.get_const_function(field, 0), count * op.size, op.size);
+          } else if (empty_arrays().set_last_size_on_write) {
+            state.last_size = op.size;
+          }
+          break;
+        }
+    }
+  }
+  return true;
+}
+
+/// DESERIALIZE ================================================================
+bool SerializationPlan::deserialize(eprosima::fastcdr::Cdr & deser, void * ros_message) const
+{
+  return deserialize(deser, ros_message, nullptr);
+}
+
+bool SerializationPlan::deserialize_view(
+  eprosima::fastcdr::Cdr & deser, void * ros_message, std::vector<void *> & views) const
+{
+  return !is_cpp_ && deserialize(deser, ros_message, &views);
+}
+
+bool SerializationPlan::deserialize(
+  eprosima::fastcdr::Cdr & deser, void * ros_message, std::vector<void *> * views) const
+{
+  auto * message = static_cast<unsigned char *>(ros_message);
+  CdrState state = kInitialState;
+
+  for (const Op & op : ops_) {
+    unsigned char * field = message + op.offset;
+
+    switch (op.kind) {
+      case OpKind::kCopy:
+        if (op.direct_states & (1u << state_index(state))) {
+          if (!skip_padding(deser, state, op.fields.front().size)) {
+            return false;
+          }
+          read_bytes(deser, state, field, op.length, op.fields.back().size);
+        } else {
+          for (const Field & run_field : op.fields) {
+            if (!skip_padding(deser, state, run_field.size)) {
+              return false;
+            }
+            read_bytes(
+              deser, state, field + run_field.offset, run_field.size * run_field.count,
+              run_field.size);
+          }
+        }
+
+        if (op.has_bools) {
+          for (const Field & run_field : op.fields) {
+            if (run_field.is_bool) {
+              normalize_bools(field + run_field.offset, run_field.count);
+            }
+          }
+        }
+        break;
+
+      case OpKind::kString: {
+          uint32_t length;
+          if (!read_length(deser, state, length)) {
+            return false;
+          }
+          const char * data = deser.getCurrentPosition();
+          if (length > 0) {
+            if (!deser.jump(length)) {
+              return false;
+            }
+            state.position += length;
+            state.last_size = 1;
+          }
+
+          size_t size = length > 0 && data[length - 1] == '\0' ? length - 1 : length;
+          if (is_cpp_) {
+            reinterpret_cast<std::string *>(field)->assign(data, size);
+          } else if (!rosidl_runtime_c__String__assignn(
+              reinterpret_cast<rosidl_runtime_c__String *>(field), data, size))
+          {
+            return false;
+          }
+          break;
+        }
+
+      case OpKind::kSequence: {
+          uint32_t count;
+          if (!read_length(deser, state, count)) {
+            return false;
+          }
+          if (op.bound > 0 && count > op.bound) {
+            return false;
+          }
+
+          // Bools are left out of views, since they may need normalizing
+          size_t length = count * op.size;
+          bool view = false;
+          if (count > 0) {
+            if (!skip_padding(deser, state, op.size)) {
+              return false;
+            }
+            view = views && !op.is_bool &&
+              reinterpret_cast<uintptr_t>(deser.getCurrentPosition()) % op.size == 0;
+          }
+
+          if (view) {
+            char * data = deser.getCurrentPosition();
+            if (!deser.jump(length) || !op.resize_function_c(field, 0)) {
+              return false;
+            }
+            state.position += length;
+            state.last_size = op.size;
+
+            // NOTE: All C sequences of primitives have the same layout
+            auto * sequence = reinterpret_cast<rosidl_runtime_c__octet__Sequence *>(field);
+            sequence->data = reinterpret_cast<uint8_t *>(data);
+            sequence->size = count;
+            sequence->capacity = count;
+            views->push_back(field);
+            break;
+          }
+
+          if (is_cpp_) {
+            op.resize_function_cpp(field, count);
+          } else if (!op.resize_function_c(field, count)) {
+            return false;
+          }
+
+          if (count > 0) {
+            auto * data = static_cast<unsigned char *>(op.get_function(field, 0));
+            read_bytes(deser, state, data, length, op.size);
+            if (op.is_bool) {
+              normalize_bools(data, count);
+            }
+          } else if (empty_arrays().set_last_size_on_read) {
+            state.last_size = op.size;
+          }
+          break;
+        }
+    }
+  }
+  return true;
+}
+
+void SerializationPlan::release_views(const std::vector<void *> & views)
+{
+  for (void * field : views) {
+    auto * sequence = static_cast<rosidl_runtime_c__octet__Sequence *>(field);
+    sequence->data = nullptr;
+    sequence->size = 0;
+    sequence->capacity = 0;
+  }
+}
+
+/// MESSAGES ===================================================================
+size_t SerializationPlan::message_size() const
+{
+  if (is_cpp_) {
+    return static_cast<const rosidl_typesupport_introspection_cpp::MessageMembers *>(
+      members_)->size_of_;
+  }
+  return static_cast<const rosidl_typesupport_introspection_c__MessageMembers *>(
+    members_)->size_of_;
+}
+
+void SerializationPlan::init_message(void * ros_message) const
+{
+  if (is_cpp_) {
+    static_cast<const rosidl_typesupport_introspection_cpp::MessageMembers *>(
+      members_)->init_function(ros_message, rosidl_runtime_cpp::MessageInitialization::ALL);
+    return;
+  }
+  static_cast<const rosidl_typesupport_introspection_c__MessageMembers *>(
+    members_)->init_function(ros_message, ROSIDL_RUNTIME_C_MSG_INIT_ALL);
+}
+
+void SerializationPlan::fini_message(void * ros_message) const
+{
+  if (is_cpp_) {
+    static_cast<const rosidl_typesupport_introspection_cpp::MessageMembers *>(
+      members_)->fini_function(ros_message);
+    return;
+  }
+  static_cast<const rosidl_typesupport_introspection_c__MessageMembers *>(
+    members_)->fini_function(ros_message);
+}
+
+}  // namespace rmw_zenoh_common_cpp
@@ -0,0 +1,124 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__SERIALIZATION_PLAN_HPP_
+#define IMPL__SERIALIZATION_PLAN_HPP_
+
+#include <fastcdr/Cdr.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// SERIALIZATION PLAN =========================================================
+// Serializes messages of a type to the same CDR as its generated type support callbacks, with a
+// few bulk copies instead of a Cdr call per field.
+//
+// The plan is derived from the introspection type support of the type. Nested messages and fixed
+// size arrays are flattened, and runs of primitive fields whose CDR layout matches their layout
+// in memory are copied as one block. Strings and sequences of primitives get an op each. Types
+// with anything else (wide strings, long doubles, and sequences of strings, messages or C++ bools)
+// have no plan, and are left to the callbacks.
+//
+// Plans work on the host byte order only. Fast CDR's alignment state is tracked alongside, so runs
+// that would be padded differently on the wire than in memory are copied field by field.
+class SerializationPlan
+{
+public:
+  // The plan for a message type, given its (C or C++) introspection type support. Plans are built
+  // the first time they are asked for and kept for the lifetime of the process.
+  // Returns nullptr if the type cannot be planned.
+  static const SerializationPlan * get(const rosidl_message_type_support_t * introspection);
+
+  // Same contract as the cdr_serialize and cdr_deserialize type support callbacks: the
+  // encapsulation is handled by the caller
+  bool serialize(const void * ros_message, eprosima::fastcdr::Cdr & ser) const;
+  bool deserialize(eprosima::fastcdr::Cdr & deser, void * ros_message) const;
+
+  // Deserialize into a message whose sequences of primitives point straight into the CDR buffer
+  // (where their elements are aligned for their type), instead of into storage of their own.
+  // The fields that do are added to views, and must be handed to release_views() before the
+  // message is finalized. The buffer must outlive the message. Only for C messages.
+  bool deserialize_view(
+    eprosima::fastcdr::Cdr & deser, void * ros_message, std::vector<void *> & views) const;
+  static void release_views(const std::vector<void *> & views);
+
+  // Whether deserialize_view() and the message functions below can be used
+  bool can_view() const {return !is_cpp_;}
+
+  // Size of the messages of the type, and their initialization and finalization
+  size_t message_size() const;
+  void init_message(void * ros_message) const;
+  void fini_message(void * ros_message) const;
+
+  size_t op_count() const {return ops_.size();}
+
+private:
+  friend class PlanBuilder;
+
+  // Primitive field (or fixed size array of them) in a run
+  struct Field
+  {
+    size_t offset;  // From the start of the run
+    size_t size;
+    size_t count;
+    bool is_bool;
+  };
+
+  enum class OpKind
+  {
+    kCopy,
+    kString,
+    kSequence
+  };
+
+  struct Op
+  {
+    OpKind kind;
+    size_t offset;  // Of the field (or of the run's first field) in the message
+
+    // kCopy: the fields of the run, the bytes they span, and the bitmask of the Fast CDR alignment
+    // states in which their CDR layout matches their memory layout
+    std::vector<Field> fields;
+    size_t length;
+    uint32_t direct_states;
+    bool has_bools;
+
+    // kSequence: element size, bound (0 if unbounded), and the introspection accessors
+    size_t size;
+    bool is_bool;
+    size_t bound;
+    size_t (* size_function)(const void *);
+    const void * (*get_const_function)(const void *, size_t);
+    void * (*get_function)(void *, size_t);
+    bool (* resize_function_c)(void *, size_t);
+    void (* resize_function_cpp)(void *, size_t);
+  };
+
+  bool deserialize(
+    eprosima::fastcdr::Cdr & deser, void * ros_message, std::vector<void *> * views) const;
+
+  bool is_cpp_;
+  const void * members_;  // Introspection members of the type (C or C++)
+  std::vector<Op> ops_;
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__SERIALIZATION_PLAN_HPP_
@@ -14,6 +14,7 @@
 
 #include "service_impl.hpp"
 
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -37,47 +38,57 @@ std::unordered_map<std::string, std::vector<rmw_service_data_t *>>
 
 
 /// ZENOH REQUEST MESSAGE SUBSCRIPTION CALLBACK (static method) ================
-void rmw_service_data_t::zn_request_sub_callback(const zn_sample_t * sample, const void *)
+void rmw_service_data_t::zn_request_sub_callback(const zn_sample_t * sample, const void * arg)
 {
   std::lock_guard<std::mutex> guard(request_callback_mutex);
 
   // NOTE(CH3): We unfortunately have to do this copy construction since we shouldn't be using
   // char * as keys to the unordered_map
-  std::string key(sample->key.val, sample->key.len);
-
-  // Vector to store the byte array (so we have a copyable container instead of a pointer)
-  std::vector<unsigned char> byte_vec(sample->value.val, sample->value.val + sample->value.len);
-
-  // Get shared pointer to byte array vector
-  // NOTE(CH3): We use a shared pointer to avoid copies and to leverage on the smart pointer's
-  // reference counting
-  auto byte_vec_ptr = std::make_shared<std::vector<unsigned char>>(std::move(byte_vec));
+  //
+  // The string is kept per thread so its storage gets reused from sample to sample
+  static thread_local std::string key;
+  key.assign(sample->key.val, sample->key.len);
 
   auto map_iter = rmw_service_data_t::zn_topic_to_service_data.find(key);
 
   // If the key was not found in the map, it means that there are no RMW services listening on this
   // topic, so this message can be dropped without issue
-  if (map_iter != rmw_service_data_t::zn_topic_to_service_data.end()) {
-    // Push shared pointer to message bytes to all associated service request message queues
-    for (auto it = map_iter->second.begin(); it != map_iter->second.end(); ++it) {
-      std::unique_lock<std::mutex> lock((*it)->request_queue_mutex_);
-
-      if ((*it)->zn_request_message_queue_.size() >= (*it)->queue_depth_) {
-        // Log warning if message is discarded due to hitting the queue depth
-        RCUTILS_LOG_WARN_NAMED(
-          "rmw_zenoh_common_cpp",
-          "Request queue depth of %ld reached, discarding oldest request message "
-          "for service for %s (ID: %ld)",
-          (*it)->queue_depth_,
-          key.c_str(),
-          (*it)->service_id_);
-
-        (*it)->zn_request_message_queue_.pop_back();
-      }
-      (*it)->zn_request_message_queue_.push_front(byte_vec_ptr);
-
-      (*it)->request_queue_mutex_.unlock();
+  if (map_iter == rmw_service_data_t::zn_topic_to_service_data.end()) {
+    return;
+  }
+
+  // Copy the message out of Zenoh's buffer once, into a buffer from the context's pool
+  auto * pool = static_cast<rmw_zenoh_common_cpp::ReceiveBufferPool *>(const_cast<void *>(arg));
+
+  rmw_zenoh_common_cpp::ReceiveBufferPtr buffer = pool->acquire(sample->value.len);
+  if (!buffer) {
+    RCUTILS_LOG_ERROR_NAMED(
+      "rmw_zenoh_common_cpp",
+      "Could not get a receive buffer of %zu bytes, dropping request message for %s",
+      sample->value.len,
+      key.c_str());
+    return;
+  }
+  memcpy(buffer->data(), sample->value.val, sample->value.len);
+
+  // Push the pooled buffer to all associated service request message queues
+  for (auto it = map_iter->second.begin(); it != map_iter->second.end(); ++it) {
+    std::lock_guard<std::mutex> lock((*it)->request_queue_mutex_);
+
+    if ((*it)->zn_request_message_queue_.size() >= (*it)->queue_depth_) {
+      // Log warning if message is discarded due to hitting the queue depth
+      RCUTILS_LOG_WARN_NAMED(
+        "rmw_zenoh_common_cpp",
+        "Request queue depth of %ld reached, discarding oldest request message "
+        "for service for %s (ID: %ld)",
+        (*it)->queue_depth_,
+        key.c_str(),
+        (*it)->service_id_);
+
+      (*it)->zn_request_message_queue_.pop_back();
     }
+    (*it)->zn_request_message_queue_.push_front(buffer);
+    (*it)->ready_claims_.set_available((*it)->zn_request_message_queue_.size());
   }
 }
 
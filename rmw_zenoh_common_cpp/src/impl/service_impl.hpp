@@ -27,6 +27,9 @@
 #include "rmw/rmw.h"
 #include "rmw_zenoh_common_cpp/TypeSupport.hpp"
 
+#include "ready_claims.hpp"
+#include "receive_buffer_pool.hpp"
+
 extern "C"
 {
 #include "rmw_zenoh_common_cpp/zenoh-net-interface.h"
@@ -73,11 +76,17 @@ struct rmw_service_data_t
   const rmw_node_t * node_;
 
   // Instanced request message queue
-  std::deque<std::shared_ptr<std::vector<unsigned char>>> zn_request_message_queue_;
+  std::deque<rmw_zenoh_common_cpp::ReceiveBufferPtr> zn_request_message_queue_;
   std::mutex request_queue_mutex_;
 
+  // Readiness of the request queue, claimed one request per waiter
+  rmw_zenoh_common_cpp::ReadyClaims ready_claims_;
+
   size_t service_id_;
   size_t queue_depth_;
+
+  // Requests discarded by rmw_take_request for being past their deadline
+  std::atomic<uint64_t> expired_requests_;
 };
 
 #endif  // IMPL__SERVICE_IMPL_HPP_
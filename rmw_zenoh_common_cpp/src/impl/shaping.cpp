@@ -0,0 +1,127 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "shaping.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// TOKEN BUCKET ===============================================================
+TokenBucket::TokenBucket(uint64_t rate, uint64_t burst, Clock::time_point now)
+: rate_(static_cast<double>(rate)),
+  burst_(static_cast<double>(burst > 0 ? burst : rate)),
+  tokens_(burst_),
+  last_refill_(now)
+{}
+
+void TokenBucket::refill(Clock::time_point now)
+{
+  if (now <= last_refill_) {
+    return;
+  }
+  std::chrono::duration<double> elapsed = now - last_refill_;
+  last_refill_ = now;
+  tokens_ = std::min(burst_, tokens_ + elapsed.count() * rate_);
+}
+
+bool TokenBucket::try_consume(size_t bytes, Clock::time_point now)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  refill(now);
+
+  double cost = static_cast<double>(bytes);
+  if (tokens_ < std::min(cost, burst_)) {
+    return false;
+  }
+  tokens_ -= cost;
+  return true;
+}
+
+std::chrono::nanoseconds TokenBucket::consume(size_t bytes, Clock::time_point now)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  refill(now);
+
+  tokens_ -= static_cast<double>(bytes);
+  if (tokens_ >= 0.0) {
+    return std::chrono::nanoseconds(0);
+  }
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::duration<double>(-tokens_ / rate_));
+}
+
+void TokenBucket::refund(size_t bytes)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  tokens_ = std::min(burst_, tokens_ + static_cast<double>(bytes));
+}
+
+/// PUBLISHER SHAPER ===========================================================
+PublisherShaper::PublisherShaper(
+  uint64_t rate, uint64_t burst, TokenBucket * session_bucket, Mode mode,
+  TokenBucket::Clock::time_point now)
+: has_bucket_(rate > 0),
+  bucket_(rate, burst, now),
+  session_bucket_(session_bucket),
+  mode_(mode)
+{}
+
+bool PublisherShaper::admit(size_t bytes)
+{
+  std::chrono::nanoseconds wait(0);
+  bool admitted = admit(bytes, TokenBucket::Clock::now(), wait);
+  if (wait.count() > 0) {
+    std::this_thread::sleep_for(wait);
+  }
+  return admitted;
+}
+
+bool PublisherShaper::admit(
+  size_t bytes, TokenBucket::Clock::time_point now, std::chrono::nanoseconds & wait)
+{
+  wait = std::chrono::nanoseconds(0);
+  if (mode_ == Mode::kDrop) {
+    bool admitted = !has_bucket_ || bucket_.try_consume(bytes, now);
+    if (admitted && session_bucket_ && !session_bucket_->try_consume(bytes, now)) {
+      // The publisher's budget was not used after all
+      if (has_bucket_) {
+        bucket_.refund(bytes);
+      }
+      admitted = false;
+    }
+    if (!admitted) {
+      dropped_messages.fetch_add(1, std::memory_order_relaxed);
+      dropped_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    return admitted;
+  }
+
+  // The message goes out once both budgets are paid back
+  if (has_bucket_) {
+    wait = bucket_.consume(bytes, now);
+  }
+  if (session_bucket_) {
+    wait = std::max(wait, session_bucket_->consume(bytes, now));
+  }
+  if (wait.count() > 0) {
+    delayed_messages.fetch_add(1, std::memory_order_relaxed);
+    delay_ns.fetch_add(static_cast<uint64_t>(wait.count()), std::memory_order_relaxed);
+  }
+  return true;
+}
+
+}  // namespace rmw_zenoh_common_cpp
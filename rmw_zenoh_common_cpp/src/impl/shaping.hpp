@@ -0,0 +1,110 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__SHAPING_HPP_
+#define IMPL__SHAPING_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// TOKEN BUCKET ===============================================================
+// Byte budget that refills at a fixed rate, up to a burst size.
+//
+// Every call takes the current time, so that tests can drive the clock.
+class TokenBucket
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // rate in bytes per second, burst in bytes (0 for one second worth of rate). The bucket starts
+  // full at now.
+  TokenBucket(uint64_t rate, uint64_t burst, Clock::time_point now = Clock::now());
+
+  // Take bytes out of the bucket if they are available at now. Returns false if they are not.
+  //
+  // A message bigger than the burst size can only ever be sent out of a full bucket, which it
+  // then leaves in debt.
+  bool try_consume(size_t bytes, Clock::time_point now = Clock::now());
+
+  // Take bytes out of the bucket at now, going into debt if they are not available.
+  // Returns how long to wait for the debt to be paid back before sending them.
+  std::chrono::nanoseconds consume(size_t bytes, Clock::time_point now = Clock::now());
+
+  // Put bytes taken by try_consume back, when the message ends up not being sent
+  void refund(size_t bytes);
+
+private:
+  // Add the tokens accumulated since the last refill
+  void refill(Clock::time_point now);
+
+  const double rate_;
+  const double burst_;
+
+  std::mutex mutex_;
+  double tokens_;
+  Clock::time_point last_refill_;
+};
+
+/// PUBLISHER SHAPER ===========================================================
+// Bandwidth limit of a publisher: its own token bucket and/or its session's one.
+//
+// In drop mode, messages that exceed either budget are dropped (and counted). In block mode, the
+// publishing thread waits until both budgets allow the message.
+class PublisherShaper
+{
+public:
+  enum class Mode
+  {
+    kDrop,
+    kBlock
+  };
+
+  // rate in bytes per second (0 for no publisher limit), burst in bytes (0 for one second worth
+  // of rate). session_bucket may be nullptr, and must outlive the shaper.
+  PublisherShaper(
+    uint64_t rate, uint64_t burst, TokenBucket * session_bucket, Mode mode,
+    TokenBucket::Clock::time_point now = TokenBucket::Clock::now());
+
+  // Account for a message of the given serialized size.
+  // Returns false if it must be dropped. In block mode, returns once it may be sent.
+  bool admit(size_t bytes);
+
+  // Account for a message of the given serialized size at now, without waiting.
+  // Returns false if it must be dropped. In block mode, wait is set to how long the message must
+  // be held back before it is sent.
+  bool admit(size_t bytes, TokenBucket::Clock::time_point now, std::chrono::nanoseconds & wait);
+
+  Mode mode() const {return mode_;}
+
+  std::atomic<uint64_t> dropped_messages{0};
+  std::atomic<uint64_t> dropped_bytes{0};
+  std::atomic<uint64_t> delayed_messages{0};
+  std::atomic<uint64_t> delay_ns{0};
+
+private:
+  bool has_bucket_;
+  TokenBucket bucket_;
+  TokenBucket * session_bucket_;
+  Mode mode_;
+};
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__SHAPING_HPP_
@@ -0,0 +1,172 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "threads.hpp"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <utility>
+
+#include "rcutils/logging_macros.h"
+
+namespace rmw_zenoh_common_cpp
+{
+
+namespace
+{
+// Registered threads, not configured yet
+std::mutex registered_mutex;
+std::vector<std::pair<std::string, std::vector<pid_t>>> registered;
+
+// Linux thread names are at most 15 characters
+constexpr size_t kMaxThreadName = 15;
+
+#ifdef __linux__
+bool set_affinity(pid_t tid, const std::vector<int> & cpus, std::string & error)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu >= CPU_SETSIZE) {
+      error = "CPU " + std::to_string(cpu) + " is out of range";
+      return false;
+    }
+    CPU_SET(cpu, &set);
+  }
+  // Threads that have exited since they were registered are left alone
+  if (sched_setaffinity(tid, sizeof(set), &set) != 0 && errno != ESRCH) {
+    error = std::string("could not set the CPU affinity: ") + strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+bool set_scheduler(pid_t tid, const std::string & policy, int priority, std::string & error)
+{
+  int native_policy = policy == "fifo" ? SCHED_FIFO : policy == "rr" ? SCHED_RR : SCHED_OTHER;
+  sched_param param;
+  memset(&param, 0, sizeof(param));
+  param.sched_priority = priority;
+  if (sched_setscheduler(tid, native_policy, &param) != 0 && errno != ESRCH) {
+    error = "could not set the scheduling policy " + policy + " with priority " +
+      std::to_string(priority) + ": " + strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+bool set_name(pid_t tid, const std::string & name, std::string & error)
+{
+  std::ofstream comm("/proc/self/task/" + std::to_string(tid) + "/comm");
+  if (!(comm << name.substr(0, kMaxThreadName) << std::flush)) {
+    error = "could not set the name " + name;
+    return false;
+  }
+  return true;
+}
+#endif
+}  // namespace
+
+/// LIST THREADS ===============================================================
+std::vector<pid_t> list_threads()
+{
+  std::vector<pid_t> tids;
+#ifdef __linux__
+  DIR * dir = opendir("/proc/self/task");
+  if (!dir) {
+    return tids;
+  }
+  while (dirent * entry = readdir(dir)) {
+    if (entry->d_name[0] != '.') {
+      tids.push_back(static_cast<pid_t>(atoi(entry->d_name)));
+    }
+  }
+  closedir(dir);
+  std::sort(tids.begin(), tids.end());
+#endif
+  return tids;
+}
+
+/// REGISTER THREADS ===========================================================
+void register_threads(
+  const std::string & thread_class, const std::vector<pid_t> & before,
+  const std::vector<pid_t> & after)
+{
+  std::vector<pid_t> started;
+  std::set_difference(
+    after.begin(), after.end(), before.begin(), before.end(), std::back_inserter(started));
+  if (started.empty()) {
+    return;
+  }
+
+  RCUTILS_LOG_DEBUG_NAMED(
+    "rmw_zenoh_common_cpp", "Registered %zu %s thread(s)", started.size(), thread_class.c_str());
+
+  std::lock_guard<std::mutex> lock(registered_mutex);
+  registered.emplace_back(thread_class, std::move(started));
+}
+
+/// CONFIGURE THREADS ==========================================================
+bool configure_threads(const Config & config, std::string & error)
+{
+  std::vector<std::pair<std::string, std::vector<pid_t>>> threads;
+  {
+    std::lock_guard<std::mutex> lock(registered_mutex);
+    threads.swap(registered);
+  }
+
+  for (const auto & thread_class : threads) {
+    const ThreadConfig * thread_config = config.thread(thread_class.first);
+    if (!thread_config) {
+      continue;
+    }
+
+#ifdef __linux__
+    const std::vector<pid_t> & tids = thread_class.second;
+    for (size_t i = 0; i < tids.size(); ++i) {
+      std::string problem;
+      bool ok = true;
+      if (!thread_config->cpus.empty()) {
+        ok = set_affinity(tids[i], thread_config->cpus, problem);
+      }
+      if (ok && !thread_config->policy.empty()) {
+        ok = set_scheduler(tids[i], thread_config->policy, thread_config->priority, problem);
+      }
+      if (ok && !thread_config->name.empty()) {
+        std::string suffix = tids.size() > 1 ? "-" + std::to_string(i) : "";
+        std::string name =
+          thread_config->name.substr(0, kMaxThreadName - suffix.size()) + suffix;
+        ok = set_name(tids[i], name, problem);
+      }
+      if (!ok) {
+        error = thread_class.first + " thread " + std::to_string(tids[i]) + ": " + problem;
+        return false;
+      }
+    }
+#endif
+  }
+  return true;
+}
+
+}  // namespace rmw_zenoh_common_cpp
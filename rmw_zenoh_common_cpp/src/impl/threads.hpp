@@ -0,0 +1,54 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__THREADS_HPP_
+#define IMPL__THREADS_HPP_
+
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// MIDDLEWARE THREADS =========================================================
+// Threads started by Zenoh on behalf of the middleware, registered under a thread class so they
+// can be given the settings of the class in the config file (see ThreadConfig).
+//
+// Zenoh does not let us start these threads ourselves, so they are found by comparing the threads
+// of the process before and after the call that starts them. The thread classes are:
+//  - session: Threads started by opening the Zenoh session.
+//  - read: The zenoh-pico read task.
+//  - lease: The zenoh-pico lease task.
+//
+// Only supported on Linux. Elsewhere no threads are ever found.
+
+// IDs of the threads of the process, sorted
+std::vector<pid_t> list_threads();
+
+// Register the threads that are in after but not in before as being of a class
+void register_threads(
+  const std::string & thread_class, const std::vector<pid_t> & before,
+  const std::vector<pid_t> & after);
+
+// Apply the settings of their class to the threads registered since the last call.
+// Returns false, with a description of the problem in error, if a setting could not be applied.
+bool configure_threads(const Config & config, std::string & error);
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__THREADS_HPP_
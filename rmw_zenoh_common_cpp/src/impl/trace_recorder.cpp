@@ -0,0 +1,183 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "trace_recorder.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include "rcutils/get_env.h"
+#include "rcutils/logging_macros.h"
+
+namespace rmw_zenoh_common_cpp
+{
+
+namespace
+{
+// Records are written out in blocks of about this many bytes
+constexpr size_t kBufferSize = 64 * 1024;
+
+int64_t steady_now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}  // namespace
+
+TraceRecorder::TraceRecorder(FILE * file, int64_t start)
+: file_(file),
+  start_(start),
+  next_id_(1)
+{
+  buffer_.reserve(kBufferSize + kTraceRecordSize + sizeof(uint16_t) + UINT16_MAX);
+
+  // The header holds the start on the system clock, to line traces of several processes up
+  int64_t system_start = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  unsigned char header[kTraceHeaderSize] = {};
+  memcpy(header, kTraceMagic, sizeof(kTraceMagic));
+  memcpy(header + 4, &kTraceVersion, sizeof(kTraceVersion));
+  memcpy(header + 8, &system_start, sizeof(system_start));
+  buffer_.insert(buffer_.end(), header, header + sizeof(header));
+}
+
+TraceRecorder::~TraceRecorder()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  write_buffer();
+  fclose(file_);
+}
+
+/// GET ========================================================================
+TraceRecorder * TraceRecorder::get()
+{
+  // Destroyed at exit, which writes out what is left of the trace
+  static std::unique_ptr<TraceRecorder> recorder(from_environment());
+  return recorder.get();
+}
+
+/// FROM ENVIRONMENT ===========================================================
+TraceRecorder * TraceRecorder::from_environment()
+{
+  const char * path;
+  if (rcutils_get_env("RMW_ZENOH_TRACE_FILE", &path) != nullptr || path[0] == '\0') {
+    return nullptr;
+  }
+  return open(path);
+}
+
+/// OPEN =======================================================================
+TraceRecorder * TraceRecorder::open(const char * path)
+{
+  FILE * file = fopen(path, "wb");
+  if (!file) {
+    RCUTILS_LOG_ERROR_NAMED(
+      "rmw_zenoh_common_cpp", "Could not create trace file %s, calls are not traced", path);
+    return nullptr;
+  }
+
+  TraceRecorder * recorder = new (std::nothrow) TraceRecorder(file, steady_now());
+  if (!recorder) {
+    fclose(file);
+    return nullptr;
+  }
+  RCUTILS_LOG_INFO_NAMED("rmw_zenoh_common_cpp", "Tracing rmw calls to %s", path);
+  return recorder;
+}
+
+/// CREATE =====================================================================
+void TraceRecorder::create(
+  TraceEvent event, const void * entity, const void * parent, const char * name)
+{
+  size_t length = name ? strnlen(name, UINT16_MAX) : 0;
+  uint16_t name_length = static_cast<uint16_t>(length);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint32_t entity_id = next_id_++;
+  ids_[entity] = entity_id;
+
+  append(event, entity_id, now(), parent ? id(parent) : 0);
+  const unsigned char * length_bytes = reinterpret_cast<const unsigned char *>(&name_length);
+  buffer_.insert(buffer_.end(), length_bytes, length_bytes + sizeof(name_length));
+  buffer_.insert(buffer_.end(), name, name + length);
+  if (buffer_.size() >= kBufferSize) {
+    write_buffer();
+  }
+}
+
+/// DESTROY ====================================================================
+void TraceRecorder::destroy(TraceEvent event, const void * entity)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  append(event, id(entity), now(), 0);
+  ids_.erase(entity);
+}
+
+/// RECORD =====================================================================
+void TraceRecorder::record(TraceEvent event, const void * entity, uint64_t value, int64_t time)
+{
+  // Taken with the lock held, so the records are in the order of their times
+  std::lock_guard<std::mutex> lock(mutex_);
+  append(event, id(entity), time != 0 ? time : now(), value);
+}
+
+/// NOW ========================================================================
+int64_t TraceRecorder::now() const
+{
+  return steady_now() - start_;
+}
+
+/// FLUSH ======================================================================
+void TraceRecorder::flush()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  write_buffer();
+  fflush(file_);
+}
+
+/// APPEND =====================================================================
+void TraceRecorder::append(TraceEvent event, uint32_t entity, int64_t time, uint64_t value)
+{
+  unsigned char record[kTraceRecordSize];
+  record[0] = static_cast<unsigned char>(event);
+  memcpy(record + 1, &entity, sizeof(entity));
+  memcpy(record + 5, &time, sizeof(time));
+  memcpy(record + 13, &value, sizeof(value));
+  buffer_.insert(buffer_.end(), record, record + sizeof(record));
+
+  // Creations write their name after the record, and then the buffer out themselves
+  if (!trace_event_creates(event) && buffer_.size() >= kBufferSize) {
+    write_buffer();
+  }
+}
+
+/// WRITE BUFFER ===============================================================
+void TraceRecorder::write_buffer()
+{
+  if (!buffer_.empty() && fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size()) {
+    RCUTILS_LOG_ERROR_NAMED("rmw_zenoh_common_cpp", "Could not write to the trace file");
+  }
+  buffer_.clear();
+}
+
+/// ID =========================================================================
+uint32_t TraceRecorder::id(const void * entity) const
+{
+  auto it = ids_.find(entity);
+  return it == ids_.end() ? 0 : it->second;
+}
+
+}  // namespace rmw_zenoh_common_cpp
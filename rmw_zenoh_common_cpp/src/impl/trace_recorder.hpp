@@ -0,0 +1,118 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMPL__TRACE_RECORDER_HPP_
+#define IMPL__TRACE_RECORDER_HPP_
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "rmw_zenoh_common_cpp/trace_format.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// TRACE RECORDER =============================================================
+// Records the rmw calls of the process to the file named by RMW_ZENOH_TRACE_FILE (see
+// trace_format.hpp), to replay them with the trace_replay tool.
+//
+// Entities are identified by their handle, and numbered in the trace as they are created.
+// Records are buffered, and written out as the buffer fills up, when a context is finalized, and
+// when the process exits.
+class TraceRecorder
+{
+public:
+  // The recorder of the process (nullptr if RMW_ZENOH_TRACE_FILE is unset, or the file cannot be
+  // created)
+  static TraceRecorder * get();
+
+  // Create a recorder writing to the file at path (nullptr if the file cannot be created)
+  static TraceRecorder * open(const char * path);
+
+  ~TraceRecorder();
+
+  // Record the creation of an entity of the node parent (nullptr for a node)
+  void create(TraceEvent event, const void * entity, const void * parent, const char * name);
+
+  // Record the destruction of an entity, which is forgotten
+  void destroy(TraceEvent event, const void * entity);
+
+  // Record a call on an entity, made at time (from now(), or 0 for now). Calls that give their time
+  // are the only records that can be out of order.
+  void record(TraceEvent event, const void * entity, uint64_t value, int64_t time = 0);
+
+  // Nanoseconds since the start of the trace
+  int64_t now() const;
+
+  // Write the buffered records out
+  void flush();
+
+private:
+  TraceRecorder(FILE * file, int64_t start);
+
+  // Create the recorder of the process, if calls are to be traced
+  static TraceRecorder * from_environment();
+
+  // Append a record to the buffer. Must be called with mutex_ held.
+  void append(TraceEvent event, uint32_t entity, int64_t time, uint64_t value);
+
+  // Write the buffer out. Must be called with mutex_ held.
+  void write_buffer();
+
+  // ID of an entity (0 if it was not recorded). Must be called with mutex_ held.
+  uint32_t id(const void * entity) const;
+
+  std::mutex mutex_;
+  FILE * file_;
+  int64_t start_;  // Steady clock
+  std::vector<unsigned char> buffer_;
+
+  std::unordered_map<const void *, uint32_t> ids_;
+  uint32_t next_id_;
+};
+
+// Record a call on an entity, if calls are traced
+inline void trace_call(TraceEvent event, const void * entity, uint64_t value)
+{
+  TraceRecorder * recorder = TraceRecorder::get();
+  if (recorder) {
+    recorder->record(event, entity, value);
+  }
+}
+
+// Record the creation of an entity of a node, if calls are traced
+inline void trace_create(
+  TraceEvent event, const void * entity, const void * node, const char * name)
+{
+  TraceRecorder * recorder = TraceRecorder::get();
+  if (recorder) {
+    recorder->create(event, entity, node, name);
+  }
+}
+
+// Record the destruction of an entity, if calls are traced
+inline void trace_destroy(TraceEvent event, const void * entity)
+{
+  TraceRecorder * recorder = TraceRecorder::get();
+  if (recorder) {
+    recorder->destroy(event, entity);
+  }
+}
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__TRACE_RECORDER_HPP_
@@ -0,0 +1,124 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "type_hash.hpp"
+
+#include <cstring>
+
+#include "rosidl_typesupport_introspection_c/field_types.h"
+#include "rosidl_typesupport_introspection_c/identifier.h"
+#include "rosidl_typesupport_introspection_c/message_introspection.h"
+
+#include "rosidl_typesupport_introspection_cpp/identifier.hpp"
+#include "rosidl_typesupport_introspection_cpp/message_introspection.hpp"
+
+namespace rmw_zenoh_common_cpp
+{
+
+namespace
+{
+constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+constexpr uint64_t kFnvPrime = 1099511628211ULL;
+
+// FNV-1a, continued from hash
+uint64_t hash_string(uint64_t hash, const std::string & string)
+{
+  for (unsigned char c : string) {
+    hash = (hash ^ c) * kFnvPrime;
+  }
+  // Terminate, so "ab" + "c" and "a" + "bc" differ
+  return (hash ^ 0xff) * kFnvPrime;
+}
+
+// The C type supports separate namespaces with "__", and the C++ ones with "::"
+std::string type_name(const char * message_namespace, const char * message_name)
+{
+  std::string name(message_namespace);
+  for (size_t pos = name.find("::"); pos != std::string::npos; pos = name.find("::", pos)) {
+    name.replace(pos, 2, "/");
+  }
+  for (size_t pos = name.find("__"); pos != std::string::npos; pos = name.find("__", pos)) {
+    name.replace(pos, 2, "/");
+  }
+  return name + "/" + message_name;
+}
+
+template<typename MessageMembersT>
+uint64_t hash_members(uint64_t hash, const MessageMembersT * members)
+{
+  hash = hash_string(hash, type_name(members->message_namespace_, members->message_name_));
+  for (uint32_t i = 0; i < members->member_count_; ++i) {
+    const auto & member = members->members_[i];
+    std::string field = std::string(member.name_) + ":" + std::to_string(member.type_id_);
+    if (member.type_id_ == rosidl_typesupport_introspection_c__ROS_TYPE_STRING ||
+      member.type_id_ == rosidl_typesupport_introspection_c__ROS_TYPE_WSTRING)
+    {
+      field += "<=" + std::to_string(member.string_upper_bound_);
+    }
+    if (member.is_array_) {
+      field += std::string(member.is_upper_bound_ ? "[<=" : "[") +
+        std::to_string(member.array_size_) + "]";
+    }
+    hash = hash_string(hash, field);
+
+    if (member.type_id_ == rosidl_typesupport_introspection_c__ROS_TYPE_MESSAGE) {
+      hash = hash_members(hash, static_cast<const MessageMembersT *>(member.members_->data));
+    }
+  }
+  return hash;
+}
+
+bool is_cpp(const rosidl_message_type_support_t * introspection)
+{
+  return strcmp(
+    introspection->typesupport_identifier,
+    rosidl_typesupport_introspection_cpp::typesupport_identifier) == 0;
+}
+}  // namespace
+
+uint64_t message_type_hash(const rosidl_message_type_support_t * introspection)
+{
+  if (!introspection) {
+    return 0;
+  }
+
+  uint64_t hash = is_cpp(introspection) ?
+    hash_members(
+    kFnvOffsetBasis,
+    static_cast<const rosidl_typesupport_introspection_cpp::MessageMembers *>(introspection->data)) :
+    hash_members(
+    kFnvOffsetBasis,
+    static_cast<const rosidl_typesupport_introspection_c__MessageMembers *>(introspection->data));
+
+  // 0 means no hash
+  return hash != 0 ? hash : 1;
+}
+
+std::string message_type_name(const rosidl_message_type_support_t * introspection)
+{
+  if (!introspection) {
+    return "";
+  }
+  if (is_cpp(introspection)) {
+    auto * members =
+      static_cast<const rosidl_typesupport_introspection_cpp::MessageMembers *>(introspection->data);
+    return type_name(members->message_namespace_, members->message_name_);
+  }
+  auto * members =
+    static_cast<const rosidl_typesupport_introspection_c__MessageMembers *>(introspection->data);
+  return type_name(members->message_namespace_, members->message_name_);
+}
+
+}  // namespace rmw_zenoh_common_cpp
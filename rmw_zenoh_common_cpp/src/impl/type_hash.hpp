@@ -0,0 +1,42 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef IMPL__TYPE_HASH_HPP_
+#define IMPL__TYPE_HASH_HPP_
+
+#include <cstdint>
+#include <string>
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+
+namespace rmw_zenoh_common_cpp
+{
+
+/// TYPE HASH ==================================================================
+// Hash of a message type, carried in the header of published samples so that subscriptions can
+// drop the samples of a different type (or of another version of the same type) before they are
+// queued and deserialized.
+//
+// The hash covers the name of the type and its layout: the names, types and array bounds of its
+// fields, nested messages included. It is the same for the C and C++ type supports of a type.
+// Returns 0 (no hash, so no check) if there is no introspection type support to derive it from.
+uint64_t message_type_hash(const rosidl_message_type_support_t * introspection);
+
+// Name of the type described by an introspection type support, as <package>/<namespace>/<name>
+std::string message_type_name(const rosidl_message_type_support_t * introspection);
+
+}  // namespace rmw_zenoh_common_cpp
+
+#endif  // IMPL__TYPE_HASH_HPP_
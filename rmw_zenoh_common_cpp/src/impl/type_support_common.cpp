@@ -15,9 +15,16 @@
 // This file is originally from:
 // https://github.com/ros2/rmw_fastrtps/blob/0134bcf52244cbbb6e7e8ac631de391beaa85f17/rmw_fastrtps_cpp/src/type_support_common.cpp
 
+#include <cstring>
 #include <string>
+#include <vector>
 
 #include "rmw/error_handling.h"
+
+#include "rosidl_typesupport_introspection_c/identifier.h"
+#include "rosidl_typesupport_introspection_cpp/identifier.hpp"
+
+#include "serialization_plan.hpp"
 #include "type_support_common.hpp"
 
 namespace rmw_zenoh_common_cpp
@@ -26,9 +33,14 @@ namespace rmw_zenoh_common_cpp
 TypeSupport::TypeSupport()
 {
   max_size_bound_ = false;
+  plan_ = nullptr;
+  serialize_with_plan_ = false;
 }
 
-void TypeSupport::set_members(const message_type_support_callbacks_t * members)
+void TypeSupport::set_members(
+  const message_type_support_callbacks_t * members,
+  const rosidl_message_type_support_t * introspection,
+  bool serialize_with_plan)
 {
   members_ = members;
 
@@ -46,6 +58,16 @@ void TypeSupport::set_members(const message_type_support_callbacks_t * members)
 
   // Total size is encapsulation size + data size
   type_size_ = 4 + data_size;
+
+  // Empty messages are serialized as a dummy byte, which plans do not know about. Without
+  // serialize_with_plan, the plan is only of use to loan out C messages.
+  plan_ = nullptr;
+  serialize_with_plan_ = serialize_with_plan;
+  bool loanable = introspection && strcmp(
+    introspection->typesupport_identifier, rosidl_typesupport_introspection_c__identifier) == 0;
+  if (introspection && has_data_ && (serialize_with_plan || loanable)) {
+    plan_ = SerializationPlan::get(introspection);
+  }
 }
 
 size_t TypeSupport::getEstimatedSerializedSize(const void * ros_message)
@@ -73,6 +95,9 @@ bool TypeSupport::serializeROSmessage(
 
   // If type is not empty, serialize message
   if (has_data_) {
+    if (plan_ && serialize_with_plan_) {
+      return plan_->serialize(ros_message, ser);
+    }
     auto callbacks = static_cast<const message_type_support_callbacks_t *>(impl);
     return callbacks->cdr_serialize(ros_message, ser);
   }
@@ -95,6 +120,12 @@ bool TypeSupport::deserializeROSmessage(
 
   // If type is not empty, deserialize message
   if (has_data_) {
+    // Plans only read samples in the host byte order
+    if (plan_ && serialize_with_plan_ &&
+      deser.endianness() == eprosima::fastcdr::Cdr::DEFAULT_ENDIAN)
+    {
+      return plan_->deserialize(deser, ros_message);
+    }
     auto callbacks = static_cast<const message_type_support_callbacks_t *>(impl);
     return callbacks->cdr_deserialize(deser, ros_message);
   }
@@ -107,11 +138,37 @@ bool TypeSupport::deserializeROSmessage(
   return true;
 }
 
-MessageTypeSupport::MessageTypeSupport(const message_type_support_callbacks_t * members)
+bool TypeSupport::canLoanMessages() const
+{
+  return has_data_ && plan_ && plan_->can_view();
+}
+
+bool TypeSupport::deserializeLoanedROSmessage(
+  eprosima::fastcdr::Cdr & deser,
+  void * ros_message,
+  std::vector<void *> & views,
+  const void * impl) const
+{
+  assert(canLoanMessages());
+
+  deser.read_encapsulation();
+
+  // Samples in the other byte order have to be swapped, so nothing can be viewed
+  if (deser.endianness() != eprosima::fastcdr::Cdr::DEFAULT_ENDIAN) {
+    auto callbacks = static_cast<const message_type_support_callbacks_t *>(impl);
+    return callbacks->cdr_deserialize(deser, ros_message);
+  }
+  return plan_->deserialize_view(deser, ros_message, views);
+}
+
+MessageTypeSupport::MessageTypeSupport(
+  const message_type_support_callbacks_t * members,
+  const rosidl_message_type_support_t * introspection,
+  bool serialize_with_plan)
 {
   assert(members);
 
-  set_members(members);
+  set_members(members, introspection, serialize_with_plan);
 }
 
 ServiceTypeSupport::ServiceTypeSupport()
@@ -138,4 +195,21 @@ ResponseTypeSupport::ResponseTypeSupport(const service_type_support_callbacks_t
   set_members(msg);
 }
 
+const rosidl_message_type_support_t * get_introspection_type_support(
+  const rosidl_message_type_support_t * type_supports,
+  const rosidl_message_type_support_t * type_support)
+{
+  bool is_cpp = strcmp(type_support->typesupport_identifier, RMW_ZENOH_CPP_TYPESUPPORT_CPP) == 0;
+  const rosidl_message_type_support_t * introspection = get_message_typesupport_handle(
+    type_supports,
+    is_cpp ?
+    rosidl_typesupport_introspection_cpp::typesupport_identifier :
+    rosidl_typesupport_introspection_c__identifier);
+  if (!introspection) {
+    // Not an error, the callbacks are used instead
+    rmw_reset_error();
+  }
+  return introspection;
+}
+
 }  // namespace rmw_zenoh_common_cpp
@@ -36,4 +36,15 @@
 #define RMW_ZENOH_CPP_TYPESUPPORT_C rosidl_typesupport_zenoh_c__identifier
 #define RMW_ZENOH_CPP_TYPESUPPORT_CPP rosidl_typesupport_zenoh_cpp::typesupport_identifier
 
+namespace rmw_zenoh_common_cpp
+{
+
+// The introspection type support of a message type in the same language (C or C++) as the Zenoh
+// type support found for it. Returns nullptr if there is none.
+const rosidl_message_type_support_t * get_introspection_type_support(
+  const rosidl_message_type_support_t * type_supports,
+  const rosidl_message_type_support_t * type_support);
+
+}  // namespace rmw_zenoh_common_cpp
+
 #endif  // IMPL__TYPE_SUPPORT_COMMON_HPP_
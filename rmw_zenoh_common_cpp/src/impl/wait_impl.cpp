@@ -36,6 +36,11 @@ bool check_wait_conditions(
   // rmw_wait call. Otherwise on repeat calls to check the predicate, things will break since
   // it'll try to compare or dereference a nullptr.
 
+  // Subscriptions and services are only reported ready for the items in their queues that no
+  // other wait has claimed yet, so concurrent waits are not all woken by the same item. The
+  // predicate only checks for unclaimed items. The claims are made when finalizing, and a wait
+  // that loses the race for the last item finds the entity not ready after all.
+
   bool stop_wait = false;
 
   // SUBSCRIPTIONS =============================================================
@@ -45,7 +50,13 @@ bool check_wait_conditions(
     for (size_t i = 0; i < subscriptions->subscriber_count; ++i) {
       auto subscription_data = static_cast<rmw_subscription_data_t *>(
         subscriptions->subscribers[i]);
-      if (subscription_data->zn_message_queue_.empty()) {
+      if (subscription_data->reorder_buffer_) {
+        std::lock_guard<std::mutex> lock(subscription_data->message_queue_mutex_);
+        subscription_data->release_reordered_samples();
+      }
+      bool ready = finalize ?
+        subscription_data->ready_claims_.claim() : subscription_data->ready_claims_.unclaimed();
+      if (!ready) {
         if (finalize) {
           // Setting to nullptr lets rcl know that this subscription is not ready
           subscriptions->subscribers[i] = nullptr;
@@ -69,7 +80,9 @@ bool check_wait_conditions(
 
     for (size_t i = 0; i < services->service_count; ++i) {
       auto service_data = static_cast<rmw_service_data_t *>(services->services[i]);
-      if (service_data->zn_request_message_queue_.empty()) {
+      bool ready = finalize ?
+        service_data->ready_claims_.claim() : service_data->ready_claims_.unclaimed();
+      if (!ready) {
         if (finalize) {
           // Setting to nullptr lets rcl know that this service is not ready
           services->services[i] = nullptr;
@@ -149,14 +162,41 @@ bool check_wait_conditions(
   // }
 
   // EVENTS ====================================================================
-  // currently rmw_zenoh_common_cpp does not handle any events. In the future, if it
-  // does, we'll need to handle it appropriately. This error message is left
-  // here to help remember this, if we accidentally enable some event in the
-  // future.
-
+  // rmw_zenoh_common_cpp handles two subscription events, each repurposed for a check of its own:
+  //  - the requested QoS incompatibility, raised for samples of an incompatible message type
+  //  - the requested deadline missed, raised when a latency budget becomes breached
+  // This error message is left here to help remember to handle any other event, if we
+  // accidentally enable one in the future.
   for (size_t i = 0; i < events->event_count; ++i) {
-    RCUTILS_LOG_ERROR_NAMED("rmw_zenoh_common_cpp", "woah! we're ignoring an event!");
-    events->events[i] = nullptr;
+    auto * event = static_cast<rmw_event_t *>(events->events[i]);
+    if (!event) {
+      continue;
+    }
+    if (event->event_type == RMW_EVENT_REQUESTED_QOS_INCOMPATIBLE) {
+      auto * subscription_data = static_cast<rmw_subscription_data_t *>(event->data);
+      std::lock_guard<std::mutex> lock(subscription_data->message_queue_mutex_);
+      if (subscription_data->incompatible_types_.size() !=
+        subscription_data->incompatible_types_reported_)
+      {
+        stop_wait = true;
+        continue;
+      }
+    } else if (event->event_type == RMW_EVENT_REQUESTED_DEADLINE_MISSED) {
+      auto * subscription_data = static_cast<rmw_subscription_data_t *>(event->data);
+      std::lock_guard<std::mutex> lock(subscription_data->message_queue_mutex_);
+      if (subscription_data->latency_monitor_ &&
+        subscription_data->latency_monitor_->breaches() !=
+        subscription_data->latency_breaches_reported_)
+      {
+        stop_wait = true;
+        continue;
+      }
+    } else {
+      RCUTILS_LOG_ERROR_NAMED("rmw_zenoh_common_cpp", "woah! we're ignoring an event!");
+    }
+    if (finalize) {
+      events->events[i] = nullptr;
+    }
   }
 
   return stop_wait;
@@ -14,10 +14,12 @@
 
 #include <unistd.h>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "rcutils/logging_macros.h"
 #include "rcutils/strdup.h"
+#include "rcutils/time.h"
 
 #include "rmw/validate_full_topic_name.h"
 #include "rmw/impl/cpp/macros.hpp"
@@ -28,8 +30,11 @@
 #include "rmw_zenoh_common_cpp/rmw_context_impl.hpp"
 #include "rmw_zenoh_common_cpp/rmw_zenoh_common.h"
 
+#include "impl/config.hpp"
 #include "impl/type_support_common.hpp"
 #include "impl/client_impl.hpp"
+#include "impl/request_metadata.hpp"
+#include "impl/trace_recorder.hpp"
 
 /// CHECK IF SERVER IS AVAILABLE ===============================================
 // Check if a service server is available for the given service client
@@ -295,6 +300,18 @@ rmw_zenoh_common_create_client(
   // Configure response message queue
   client_data->queue_depth_ = qos_profile->depth;
 
+  // Configure request deadlines (can be changed with rmw_zenoh_set_client_request_timeout)
+  rmw_zenoh_common_cpp::ServiceConfig service_config =
+    node->context->impl->config->service(client->service_name);
+  client_data->request_timeout_.store(
+    rmw_zenoh_common_cpp::request_timeout_ns(
+      service_config.request_timeout / 1000, (service_config.request_timeout % 1000) * 1000000),
+    std::memory_order_relaxed);
+
+  // Responses are only queued until a response callback is set
+  client_data->response_callback_ = nullptr;
+  client_data->response_callback_arg_ = nullptr;
+
   // ADD CLIENT DATA TO TOPIC MAP ==============================================
   // This will allow us to access the client data structs for this Zenoh topic key expression
   // (This is for listening for service responses)
@@ -318,7 +335,7 @@ rmw_zenoh_common_create_client(
       zn_rname(client_data->zn_response_topic_key_),
       zn_subinfo_default(),  // NOTE(CH3): Default for now
       client_data->zn_response_sub_callback,
-      nullptr);
+      node->context->impl->rx_buffer_pool);
 
     RCUTILS_LOG_DEBUG_NAMED(
       "rmw_zenoh_common_cpp",
@@ -381,13 +398,16 @@ rmw_zenoh_common_create_client(
   // the one edge case is if someone starts a service and client on the same process, but there is
   // a delay between when the client and service starts (and the client is started first, and there
   // are no other processes anywhere on the network where the Zenoh queryable is being listened to.)
-  zn_declare_queryable(
+  client_data->zn_availability_queryable_ = zn_declare_queryable(
     session,
     zn_rname(client->service_name),
     ZN_QUERYABLE_STORAGE,
     [](zn_query_t *, const void *) {},
     nullptr);
 
+  rmw_zenoh_common_cpp::trace_create(
+    rmw_zenoh_common_cpp::TraceEvent::kCreateClient, client, node, client->service_name);
+
   return client;
 }
 
@@ -415,6 +435,8 @@ rmw_zenoh_common_destroy_client(
     eclipse_zenoh_identifier,
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
 
+  rmw_zenoh_common_cpp::trace_destroy(rmw_zenoh_common_cpp::TraceEvent::kDestroyClient, client);
+
   // OBTAIN ALLOCATOR ==========================================================
   rcutils_allocator_t * allocator = &node->context->options.allocator;
 
@@ -466,11 +488,37 @@ rmw_zenoh_common_destroy_client(
       client_data->client_id_);
   }
 
+  // DELETE CLIENT DATA IN QUERYABLE MAP =======================================
+  std::string queryable_key(client->service_name);
+  auto queryable_map_iter = rmw_client_data_t::zn_queryable_to_client_data.find(queryable_key);
+
+  if (queryable_map_iter != rmw_client_data_t::zn_queryable_to_client_data.end()) {
+    std::vector<rmw_client_data_t *> & clients = queryable_map_iter->second;
+    for (auto it = clients.begin(); it != clients.end(); ++it) {
+      if ((*it)->client_id_ == client_data->client_id_) {
+        clients.erase(it);
+        break;
+      }
+    }
+
+    // Otherwise the map keeps a key for every service name a client was ever created for
+    if (clients.empty()) {
+      rmw_client_data_t::zn_queryable_to_client_data.erase(queryable_map_iter);
+    }
+  }
+
   // CLEANUP ===================================================================
+  if (client_data->zn_availability_queryable_) {
+    zn_undeclare_queryable(client_data->zn_availability_queryable_);
+  }
+
   allocator->deallocate(const_cast<char *>(client_data->zn_request_topic_key_), allocator->state);
   allocator->deallocate(const_cast<char *>(client_data->zn_response_topic_key_), allocator->state);
   allocator->deallocate(client_data->request_type_support_, allocator->state);
   allocator->deallocate(client_data->response_type_support_, allocator->state);
+
+  // Destruct the queue so any messages still in it go back to the receive buffer pool
+  client_data->~rmw_client_data_t();
   allocator->deallocate(client->data, allocator->state);
 
   allocator->deallocate(const_cast<char *>(client->service_name), allocator->state);
@@ -523,7 +571,7 @@ rmw_zenoh_common_send_request(
     ->request_type_support_->getEstimatedSerializedSize(ros_request));
 
   // Account for metadata
-  max_data_length += sizeof(std::int64_t);  // Internal type of the atomic sequence ID
+  max_data_length += rmw_zenoh_common_cpp::kRequestMetadataSize;
 
   // Init serialized message byte array
   char * request_bytes = static_cast<char *>(
@@ -554,18 +602,26 @@ rmw_zenoh_common_send_request(
   }
 
   size_t data_length = ser.getSerializedDataLength();
+  rmw_zenoh_common_cpp::trace_call(
+    rmw_zenoh_common_cpp::TraceEvent::kSendRequest, client, data_length);
 
   // ADD METADATA ==============================================================
-  //
-  // TODO(CH3): Refactor this into its own modular set of functions eventually to make adding
-  // more metadata convenient
   *sequence_id = rmw_client_data_t::sequence_id_counter.fetch_add(1, std::memory_order_relaxed);
 
-  size_t meta_length = sizeof(std::int64_t);  // Internal type of the atomic sequence ID
-  memcpy(
-    request_bytes + data_length,
-    reinterpret_cast<char *>(sequence_id),
-    meta_length);
+  rmw_zenoh_common_cpp::RequestMetadata metadata;
+  metadata.sequence_id = *sequence_id;
+  metadata.deadline = 0;
+
+  // The deadline is absolute, so servers on other hosts can check it against their own clock
+  int64_t request_timeout = client_data->request_timeout_.load(std::memory_order_relaxed);
+  rcutils_time_point_value_t now;
+  if (request_timeout > 0 && rcutils_system_time_now(&now) == RCUTILS_RET_OK) {
+    metadata.deadline = rmw_zenoh_common_cpp::request_deadline(now, request_timeout);
+  }
+
+  size_t meta_length = rmw_zenoh_common_cpp::kRequestMetadataSize;
+  rmw_zenoh_common_cpp::write_request_metadata(
+    metadata, reinterpret_cast<unsigned char *>(request_bytes + data_length));
 
   // PUBLISH ON ZENOH MIDDLEWARE LAYER =========================================
   size_t wrid_ret = zn_write(
@@ -616,9 +672,6 @@ rmw_zenoh_common_take_response(
   // OBTAIN CLIENT MEMBERS =====================================================
   auto client_data = static_cast<rmw_client_data_t *>(client->data);
 
-  // OBTAIN ALLOCATOR ==========================================================
-  rcutils_allocator_t * allocator = &client_data->node_->context->options.allocator;
-
   // RETRIEVE SERIALIZED MESSAGE ===============================================
   std::unique_lock<std::mutex> lock(client_data->response_queue_mutex_);
 
@@ -631,16 +684,20 @@ rmw_zenoh_common_take_response(
   }
 
   // NOTE(CH3): Potential place to handle "QoS" (e.g. could pop from back so it is LIFO)
-  auto response_bytes_ptr = client_data->zn_response_message_queue_.back();
+  auto response_bytes_ptr = std::move(client_data->zn_response_message_queue_.back());
   client_data->zn_response_message_queue_.pop_back();
 
-  client_data->response_queue_mutex_.unlock();
+  lock.unlock();
 
   RCUTILS_LOG_DEBUG_NAMED(
     "rmw_zenoh_common_cpp",
     "[rmw_take] Response found: %s",
     client_data->zn_response_topic_key_);
 
+  rmw_zenoh_common_cpp::trace_call(
+    rmw_zenoh_common_cpp::TraceEvent::kTakeResponse, client,
+    response_bytes_ptr->size() - sizeof(std::int64_t));
+
   // RETRIEVE METADATA =========================================================
   // TODO(CH3): Again, refactor this into a modular set of functions eventually
   size_t meta_length = sizeof(std::int64_t);  // Internal type of the atomic sequence ID
@@ -648,18 +705,18 @@ rmw_zenoh_common_take_response(
   // Use metadata
   memcpy(
     &request_header->request_id.sequence_number,
-    &response_bytes_ptr->back() + 1 - meta_length,
+    response_bytes_ptr->data() + response_bytes_ptr->size() - meta_length,
     meta_length);
 
   // DESERIALIZE MESSAGE =======================================================
   size_t data_length = response_bytes_ptr->size() - meta_length;
 
-  unsigned char * cdr_buffer = static_cast<unsigned char *>(
-    allocator->allocate(data_length, allocator->state));
-  memcpy(cdr_buffer, &response_bytes_ptr->front(), data_length);
-
+  // NOTE: Deserialized straight out of the pooled receive buffer, which is only ever read from
+  //
   // Object that manages the raw buffer.
-  eprosima::fastcdr::FastBuffer fastbuffer(reinterpret_cast<char *>(cdr_buffer), data_length);
+  eprosima::fastcdr::FastBuffer fastbuffer(
+    reinterpret_cast<char *>(response_bytes_ptr->data()),
+    data_length);
 
   // Object that deserializes the data
   eprosima::fastcdr::Cdr deser(
@@ -674,7 +731,6 @@ rmw_zenoh_common_take_response(
   }
 
   *taken = true;
-  allocator->deallocate(cdr_buffer, allocator->state);
 
   return RMW_RET_OK;
 }
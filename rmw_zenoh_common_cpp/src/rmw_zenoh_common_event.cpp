@@ -21,15 +21,56 @@
 #include "rmw/rmw.h"
 #include "rmw/event.h"
 
+#include "impl/pubsub_impl.hpp"
+
 #include "rmw_zenoh_common_cpp/rmw_zenoh_common.h"
 
-// STUB
 rmw_ret_t
 rmw_take_event(const rmw_event_t * event_handle, void * event_info, bool * taken)
 {
-  (void)event_info;
+  RMW_CHECK_ARGUMENT_FOR_NULL(event_handle, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(event_info, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(taken, RMW_RET_INVALID_ARGUMENT);
+
+  // TAKE INCOMPATIBLE TYPE EVENT ==============================================
+  // rmw has no event for publishers and subscriptions that disagree on the message type, so the
+  // types a subscription dropped samples of are counted as requested QoS incompatibilities
+  if (event_handle->event_type == RMW_EVENT_REQUESTED_QOS_INCOMPATIBLE) {
+    auto * subscription_data = static_cast<rmw_subscription_data_t *>(event_handle->data);
+    auto * status = static_cast<rmw_requested_qos_incompatible_event_status_t *>(event_info);
+
+    std::lock_guard<std::mutex> lock(subscription_data->message_queue_mutex_);
+    size_t count = subscription_data->incompatible_types_.size();
+    status->total_count = static_cast<int32_t>(count);
+    status->total_count_change =
+      static_cast<int32_t>(count - subscription_data->incompatible_types_reported_);
+    status->last_policy_kind = RMW_QOS_POLICY_INVALID;
+    subscription_data->incompatible_types_reported_ = count;
+
+    *taken = true;
+    return RMW_RET_OK;
+  }
+
+  // TAKE LATENCY BUDGET EVENT =================================================
+  // rmw has no latency event either, so breaches of the latency budget of a subscription's topic
+  // are counted as missed deadlines (samples that arrived later than they were due)
+  if (event_handle->event_type == RMW_EVENT_REQUESTED_DEADLINE_MISSED) {
+    auto * subscription_data = static_cast<rmw_subscription_data_t *>(event_handle->data);
+    auto * status = static_cast<rmw_requested_deadline_missed_status_t *>(event_info);
+
+    std::lock_guard<std::mutex> lock(subscription_data->message_queue_mutex_);
+    uint64_t breaches = subscription_data->latency_monitor_ ?
+      subscription_data->latency_monitor_->breaches() : 0;
+    status->total_count = static_cast<int32_t>(breaches);
+    status->total_count_change =
+      static_cast<int32_t>(breaches - subscription_data->latency_breaches_reported_);
+    subscription_data->latency_breaches_reported_ = breaches;
+
+    *taken = true;
+    return RMW_RET_OK;
+  }
 
-  // Because we are currently not (intentionally) requesting any events, this
+  // Because we are currently not (intentionally) requesting any other events, this
   // message is a warning to future-us that we aren't expecting to be here!
   RCUTILS_LOG_WARN_NAMED("rmw_zenoh_common_cpp", "rmw_take_event() WOAH");
 
@@ -112,9 +153,21 @@ rmw_zenoh_common_subscription_event_init(
   );
 
   if (event_type == RMW_EVENT_REQUESTED_QOS_INCOMPATIBLE) {
-    // Because rmw_zenoh_common_cpp does not currently have multiple QoS, we will not handle this
-    // event.
-    return RMW_RET_UNSUPPORTED;
+    // rmw_zenoh_common_cpp does not currently have multiple QoS, so this event reports samples of
+    // an incompatible message type instead (see rmw_take_event)
+    event->implementation_identifier = subscription->implementation_identifier;
+    event->data = subscription->data;
+    event->event_type = event_type;
+    return RMW_RET_OK;
+  }
+
+  if (event_type == RMW_EVENT_REQUESTED_DEADLINE_MISSED) {
+    // Reports breaches of the latency budget of the topic (see rmw_take_event), and never fires
+    // on topics without one
+    event->implementation_identifier = subscription->implementation_identifier;
+    event->data = subscription->data;
+    event->event_type = event_type;
+    return RMW_RET_OK;
   }
 
   RCUTILS_LOG_ERROR_NAMED(
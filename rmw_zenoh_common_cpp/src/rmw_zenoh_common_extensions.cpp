@@ -0,0 +1,646 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "rcutils/logging_macros.h"
+#include "rcutils/time.h"
+
+#include "rmw/error_handling.h"
+#include "rmw/impl/cpp/macros.hpp"
+#include "rmw/rmw.h"
+
+#include "rmw_zenoh_common_cpp/rmw_context_impl.hpp"
+
+#include "impl/client_impl.hpp"
+#include "impl/codec.hpp"
+#include "impl/history_ring.hpp"
+#include "impl/pubsub_impl.hpp"
+#include "impl/request_metadata.hpp"
+#include "impl/service_impl.hpp"
+
+#include "rmw_zenoh_common_cpp/rmw_zenoh_common.h"
+#include "rmw_zenoh_common_cpp/rmw_zenoh_extensions.h"
+
+namespace
+{
+// Adapts a codec registered through the C API
+class CallbackCodec : public rmw_zenoh_common_cpp::Codec
+{
+public:
+  explicit CallbackCodec(const rmw_zenoh_codec_t & codec)
+  : codec_(codec) {}
+
+  uint8_t id() const override {return codec_.id;}
+  const char * name() const override {return codec_.name;}
+
+  size_t max_encoded_size(size_t raw_length) const override
+  {
+    return codec_.max_encoded_size(raw_length, codec_.state);
+  }
+
+  size_t max_decoded_size(size_t encoded_length) const override
+  {
+    return codec_.max_decoded_size(encoded_length, codec_.state);
+  }
+
+  size_t encode(
+    const unsigned char * raw, size_t raw_length,
+    unsigned char * out, size_t out_capacity) const override
+  {
+    return codec_.encode(raw, raw_length, out, out_capacity, codec_.state);
+  }
+
+  bool decode(
+    const unsigned char * in, size_t in_length,
+    unsigned char * raw, size_t raw_length) const override
+  {
+    return codec_.decode(in, in_length, raw, raw_length, codec_.state);
+  }
+
+private:
+  rmw_zenoh_codec_t codec_;
+};
+
+// Longest history query timeout waited for with a deadline, in seconds (about 136 years)
+constexpr uint64_t kMaxHistoryTimeoutSec = 1ull << 32;
+
+// Replies to a history query, shared with the reply callback (which outlives the caller if the
+// query times out)
+struct HistoryReplies
+{
+  struct Sample
+  {
+    int64_t timestamp;
+    uint64_t sequence;
+    std::vector<unsigned char> data;
+  };
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::vector<Sample> samples;
+  bool done = false;
+};
+
+// The callback argument is a heap allocated std::shared_ptr<HistoryReplies>, deleted by the last
+// call (which has no sample, once all the replies are in)
+void zn_history_reply_callback(
+  const zn_source_info_t *, const zn_sample_t * sample, const void * arg)
+{
+  auto * replies = static_cast<std::shared_ptr<HistoryReplies> *>(const_cast<void *>(arg));
+
+  if (!sample) {
+    {
+      std::lock_guard<std::mutex> lock((*replies)->mutex);
+      (*replies)->done = true;
+    }
+    (*replies)->condition.notify_all();
+    delete replies;
+    return;
+  }
+
+  const auto * data = reinterpret_cast<const unsigned char *>(sample->value.val);
+  HistoryReplies::Sample reply;
+  if (!rmw_zenoh_common_cpp::read_history_reply_header(
+      data, sample->value.len, reply.timestamp, reply.sequence))
+  {
+    return;
+  }
+  reply.data.assign(
+    data + rmw_zenoh_common_cpp::kHistoryReplyHeaderSize, data + sample->value.len);
+
+  std::lock_guard<std::mutex> lock((*replies)->mutex);
+  (*replies)->samples.push_back(std::move(reply));
+}
+}  // namespace
+
+/// REGISTER CODEC =============================================================
+rmw_ret_t
+rmw_zenoh_register_codec(const rmw_zenoh_codec_t * codec)
+{
+  RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "rmw_zenoh_register_codec");
+
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(codec, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(codec->name, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(codec->max_encoded_size, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(codec->max_decoded_size, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(codec->encode, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(codec->decode, RMW_RET_INVALID_ARGUMENT);
+
+  if (codec->id < rmw_zenoh_common_cpp::kFirstUserCodecId) {
+    RMW_SET_ERROR_MSG("codec IDs below 16 are reserved");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  // REGISTER CODEC ============================================================
+  // NOTE: Registered codecs live as long as the process
+  auto * callback_codec = new (std::nothrow) CallbackCodec(*codec);
+  if (!callback_codec) {
+    RMW_SET_ERROR_MSG("failed to allocate codec");
+    return RMW_RET_BAD_ALLOC;
+  }
+
+  if (!rmw_zenoh_common_cpp::register_codec(callback_codec)) {
+    delete callback_codec;
+    RMW_SET_ERROR_MSG("a codec with the same ID or name is already registered");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  return RMW_RET_OK;
+}
+
+/// GET PUBLISHER SHAPING STATS ================================================
+rmw_ret_t
+rmw_zenoh_common_get_publisher_shaping_stats(
+  const rmw_publisher_t * publisher,
+  rmw_zenoh_publisher_shaping_stats_t * stats,
+  const char * const eclipse_zenoh_identifier)
+{
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(publisher, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    publisher,
+    publisher->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  RMW_CHECK_ARGUMENT_FOR_NULL(publisher->data, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(stats, RMW_RET_INVALID_ARGUMENT);
+
+  // GET STATS =================================================================
+  const rmw_zenoh_common_cpp::PublisherShaper * shaper =
+    static_cast<const rmw_publisher_data_t *>(publisher->data)->shaper_;
+
+  *stats = rmw_zenoh_publisher_shaping_stats_t();
+  if (shaper) {
+    stats->dropped_messages = shaper->dropped_messages.load(std::memory_order_relaxed);
+    stats->dropped_bytes = shaper->dropped_bytes.load(std::memory_order_relaxed);
+    stats->delayed_messages = shaper->delayed_messages.load(std::memory_order_relaxed);
+    stats->delay_ns = shaper->delay_ns.load(std::memory_order_relaxed);
+  }
+
+  return RMW_RET_OK;
+}
+
+/// CREATE SUBSCRIPTIONS =======================================================
+rmw_ret_t
+rmw_zenoh_common_create_subscriptions(
+  const rmw_node_t * node,
+  const rmw_zenoh_subscription_request_t * requests,
+  size_t count,
+  rmw_subscription_t ** subscriptions,
+  const char * const eclipse_zenoh_identifier)
+{
+  RCUTILS_LOG_DEBUG_NAMED(
+    "rmw_zenoh_common_cpp", "[rmw_zenoh_create_subscriptions] %zu subscriptions", count);
+
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(node, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    node,
+    node->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  RMW_CHECK_ARGUMENT_FOR_NULL(node->data, RMW_RET_INVALID_ARGUMENT);
+  if (count > 0) {
+    RMW_CHECK_ARGUMENT_FOR_NULL(requests, RMW_RET_INVALID_ARGUMENT);
+    RMW_CHECK_ARGUMENT_FOR_NULL(subscriptions, RMW_RET_INVALID_ARGUMENT);
+  }
+
+  // CREATE SUBSCRIPTIONS ======================================================
+  for (size_t i = 0; i < count; ++i) {
+    subscriptions[i] = rmw_zenoh_common_create_subscription(
+      node,
+      requests[i].type_support,
+      requests[i].topic_name,
+      requests[i].qos_profile,
+      requests[i].subscription_options,
+      eclipse_zenoh_identifier);
+    if (subscriptions[i]) {
+      continue;
+    }
+
+    // ROLL BACK ===============================================================
+    // Keep the error of the subscription that failed
+    rmw_error_string_t error = rmw_get_error_string();
+    rmw_reset_error();
+    while (i-- > 0) {
+      rmw_zenoh_common_destroy_subscription(
+        const_cast<rmw_node_t *>(node), subscriptions[i], eclipse_zenoh_identifier);
+      subscriptions[i] = nullptr;
+    }
+    rmw_reset_error();
+    RMW_SET_ERROR_MSG(error.str);
+    return RMW_RET_ERROR;
+  }
+
+  return RMW_RET_OK;
+}
+
+/// CREATE PUBLISHERS ==========================================================
+rmw_ret_t
+rmw_zenoh_common_create_publishers(
+  const rmw_node_t * node,
+  const rmw_zenoh_publisher_request_t * requests,
+  size_t count,
+  rmw_publisher_t ** publishers,
+  const char * const eclipse_zenoh_identifier)
+{
+  RCUTILS_LOG_DEBUG_NAMED(
+    "rmw_zenoh_common_cpp", "[rmw_zenoh_create_publishers] %zu publishers", count);
+
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(node, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    node,
+    node->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  RMW_CHECK_ARGUMENT_FOR_NULL(node->data, RMW_RET_INVALID_ARGUMENT);
+  if (count > 0) {
+    RMW_CHECK_ARGUMENT_FOR_NULL(requests, RMW_RET_INVALID_ARGUMENT);
+    RMW_CHECK_ARGUMENT_FOR_NULL(publishers, RMW_RET_INVALID_ARGUMENT);
+  }
+
+  // CREATE PUBLISHERS =========================================================
+  for (size_t i = 0; i < count; ++i) {
+    publishers[i] = rmw_zenoh_common_create_publisher(
+      node,
+      requests[i].type_support,
+      requests[i].topic_name,
+      requests[i].qos_profile,
+      requests[i].publisher_options,
+      eclipse_zenoh_identifier);
+    if (publishers[i]) {
+      continue;
+    }
+
+    // ROLL BACK ===============================================================
+    // Keep the error of the publisher that failed
+    rmw_error_string_t error = rmw_get_error_string();
+    rmw_reset_error();
+    while (i-- > 0) {
+      rmw_zenoh_common_destroy_publisher(
+        const_cast<rmw_node_t *>(node), publishers[i], eclipse_zenoh_identifier);
+      publishers[i] = nullptr;
+    }
+    rmw_reset_error();
+    RMW_SET_ERROR_MSG(error.str);
+    return RMW_RET_ERROR;
+  }
+
+  return RMW_RET_OK;
+}
+
+/// QUERY HISTORY ==============================================================
+rmw_zenoh_history_t
+rmw_zenoh_get_zero_initialized_history(void)
+{
+  rmw_zenoh_history_t history;
+  history.samples = nullptr;
+  history.size = 0;
+  history.allocator = rcutils_get_zero_initialized_allocator();
+  return history;
+}
+
+rmw_ret_t
+rmw_zenoh_common_query_history(
+  const rmw_node_t * node,
+  const char * topic_name,
+  const rmw_zenoh_history_query_t * query,
+  rmw_time_t timeout,
+  rmw_zenoh_history_t * history,
+  const char * const eclipse_zenoh_identifier)
+{
+  RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "[rmw_zenoh_query_history] %s", topic_name);
+
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(node, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    node,
+    node->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  RMW_CHECK_ARGUMENT_FOR_NULL(node->context, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(node->context->impl, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(topic_name, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(query, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(history, RMW_RET_INVALID_ARGUMENT);
+
+  if (history->samples) {
+    RMW_SET_ERROR_MSG("history already holds samples");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  // QUERY PUBLISHERS ==========================================================
+  auto replies = std::make_shared<HistoryReplies>();
+  auto * callback_replies = new (std::nothrow) std::shared_ptr<HistoryReplies>(replies);
+  if (!callback_replies) {
+    RMW_SET_ERROR_MSG("failed to allocate history query");
+    return RMW_RET_BAD_ALLOC;
+  }
+
+  rmw_zenoh_common_cpp::HistoryQuery history_query;
+  history_query.last = query->last;
+  history_query.since = query->since;
+  history_query.until = query->until;
+
+  // Every publisher replies on the same key, so the replies must not be consolidated
+  zn_query_consolidation_t consolidation;
+  consolidation.first_routers = zn_consolidation_mode_t_NONE;
+  consolidation.last_router = zn_consolidation_mode_t_NONE;
+  consolidation.reception = zn_consolidation_mode_t_NONE;
+
+  std::string history_key = std::string(topic_name) + rmw_zenoh_common_cpp::kHistoryKeySuffix;
+  zn_query(
+    node->context->impl->session,
+    zn_rname(history_key.c_str()),
+    rmw_zenoh_common_cpp::format_history_query(history_query).c_str(),
+    zn_query_target_default(),
+    consolidation,
+    zn_history_reply_callback,
+    callback_replies);
+
+  // WAIT FOR REPLIES ==========================================================
+  std::vector<HistoryReplies::Sample> samples;
+  bool timed_out = false;
+  {
+    auto done = [&replies]() {return replies->done;};
+
+    // Timeouts too long to be added to the current time, like RMW_DURATION_INFINITE, have no
+    // deadline
+    std::unique_lock<std::mutex> lock(replies->mutex);
+    if (timeout.sec >= kMaxHistoryTimeoutSec) {
+      replies->condition.wait(lock, done);
+    } else {
+      timed_out = !replies->condition.wait_for(
+        lock,
+        std::chrono::seconds(timeout.sec) + std::chrono::nanoseconds(timeout.nsec),
+        done);
+    }
+    samples.swap(replies->samples);
+  }
+
+  // Merge the replies of the publishers, and keep the last ones asked for
+  std::sort(
+    samples.begin(), samples.end(),
+    [](const HistoryReplies::Sample & a, const HistoryReplies::Sample & b) {
+      return a.timestamp < b.timestamp;
+    });
+  size_t first = 0;
+  if (query->last > 0 && samples.size() > query->last) {
+    first = samples.size() - query->last;
+  }
+
+  // FILL HISTORY ==============================================================
+  rcutils_allocator_t * allocator = &node->context->options.allocator;
+  history->allocator = *allocator;
+  history->size = 0;
+  if (samples.size() > first) {
+    history->samples = static_cast<rmw_zenoh_history_sample_t *>(
+      allocator->allocate(
+        sizeof(rmw_zenoh_history_sample_t) * (samples.size() - first), allocator->state));
+    if (!history->samples) {
+      RMW_SET_ERROR_MSG("failed to allocate history samples");
+      return RMW_RET_BAD_ALLOC;
+    }
+  }
+
+  for (size_t i = first; i < samples.size(); ++i) {
+    rmw_zenoh_history_sample_t & sample = history->samples[history->size];
+    sample.serialized_message = rmw_get_zero_initialized_serialized_message();
+    if (rmw_serialized_message_init(
+        &sample.serialized_message, samples[i].data.size(), allocator) != RMW_RET_OK)
+    {
+      rmw_zenoh_history_fini(history);
+      RMW_SET_ERROR_MSG("failed to allocate history sample");
+      return RMW_RET_BAD_ALLOC;
+    }
+    memcpy(sample.serialized_message.buffer, samples[i].data.data(), samples[i].data.size());
+    sample.serialized_message.buffer_length = samples[i].data.size();
+    sample.timestamp = samples[i].timestamp;
+    sample.sequence = samples[i].sequence;
+    ++history->size;
+  }
+
+  if (timed_out) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+      "timed out waiting for the history of %s (%zu samples received)",
+      topic_name,
+      history->size);
+    return RMW_RET_TIMEOUT;
+  }
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_zenoh_history_fini(rmw_zenoh_history_t * history)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(history, RMW_RET_INVALID_ARGUMENT);
+
+  for (size_t i = 0; i < history->size; ++i) {
+    rmw_serialized_message_fini(&history->samples[i].serialized_message);
+  }
+  if (history->samples) {
+    history->allocator.deallocate(history->samples, history->allocator.state);
+  }
+  *history = rmw_zenoh_get_zero_initialized_history();
+  return RMW_RET_OK;
+}
+
+/// GET SUBSCRIPTION LATENCY ===================================================
+rmw_ret_t
+rmw_zenoh_common_get_subscription_latency(
+  const rmw_subscription_t * subscription,
+  rmw_zenoh_subscription_latency_t * latency,
+  const char * const eclipse_zenoh_identifier)
+{
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    subscription,
+    subscription->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription->data, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(latency, RMW_RET_INVALID_ARGUMENT);
+
+  auto * subscription_data = static_cast<rmw_subscription_data_t *>(subscription->data);
+
+  // GET LATENCY ===============================================================
+  rcutils_time_point_value_t now;
+  if (rcutils_system_time_now(&now) != RCUTILS_RET_OK) {
+    RMW_SET_ERROR_MSG("failed to get the current time");
+    return RMW_RET_ERROR;
+  }
+
+  std::lock_guard<std::mutex> lock(subscription_data->message_queue_mutex_);
+  rmw_zenoh_common_cpp::LatencyMonitor * monitor = subscription_data->latency_monitor_;
+  if (!monitor) {
+    RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+      "topic %s has no latency budget", subscription->topic_name);
+    return RMW_RET_UNSUPPORTED;
+  }
+
+  latency->budget = monitor->budget();
+  latency->window = monitor->window();
+  latency->count = monitor->count(now);
+  latency->p50 = monitor->percentile(0.5, now);
+  latency->p90 = monitor->percentile(0.9, now);
+  latency->p99 = monitor->percentile(0.99, now);
+  latency->breached = monitor->breached();
+  latency->breaches = monitor->breaches();
+  latency->over_budget = monitor->over_budget();
+  latency->max = monitor->max_latency();
+  return RMW_RET_OK;
+}
+
+/// SUBSCRIPTION LOSSES ========================================================
+rmw_ret_t
+rmw_zenoh_common_get_subscription_losses(
+  const rmw_subscription_t * subscription,
+  rmw_zenoh_subscription_losses_t * losses,
+  const char * const eclipse_zenoh_identifier)
+{
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    subscription,
+    subscription->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription->data, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(losses, RMW_RET_INVALID_ARGUMENT);
+
+  // GET COUNTERS ==============================================================
+  auto * subscription_data = static_cast<rmw_subscription_data_t *>(subscription->data);
+
+  std::lock_guard<std::mutex> lock(subscription_data->message_queue_mutex_);
+  losses->shed = subscription_data->shed_samples_;
+  losses->overflowed = subscription_data->overflowed_samples_;
+  return RMW_RET_OK;
+}
+
+/// DIRECT DISPATCH ============================================================
+rmw_ret_t
+rmw_zenoh_common_set_subscription_callback(
+  const rmw_subscription_t * subscription,
+  rmw_zenoh_subscription_callback_t callback,
+  void * ros_message,
+  void * user_data,
+  const char * const eclipse_zenoh_identifier)
+{
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    subscription,
+    subscription->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription->data, RMW_RET_INVALID_ARGUMENT);
+
+  if (callback && !ros_message && !subscription->can_loan_messages) {
+    RMW_SET_ERROR_MSG("subscription cannot loan messages, a message must be given");
+    return RMW_RET_UNSUPPORTED;
+  }
+
+  // SET CALLBACK ==============================================================
+  auto * subscription_data = static_cast<rmw_subscription_data_t *>(subscription->data);
+  if (subscription_data->direct_dispatcher_->in_callback()) {
+    RMW_SET_ERROR_MSG("cannot set the callback of a subscription from its callback");
+    return RMW_RET_ERROR;
+  }
+  if (!subscription_data->direct_dispatcher_->set(callback, ros_message, user_data)) {
+    RMW_SET_ERROR_MSG("failed to allocate message for direct dispatch");
+    return RMW_RET_BAD_ALLOC;
+  }
+  return RMW_RET_OK;
+}
+
+/// RESPONSE NOTIFICATION ======================================================
+rmw_ret_t
+rmw_zenoh_common_set_client_response_callback(
+  const rmw_client_t * client,
+  rmw_zenoh_client_response_callback_t callback,
+  void * user_data,
+  const char * const eclipse_zenoh_identifier)
+{
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(client, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    client,
+    client->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  RMW_CHECK_ARGUMENT_FOR_NULL(client->data, RMW_RET_INVALID_ARGUMENT);
+
+  // SET CALLBACK ==============================================================
+  static_cast<rmw_client_data_t *>(client->data)->set_response_callback(callback, user_data);
+  return RMW_RET_OK;
+}
+
+/// REQUEST DEADLINES ==========================================================
+rmw_ret_t
+rmw_zenoh_common_set_client_request_timeout(
+  const rmw_client_t * client,
+  rmw_time_t timeout,
+  const char * const eclipse_zenoh_identifier)
+{
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(client, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    client,
+    client->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  RMW_CHECK_ARGUMENT_FOR_NULL(client->data, RMW_RET_INVALID_ARGUMENT);
+
+  // SET TIMEOUT ===============================================================
+  // Timeouts too long to be added to the current time, like RMW_DURATION_INFINITE, have no
+  // deadline
+  static_cast<rmw_client_data_t *>(client->data)->request_timeout_.store(
+    rmw_zenoh_common_cpp::request_timeout_ns(timeout.sec, timeout.nsec),
+    std::memory_order_relaxed);
+  return RMW_RET_OK;
+}
+
+rmw_ret_t
+rmw_zenoh_common_get_service_expired_requests(
+  const rmw_service_t * service,
+  uint64_t * count,
+  const char * const eclipse_zenoh_identifier)
+{
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(service, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    service,
+    service->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  RMW_CHECK_ARGUMENT_FOR_NULL(service->data, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(count, RMW_RET_INVALID_ARGUMENT);
+
+  // GET COUNT =================================================================
+  *count = static_cast<const rmw_service_data_t *>(service->data)->expired_requests_.load(
+    std::memory_order_relaxed);
+  return RMW_RET_OK;
+}
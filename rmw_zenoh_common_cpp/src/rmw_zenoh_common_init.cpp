@@ -17,6 +17,9 @@
 #include <cstring>
 
 #include <memory>
+#include <new>
+#include <string>
+#include <vector>
 
 #include "rmw/impl/cpp/macros.hpp"
 #include "rmw/error_handling.h"
@@ -31,6 +34,13 @@
 #include "rmw_zenoh_common_cpp/rmw_zenoh_common.h"
 #include "rmw_zenoh_common_cpp/zenoh-net-interface.h"
 
+#include "impl/config.hpp"
+#include "impl/overload_detector.hpp"
+#include "impl/receive_buffer_pool.hpp"
+#include "impl/shaping.hpp"
+#include "impl/threads.hpp"
+#include "impl/trace_recorder.hpp"
+
 /// INIT CONTEXT ===============================================================
 // Initialize the middleware with the given options, and yielding an context.
 //
@@ -94,6 +104,147 @@ rmw_zenoh_common_init_pre(
   return RMW_RET_OK;
 }
 
+/// FINISH CONTEXT INIT ========================================================
+// Set up the implementation specific context members that are shared by both Zenoh backends.
+//
+// Called by rmw_init once the Zenoh session has been opened and assigned to context->impl.
+// If any step fails, the session is closed and the context is finalized and zero initialized.
+//
+// These members can be configured with the following environment variables:
+//  - RMW_ZENOH_RX_POOL_HUGE_PAGES: Back the largest receive buffer size classes with huge pages
+//                                  (true/false)
+//  - RMW_ZENOH_CONFIG_FILE: Path of a config file with per-topic and session settings
+//                           (see impl/config.hpp)
+rmw_ret_t
+rmw_zenoh_common_init_post(rmw_context_t * context, const char * const eclipse_zenoh_identifier)
+{
+  RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "rmw_init (post)");
+
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(context, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_FOR_NULL_WITH_MSG(
+    context->impl,
+    "expected initialized context",
+    return RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    context,
+    context->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  // CLEANUP DEFINITIONS =======================================================
+  // Store a pointer to the context with a custom deleter that closes the session, frees whatever
+  // was set up so far and zero inits the context if any of the steps below fail
+  std::unique_ptr<rmw_context_t, void (*)(rmw_context_t *)> clean_when_fail(
+    context,
+    [](rmw_context_t * context) {
+      rcutils_allocator_t * allocator = &context->options.allocator;
+
+      zn_close(context->impl->session);
+      if (context->impl->rx_buffer_pool) {
+        context->impl->rx_buffer_pool->release();
+      }
+      delete context->impl->config;
+      delete context->impl->session_bucket;
+      delete context->impl->rx_overload;
+      allocator->deallocate(context->impl, allocator->state);
+      context->impl = nullptr;
+
+      if (RMW_RET_OK != rmw_zenoh_common_init_options_fini(
+          &context->options, context->implementation_identifier))
+      {
+        RMW_SAFE_FWRITE_TO_STDERR(
+          "'rmw_zenoh_common_init_options_fini' failed while being executed due to '"
+          "rmw_zenoh_common_init_post' failing.\n");
+      }
+      *context = rmw_get_zero_initialized_context();
+    });
+
+  // CREATE RECEIVE BUFFER POOL ================================================
+  rmw_zenoh_common_cpp::ReceiveBufferPool::Options pool_options;
+  pool_options.use_huge_pages = context->options.impl->rx_pool_huge_pages;
+
+  context->impl->rx_buffer_pool = rmw_zenoh_common_cpp::ReceiveBufferPool::create(pool_options);
+  if (!context->impl->rx_buffer_pool) {
+    RMW_SET_ERROR_MSG("failed to allocate receive buffer pool");
+    return RMW_RET_BAD_ALLOC;
+  }
+
+  // LOAD CONFIG ===============================================================
+  context->impl->config = new (std::nothrow) rmw_zenoh_common_cpp::Config();
+  if (!context->impl->config) {
+    RMW_SET_ERROR_MSG("failed to allocate config");
+    return RMW_RET_BAD_ALLOC;
+  }
+
+  const char * config_file = context->options.impl->config_file;
+  if (config_file) {
+    std::string error;
+    if (!context->impl->config->load(config_file, error)) {
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("failed to load config file: %s", error.c_str());
+      return RMW_RET_ERROR;
+    }
+    RCUTILS_LOG_INFO_NAMED("rmw_zenoh_common_cpp", "Loaded config file %s", config_file);
+  }
+
+  // CONFIGURE MIDDLEWARE THREADS ==============================================
+  {
+    std::string error;
+    if (!rmw_zenoh_common_cpp::configure_threads(*context->impl->config, error)) {
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("failed to configure thread: %s", error.c_str());
+      return RMW_RET_ERROR;
+    }
+  }
+
+  // CREATE SESSION BANDWIDTH LIMIT ============================================
+  const rmw_zenoh_common_cpp::SessionConfig & session_config = context->impl->config->session();
+  if (session_config.rate_limit > 0) {
+    context->impl->session_bucket = new (std::nothrow) rmw_zenoh_common_cpp::TokenBucket(
+      session_config.rate_limit, session_config.burst);
+    if (!context->impl->session_bucket) {
+      RMW_SET_ERROR_MSG("failed to allocate session bandwidth limit");
+      return RMW_RET_BAD_ALLOC;
+    }
+  }
+
+  // CREATE RECEIVE OVERLOAD DETECTOR ==========================================
+  if (session_config.rx_overload_delay > 0.0 || session_config.rx_overload_bytes > 0) {
+    context->impl->rx_overload = new (std::nothrow) rmw_zenoh_common_cpp::OverloadDetector(
+      static_cast<int64_t>(session_config.rx_overload_delay * 1e6),
+      static_cast<size_t>(session_config.rx_overload_bytes));
+    if (!context->impl->rx_overload) {
+      RMW_SET_ERROR_MSG("failed to allocate receive overload detector");
+      return RMW_RET_BAD_ALLOC;
+    }
+  }
+
+  // CLEANUP IF PASSED =========================================================
+  clean_when_fail.release();
+
+  return RMW_RET_OK;
+}
+
+/// REGISTER MIDDLEWARE THREADS ================================================
+namespace
+{
+// Threads of the process when rmw_zenoh_common_threads_begin was last called on this thread
+thread_local std::vector<pid_t> threads_before;
+}  // namespace
+
+void
+rmw_zenoh_common_threads_begin(void)
+{
+  threads_before = rmw_zenoh_common_cpp::list_threads();
+}
+
+void
+rmw_zenoh_common_threads_end(const char * thread_class)
+{
+  rmw_zenoh_common_cpp::register_threads(
+    thread_class, threads_before, rmw_zenoh_common_cpp::list_threads());
+  threads_before.clear();
+}
+
 /// SHUTDOWN CONTEXT ===========================================================
 // Shutdown the middleware for a given context.
 //
@@ -153,8 +304,21 @@ rmw_zenoh_common_context_fini(rmw_context_t * context, const char * const eclips
 
   // CLEANUP ===================================================================
   // Deallocate implementation specific members
+  //
+  // NOTE: Samples still referenced by anyone keep the pool alive until they are dropped
+  if (context->impl->rx_buffer_pool) {
+    context->impl->rx_buffer_pool->release();
+  }
+  delete context->impl->config;
+  delete context->impl->session_bucket;
+  delete context->impl->rx_overload;
   allocator->deallocate(context->impl, allocator->state);
 
+  // The trace of the process outlives its contexts, but what it has so far should be on disk
+  if (rmw_zenoh_common_cpp::TraceRecorder::get()) {
+    rmw_zenoh_common_cpp::TraceRecorder::get()->flush();
+  }
+
   // Reset context
   *context = rmw_get_zero_initialized_context();
 
@@ -133,6 +133,49 @@ rmw_zenoh_common_init_options_init(
     return RMW_RET_BAD_ALLOC;
   }
 
+  // Populate receive buffer pool huge page preference
+  const char * zenoh_huge_pages_env_value;
+  if (nullptr != rcutils_get_env("RMW_ZENOH_RX_POOL_HUGE_PAGES", &zenoh_huge_pages_env_value)) {
+    RMW_SET_ERROR_MSG("error trying to retrieve RMW_ZENOH_RX_POOL_HUGE_PAGES env var");
+    return RMW_RET_ERROR;
+  }
+
+  init_options->impl->rx_pool_huge_pages =
+    strcicmp(zenoh_huge_pages_env_value, "TRUE") == 0 ||
+    strcicmp(zenoh_huge_pages_env_value, "1") == 0;
+
+  // Populate serialization plan preference
+  const char * zenoh_plans_env_value;
+  if (nullptr != rcutils_get_env("RMW_ZENOH_SERIALIZATION_PLANS", &zenoh_plans_env_value)) {
+    RMW_SET_ERROR_MSG("error trying to retrieve RMW_ZENOH_SERIALIZATION_PLANS env var");
+    return RMW_RET_ERROR;
+  }
+
+  init_options->impl->serialization_plans =
+    strcicmp(zenoh_plans_env_value, "TRUE") == 0 ||
+    strcicmp(zenoh_plans_env_value, "1") == 0;
+
+  // Populate config file path
+  const char * zenoh_config_file_env_value;
+  if (nullptr != rcutils_get_env("RMW_ZENOH_CONFIG_FILE", &zenoh_config_file_env_value)) {
+    RMW_SET_ERROR_MSG("error trying to retrieve RMW_ZENOH_CONFIG_FILE env var");
+    return RMW_RET_ERROR;
+  }
+
+  if (zenoh_config_file_env_value[0] == '\0') {
+    init_options->impl->config_file = nullptr;
+  } else {
+    init_options->impl->config_file = rcutils_strdup(zenoh_config_file_env_value, allocator);
+    if (!init_options->impl->config_file) {
+      RMW_SET_ERROR_MSG("failed to allocate RMW_ZENOH_CONFIG_FILE");
+      allocator.deallocate(init_options->impl->mode, allocator.state);
+      allocator.deallocate(init_options->impl->session_locator, allocator.state);
+      allocator.deallocate(init_options->impl, allocator.state);
+      allocator.deallocate(init_options->enclave, allocator.state);
+      return RMW_RET_BAD_ALLOC;
+    }
+  }
+
   return RMW_RET_OK;
 }
 
@@ -203,6 +246,19 @@ rmw_zenoh_common_init_options_copy(
     return RMW_RET_BAD_ALLOC;
   }
 
+  tmp.impl->rx_pool_huge_pages = src->impl->rx_pool_huge_pages;
+  tmp.impl->serialization_plans = src->impl->serialization_plans;
+
+  tmp.impl->config_file = rcutils_strdup(src->impl->config_file, allocator);
+  if (nullptr != src->impl->config_file && nullptr == tmp.impl->config_file) {
+    RMW_SET_ERROR_MSG("failed to allocate RMW_ZENOH_CONFIG_FILE");
+    allocator.deallocate(tmp.impl->mode, allocator.state);
+    allocator.deallocate(tmp.impl->session_locator, allocator.state);
+    allocator.deallocate(tmp.impl, allocator.state);
+    allocator.deallocate(tmp.enclave, allocator.state);
+    return RMW_RET_BAD_ALLOC;
+  }
+
   // NOTE(CH3): No security yet
   // tmp.security_options = rmw_get_zero_initialized_security_options();
   // rmw_ret_t ret =
@@ -244,6 +300,7 @@ rmw_zenoh_common_init_options_fini(
 
   allocator.deallocate(init_options->impl->session_locator, allocator.state);
   allocator.deallocate(init_options->impl->mode, allocator.state);
+  allocator.deallocate(init_options->impl->config_file, allocator.state);
   allocator.deallocate(init_options->impl, allocator.state);
   allocator.deallocate(init_options->enclave, allocator.state);
 
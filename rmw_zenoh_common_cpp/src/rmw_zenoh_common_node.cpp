@@ -14,6 +14,9 @@
 
 // Doc: http://docs.ros2.org/latest/api/rmw/rmw_8h.html
 
+#include <new>
+#include <string>
+
 #include "rmw/impl/cpp/macros.hpp"
 #include "rmw/validate_node_name.h"
 #include "rmw/validate_namespace.h"
@@ -21,7 +24,6 @@
 #include "rmw/rmw.h"
 
 #include "rcutils/logging_macros.h"
-#include "rcutils/strdup.h"
 
 #include "rmw_zenoh_common_cpp/rmw_init_options_impl.hpp"
 #include "rmw_zenoh_common_cpp/rmw_context_impl.hpp"
@@ -29,6 +31,9 @@
 
 #include "rmw_zenoh_common_cpp/rmw_zenoh_common.h"
 
+#include "impl/entity_arena.hpp"
+#include "impl/trace_recorder.hpp"
+
 /// CREATE NODE ================================================================
 // Create a node and return a handle to that node.
 //
@@ -99,68 +104,47 @@ rmw_zenoh_common_create_node(
   }
 
   // INIT NODE =================================================================
-  // NOTE(CH3): Unfortunately we have to make do with these ugly copy pasted calls until
-  // rcpputils::make_scope_exit() gets ported into a ROS2 release
-  //
-  // TODO(CH3): Once it is, replace the repeated deallocate calls with a scope exit handler
-  rmw_node_t * node = static_cast<rmw_node_t *>(
-    allocator->allocate(sizeof(rmw_node_t), allocator->state));
-  if (!node) {
+  // The node and everything it owns (its entities included) live in the node's arena, which is
+  // itself the only thing taken from the allocator directly
+  auto * arena = new (std::nothrow) rmw_zenoh_common_cpp::EntityArena(*allocator);
+  if (!arena) {
+    RMW_SET_ERROR_MSG("failed to allocate node arena");
+    return nullptr;
+  }
+
+  rmw_node_t * node = static_cast<rmw_node_t *>(arena->allocate(sizeof(rmw_node_t)));
+  rmw_node_impl_t * node_data = static_cast<rmw_node_impl_t *>(
+    arena->allocate(sizeof(rmw_node_impl_t)));
+  if (!node || !node_data) {
     RMW_SET_ERROR_MSG("failed to allocate rmw_node_t");
+    delete arena;
     return nullptr;
   }
 
   // Populate common members
   node->implementation_identifier = eclipse_zenoh_identifier;
 
-  node->name = rcutils_strdup(name, *allocator);
-  if (!node->name) {
+  node->name = arena->strdup(name);
+  node->namespace_ = arena->strdup(namespace_);
+  if (!node->name || !node->namespace_) {
     RMW_SET_ERROR_MSG("failed to allocate node name");
-    allocator->deallocate(node, allocator->state);
+    delete arena;
     return nullptr;
   }
 
-  node->namespace_ = rcutils_strdup(namespace_, *allocator);
-  if (!node->namespace_) {
-    RMW_SET_ERROR_MSG("failed to allocate node namespace");
-    allocator->deallocate(const_cast<char *>(node->name), allocator->state);
-    allocator->deallocate(node, allocator->state);
-    return nullptr;
-  }
-
-  node->data = static_cast<rmw_node_impl_t *>(
-    allocator->allocate(sizeof(rmw_node_impl_t), allocator->state)
-  );
-  if (!node->data) {
-    RMW_SET_ERROR_MSG("failed to allocate rmw_node_impl_t");
-    allocator->deallocate(const_cast<char *>(node->namespace_), allocator->state);
-    allocator->deallocate(const_cast<char *>(node->name), allocator->state);
-    allocator->deallocate(node, allocator->state);
-    return nullptr;
-  }
+  node->data = node_data;
+  node_data->arena_ = arena;
 
   // Assign ROS context
   node->context = context;
 
   // POPULATE ZENOH SPECIFIC NODE MEMBERS ======================================
-  // Get typed pointer to implementation specific node data struct
-  rmw_node_impl_t * node_data = static_cast<rmw_node_impl_t *>(node->data);
-
   // Create graph guard condition
-  node_data->graph_guard_condition_ = static_cast<rmw_guard_condition_t *>(
-    allocator->allocate(sizeof(rmw_guard_condition_t), allocator->state));
   node_data->graph_guard_condition_ = rmw_zenoh_common_create_guard_condition(
     node->context,
     eclipse_zenoh_identifier);
   if (!node_data->graph_guard_condition_) {
-    if (rmw_destroy_guard_condition(node_data->graph_guard_condition_) != RMW_RET_OK) {
-      RMW_SAFE_FWRITE_TO_STDERR("Failed to destroy guard condition in rmw_create_node");
-    }
-    allocator->deallocate(const_cast<char *>(node->namespace_), allocator->state);
-    allocator->deallocate(const_cast<char *>(node->name), allocator->state);
-
-    allocator->deallocate(node->data, allocator->state);
-    allocator->deallocate(node, allocator->state);
+    delete arena;
     return nullptr;
   }
 
@@ -178,6 +162,17 @@ rmw_zenoh_common_create_node(
   //   return nullptr;
   // }
 
+  // Nodes are traced by their fully qualified name
+  if (rmw_zenoh_common_cpp::TraceRecorder::get()) {
+    std::string fqn = node->namespace_;
+    if (fqn.empty() || fqn.back() != '/') {
+      fqn += '/';
+    }
+    fqn += node->name;
+    rmw_zenoh_common_cpp::trace_create(
+      rmw_zenoh_common_cpp::TraceEvent::kCreateNode, node, nullptr, fqn.c_str());
+  }
+
   return node;
 }
 
@@ -199,21 +194,17 @@ rmw_zenoh_common_destroy_node(rmw_node_t * node, const char * const eclipse_zeno
 
   RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "[rmw_destroy_node] %s", node->name);
 
-  // OBTAIN ALLOCATOR ==========================================================
-  rcutils_allocator_t * allocator = &node->context->options.allocator;
+  rmw_zenoh_common_cpp::trace_destroy(rmw_zenoh_common_cpp::TraceEvent::kDestroyNode, node);
 
   // CLEANUP ===================================================================
-  const rmw_ret_t destroyed = rmw_destroy_guard_condition(
-    static_cast<rmw_node_impl_t *>(node->data)->graph_guard_condition_);
+  auto * node_data = static_cast<rmw_node_impl_t *>(node->data);
+  const rmw_ret_t destroyed = rmw_destroy_guard_condition(node_data->graph_guard_condition_);
   if (destroyed != RMW_RET_OK) {
     RMW_SAFE_FWRITE_TO_STDERR("Failed to destroy guard condition in rmw_destroy_node");
   }
 
-  allocator->deallocate(const_cast<char *>(node->namespace_), allocator->state);
-  allocator->deallocate(const_cast<char *>(node->name), allocator->state);
-  allocator->deallocate(node->data, allocator->state);
-
-  allocator->deallocate(node, allocator->state);
+  // Takes the node (and whatever its entities left behind) with it
+  delete node_data->arena_;
 
   return RMW_RET_OK;
 }
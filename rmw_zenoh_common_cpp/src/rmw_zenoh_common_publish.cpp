@@ -15,7 +15,10 @@
 #include <fastcdr/FastBuffer.h>
 #include <fastcdr/Cdr.h>
 
+#include <mutex>
+
 #include "rcutils/logging_macros.h"
+#include "rcutils/time.h"
 
 #include "rmw/impl/cpp/macros.hpp"
 #include "rmw/error_handling.h"
@@ -23,7 +26,11 @@
 #include "rmw/rmw.h"
 
 #include "impl/type_support_common.hpp"
+#include "impl/codec.hpp"
+#include "impl/delta.hpp"
 #include "impl/pubsub_impl.hpp"
+#include "impl/sample_header.hpp"
+#include "impl/trace_recorder.hpp"
 
 #include "rmw_zenoh_common_cpp/rmw_zenoh_common.h"
 #include "rmw_zenoh_common_cpp/zenoh-net-interface.h"
@@ -37,7 +44,6 @@ rmw_zenoh_common_publish(
   rmw_publisher_allocation_t * allocation,
   const char * const eclipse_zenoh_identifier)
 {
-  (void) allocation;
   RCUTILS_LOG_DEBUG_NAMED(
     "rmw_zenoh_common_cpp", "[rmw_publish] %s (%ld)",
     publisher->topic_name,
@@ -56,19 +62,62 @@ rmw_zenoh_common_publish(
   auto publisher_data = static_cast<rmw_publisher_data_t *>(publisher->data);
   RMW_CHECK_ARGUMENT_FOR_NULL(publisher_data, RMW_RET_ERROR);
 
+  rmw_publisher_allocation_data_t * allocation_data = nullptr;
+  if (allocation) {
+    RMW_CHECK_ARGUMENT_FOR_NULL(allocation->data, RMW_RET_INVALID_ARGUMENT);
+    RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+      allocation,
+      allocation->implementation_identifier,
+      eclipse_zenoh_identifier,
+      return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+    allocation_data = static_cast<rmw_publisher_allocation_data_t *>(allocation->data);
+    if (allocation_data->type_support_impl_ != publisher_data->type_support_impl_) {
+      RMW_SET_ERROR_MSG("publisher allocation was initialized for a different message type");
+      return RMW_RET_INVALID_ARGUMENT;
+    }
+  }
+
   // ASSIGN ALLOCATOR ==========================================================
   rcutils_allocator_t * allocator =
     &(static_cast<rmw_publisher_data_t *>(publisher->data)->node_->context->options.allocator);
 
   // SERIALIZE DATA ============================================================
+  //
+  // NOTE: The message is serialized after room for the largest sample header, so unencoded samples
+  // can be written out in one go.
   size_t max_data_length = (static_cast<rmw_publisher_data_t *>(publisher->data)
     ->type_support_->getEstimatedSerializedSize(ros_message));
+  size_t max_sample_length = rmw_zenoh_common_cpp::kMaxSampleHeaderSize + max_data_length;
 
   // Init serialized message byte array
-  char * msg_bytes = static_cast<char *>(allocator->allocate(max_data_length, allocator->state));
+  char * msg_bytes = nullptr;
+  if (allocation_data) {
+    // Serialize into the preallocated buffer. It only ever has to grow for unbounded types.
+    if (max_sample_length > allocation_data->capacity_) {
+      rcutils_allocator_t * allocation_allocator = &allocation_data->allocator_;
+      char * buffer = static_cast<char *>(
+        allocation_allocator->reallocate(
+          allocation_data->buffer_, max_sample_length, allocation_allocator->state));
+      if (!buffer) {
+        RMW_SET_ERROR_MSG("failed to grow publisher allocation buffer");
+        return RMW_RET_BAD_ALLOC;
+      }
+      allocation_data->buffer_ = buffer;
+      allocation_data->capacity_ = max_sample_length;
+    }
+    msg_bytes = allocation_data->buffer_;
+  } else {
+    msg_bytes = static_cast<char *>(allocator->allocate(max_sample_length, allocator->state));
+    if (!msg_bytes) {
+      RMW_SET_ERROR_MSG("failed to allocate serialization buffer");
+      return RMW_RET_BAD_ALLOC;
+    }
+  }
 
   // Object that manages the raw buffer
-  eprosima::fastcdr::FastBuffer fastbuffer(msg_bytes, max_data_length);
+  eprosima::fastcdr::FastBuffer fastbuffer(
+    msg_bytes + rmw_zenoh_common_cpp::kMaxSampleHeaderSize, max_data_length);
 
   // Object that serializes the data
   eprosima::fastcdr::Cdr ser(
@@ -81,20 +130,135 @@ rmw_zenoh_common_publish(
       publisher_data->type_support_impl_))
   {
     RMW_SET_ERROR_MSG("could not serialize ROS message");
-    allocator->deallocate(msg_bytes, allocator->state);
+    if (!allocation_data) {
+      allocator->deallocate(msg_bytes, allocator->state);
+    }
     return RMW_RET_ERROR;
   }
 
   size_t data_length = ser.getSerializedDataLength();
+  rmw_zenoh_common_cpp::trace_call(
+    rmw_zenoh_common_cpp::TraceEvent::kPublish, publisher, data_length);
+
+  // SHAPE BANDWIDTH ===========================================================
+  // Done on the serialized message, before the stages below advance the publisher's streams (a
+  // dropped delta would otherwise leave subscriptions without the base of the next one)
+  rmw_zenoh_common_cpp::PublisherShaper * shaper = publisher_data->shaper_;
+  if (shaper && !shaper->admit(data_length)) {
+    RCUTILS_LOG_WARN_ONCE_NAMED(
+      "rmw_zenoh_common_cpp",
+      "Dropping messages over the bandwidth limit for %s",
+      publisher->topic_name);
+    RCUTILS_LOG_DEBUG_NAMED(
+      "rmw_zenoh_common_cpp",
+      "[rmw_publish] Dropped %zu bytes over the bandwidth limit for %s",
+      data_length,
+      publisher->topic_name);
+
+    if (!allocation_data) {
+      allocator->deallocate(msg_bytes, allocator->state);
+    }
+    return RMW_RET_OK;
+  }
+
+  // ENCODE PAYLOAD ============================================================
+  // Every stage writes its output after room for the largest header, which is written in front of
+  // the final payload.
+  rmw_zenoh_common_cpp::SampleHeader header;
+  header.version = rmw_zenoh_common_cpp::kSampleHeaderVersion;
+  header.codec = rmw_zenoh_common_cpp::kCodecNone;
+  header.flags = 0;
+
+  rmw_zenoh_common_cpp::InstanceKey * instance_key = publisher_data->instance_key_;
+  if (instance_key) {
+    header.flags |= rmw_zenoh_common_cpp::kSampleFlagInstance;
+    header.instance = instance_key->get(ros_message);
+  }
+
+  if (publisher_data->type_hash_ != 0) {
+    header.flags |= rmw_zenoh_common_cpp::kSampleFlagType;
+    header.type_hash = publisher_data->type_hash_;
+  }
+
+  if (publisher_data->sequencer_) {
+    publisher_data->sequencer_->stamp(header);
+  }
+
+  rcutils_time_point_value_t now = 0;
+  if (publisher_data->timestamp_samples_ || publisher_data->history_) {
+    rcutils_system_time_now(&now);
+  }
+  if (publisher_data->timestamp_samples_) {
+    header.flags |= rmw_zenoh_common_cpp::kSampleFlagTimestamp;
+    header.timestamp = now;
+  }
+
+  auto * payload = reinterpret_cast<unsigned char *>(msg_bytes) +
+    rmw_zenoh_common_cpp::kMaxSampleHeaderSize;
+  size_t payload_length = data_length;
+
+  // The stages' buffers are only free again once the sample has been written out
+  std::unique_lock<std::mutex> delta_lock;
+  rmw_zenoh_common_cpp::DeltaEncoder * delta_encoder = publisher_data->delta_encoder_;
+  if (delta_encoder) {
+    delta_lock = std::unique_lock<std::mutex>(delta_encoder->mutex());
+
+    size_t delta_length = delta_encoder->encode(
+      payload, payload_length, rmw_zenoh_common_cpp::kMaxSampleHeaderSize, header);
+    if (delta_length > 0) {
+      payload = delta_encoder->buffer() + rmw_zenoh_common_cpp::kMaxSampleHeaderSize;
+      payload_length = delta_length;
+    }
+  }
+
+  header.raw_length = static_cast<uint32_t>(payload_length);
+
+  std::unique_lock<std::mutex> encoder_lock;
+  rmw_zenoh_common_cpp::PayloadEncoder * encoder = publisher_data->encoder_;
+  if (encoder) {
+    encoder_lock = std::unique_lock<std::mutex>(encoder->mutex());
+
+    size_t encoded_length = encoder->encode(
+      payload, payload_length, rmw_zenoh_common_cpp::kMaxSampleHeaderSize);
+    if (encoded_length > 0) {
+      header.codec = encoder->codec()->id();
+      payload = encoder->buffer() + rmw_zenoh_common_cpp::kMaxSampleHeaderSize;
+      payload_length = encoded_length;
+    }
+  }
+
+  size_t header_size = rmw_zenoh_common_cpp::sample_header_size(header.flags);
+  unsigned char * sample = payload - header_size;
+  rmw_zenoh_common_cpp::write_sample_header(header, sample);
+
+  // KEEP HISTORY ==============================================================
+  // The serialized message is still untouched in front of the other stages' buffers
+  rmw_zenoh_common_cpp::HistoryRing * history = publisher_data->history_;
+  if (history) {
+    history->push(
+      now,
+      reinterpret_cast<const unsigned char *>(msg_bytes) +
+      rmw_zenoh_common_cpp::kMaxSampleHeaderSize,
+      data_length);
+  }
 
   // PUBLISH ON ZENOH MIDDLEWARE LAYER =========================================
   size_t wrid_ret = zn_write(
     publisher_data->zn_session_,
     zn_rid(publisher_data->zn_topic_id_),
-    msg_bytes,
-    data_length);
+    reinterpret_cast<const char *>(sample),
+    header_size + payload_length);
 
-  allocator->deallocate(msg_bytes, allocator->state);
+  if (encoder_lock.owns_lock()) {
+    encoder_lock.unlock();
+  }
+  if (delta_lock.owns_lock()) {
+    delta_lock.unlock();
+  }
+
+  if (!allocation_data) {
+    allocator->deallocate(msg_bytes, allocator->state);
+  }
 
   if (wrid_ret == 0) {
     return RMW_RET_OK;
@@ -12,8 +12,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cinttypes>
+#include <new>
+#include <string>
+
 #include "rcutils/logging_macros.h"
-#include "rcutils/strdup.h"
+#include "rcutils/time.h"
 
 #include "rmw/types.h"
 #include "rmw/validate_full_topic_name.h"
@@ -22,15 +26,22 @@
 #include "rmw/event.h"
 #include "rmw/rmw.h"
 
+#include "rmw_zenoh_common_cpp/rmw_init_options_impl.hpp"
 #include "rmw_zenoh_common_cpp/rmw_context_impl.hpp"
 
+#include "impl/config.hpp"
 #include "impl/pubsub_impl.hpp"
 #include "impl/qos.hpp"
+#include "impl/sample_header.hpp"
+#include "impl/type_hash.hpp"
 #include "impl/type_support_common.hpp"
 #include "impl/debug_helpers.hpp"
+#include "impl/history_ring.hpp"
+#include "impl/trace_recorder.hpp"
 
 #include "rmw_zenoh_common_cpp/zenoh-net-interface.h"
 #include "rmw_zenoh_common_cpp/rmw_zenoh_common.h"
+#include "rmw_zenoh_common_cpp/rmw_zenoh_extensions.h"
 
 /// CREATE PUBLISHER ===========================================================
 // Create and return an rmw publisher.
@@ -81,8 +92,9 @@ rmw_zenoh_common_create_publisher(
     return nullptr;
   }
 
-  // OBTAIN ALLOCATOR ==========================================================
-  rcutils_allocator_t * allocator = &node->context->options.allocator;
+  // OBTAIN ARENA ==============================================================
+  // The metadata of the publisher lives in the node's arena
+  rmw_zenoh_common_cpp::EntityArena * arena = static_cast<rmw_node_impl_t *>(node->data)->arena_;
 
   // VALIDATE TOPIC NAME =======================================================
   int validation_result;
@@ -100,6 +112,7 @@ rmw_zenoh_common_create_publisher(
   // OBTAIN TYPESUPPORT ========================================================
   const rosidl_message_type_support_t * type_support = get_message_typesupport_handle(
     type_supports, RMW_ZENOH_CPP_TYPESUPPORT_C);
+  bool is_cpp_type_support = false;
 
   if (!type_support) {
     type_support = get_message_typesupport_handle(type_supports, RMW_ZENOH_CPP_TYPESUPPORT_CPP);
@@ -108,11 +121,12 @@ rmw_zenoh_common_create_publisher(
       RMW_SET_ERROR_MSG("type support not from this implementation");
       return nullptr;
     }
+    is_cpp_type_support = true;
   }
 
   // CREATE PUBLISHER ==========================================================
   rmw_publisher_t * publisher = static_cast<rmw_publisher_t *>(
-    allocator->allocate(sizeof(rmw_publisher_t), allocator->state));
+    arena->allocate(sizeof(rmw_publisher_t)));
   if (!publisher) {
     RMW_SET_ERROR_MSG("failed to allocate rmw_publisher_t");
     return nullptr;
@@ -121,20 +135,20 @@ rmw_zenoh_common_create_publisher(
   // Populate common members
   publisher->implementation_identifier = eclipse_zenoh_identifier;
 
-  publisher->topic_name = rcutils_strdup(topic_name, *allocator);
+  publisher->topic_name = arena->strdup(topic_name);
   if (!publisher->topic_name) {
     RMW_SET_ERROR_MSG("failed to allocate publisher topic name");
-    allocator->deallocate(publisher, allocator->state);
+    arena->deallocate(publisher, sizeof(rmw_publisher_t));
     return nullptr;
   }
 
   publisher->data = static_cast<rmw_publisher_data_t *>(
-    allocator->allocate(sizeof(rmw_publisher_data_t), allocator->state));
+    arena->allocate(sizeof(rmw_publisher_data_t)));
   if (!publisher->data) {
     RMW_SET_ERROR_MSG("failed to allocate publisher data");
-    allocator->deallocate(publisher->data, allocator->state);
-    allocator->deallocate(const_cast<char *>(publisher->topic_name), allocator->state);
-    allocator->deallocate(publisher, allocator->state);
+    arena->deallocate(publisher->data, sizeof(rmw_publisher_data_t));
+    arena->deallocate_string(publisher->topic_name);
+    arena->deallocate(publisher, sizeof(rmw_publisher_t));
     return nullptr;
   }
 
@@ -168,16 +182,258 @@ rmw_zenoh_common_create_publisher(
 
   // Allocate and in-place construct new message typesupport instance
   publisher_data->type_support_ = static_cast<rmw_zenoh_common_cpp::MessageTypeSupport *>(
-    allocator->allocate(sizeof(rmw_zenoh_common_cpp::MessageTypeSupport), allocator->state));
-  new(publisher_data->type_support_) rmw_zenoh_common_cpp::MessageTypeSupport(callbacks);
+    arena->allocate(sizeof(rmw_zenoh_common_cpp::MessageTypeSupport)));
   if (!publisher_data->type_support_) {
     RMW_SET_ERROR_MSG("failed to allocate MessageTypeSupport");
-    allocator->deallocate(publisher->data, allocator->state);
+    arena->deallocate(publisher->data, sizeof(rmw_publisher_data_t));
 
-    allocator->deallocate(const_cast<char *>(publisher->topic_name), allocator->state);
-    allocator->deallocate(publisher, allocator->state);
+    arena->deallocate_string(publisher->topic_name);
+    arena->deallocate(publisher, sizeof(rmw_publisher_t));
     return nullptr;
   }
+  const rosidl_message_type_support_t * introspection =
+    rmw_zenoh_common_cpp::get_introspection_type_support(type_supports, type_support);
+  // Serialization plans are opt-in (see RMW_ZENOH_SERIALIZATION_PLANS)
+  new(publisher_data->type_support_) rmw_zenoh_common_cpp::MessageTypeSupport(
+    callbacks, node->context->options.impl->serialization_plans ? introspection : nullptr);
+
+  // Samples carry the hash of their type, for subscriptions to drop the ones they cannot take
+  publisher_data->type_hash_ = rmw_zenoh_common_cpp::message_type_hash(introspection);
+
+  // Set up the payload codec configured for the topic
+  rmw_zenoh_common_cpp::TopicConfig topic_config =
+    node->context->impl->config->topic(publisher->topic_name);
+
+  publisher_data->encoder_ = nullptr;
+  if (topic_config.codec != "none") {
+    const rmw_zenoh_common_cpp::Codec * codec =
+      rmw_zenoh_common_cpp::find_codec(topic_config.codec);
+    if (codec) {
+      publisher_data->encoder_ = new (std::nothrow) rmw_zenoh_common_cpp::PayloadEncoder(
+        codec, topic_config.codec_min_size, topic_config.codec_max_ratio);
+    } else {
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING("unknown codec '%s'", topic_config.codec.c_str());
+    }
+
+    if (!publisher_data->encoder_) {
+      if (codec) {
+        RMW_SET_ERROR_MSG("failed to allocate payload encoder");
+      }
+      arena->deallocate(
+        publisher_data->type_support_, sizeof(rmw_zenoh_common_cpp::MessageTypeSupport));
+      arena->deallocate(publisher->data, sizeof(rmw_publisher_data_t));
+
+      arena->deallocate_string(publisher->topic_name);
+      arena->deallocate(publisher, sizeof(rmw_publisher_t));
+      return nullptr;
+    }
+
+    RCUTILS_LOG_DEBUG_NAMED(
+      "rmw_zenoh_common_cpp",
+      "[rmw_create_publisher] %s: codec %s (min size %zu, max ratio %.2f)",
+      topic_name,
+      codec->name(),
+      topic_config.codec_min_size,
+      topic_config.codec_max_ratio);
+  }
+
+  // Set up the delta stage, and answer the keyframe queries of late joining subscriptions
+  publisher_data->delta_encoder_ = nullptr;
+  publisher_data->zn_keyframe_queryable_ = nullptr;
+  if (topic_config.delta) {
+    publisher_data->delta_encoder_ = new (std::nothrow) rmw_zenoh_common_cpp::DeltaEncoder(
+      topic_config.keyframe_interval);
+    if (!publisher_data->delta_encoder_) {
+      RMW_SET_ERROR_MSG("failed to allocate delta encoder");
+    } else {
+      std::string keyframe_key =
+        std::string(publisher->topic_name) + rmw_zenoh_common_cpp::kKeyframeKeySuffix;
+      publisher_data->zn_keyframe_queryable_ = zn_declare_queryable(
+        session,
+        zn_rname(keyframe_key.c_str()),
+        ZN_QUERYABLE_STORAGE,
+        rmw_publisher_data_t::zn_keyframe_queryable_callback,
+        publisher_data);
+      if (!publisher_data->zn_keyframe_queryable_) {
+        RMW_SET_ERROR_MSG("failed to create keyframe queryable for publisher");
+        delete publisher_data->delta_encoder_;
+      }
+    }
+
+    if (!publisher_data->zn_keyframe_queryable_) {
+      delete publisher_data->encoder_;
+      arena->deallocate(
+        publisher_data->type_support_, sizeof(rmw_zenoh_common_cpp::MessageTypeSupport));
+      arena->deallocate(publisher->data, sizeof(rmw_publisher_data_t));
+
+      arena->deallocate_string(publisher->topic_name);
+      arena->deallocate(publisher, sizeof(rmw_publisher_t));
+      return nullptr;
+    }
+
+    RCUTILS_LOG_DEBUG_NAMED(
+      "rmw_zenoh_common_cpp",
+      "[rmw_create_publisher] %s: delta encoded (keyframe interval %zu)",
+      topic_name,
+      topic_config.keyframe_interval);
+  }
+
+  // Set up the bandwidth limits of the publisher and its session
+  uint64_t rate_limit = topic_config.rate_limit;
+  uint64_t burst = topic_config.burst;
+  bool rate_limit_block = topic_config.rate_limit_block;
+  if (publisher_options->rmw_specific_publisher_payload) {
+    auto * zenoh_options = static_cast<const rmw_zenoh_publisher_options_t *>(
+      publisher_options->rmw_specific_publisher_payload);
+    rate_limit = zenoh_options->rate_limit;
+    burst = zenoh_options->burst;
+    rate_limit_block = zenoh_options->rate_limit_mode == RMW_ZENOH_RATE_LIMIT_BLOCK;
+  }
+
+  publisher_data->shaper_ = nullptr;
+  if (rate_limit > 0 || node->context->impl->session_bucket) {
+    publisher_data->shaper_ = new (std::nothrow) rmw_zenoh_common_cpp::PublisherShaper(
+      rate_limit,
+      burst,
+      node->context->impl->session_bucket,
+      rate_limit_block ?
+      rmw_zenoh_common_cpp::PublisherShaper::Mode::kBlock :
+      rmw_zenoh_common_cpp::PublisherShaper::Mode::kDrop);
+    if (!publisher_data->shaper_) {
+      RMW_SET_ERROR_MSG("failed to allocate publisher bandwidth limit");
+      if (publisher_data->zn_keyframe_queryable_) {
+        zn_undeclare_queryable(publisher_data->zn_keyframe_queryable_);
+      }
+      delete publisher_data->delta_encoder_;
+      delete publisher_data->encoder_;
+      arena->deallocate(
+        publisher_data->type_support_, sizeof(rmw_zenoh_common_cpp::MessageTypeSupport));
+      arena->deallocate(publisher->data, sizeof(rmw_publisher_data_t));
+
+      arena->deallocate_string(publisher->topic_name);
+      arena->deallocate(publisher, sizeof(rmw_publisher_t));
+      return nullptr;
+    }
+
+    RCUTILS_LOG_DEBUG_NAMED(
+      "rmw_zenoh_common_cpp",
+      "[rmw_create_publisher] %s: rate limit %" PRIu64 " B/s, burst %" PRIu64 " B (%s)",
+      topic_name,
+      rate_limit,
+      burst,
+      rate_limit_block ? "block" : "drop");
+  }
+
+  // Set up the instance key of a keyed topic
+  publisher_data->instance_key_ = nullptr;
+  if (!topic_config.key.empty()) {
+    publisher_data->instance_key_ = new (std::nothrow) rmw_zenoh_common_cpp::InstanceKey();
+    std::string error = "failed to allocate instance key";
+    if (!publisher_data->instance_key_ ||
+      !publisher_data->instance_key_->init(
+        type_supports, is_cpp_type_support, topic_config.key, error))
+    {
+      RMW_SET_ERROR_MSG_WITH_FORMAT_STRING(
+        "invalid key for topic %s: %s", topic_name, error.c_str());
+      delete publisher_data->instance_key_;
+      delete publisher_data->shaper_;
+      if (publisher_data->zn_keyframe_queryable_) {
+        zn_undeclare_queryable(publisher_data->zn_keyframe_queryable_);
+      }
+      delete publisher_data->delta_encoder_;
+      delete publisher_data->encoder_;
+      arena->deallocate(
+        publisher_data->type_support_, sizeof(rmw_zenoh_common_cpp::MessageTypeSupport));
+      arena->deallocate(publisher->data, sizeof(rmw_publisher_data_t));
+
+      arena->deallocate_string(publisher->topic_name);
+      arena->deallocate(publisher, sizeof(rmw_publisher_t));
+      return nullptr;
+    }
+
+    RCUTILS_LOG_DEBUG_NAMED(
+      "rmw_zenoh_common_cpp",
+      "[rmw_create_publisher] %s: keyed by %s",
+      topic_name,
+      topic_config.key.c_str());
+  }
+
+  // Stamp the samples for the subscriptions of a topic with a reorder window or a latency budget
+  publisher_data->timestamp_samples_ =
+    topic_config.reorder_window > 0 || topic_config.latency_budget > 0.0;
+
+  // Number the samples for the subscriptions to drop their duplicates
+  publisher_data->sequencer_ = nullptr;
+  if (topic_config.deduplicate) {
+    publisher_data->sequencer_ = new (std::nothrow) rmw_zenoh_common_cpp::SampleSequencer();
+    if (!publisher_data->sequencer_) {
+      RMW_SET_ERROR_MSG("failed to allocate sample sequencer");
+      delete publisher_data->instance_key_;
+      delete publisher_data->shaper_;
+      if (publisher_data->zn_keyframe_queryable_) {
+        zn_undeclare_queryable(publisher_data->zn_keyframe_queryable_);
+      }
+      delete publisher_data->delta_encoder_;
+      delete publisher_data->encoder_;
+      arena->deallocate(
+        publisher_data->type_support_, sizeof(rmw_zenoh_common_cpp::MessageTypeSupport));
+      arena->deallocate(publisher->data, sizeof(rmw_publisher_data_t));
+
+      arena->deallocate_string(publisher->topic_name);
+      arena->deallocate(publisher, sizeof(rmw_publisher_t));
+      return nullptr;
+    }
+  }
+
+  // Keep the last samples published, to answer the history queries of the topic
+  publisher_data->history_ = nullptr;
+  publisher_data->zn_history_queryable_ = nullptr;
+  if (topic_config.history > 0) {
+    publisher_data->history_ = new (std::nothrow) rmw_zenoh_common_cpp::HistoryRing(
+      topic_config.history,
+      RCUTILS_MS_TO_NS(static_cast<int64_t>(topic_config.history_duration)));
+    if (!publisher_data->history_) {
+      RMW_SET_ERROR_MSG("failed to allocate history ring");
+    } else {
+      std::string history_key =
+        std::string(publisher->topic_name) + rmw_zenoh_common_cpp::kHistoryKeySuffix;
+      publisher_data->zn_history_queryable_ = zn_declare_queryable(
+        session,
+        zn_rname(history_key.c_str()),
+        ZN_QUERYABLE_STORAGE,
+        rmw_publisher_data_t::zn_history_queryable_callback,
+        publisher_data);
+      if (!publisher_data->zn_history_queryable_) {
+        RMW_SET_ERROR_MSG("failed to create history queryable for publisher");
+        delete publisher_data->history_;
+      }
+    }
+
+    if (!publisher_data->zn_history_queryable_) {
+      delete publisher_data->sequencer_;
+      delete publisher_data->instance_key_;
+      delete publisher_data->shaper_;
+      if (publisher_data->zn_keyframe_queryable_) {
+        zn_undeclare_queryable(publisher_data->zn_keyframe_queryable_);
+      }
+      delete publisher_data->delta_encoder_;
+      delete publisher_data->encoder_;
+      arena->deallocate(
+        publisher_data->type_support_, sizeof(rmw_zenoh_common_cpp::MessageTypeSupport));
+      arena->deallocate(publisher->data, sizeof(rmw_publisher_data_t));
+
+      arena->deallocate_string(publisher->topic_name);
+      arena->deallocate(publisher, sizeof(rmw_publisher_t));
+      return nullptr;
+    }
+
+    RCUTILS_LOG_DEBUG_NAMED(
+      "rmw_zenoh_common_cpp",
+      "[rmw_create_publisher] %s: history of %zu samples (%" PRIu64 " ms)",
+      topic_name,
+      topic_config.history,
+      topic_config.history_duration);
+  }
 
   // Assign node pointer
   publisher_data->node_ = node;
@@ -189,6 +445,9 @@ rmw_zenoh_common_create_publisher(
   //
   // Perhaps track something using the nodes?
 
+  rmw_zenoh_common_cpp::trace_create(
+    rmw_zenoh_common_cpp::TraceEvent::kCreatePublisher, publisher, node, publisher->topic_name);
+
   return publisher;
 }
 
@@ -218,42 +477,145 @@ rmw_zenoh_common_destroy_publisher(
     "rmw_zenoh_common_cpp", "[rmw_destroy_publisher] %s",
     publisher->topic_name);
 
-  // OBTAIN ALLOCATOR ==========================================================
-  rcutils_allocator_t * allocator = &node->context->options.allocator;
+  rmw_zenoh_common_cpp::trace_destroy(
+    rmw_zenoh_common_cpp::TraceEvent::kDestroyPublisher, publisher);
 
-  // CLEANUP ===================================================================
-  allocator->deallocate(
-    static_cast<rmw_publisher_data_t *>(publisher->data)->type_support_,
-    allocator->state);
-  allocator->deallocate(publisher->data, allocator->state);
+  // OBTAIN ARENA ==============================================================
+  // The metadata of the publisher lives in the node's arena
+  rmw_zenoh_common_cpp::EntityArena * arena = static_cast<rmw_node_impl_t *>(node->data)->arena_;
 
-  allocator->deallocate(const_cast<char *>(publisher->topic_name), allocator->state);
-  allocator->deallocate(publisher, allocator->state);
+  // CLEANUP ===================================================================
+  auto publisher_data = static_cast<rmw_publisher_data_t *>(publisher->data);
+  if (publisher_data->zn_history_queryable_) {
+    zn_undeclare_queryable(publisher_data->zn_history_queryable_);
+  }
+  delete publisher_data->history_;
+  if (publisher_data->zn_keyframe_queryable_) {
+    zn_undeclare_queryable(publisher_data->zn_keyframe_queryable_);
+  }
+  delete publisher_data->sequencer_;
+  delete publisher_data->instance_key_;
+  delete publisher_data->shaper_;
+  delete publisher_data->delta_encoder_;
+  delete publisher_data->encoder_;
+  arena->deallocate(
+    publisher_data->type_support_, sizeof(rmw_zenoh_common_cpp::MessageTypeSupport));
+  arena->deallocate(publisher->data, sizeof(rmw_publisher_data_t));
+
+  arena->deallocate_string(publisher->topic_name);
+  arena->deallocate(publisher, sizeof(rmw_publisher_t));
   return RMW_RET_OK;
 }
 
-/// UNIMPLEMENTED ==============================================================
+/// INIT PUBLISHER ALLOCATION =================================================
+// Preallocate the serialization buffer used when publishing with the allocation.
+//
+// NOTE: rosidl_runtime_c__Sequence__bound does not carry any sizes yet, so the bounds are taken
+// from the type support instead (which knows the bounds of every bounded sequence and string).
 rmw_ret_t
-rmw_init_publisher_allocation(
-  const rosidl_message_type_support_t * type_support,
+rmw_zenoh_common_init_publisher_allocation(
+  const rosidl_message_type_support_t * type_supports,
   const rosidl_runtime_c__Sequence__bound * message_bounds,
-  rmw_publisher_allocation_t * allocation)
+  rmw_publisher_allocation_t * allocation,
+  const char * const eclipse_zenoh_identifier)
 {
-  (void)type_support;
   (void)message_bounds;
-  (void)allocation;
   RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "rmw_init_publisher_allocation");
-  return RMW_RET_UNSUPPORTED;
+
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(type_supports, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
+
+  if (allocation->data) {
+    RMW_SET_ERROR_MSG("publisher allocation already initialized");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  // OBTAIN TYPESUPPORT ========================================================
+  const rosidl_message_type_support_t * type_support = get_message_typesupport_handle(
+    type_supports, RMW_ZENOH_CPP_TYPESUPPORT_C);
+
+  if (!type_support) {
+    type_support = get_message_typesupport_handle(type_supports, RMW_ZENOH_CPP_TYPESUPPORT_CPP);
+    if (!type_support) {
+      RMW_SET_ERROR_MSG("type support not from this implementation");
+      return RMW_RET_INVALID_ARGUMENT;
+    }
+  }
+
+  auto callbacks = static_cast<const message_type_support_callbacks_t *>(type_support->data);
+  rmw_zenoh_common_cpp::MessageTypeSupport message_type_support(callbacks);
+
+  // OBTAIN ALLOCATOR ==========================================================
+  // NOTE: There is no context to take the allocator from, so the default one is used
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+
+  // CREATE ALLOCATION =========================================================
+  auto allocation_data = static_cast<rmw_publisher_allocation_data_t *>(
+    allocator.allocate(sizeof(rmw_publisher_allocation_data_t), allocator.state));
+  if (!allocation_data) {
+    RMW_SET_ERROR_MSG("failed to allocate publisher allocation data");
+    return RMW_RET_BAD_ALLOC;
+  }
+
+  allocation_data->type_support_impl_ = type_support->data;
+  allocation_data->bounded_ = message_type_support.isBounded();
+  allocation_data->capacity_ =
+    rmw_zenoh_common_cpp::kMaxSampleHeaderSize + message_type_support.getMaxSerializedSize();
+  allocation_data->allocator_ = allocator;
+
+  allocation_data->buffer_ = static_cast<char *>(
+    allocator.allocate(allocation_data->capacity_, allocator.state));
+  if (!allocation_data->buffer_) {
+    RMW_SET_ERROR_MSG("failed to allocate publisher allocation buffer");
+    allocator.deallocate(allocation_data, allocator.state);
+    return RMW_RET_BAD_ALLOC;
+  }
+
+  RCUTILS_LOG_DEBUG_NAMED(
+    "rmw_zenoh_common_cpp",
+    "[rmw_init_publisher_allocation] %s::%s: %zu bytes (%s)",
+    callbacks->message_namespace_,
+    callbacks->message_name_,
+    allocation_data->capacity_,
+    allocation_data->bounded_ ? "bounded" : "unbounded");
+
+  allocation->implementation_identifier = eclipse_zenoh_identifier;
+  allocation->data = allocation_data;
+  return RMW_RET_OK;
 }
 
+/// FINI PUBLISHER ALLOCATION ==================================================
 rmw_ret_t
-rmw_fini_publisher_allocation(rmw_publisher_allocation_t * allocation)
+rmw_zenoh_common_fini_publisher_allocation(
+  rmw_publisher_allocation_t * allocation,
+  const char * const eclipse_zenoh_identifier)
 {
-  (void)allocation;
   RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "rmw_fini_publisher_allocation");
-  return RMW_RET_UNSUPPORTED;
+
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation->data, RMW_RET_INVALID_ARGUMENT);
+
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    allocation,
+    allocation->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  // CLEANUP ===================================================================
+  auto allocation_data = static_cast<rmw_publisher_allocation_data_t *>(allocation->data);
+  rcutils_allocator_t allocator = allocation_data->allocator_;
+
+  allocator.deallocate(allocation_data->buffer_, allocator.state);
+  allocator.deallocate(allocation_data, allocator.state);
+
+  allocation->implementation_identifier = nullptr;
+  allocation->data = nullptr;
+  return RMW_RET_OK;
 }
 
+/// UNIMPLEMENTED ==============================================================
 rmw_ret_t
 rmw_borrow_loaned_message(
   const rmw_publisher_t * publisher,
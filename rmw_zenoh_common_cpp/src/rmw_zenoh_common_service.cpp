@@ -12,11 +12,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cinttypes>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "rcutils/logging_macros.h"
 #include "rcutils/strdup.h"
+#include "rcutils/time.h"
 
 #include "rmw/validate_full_topic_name.h"
 #include "rmw/impl/cpp/macros.hpp"
@@ -30,6 +33,8 @@
 #include "impl/type_support_common.hpp"
 #include "impl/service_impl.hpp"
 #include "impl/client_impl.hpp"
+#include "impl/request_metadata.hpp"
+#include "impl/trace_recorder.hpp"
 
 /// CREATE SERVICE SERVER ======================================================
 // Create and return an rmw service server
@@ -259,7 +264,7 @@ rmw_zenoh_common_create_service(
       zn_rname(service_data->zn_request_topic_key_),
       zn_subinfo_default(),  // NOTE(CH3): Default for now
       service_data->zn_request_sub_callback,
-      nullptr);
+      node->context->impl->rx_buffer_pool);
 
     RCUTILS_LOG_DEBUG_NAMED(
       "rmw_zenoh_common_cpp",
@@ -317,6 +322,9 @@ rmw_zenoh_common_create_service(
     return nullptr;
   }
 
+  rmw_zenoh_common_cpp::trace_create(
+    rmw_zenoh_common_cpp::TraceEvent::kCreateService, service, node, service->service_name);
+
   return service;
 }
 
@@ -346,6 +354,8 @@ rmw_zenoh_common_destroy_service(
     eclipse_zenoh_identifier,
     return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
 
+  rmw_zenoh_common_cpp::trace_destroy(rmw_zenoh_common_cpp::TraceEvent::kDestroyService, service);
+
   // OBTAIN ALLOCATOR ==========================================================
   rcutils_allocator_t * allocator = &node->context->options.allocator;
 
@@ -404,6 +414,9 @@ rmw_zenoh_common_destroy_service(
   allocator->deallocate(const_cast<char *>(service_data->zn_response_topic_key_), allocator->state);
   allocator->deallocate(service_data->request_type_support_, allocator->state);
   allocator->deallocate(service_data->response_type_support_, allocator->state);
+
+  // Destruct the queue so any messages still in it go back to the receive buffer pool
+  service_data->~rmw_service_data_t();
   allocator->deallocate(service->data, allocator->state);
 
   allocator->deallocate(const_cast<char *>(service->service_name), allocator->state);
@@ -444,13 +457,54 @@ rmw_zenoh_common_take_request(
   // OBTAIN SERVICE MEMBERS ====================================================
   auto * service_data = static_cast<rmw_service_data_t *>(service->data);
 
-  // OBTAIN ALLOCATOR ==========================================================
-  rcutils_allocator_t * allocator = &service_data->node_->context->options.allocator;
-
   // RETRIEVE SERIALIZED MESSAGE ===============================================
   std::unique_lock<std::mutex> lock(service_data->request_queue_mutex_);
 
-  if (service_data->zn_request_message_queue_.empty()) {
+  // Whatever this finds, the claim of the wait that woke the caller is used up
+  service_data->ready_claims_.release();
+
+  // Skip the requests whose clients have given up on them, without deserializing them
+  rmw_zenoh_common_cpp::ReceiveBufferPtr request_bytes_ptr;
+  rmw_zenoh_common_cpp::RequestMetadata metadata;
+  rcutils_time_point_value_t now = 0;
+  while (!service_data->zn_request_message_queue_.empty()) {
+    // NOTE(CH3): Potential place to handle "QoS" (e.g. could pop from back so it is LIFO)
+    request_bytes_ptr = std::move(service_data->zn_request_message_queue_.back());
+    service_data->zn_request_message_queue_.pop_back();
+
+    if (!rmw_zenoh_common_cpp::read_request_metadata(
+        request_bytes_ptr->data(), request_bytes_ptr->size(), metadata))
+    {
+      RCUTILS_LOG_WARN_NAMED(
+        "rmw_zenoh_common_cpp",
+        "[rmw_take] Dropping truncated request message for %s",
+        service_data->zn_request_topic_key_);
+      request_bytes_ptr.reset();
+      continue;
+    }
+
+    // The clock is only read for the first request with a deadline
+    if (metadata.deadline != 0 && now == 0 && rcutils_system_time_now(&now) != RCUTILS_RET_OK) {
+      now = 0;
+    }
+    if (now != 0 && rmw_zenoh_common_cpp::request_expired(metadata, now)) {
+      service_data->expired_requests_.fetch_add(1, std::memory_order_relaxed);
+      RCUTILS_LOG_DEBUG_NAMED(
+        "rmw_zenoh_common_cpp",
+        "[rmw_take] Discarding request %" PRId64 " for %s, %" PRId64 " ns past its deadline",
+        metadata.sequence_id,
+        service_data->zn_request_topic_key_,
+        now - metadata.deadline);
+      request_bytes_ptr.reset();
+      continue;
+    }
+    break;
+  }
+  service_data->ready_claims_.set_available(service_data->zn_request_message_queue_.size());
+
+  lock.unlock();
+
+  if (!request_bytes_ptr) {
     // NOTE(CH3): It is correct to be returning RMW_RET_OK. The information that the message
     // was not found is encoded in the fact that the taken-out parameter is still False.
     //
@@ -458,39 +512,27 @@ rmw_zenoh_common_take_request(
     return RMW_RET_OK;
   }
 
-  // NOTE(CH3): Potential place to handle "QoS" (e.g. could pop from back so it is LIFO)
-  auto request_bytes_ptr = service_data->zn_request_message_queue_.back();
-  service_data->zn_request_message_queue_.pop_back();
-
-  service_data->request_queue_mutex_.unlock();
-
   RCUTILS_LOG_DEBUG_NAMED(
     "rmw_zenoh_common_cpp",
     "[rmw_take] Request found: %s",
     service_data->zn_request_topic_key_);
 
-  // RETRIEVE METADATA =========================================================
-  //
-  // TODO(CH3): Refactor this into its own modular set of functions eventually to make adding
-  // more metadata convenient
-  size_t meta_length = sizeof(std::int64_t);  // Internal type of the atomic sequence ID
+  rmw_zenoh_common_cpp::trace_call(
+    rmw_zenoh_common_cpp::TraceEvent::kTakeRequest, service,
+    request_bytes_ptr->size() - rmw_zenoh_common_cpp::kRequestMetadataSize);
 
-  // Use metadata
-  memcpy(
-    &request_header->request_id.sequence_number,
-    &request_bytes_ptr->back() + 1 - meta_length,
-    meta_length);
+  // RETRIEVE METADATA =========================================================
+  request_header->request_id.sequence_number = metadata.sequence_id;
 
   // DESERIALIZE MESSAGE =======================================================
-  size_t data_length = request_bytes_ptr->size() - meta_length;
-
-  unsigned char * cdr_buffer = static_cast<unsigned char *>(allocator->allocate(
-      data_length,
-      allocator->state));
-  memcpy(cdr_buffer, &request_bytes_ptr->front(), data_length);
+  size_t data_length = request_bytes_ptr->size() - rmw_zenoh_common_cpp::kRequestMetadataSize;
 
+  // NOTE: Deserialized straight out of the pooled receive buffer, which is only ever read from
+  //
   // Object that manages the raw buffer.
-  eprosima::fastcdr::FastBuffer fastbuffer(reinterpret_cast<char *>(cdr_buffer), data_length);
+  eprosima::fastcdr::FastBuffer fastbuffer(
+    reinterpret_cast<char *>(request_bytes_ptr->data()),
+    data_length);
 
   // Object that deserializes the data
   eprosima::fastcdr::Cdr deser(
@@ -507,7 +549,6 @@ rmw_zenoh_common_take_request(
   }
 
   *taken = true;
-  allocator->deallocate(cdr_buffer, allocator->state);
 
   return RMW_RET_OK;
 }
@@ -585,6 +626,8 @@ rmw_zenoh_common_send_response(
   }
 
   size_t data_length = ser.getSerializedDataLength();
+  rmw_zenoh_common_cpp::trace_call(
+    rmw_zenoh_common_cpp::TraceEvent::kSendResponse, service, data_length);
 
   // ADD METADATA ==============================================================
   // TODO(CH3): Again, refactor this into a modular set of functions eventually
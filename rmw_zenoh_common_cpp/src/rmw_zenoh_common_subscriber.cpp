@@ -12,12 +12,15 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cinttypes>
 #include <functional>
+#include <new>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "rcutils/logging_macros.h"
-#include "rcutils/strdup.h"
+#include "rcutils/time.h"
 
 #include "rmw/ret_types.h"
 #include "rmw/validate_full_topic_name.h"
@@ -26,10 +29,16 @@
 #include "rmw/event.h"
 #include "rmw/rmw.h"
 
+#include "rmw_zenoh_common_cpp/rmw_init_options_impl.hpp"
 #include "rmw_zenoh_common_cpp/rmw_context_impl.hpp"
 
+#include "impl/config.hpp"
 #include "impl/pubsub_impl.hpp"
+#include "impl/receive_buffer_pool.hpp"
+#include "impl/serialization_plan.hpp"
 #include "impl/qos.hpp"
+#include "impl/trace_recorder.hpp"
+#include "impl/type_hash.hpp"
 #include "impl/type_support_common.hpp"
 #include "impl/debug_helpers.hpp"
 
@@ -88,8 +97,9 @@ rmw_zenoh_common_create_subscription(
     return nullptr;
   }
 
-  // OBTAIN ALLOCATOR ==========================================================
-  rcutils_allocator_t * allocator = &node->context->options.allocator;
+  // OBTAIN ARENA ==============================================================
+  // The metadata of the subscription lives in the node's arena
+  rmw_zenoh_common_cpp::EntityArena * arena = static_cast<rmw_node_impl_t *>(node->data)->arena_;
 
   // VALIDATE TOPIC NAME =======================================================
   int validation_result;
@@ -119,7 +129,7 @@ rmw_zenoh_common_create_subscription(
 
   // CREATE SUBSCRIPTION =======================================================
   rmw_subscription_t * subscription = static_cast<rmw_subscription_t *>(
-    allocator->allocate(sizeof(rmw_subscription_t), allocator->state));
+    arena->allocate(sizeof(rmw_subscription_t)));
   if (!subscription) {
     RMW_SET_ERROR_MSG("failed to allocate rmw_subscription_t");
     return nullptr;
@@ -130,22 +140,22 @@ rmw_zenoh_common_create_subscription(
   subscription->options = *subscription_options;
   subscription->can_loan_messages = false;
 
-  subscription->topic_name = rcutils_strdup(topic_name, *allocator);
+  subscription->topic_name = arena->strdup(topic_name);
   if (!subscription->topic_name) {
     RMW_SET_ERROR_MSG("failed to allocate subscription topic name");
-    allocator->deallocate(subscription, allocator->state);
+    arena->deallocate(subscription, sizeof(rmw_subscription_t));
     return nullptr;
   }
 
   subscription->data = static_cast<rmw_subscription_data_t *>(
-    allocator->allocate(sizeof(rmw_subscription_data_t), allocator->state));
-  new(subscription->data) rmw_subscription_data_t();
+    arena->allocate(sizeof(rmw_subscription_data_t)));
   if (!subscription->data) {
     RMW_SET_ERROR_MSG("failed to allocate subscription data");
-    allocator->deallocate(const_cast<char *>(subscription->topic_name), allocator->state);
-    allocator->deallocate(subscription, allocator->state);
+    arena->deallocate_string(subscription->topic_name);
+    arena->deallocate(subscription, sizeof(rmw_subscription_t));
     return nullptr;
   }
+  new(subscription->data) rmw_subscription_data_t();
 
   // CREATE SUBSCRIPTION MEMBERS ===============================================
   // Init type support callbacks
@@ -163,16 +173,29 @@ rmw_zenoh_common_create_subscription(
 
   // Allocate and in-place assign new message typesupport instance
   subscription_data->type_support_ = static_cast<rmw_zenoh_common_cpp::MessageTypeSupport *>(
-    allocator->allocate(sizeof(rmw_zenoh_common_cpp::MessageTypeSupport), allocator->state));
-  new(subscription_data->type_support_) rmw_zenoh_common_cpp::MessageTypeSupport(callbacks);
+    arena->allocate(sizeof(rmw_zenoh_common_cpp::MessageTypeSupport)));
   if (!subscription_data->type_support_) {
     RMW_SET_ERROR_MSG("failed to allocate MessageTypeSupport");
-    allocator->deallocate(subscription->data, allocator->state);
+    subscription_data->~rmw_subscription_data_t();
+    arena->deallocate(subscription->data, sizeof(rmw_subscription_data_t));
 
-    allocator->deallocate(const_cast<char *>(subscription->topic_name), allocator->state);
-    allocator->deallocate(subscription, allocator->state);
+    arena->deallocate_string(subscription->topic_name);
+    arena->deallocate(subscription, sizeof(rmw_subscription_t));
     return nullptr;
   }
+  const rosidl_message_type_support_t * introspection =
+    rmw_zenoh_common_cpp::get_introspection_type_support(type_supports, type_support);
+  // Serialization plans are opt-in (see RMW_ZENOH_SERIALIZATION_PLANS), but C messages are
+  // loaned out with theirs either way
+  new(subscription_data->type_support_) rmw_zenoh_common_cpp::MessageTypeSupport(
+    callbacks, introspection, node->context->options.impl->serialization_plans);
+
+  // Samples whose type hash differs are dropped before they are queued
+  subscription_data->type_hash_ = rmw_zenoh_common_cpp::message_type_hash(introspection);
+  subscription_data->incompatible_types_reported_ = 0;
+
+  // Messages can only be loaned out where their sequences can view the receive buffers
+  subscription->can_loan_messages = subscription_data->type_support_->canLoanMessages();
 
   // Assign node pointer
   subscription_data->node_ = node;
@@ -181,24 +204,119 @@ rmw_zenoh_common_create_subscription(
   subscription_data->subscription_id_ =
     rmw_subscription_data_t::subscription_id_counter.fetch_add(1, std::memory_order_relaxed);
 
-  // Configure message queue
+  subscription_data->topic_name_ = subscription->topic_name;
+
+  // Configure message queue (with its history kept per instance on keyed topics)
+  rmw_zenoh_common_cpp::TopicConfig topic_config =
+    node->context->impl->config->topic(subscription->topic_name);
   subscription_data->queue_depth_ = qos_profile->depth;
+  subscription_data->zn_message_queue_ = rmw_zenoh_common_cpp::SampleQueue(
+    qos_profile->depth, !topic_config.key.empty());
+
+  // Shed samples by the topic's priority when the receive path is overloaded
+  subscription_data->overload_detector_ = node->context->impl->rx_overload;
+  subscription_data->priority_ = topic_config.priority;
+  subscription_data->shed_samples_ = 0;
+  subscription_data->overflowed_samples_ = 0;
+
+  // Put stamped samples in timestamp order before queueing them, on topics with a reorder window
+  subscription_data->reorder_buffer_ = nullptr;
+  if (topic_config.reorder_window > 0) {
+    subscription_data->reorder_buffer_ = new (std::nothrow) rmw_zenoh_common_cpp::ReorderBuffer(
+      RCUTILS_MS_TO_NS(static_cast<int64_t>(topic_config.reorder_window)));
+    if (!subscription_data->reorder_buffer_) {
+      RMW_SET_ERROR_MSG("failed to allocate reorder buffer");
+      arena->deallocate(
+        subscription_data->type_support_, sizeof(rmw_zenoh_common_cpp::MessageTypeSupport));
+      subscription_data->~rmw_subscription_data_t();
+      arena->deallocate(subscription->data, sizeof(rmw_subscription_data_t));
+
+      arena->deallocate_string(subscription->topic_name);
+      arena->deallocate(subscription, sizeof(rmw_subscription_t));
+      return nullptr;
+    }
+
+    RCUTILS_LOG_DEBUG_NAMED(
+      "rmw_zenoh_common_cpp",
+      "[rmw_create_subscription] %s: reorder window of %" PRIu64 " ms",
+      topic_name,
+      topic_config.reorder_window);
+  }
+
+  // Track the latency of the samples taken, on topics with a latency budget
+  subscription_data->latency_monitor_ = nullptr;
+  subscription_data->latency_breaches_reported_ = 0;
+  if (topic_config.latency_budget > 0.0) {
+    subscription_data->latency_monitor_ = new (std::nothrow) rmw_zenoh_common_cpp::LatencyMonitor(
+      static_cast<int64_t>(topic_config.latency_budget * 1e6),
+      RCUTILS_MS_TO_NS(static_cast<int64_t>(topic_config.latency_window)));
+    if (!subscription_data->latency_monitor_) {
+      RMW_SET_ERROR_MSG("failed to allocate latency monitor");
+      delete subscription_data->reorder_buffer_;
+      arena->deallocate(
+        subscription_data->type_support_, sizeof(rmw_zenoh_common_cpp::MessageTypeSupport));
+      subscription_data->~rmw_subscription_data_t();
+      arena->deallocate(subscription->data, sizeof(rmw_subscription_data_t));
+
+      arena->deallocate_string(subscription->topic_name);
+      arena->deallocate(subscription, sizeof(rmw_subscription_t));
+      return nullptr;
+    }
+
+    RCUTILS_LOG_DEBUG_NAMED(
+      "rmw_zenoh_common_cpp",
+      "[rmw_create_subscription] %s: latency budget of %.3f ms over %" PRIu64 " ms",
+      topic_name,
+      topic_config.latency_budget,
+      topic_config.latency_window);
+  }
+
+  // Samples go to the message queue until a direct dispatch callback is set
+  subscription_data->direct_dispatcher_.reset(
+    new (std::nothrow) rmw_zenoh_common_cpp::DirectDispatcher(
+      subscription_data->type_support_, subscription_data->type_support_impl_,
+      subscription->topic_name, node->context->options.allocator));
+  if (!subscription_data->direct_dispatcher_) {
+    RMW_SET_ERROR_MSG("failed to allocate direct dispatcher");
+    delete subscription_data->latency_monitor_;
+    delete subscription_data->reorder_buffer_;
+    arena->deallocate(
+      subscription_data->type_support_, sizeof(rmw_zenoh_common_cpp::MessageTypeSupport));
+    subscription_data->~rmw_subscription_data_t();
+    arena->deallocate(subscription->data, sizeof(rmw_subscription_data_t));
+
+    arena->deallocate_string(subscription->topic_name);
+    arena->deallocate(subscription, sizeof(rmw_subscription_t));
+    return nullptr;
+  }
 
   // ADD SUBSCRIPTION DATA TO TOPIC MAP ========================================
   // This will allow us to access the subscription data structs for this Zenoh topic key expression
+  //
+  // NOTE: The topic maps are used by the receiving thread with sub_callback_mutex held
   std::string key(subscription->topic_name);
-  auto map_iter = rmw_subscription_data_t::zn_topic_to_sub_data.find(key);
+  bool new_topic = false;
+  {
+    std::lock_guard<std::mutex> guard(sub_callback_mutex);
+    auto map_iter = rmw_subscription_data_t::zn_topic_to_sub_data.find(key);
+
+    if (map_iter == rmw_subscription_data_t::zn_topic_to_sub_data.end()) {
+      // If no elements for this Zenoh topic key expression exists, add it in
+      std::vector<rmw_subscription_data_t *> sub_data_vec{subscription_data};
+      rmw_subscription_data_t::zn_topic_to_sub_data[key] = sub_data_vec;
+      new_topic = true;
+    } else {
+      // Otherwise, append to the vector
+      map_iter->second.push_back(subscription_data);
+    }
+  }
 
-  if (map_iter == rmw_subscription_data_t::zn_topic_to_sub_data.end()) {
+  if (new_topic) {
     RCUTILS_LOG_DEBUG_NAMED(
       "rmw_zenoh_common_cpp",
       "[rmw_create_subscription] New topic detected: %s",
       topic_name);
 
-    // If no elements for this Zenoh topic key expression exists, add it in
-    std::vector<rmw_subscription_data_t *> sub_data_vec{subscription_data};
-    rmw_subscription_data_t::zn_topic_to_sub_data[key] = sub_data_vec;
-
     // We initialise subscribers ONCE (otherwise we'll get duplicate messages)
     // The topic name will be the same for any duplicate subscribers, so it is ok
     subscription_data->zn_subscriber_ = zn_declare_subscriber(
@@ -206,15 +324,12 @@ rmw_zenoh_common_create_subscription(
       zn_rname(subscription->topic_name),
       zn_subinfo_default(),  // NOTE(CH3): Default for now
       subscription_data->zn_sub_callback,
-      nullptr);
+      node->context->impl->rx_buffer_pool);
 
     RCUTILS_LOG_DEBUG_NAMED(
       "rmw_zenoh_common_cpp",
       "[rmw_create_subscription] Zenoh subscription declared for %s",
       topic_name);
-  } else {
-    // Otherwise, append to the vector
-    map_iter->second.push_back(subscription_data);
   }
 
   RCUTILS_LOG_DEBUG_NAMED(
@@ -230,6 +345,10 @@ rmw_zenoh_common_create_subscription(
   //
   // Perhaps track something using the nodes?
 
+  rmw_zenoh_common_cpp::trace_create(
+    rmw_zenoh_common_cpp::TraceEvent::kCreateSubscription, subscription, node,
+    subscription->topic_name);
+
   return subscription;
 }
 
@@ -257,36 +376,64 @@ rmw_zenoh_common_destroy_subscription(
   // OBTAIN SUBSCRIPTION MEMBERS ===============================================
   auto subscription_data = static_cast<rmw_subscription_data_t *>(subscription->data);
 
+  // Destroying the subscription waits for its direct dispatch callback to return
+  if (subscription_data->direct_dispatcher_->in_callback()) {
+    RMW_SET_ERROR_MSG("cannot destroy a subscription from its direct dispatch callback");
+    return RMW_RET_ERROR;
+  }
+
   RCUTILS_LOG_DEBUG_NAMED(
     "rmw_zenoh_common_cpp",
     "[rmw_destroy_subscription] %s (ID: %ld)",
     subscription->topic_name,
     subscription_data->subscription_id_);
 
-  // OBTAIN ALLOCATOR ==========================================================
-  rcutils_allocator_t * allocator = &node->context->options.allocator;
+  rmw_zenoh_common_cpp::trace_destroy(
+    rmw_zenoh_common_cpp::TraceEvent::kDestroySubscription, subscription);
+
+  // OBTAIN ARENA ==============================================================
+  // The metadata of the subscription lives in the node's arena
+  rmw_zenoh_common_cpp::EntityArena * arena = static_cast<rmw_node_impl_t *>(node->data)->arena_;
 
   // DELETE SUBSCRIPTION DATA IN TOPIC MAP =====================================
+  // The topic maps are used by the receiving thread with sub_callback_mutex held. The Zenoh
+  // subscriber is undeclared after releasing it, since that may wait for a callback in progress.
   std::string key(subscription->topic_name);
-  auto map_iter = rmw_subscription_data_t::zn_topic_to_sub_data.find(key);
+  bool found = false;
+  bool last_on_topic = false;
+  {
+    std::lock_guard<std::mutex> guard(sub_callback_mutex);
+    auto map_iter = rmw_subscription_data_t::zn_topic_to_sub_data.find(key);
+
+    if (map_iter != rmw_subscription_data_t::zn_topic_to_sub_data.end()) {
+      found = true;
+
+      // Delete the subscription data pointer in the Zenoh topic to subscription data map
+      for (auto it = map_iter->second.begin(); it != map_iter->second.end(); ++it) {
+        if ((*it)->subscription_id_ == subscription_data->subscription_id_) {
+          map_iter->second.erase(it);
+          break;
+        }
+      }
 
-  if (map_iter == rmw_subscription_data_t::zn_topic_to_sub_data.end()) {
+      // Delete the map element if no other subscription data pointers exist
+      // (That is, when no other subscriptions are listening to the Zenoh topic)
+      if (map_iter->second.empty()) {
+        last_on_topic = true;
+        rmw_subscription_data_t::zn_topic_to_sub_data.erase(map_iter);
+        rmw_subscription_data_t::zn_topic_to_delta_streams.erase(key);
+        rmw_subscription_data_t::zn_topic_to_duplicate_filter.erase(key);
+      }
+    }
+  }
+
+  if (!found) {
     RCUTILS_LOG_WARN_NAMED(
       "rmw_zenoh_common_cpp",
       "subscription not found in Zenoh topic to subscription data map! %s",
       subscription->topic_name);
   } else {
-    // Delete the subscription data pointer in the Zenoh topic to subscription data map
-    for (auto it = map_iter->second.begin(); it != map_iter->second.end(); ++it) {
-      if ((*it)->subscription_id_ == subscription_data->subscription_id_) {
-        map_iter->second.erase(it);
-        break;
-      }
-    }
-
-    // Delete the map element if no other subscription data pointers exist
-    // (That is, when no other subscriptions are listening to the Zenoh topic)
-    if (map_iter->second.empty()) {
+    if (last_on_topic) {
       RCUTILS_LOG_DEBUG_NAMED(
         "rmw_zenoh_common_cpp",
         "[rmw_destroy_subscription] No more subscriptions listening to %s",
@@ -300,8 +447,6 @@ rmw_zenoh_common_destroy_subscription(
         "rmw_zenoh_common_cpp",
         "[rmw_destroy_subscription] Zenoh subcriber undeclared for %s",
         subscription->topic_name);
-
-      rmw_subscription_data_t::zn_topic_to_sub_data.erase(map_iter);
     }
 
     RCUTILS_LOG_DEBUG_NAMED(
@@ -312,11 +457,77 @@ rmw_zenoh_common_destroy_subscription(
   }
 
   // CLEANUP ===================================================================
-  allocator->deallocate(subscription_data->type_support_, allocator->state);
-  allocator->deallocate(subscription->data, allocator->state);
+  // Wait out a direct dispatch callback in progress. The receiving thread may still hold on to the
+  // dispatcher, but will not call the callback again.
+  subscription_data->direct_dispatcher_->set(nullptr, nullptr, nullptr);
+
+  // Messages still on loan cannot outlive the subscription
+  rcutils_allocator_t * allocator = &node->context->options.allocator;
+  for (auto & loan : subscription_data->loaned_messages_) {
+    rmw_zenoh_common_cpp::SerializationPlan::release_views(loan.second.views);
+    subscription_data->type_support_->getPlan()->fini_message(loan.first);
+    allocator->deallocate(loan.first, allocator->state);
+  }
+  subscription_data->loaned_messages_.clear();
+
+  arena->deallocate(
+    subscription_data->type_support_, sizeof(rmw_zenoh_common_cpp::MessageTypeSupport));
+
+  // Destruct the queue so any samples still in it go back to the receive buffer pool
+  delete subscription_data->reorder_buffer_;
+  delete subscription_data->latency_monitor_;
+  subscription_data->~rmw_subscription_data_t();
+  arena->deallocate(subscription->data, sizeof(rmw_subscription_data_t));
 
-  allocator->deallocate(const_cast<char *>(subscription->topic_name), allocator->state);
-  allocator->deallocate(subscription, allocator->state);
+  arena->deallocate_string(subscription->topic_name);
+  arena->deallocate(subscription, sizeof(rmw_subscription_t));
+
+  return RMW_RET_OK;
+}
+
+/// PREPARE SUBSCRIPTION ALLOCATION ============================================
+// Validate an allocation passed to take, and make sure the context's receive buffer pool holds
+// enough buffers of the maximum message size to fill the subscription's queue.
+//
+// The buffers are only reserved the first time the allocation is used with a subscription.
+static rmw_ret_t
+prepare_subscription_allocation(
+  const rmw_subscription_t * subscription,
+  rmw_subscription_allocation_t * allocation,
+  const char * const eclipse_zenoh_identifier)
+{
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation->data, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    allocation,
+    allocation->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  auto * subscription_data = static_cast<rmw_subscription_data_t *>(subscription->data);
+  auto * allocation_data = static_cast<rmw_subscription_allocation_data_t *>(allocation->data);
+
+  if (allocation_data->type_support_impl_ != subscription_data->type_support_impl_) {
+    RMW_SET_ERROR_MSG("subscription allocation was initialized for a different message type");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  if (allocation_data->reserved_for_ == subscription_data || !allocation_data->bounded_) {
+    return RMW_RET_OK;
+  }
+
+  // One buffer per queued message, plus the one being deserialized
+  rmw_zenoh_common_cpp::ReceiveBufferPool * pool =
+    subscription_data->node_->context->impl->rx_buffer_pool;
+  if (!pool->reserve(
+      allocation_data->max_serialized_size_, subscription_data->queue_depth_ + 1))
+  {
+    RCUTILS_LOG_WARN_NAMED(
+      "rmw_zenoh_common_cpp",
+      "[rmw_take] could not reserve receive buffers of %zu bytes for %s",
+      allocation_data->max_serialized_size_,
+      subscription->topic_name);
+  }
+  allocation_data->reserved_for_ = subscription_data;
 
   return RMW_RET_OK;
 }
@@ -331,7 +542,6 @@ rmw_zenoh_common_take(
   rmw_subscription_allocation_t * allocation,
   const char * const eclipse_zenoh_identifier)
 {
-  (void)allocation;
   *taken = false;
 
   RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "rmw_take");
@@ -350,15 +560,24 @@ rmw_zenoh_common_take(
   RMW_CHECK_ARGUMENT_FOR_NULL(subscription->data, RMW_RET_ERROR);
   RMW_CHECK_ARGUMENT_FOR_NULL(subscription->topic_name, RMW_RET_INVALID_ARGUMENT);
 
+  if (allocation) {
+    rmw_ret_t ret = prepare_subscription_allocation(
+      subscription, allocation, eclipse_zenoh_identifier);
+    if (ret != RMW_RET_OK) {
+      return ret;
+    }
+  }
+
   // OBTAIN SUBSCRIPTION MEMBERS ===============================================
   auto * subscription_data = static_cast<rmw_subscription_data_t *>(subscription->data);
 
-  // OBTAIN ALLOCATOR ==========================================================
-  rcutils_allocator_t * allocator = &subscription_data->node_->context->options.allocator;
-
   // RETRIEVE SERIALIZED MESSAGE ===============================================
   std::unique_lock<std::mutex> lock(subscription_data->message_queue_mutex_);
 
+  // Whatever this finds, the claim of the wait that woke the caller is used up
+  subscription_data->ready_claims_.release();
+  subscription_data->release_reordered_samples();
+
   if (subscription_data->zn_message_queue_.empty()) {
     // NOTE(CH3): It is correct to be returning RMW_RET_OK. The information that the message
     // was not found is encoded in the fact that the taken-out parameter is still False.
@@ -368,32 +587,30 @@ rmw_zenoh_common_take(
   }
 
   // NOTE(CH3): Potential place to handle "QoS" (e.g. could pop from back so it is LIFO)
-  auto msg_bytes_ptr = subscription_data->zn_message_queue_.back();
-  subscription_data->zn_message_queue_.pop_back();
+  auto msg_buffer = subscription_data->zn_message_queue_.pop();
+  subscription_data->ready_claims_.set_available(subscription_data->zn_message_queue_.size());
+  subscription_data->record_latency(msg_buffer);
+  subscription_data->record_queue_delay(msg_buffer);
 
-  subscription_data->message_queue_mutex_.unlock();
+  lock.unlock();
 
   RCUTILS_LOG_DEBUG_NAMED(
     "rmw_zenoh_common_cpp",
     "[rmw_take] Message found: %s",
     subscription->topic_name);
 
+  rmw_zenoh_common_cpp::trace_call(
+    rmw_zenoh_common_cpp::TraceEvent::kTake, subscription, msg_buffer->size());
+
   // DESERIALIZE MESSAGE =======================================================
   //
-  // NOTE(CH3): Potential place for optimisation (Eliminate repeated copies and deserialisations)
+  // NOTE: The message is deserialized straight out of the pooled receive buffer. The buffer may be
+  // shared with the other subscriptions on this topic, but it is only ever read from.
   //
-  // If multiple subscribers are looking at this message, the message can just be deserialised
-  // once.
-  //
-  // But that will mean tracking the serialisation state of the message (perhaps with a pair?)
-  unsigned char * cdr_buffer = static_cast<unsigned char *>(
-    allocator->allocate(msg_bytes_ptr->size(), allocator->state));
-  memcpy(cdr_buffer, &msg_bytes_ptr->front(), msg_bytes_ptr->size());
-
   // Object that manages the raw buffer
   eprosima::fastcdr::FastBuffer fastbuffer(
-    reinterpret_cast<char *>(cdr_buffer),
-    msg_bytes_ptr->size());
+    reinterpret_cast<char *>(msg_buffer->data()),
+    msg_buffer->size());
 
   // Object that serializes the data
   eprosima::fastcdr::Cdr deser(
@@ -410,7 +627,6 @@ rmw_zenoh_common_take(
   }
 
   *taken = true;
-  allocator->deallocate(cdr_buffer, allocator->state);
 
   return RMW_RET_OK;
 }
@@ -436,7 +652,6 @@ rmw_zenoh_common_take_with_info(
   rmw_subscription_allocation_t * allocation,
   const char * const eclipse_zenoh_identifier)
 {
-  (void)allocation;
   *taken = false;
 
   RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "rmw_take_with_info");
@@ -456,15 +671,24 @@ rmw_zenoh_common_take_with_info(
   RMW_CHECK_ARGUMENT_FOR_NULL(subscription->topic_name, RMW_RET_ERROR);
   RMW_CHECK_ARGUMENT_FOR_NULL(subscription->data, RMW_RET_ERROR);
 
+  if (allocation) {
+    rmw_ret_t ret = prepare_subscription_allocation(
+      subscription, allocation, eclipse_zenoh_identifier);
+    if (ret != RMW_RET_OK) {
+      return ret;
+    }
+  }
+
   // OBTAIN SUBSCRIPTION MEMBERS ===============================================
   auto * subscription_data = static_cast<rmw_subscription_data_t *>(subscription->data);
 
-  // OBTAIN ALLOCATOR ==========================================================
-  rcutils_allocator_t * allocator = &subscription_data->node_->context->options.allocator;
-
   // RETRIEVE SERIALIZED MESSAGE ===============================================
   std::unique_lock<std::mutex> lock(subscription_data->message_queue_mutex_);
 
+  // Whatever this finds, the claim of the wait that woke the caller is used up
+  subscription_data->ready_claims_.release();
+  subscription_data->release_reordered_samples();
+
   if (subscription_data->zn_message_queue_.empty()) {
     // NOTE(CH3): It is correct to be returning RMW_RET_OK. The information that the message
     // was not found is encoded in the fact that the taken-out parameter is still False.
@@ -474,33 +698,30 @@ rmw_zenoh_common_take_with_info(
   }
 
   // NOTE(CH3): Potential place to handle "QoS" (e.g. could pop from back so it is LIFO)
-  auto msg_bytes_ptr = subscription_data->zn_message_queue_.back();
-  subscription_data->zn_message_queue_.pop_back();
+  auto msg_buffer = subscription_data->zn_message_queue_.pop();
+  subscription_data->ready_claims_.set_available(subscription_data->zn_message_queue_.size());
+  subscription_data->record_latency(msg_buffer);
+  subscription_data->record_queue_delay(msg_buffer);
 
-  subscription_data->message_queue_mutex_.unlock();
+  lock.unlock();
 
   RCUTILS_LOG_DEBUG_NAMED(
     "rmw_zenoh_common_cpp",
     "[rmw_take] Message found: %s",
     subscription->topic_name);
 
+  rmw_zenoh_common_cpp::trace_call(
+    rmw_zenoh_common_cpp::TraceEvent::kTake, subscription, msg_buffer->size());
+
   // DESERIALIZE MESSAGE =======================================================
   //
-  // NOTE(CH3): Potential place for optimisation (Eliminate repeated copies and deserialisations)
+  // NOTE: The message is deserialized straight out of the pooled receive buffer. The buffer may be
+  // shared with the other subscriptions on this topic, but it is only ever read from.
   //
-  // If multiple subscribers are looking at this message, the message can just be deserialised
-  // once.
-  //
-  // But that will mean tracking the serialisation state of the message (perhaps with a pair?)
-  unsigned char * cdr_buffer = static_cast<unsigned char *>(allocator->allocate(
-      msg_bytes_ptr->size(),
-      allocator->state));
-  memcpy(cdr_buffer, &msg_bytes_ptr->front(), msg_bytes_ptr->size());
-
   // Object that manages the raw buffer
   eprosima::fastcdr::FastBuffer fastbuffer(
-    reinterpret_cast<char *>(cdr_buffer),
-    msg_bytes_ptr->size());
+    reinterpret_cast<char *>(msg_buffer->data()),
+    msg_buffer->size());
 
   // Object that serializes the data
   eprosima::fastcdr::Cdr deser(
@@ -517,31 +738,106 @@ rmw_zenoh_common_take_with_info(
   }
 
   *taken = true;
-  allocator->deallocate(cdr_buffer, allocator->state);
 
   return RMW_RET_OK;
 }
 
-/// UNIMPLEMENTED ==============================================================
+/// INIT SUBSCRIPTION ALLOCATION ==============================================
+// Record the maximum serialized size of the type, to size the receive buffers to reserve for it.
+//
+// NOTE: rosidl_runtime_c__Sequence__bound does not carry any sizes yet, so the bounds are taken
+// from the type support instead (which knows the bounds of every bounded sequence and string).
 rmw_ret_t
-rmw_init_subscription_allocation(
-  const rosidl_message_type_support_t * type_support,
+rmw_zenoh_common_init_subscription_allocation(
+  const rosidl_message_type_support_t * type_supports,
   const rosidl_runtime_c__Sequence__bound * message_bounds,
-  rmw_subscription_allocation_t * allocation)
+  rmw_subscription_allocation_t * allocation,
+  const char * const eclipse_zenoh_identifier)
 {
-  (void)type_support;
   (void)message_bounds;
-  (void)allocation;
   RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "rmw_init_subscription_allocation");
-  return RMW_RET_UNSUPPORTED;
+
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(type_supports, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
+
+  if (allocation->data) {
+    RMW_SET_ERROR_MSG("subscription allocation already initialized");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  // OBTAIN TYPESUPPORT ========================================================
+  const rosidl_message_type_support_t * type_support = get_message_typesupport_handle(
+    type_supports, RMW_ZENOH_CPP_TYPESUPPORT_C);
+
+  if (!type_support) {
+    type_support = get_message_typesupport_handle(type_supports, RMW_ZENOH_CPP_TYPESUPPORT_CPP);
+    if (!type_support) {
+      RMW_SET_ERROR_MSG("type support not from this implementation");
+      return RMW_RET_INVALID_ARGUMENT;
+    }
+  }
+
+  auto callbacks = static_cast<const message_type_support_callbacks_t *>(type_support->data);
+  rmw_zenoh_common_cpp::MessageTypeSupport message_type_support(callbacks);
+
+  // CREATE ALLOCATION =========================================================
+  // NOTE: There is no context to take the allocator from, so the default one is used
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+
+  auto allocation_data = static_cast<rmw_subscription_allocation_data_t *>(
+    allocator.allocate(sizeof(rmw_subscription_allocation_data_t), allocator.state));
+  if (!allocation_data) {
+    RMW_SET_ERROR_MSG("failed to allocate subscription allocation data");
+    return RMW_RET_BAD_ALLOC;
+  }
+
+  allocation_data->type_support_impl_ = type_support->data;
+  allocation_data->max_serialized_size_ = message_type_support.getMaxSerializedSize();
+  allocation_data->bounded_ = message_type_support.isBounded();
+  allocation_data->reserved_for_ = nullptr;
+
+  if (!allocation_data->bounded_) {
+    RCUTILS_LOG_WARN_NAMED(
+      "rmw_zenoh_common_cpp",
+      "[rmw_init_subscription_allocation] %s::%s is not bounded, "
+      "so no receive buffers can be reserved for it",
+      callbacks->message_namespace_,
+      callbacks->message_name_);
+  }
+
+  allocation->implementation_identifier = eclipse_zenoh_identifier;
+  allocation->data = allocation_data;
+  return RMW_RET_OK;
 }
 
+/// FINI SUBSCRIPTION ALLOCATION ===============================================
+// NOTE: Receive buffers reserved for the allocation stay in the pool, they are still of use to
+// the subscriptions they were reserved for.
 rmw_ret_t
-rmw_fini_subscription_allocation(rmw_subscription_allocation_t * allocation)
+rmw_zenoh_common_fini_subscription_allocation(
+  rmw_subscription_allocation_t * allocation,
+  const char * const eclipse_zenoh_identifier)
 {
-  (void)allocation;
   RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "rmw_fini_subscription_allocation");
-  return RMW_RET_UNSUPPORTED;
+
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(allocation->data, RMW_RET_INVALID_ARGUMENT);
+
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    allocation,
+    allocation->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  // CLEANUP ===================================================================
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  allocator.deallocate(allocation->data, allocator.state);
+
+  allocation->implementation_identifier = nullptr;
+  allocation->data = nullptr;
+  return RMW_RET_OK;
 }
 
 rmw_ret_t
@@ -593,6 +889,7 @@ rmw_zenoh_common_subscription_get_actual_qos(
   return RMW_RET_OK;
 }
 
+/// UNIMPLEMENTED ==============================================================
 rmw_ret_t
 rmw_take_serialized_message(
   const rmw_subscription_t * subscription,
@@ -625,47 +922,205 @@ rmw_take_serialized_message_with_info(
   return RMW_RET_UNSUPPORTED;
 }
 
+/// TAKE LOANED MESSAGE =======================================================
+// Take a message out of the message queue into a message allocated for the caller, with its
+// sequences of primitives left pointing into the sample buffer (read-only, since the buffer may be
+// shared with the other subscriptions on the topic). The buffer stays pinned until the message is
+// returned with rmw_return_loaned_message_from_subscription.
+static rmw_ret_t
+take_loaned_message(
+  const rmw_subscription_t * subscription,
+  void ** loaned_message,
+  bool * taken,
+  rmw_subscription_allocation_t * allocation,
+  const char * const eclipse_zenoh_identifier)
+{
+  *taken = false;
+
+  // ASSERTIONS ================================================================
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(loaned_message, RMW_RET_INVALID_ARGUMENT);
+
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    subscription,
+    subscription->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription->data, RMW_RET_ERROR);
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription->topic_name, RMW_RET_ERROR);
+
+  if (*loaned_message) {
+    RMW_SET_ERROR_MSG("loaned message is not null");
+    return RMW_RET_INVALID_ARGUMENT;
+  }
+
+  if (!subscription->can_loan_messages) {
+    RMW_SET_ERROR_MSG(
+      "subscription cannot loan messages: only C messages without wide strings, long doubles, "
+      "or sequences of strings or messages can be loaned");
+    return RMW_RET_UNSUPPORTED;
+  }
+
+  if (allocation) {
+    rmw_ret_t ret = prepare_subscription_allocation(
+      subscription, allocation, eclipse_zenoh_identifier);
+    if (ret != RMW_RET_OK) {
+      return ret;
+    }
+  }
+
+  // OBTAIN SUBSCRIPTION MEMBERS ===============================================
+  auto * subscription_data = static_cast<rmw_subscription_data_t *>(subscription->data);
+  const rmw_zenoh_common_cpp::SerializationPlan * plan =
+    subscription_data->type_support_->getPlan();
+  rcutils_allocator_t * allocator = &subscription_data->node_->context->options.allocator;
+
+  // RETRIEVE SERIALIZED MESSAGE ===============================================
+  std::unique_lock<std::mutex> lock(subscription_data->message_queue_mutex_);
+
+  // Whatever this finds, the claim of the wait that woke the caller is used up
+  subscription_data->ready_claims_.release();
+  subscription_data->release_reordered_samples();
+
+  if (subscription_data->zn_message_queue_.empty()) {
+    return RMW_RET_OK;
+  }
+
+  auto msg_buffer = subscription_data->zn_message_queue_.pop();
+  subscription_data->ready_claims_.set_available(subscription_data->zn_message_queue_.size());
+  subscription_data->record_latency(msg_buffer);
+  subscription_data->record_queue_delay(msg_buffer);
+
+  lock.unlock();
+
+  RCUTILS_LOG_DEBUG_NAMED(
+    "rmw_zenoh_common_cpp",
+    "[rmw_take_loaned_message] Message found: %s",
+    subscription->topic_name);
+
+  rmw_zenoh_common_cpp::trace_call(
+    rmw_zenoh_common_cpp::TraceEvent::kTake, subscription, msg_buffer->size());
+
+  // DESERIALIZE MESSAGE =======================================================
+  void * ros_message = allocator->allocate(plan->message_size(), allocator->state);
+  if (!ros_message) {
+    RMW_SET_ERROR_MSG("failed to allocate loaned message");
+    return RMW_RET_BAD_ALLOC;
+  }
+  plan->init_message(ros_message);
+
+  eprosima::fastcdr::FastBuffer fastbuffer(
+    reinterpret_cast<char *>(msg_buffer->data()),
+    msg_buffer->size());
+
+  eprosima::fastcdr::Cdr deser(
+    fastbuffer,
+    eprosima::fastcdr::Cdr::DEFAULT_ENDIAN,
+    eprosima::fastcdr::Cdr::DDS_CDR);
+
+  rmw_subscription_data_t::LoanedMessage loan;
+  if (!subscription_data->type_support_->deserializeLoanedROSmessage(
+      deser,
+      ros_message,
+      loan.views,
+      subscription_data->type_support_impl_))
+  {
+    rmw_zenoh_common_cpp::SerializationPlan::release_views(loan.views);
+    plan->fini_message(ros_message);
+    allocator->deallocate(ros_message, allocator->state);
+    RMW_SET_ERROR_MSG("could not deserialize ROS message");
+    return RMW_RET_ERROR;
+  }
+
+  // Only messages with views need to keep their sample buffer
+  if (!loan.views.empty()) {
+    loan.buffer = std::move(msg_buffer);
+  }
+
+  {
+    std::lock_guard<std::mutex> loans_lock(subscription_data->loaned_messages_mutex_);
+    subscription_data->loaned_messages_.emplace(ros_message, std::move(loan));
+  }
+
+  *loaned_message = ros_message;
+  *taken = true;
+
+  return RMW_RET_OK;
+}
+
 rmw_ret_t
-rmw_take_loaned_message(
+rmw_zenoh_common_take_loaned_message(
   const rmw_subscription_t * subscription,
   void ** loaned_message,
   bool * taken,
-  rmw_subscription_allocation_t * allocation)
+  rmw_subscription_allocation_t * allocation,
+  const char * const eclipse_zenoh_identifier)
 {
-  (void)subscription;
-  (void)loaned_message;
-  (void)taken;
-  (void)allocation;
-  RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "rmw_take_loaned_message (Unsupported)");
-  return RMW_RET_UNSUPPORTED;
+  RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "rmw_take_loaned_message");
+  RMW_CHECK_ARGUMENT_FOR_NULL(taken, RMW_RET_INVALID_ARGUMENT);
+
+  return take_loaned_message(
+    subscription, loaned_message, taken, allocation, eclipse_zenoh_identifier);
 }
 
+// NOTE: The message info is left unfilled, as in rmw_zenoh_common_take_with_info
 rmw_ret_t
 rmw_zenoh_common_take_loaned_message_with_info(
   const rmw_subscription_t * subscription,
   void ** loaned_message,
   bool * taken,
   rmw_message_info_t * message_info,
-  rmw_subscription_allocation_t * allocation)
+  rmw_subscription_allocation_t * allocation,
+  const char * const eclipse_zenoh_identifier)
 {
-  (void)subscription;
-  (void)loaned_message;
-  (void)taken;
-  (void)message_info;
-  (void)allocation;
-  RCUTILS_LOG_DEBUG_NAMED(
-    "rmw_zenoh_common_cpp",
-    "rmw_take_loaned_message_with_info (Unsupported)");
-  return RMW_RET_UNSUPPORTED;
+  RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "rmw_take_loaned_message_with_info");
+  RMW_CHECK_ARGUMENT_FOR_NULL(taken, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(message_info, RMW_RET_INVALID_ARGUMENT);
+
+  return take_loaned_message(
+    subscription, loaned_message, taken, allocation, eclipse_zenoh_identifier);
 }
 
+/// RETURN LOANED MESSAGE ======================================================
+// Finalize and free a message taken with rmw_take_loaned_message, unpinning its sample buffer
 rmw_ret_t
 rmw_zenoh_common_return_loaned_message_from_subscription(
   const rmw_subscription_t * subscription,
-  void * loaned_message)
+  void * loaned_message,
+  const char * const eclipse_zenoh_identifier)
 {
-  (void)subscription;
-  (void)loaned_message;
   RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "rmw_return_loaned_message_from_subscription");
-  return RMW_RET_UNSUPPORTED;
+
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_TYPE_IDENTIFIERS_MATCH(
+    subscription,
+    subscription->implementation_identifier,
+    eclipse_zenoh_identifier,
+    return RMW_RET_INCORRECT_RMW_IMPLEMENTATION);
+  RMW_CHECK_ARGUMENT_FOR_NULL(loaned_message, RMW_RET_INVALID_ARGUMENT);
+  RMW_CHECK_ARGUMENT_FOR_NULL(subscription->data, RMW_RET_ERROR);
+
+  auto * subscription_data = static_cast<rmw_subscription_data_t *>(subscription->data);
+  rcutils_allocator_t * allocator = &subscription_data->node_->context->options.allocator;
+
+  rmw_subscription_data_t::LoanedMessage loan;
+  {
+    std::lock_guard<std::mutex> loans_lock(subscription_data->loaned_messages_mutex_);
+    auto it = subscription_data->loaned_messages_.find(loaned_message);
+    if (it == subscription_data->loaned_messages_.end()) {
+      RMW_SET_ERROR_MSG("message was not loaned by this subscription");
+      return RMW_RET_INVALID_ARGUMENT;
+    }
+    loan = std::move(it->second);
+    subscription_data->loaned_messages_.erase(it);
+  }
+
+  // The views must be detached before finalizing, which would otherwise free the sample buffer
+  rmw_zenoh_common_cpp::SerializationPlan::release_views(loan.views);
+  subscription_data->type_support_->getPlan()->fini_message(loaned_message);
+  allocator->deallocate(loaned_message, allocator->state);
+
+  // The sample buffer goes back to the receive buffer pool with the loan
+  return RMW_RET_OK;
 }
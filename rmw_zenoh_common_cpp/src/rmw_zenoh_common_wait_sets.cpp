@@ -24,6 +24,7 @@
 #include "rmw/event.h"
 
 #include "impl/wait_impl.hpp"
+#include "impl/trace_recorder.hpp"
 
 #include "rmw_zenoh_common_cpp/rmw_zenoh_common.h"
 
@@ -180,6 +181,10 @@ rmw_wait(
   // to create a static mutex in something like wait_impl.cpp, assign it in here, pass it in to
   // each static callback function, and then unassign it later on.
 
+  // The time blocked is traced, for reference (waits are not replayed)
+  rmw_zenoh_common_cpp::TraceRecorder * recorder = rmw_zenoh_common_cpp::TraceRecorder::get();
+  int64_t wait_start = recorder ? recorder->now() : 0;
+
   // CHECK WAIT CONDITIONS =====================================================
   std::unique_lock<std::mutex> lock(*condition_mutex);
 
@@ -227,6 +232,12 @@ rmw_wait(
   check_wait_conditions(subscriptions, guard_conditions, services, clients, events, true);
   lock.unlock();
 
+  if (recorder) {
+    recorder->record(
+      rmw_zenoh_common_cpp::TraceEvent::kWait, nullptr,
+      static_cast<uint64_t>(recorder->now() - wait_start), wait_start);
+  }
+
   if (timed_out) {
     RCUTILS_LOG_DEBUG_NAMED("rmw_zenoh_common_cpp", "[rmw_wait] TIMED OUT");
     return RMW_RET_TIMEOUT;
@@ -0,0 +1,421 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Matching latency benchmark: how long after an endpoint is created it is matched with its peers,
+// with a number of unrelated endpoints already in the system.
+//
+// Measured, each from the creation of the endpoint on one session to the moment another session
+// (in the same process) sees it:
+// - subscription: the first message of a publisher that was already publishing is taken
+// - publisher: the first message of a new publisher is taken by an existing subscription
+// - service: rmw_service_server_is_available() is true for an existing client
+// - graph: rmw_count_publishers() counts the new publisher
+//
+// colcon test only measures each latency once, without pre-existing endpoints. The mode and
+// router come from RMW_ZENOH_MODE and RMW_ZENOH_SESSION_LOCATOR, so run it once per mode.
+// RMW_ZENOH_BENCHMARK_ENDPOINTS lists the numbers of pre-existing endpoints (0,10,100,1000,5000
+// by default), RMW_ZENOH_BENCHMARK_REPETITIONS how often each latency is measured (10 by
+// default), and RMW_ZENOH_BENCHMARK_TIMEOUT after how many seconds a measurement is given up (10
+// by default). The results are printed as CSV, in milliseconds. If RMW_ZENOH_BENCHMARK_PERF is 1,
+// the hardware counters and scheduling statistics of the threads of the process (see
+// perf_counters.hpp) are added, per measurement.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/rmw.h"
+#include "rmw/error_handling.h"
+
+#include "test_msgs/msg/basic_types.h"
+#include "test_msgs/srv/basic_types.h"
+
+#include "./perf_counters.hpp"
+
+#ifdef RMW_IMPLEMENTATION
+# define CLASSNAME_(NAME, SUFFIX) NAME ## __ ## SUFFIX
+# define CLASSNAME(NAME, SUFFIX) CLASSNAME_(NAME, SUFFIX)
+#else
+# define CLASSNAME(NAME, SUFFIX) NAME
+#endif
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::chrono::milliseconds kPollPeriod{1};
+
+std::vector<size_t> env_list(const char * name, const std::vector<size_t> & default_value)
+{
+  const char * value = std::getenv(name);
+  if (!value || !*value) {
+    return default_value;
+  }
+  std::vector<size_t> list;
+  std::stringstream stream(value);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    list.push_back(std::strtoull(item.c_str(), nullptr, 10));
+  }
+  return list;
+}
+
+size_t env_size(const char * name, size_t default_value)
+{
+  std::vector<size_t> list = env_list(name, {default_value});
+  return list.empty() || list.front() == 0 ? default_value : list.front();
+}
+
+// Latencies of a measurement, in milliseconds (negative if the measurement timed out)
+struct Latencies
+{
+  std::vector<double> values;
+  bool unsupported = false;
+  PerfCounters::Thread perf;  // Over all the measurements
+
+  void print(const char * mode, size_t endpoints, const char * measurement) const
+  {
+    std::vector<double> sorted;
+    for (double value : values) {
+      if (value >= 0) {
+        sorted.push_back(value);
+      }
+    }
+    std::sort(sorted.begin(), sorted.end());
+    size_t timeouts = values.size() - sorted.size();
+    if (unsupported || sorted.empty()) {
+      printf("%s,%zu,%s,,,,,%zu", mode, endpoints, measurement, timeouts);
+    } else {
+      auto percentile = [&sorted](double p) {
+          return sorted[static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5)];
+        };
+      printf(
+        "%s,%zu,%s,%.2f,%.2f,%.2f,%.2f,%zu", mode, endpoints, measurement, sorted.front(),
+        percentile(0.5), percentile(0.9), sorted.back(), timeouts);
+    }
+    if (PerfCounters::enabled()) {
+      double measurements = static_cast<double>(values.size());
+      for (int64_t count : perf.counts) {
+        if (count >= 0 && measurements > 0) {
+          printf(",%.0f", static_cast<double>(count) / measurements);
+        } else {
+          printf(",");
+        }
+      }
+      printf(",%.0f", measurements > 0 ? perf.cpu_seconds * 1e6 / measurements : 0);
+    }
+    printf("%s\n", unsupported ? ",unsupported" : "");
+  }
+};
+
+double elapsed_ms(Clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+}  // namespace
+
+class CLASSNAME (BenchmarkMatchingLatency, RMW_IMPLEMENTATION) : public ::testing::Test
+{
+protected:
+  struct Session
+  {
+    rmw_init_options_t init_options{rmw_get_zero_initialized_init_options()};
+    rmw_context_t context{rmw_get_zero_initialized_context()};
+    rmw_node_t * node{nullptr};
+  };
+
+  void SetUp() override
+  {
+    // One session holds the pre-existing endpoints, and the other two the measured ones
+    for (Session * session : {&background, &local, &remote}) {
+      rmw_ret_t ret =
+        rmw_init_options_init(&session->init_options, rcutils_get_default_allocator());
+      ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+      session->init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+      ASSERT_STREQ("/", session->init_options.enclave);
+      ret = rmw_init(&session->init_options, &session->context);
+      ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+      session->node = rmw_create_node(&session->context, "benchmark", "/matching", 0, false);
+      ASSERT_NE(nullptr, session->node) << rcutils_get_error_string().str;
+    }
+    msg_ts = ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+    srv_ts = ROSIDL_GET_SRV_TYPE_SUPPORT(test_msgs, srv, BasicTypes);
+    ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&message));
+  }
+
+  void TearDown() override
+  {
+    test_msgs__msg__BasicTypes__fini(&message);
+    for (rmw_publisher_t * pub : background_publishers) {
+      EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(background.node, pub));
+    }
+    for (rmw_subscription_t * sub : background_subscriptions) {
+      EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(background.node, sub));
+    }
+    for (Session * session : {&background, &local, &remote}) {
+      if (session->node) {
+        EXPECT_EQ(RMW_RET_OK, rmw_destroy_node(session->node)) << rmw_get_error_string().str;
+      }
+      if (session->context.impl) {
+        EXPECT_EQ(RMW_RET_OK, rmw_shutdown(&session->context)) << rmw_get_error_string().str;
+        EXPECT_EQ(RMW_RET_OK, rmw_context_fini(&session->context)) <<
+          rmw_get_error_string().str;
+      }
+      if (session->init_options.implementation_identifier) {
+        EXPECT_EQ(RMW_RET_OK, rmw_init_options_fini(&session->init_options)) <<
+          rmw_get_error_string().str;
+      }
+    }
+  }
+
+  // Add pre-existing endpoints (half publishers, half subscriptions) until there are count
+  void add_background_endpoints(size_t count)
+  {
+    rmw_publisher_options_t publisher_options = rmw_get_default_publisher_options();
+    rmw_subscription_options_t subscription_options = rmw_get_default_subscription_options();
+    for (size_t i = background_publishers.size() + background_subscriptions.size(); i < count;
+      ++i)
+    {
+      std::string topic = "/matching/background_" + std::to_string(i);
+      if (i % 2 == 0) {
+        rmw_publisher_t * pub = rmw_create_publisher(
+          background.node, msg_ts, topic.c_str(), &rmw_qos_profile_default, &publisher_options);
+        ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+        background_publishers.push_back(pub);
+      } else {
+        rmw_subscription_t * sub = rmw_create_subscription(
+          background.node, msg_ts, topic.c_str(), &rmw_qos_profile_default,
+          &subscription_options);
+        ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
+        background_subscriptions.push_back(sub);
+      }
+    }
+  }
+
+  rmw_publisher_t * create_publisher(Session & session, const std::string & topic)
+  {
+    rmw_publisher_options_t options = rmw_get_default_publisher_options();
+    rmw_publisher_t * pub = rmw_create_publisher(
+      session.node, msg_ts, topic.c_str(), &rmw_qos_profile_default, &options);
+    EXPECT_NE(nullptr, pub) << rmw_get_error_string().str;
+    return pub;
+  }
+
+  rmw_subscription_t * create_subscription(Session & session, const std::string & topic)
+  {
+    rmw_subscription_options_t options = rmw_get_default_subscription_options();
+    rmw_subscription_t * sub = rmw_create_subscription(
+      session.node, msg_ts, topic.c_str(), &rmw_qos_profile_default, &options);
+    EXPECT_NE(nullptr, sub) << rmw_get_error_string().str;
+    return sub;
+  }
+
+  // Publish every poll period until the subscription takes a message.
+  // Returns the milliseconds since start, or -1 on timeout.
+  double first_message(rmw_publisher_t * pub, rmw_subscription_t * sub, Clock::time_point start)
+  {
+    while (Clock::now() - start < timeout) {
+      rmw_publish(pub, &message, nullptr);
+      bool taken = false;
+      if (rmw_take(sub, &message, &taken, nullptr) == RMW_RET_OK && taken) {
+        return elapsed_ms(start);
+      }
+      rmw_reset_error();
+      std::this_thread::sleep_for(kPollPeriod);
+    }
+    return -1;
+  }
+
+  // Add a measurement to latencies, with the counters over it if they are collected
+  template<typename MeasureT>
+  void measure(Latencies & latencies, MeasureT measure)
+  {
+    if (!PerfCounters::enabled()) {
+      latencies.values.push_back(measure());
+      return;
+    }
+    PerfCounters perf;
+    perf.start();
+    latencies.values.push_back(measure());
+    latencies.perf = PerfCounters::total({latencies.perf, PerfCounters::total(perf.stop())});
+  }
+
+  double measure_subscription(const std::string & topic)
+  {
+    rmw_publisher_t * pub = create_publisher(remote, topic);
+    if (!pub) {
+      return -1;
+    }
+    Clock::time_point start = Clock::now();
+    rmw_subscription_t * sub = create_subscription(local, topic);
+    double latency = sub ? first_message(pub, sub, start) : -1;
+    if (sub) {
+      rmw_destroy_subscription(local.node, sub);
+    }
+    rmw_destroy_publisher(remote.node, pub);
+    return latency;
+  }
+
+  double measure_publisher(const std::string & topic)
+  {
+    rmw_subscription_t * sub = create_subscription(local, topic);
+    if (!sub) {
+      return -1;
+    }
+    Clock::time_point start = Clock::now();
+    rmw_publisher_t * pub = create_publisher(remote, topic);
+    double latency = pub ? first_message(pub, sub, start) : -1;
+    if (pub) {
+      rmw_destroy_publisher(remote.node, pub);
+    }
+    rmw_destroy_subscription(local.node, sub);
+    return latency;
+  }
+
+  double measure_service(const std::string & name)
+  {
+    rmw_client_t * client =
+      rmw_create_client(local.node, srv_ts, name.c_str(), &rmw_qos_profile_services_default);
+    EXPECT_NE(nullptr, client) << rmw_get_error_string().str;
+    if (!client) {
+      return -1;
+    }
+    Clock::time_point start = Clock::now();
+    rmw_service_t * service =
+      rmw_create_service(remote.node, srv_ts, name.c_str(), &rmw_qos_profile_services_default);
+    EXPECT_NE(nullptr, service) << rmw_get_error_string().str;
+    double latency = -1;
+    while (service && Clock::now() - start < timeout) {
+      bool available = false;
+      if (rmw_service_server_is_available(local.node, client, &available) == RMW_RET_OK &&
+        available)
+      {
+        latency = elapsed_ms(start);
+        break;
+      }
+      rmw_reset_error();
+      std::this_thread::sleep_for(kPollPeriod);
+    }
+    if (service) {
+      rmw_destroy_service(remote.node, service);
+    }
+    rmw_destroy_client(local.node, client);
+    return latency;
+  }
+
+  double measure_graph(const std::string & topic, bool & unsupported)
+  {
+    Clock::time_point start = Clock::now();
+    rmw_publisher_t * pub = create_publisher(remote, topic);
+    if (!pub) {
+      return -1;
+    }
+    double latency = -1;
+    while (Clock::now() - start < timeout) {
+      size_t count = 0;
+      rmw_ret_t ret = rmw_count_publishers(local.node, topic.c_str(), &count);
+      if (ret == RMW_RET_UNSUPPORTED) {
+        unsupported = true;
+        rmw_reset_error();
+        break;
+      }
+      if (ret == RMW_RET_OK && count > 0) {
+        latency = elapsed_ms(start);
+        break;
+      }
+      rmw_reset_error();
+      std::this_thread::sleep_for(kPollPeriod);
+    }
+    rmw_destroy_publisher(remote.node, pub);
+    return latency;
+  }
+
+  Session background;
+  Session local;
+  Session remote;
+  std::vector<rmw_publisher_t *> background_publishers;
+  std::vector<rmw_subscription_t *> background_subscriptions;
+
+  const rosidl_message_type_support_t * msg_ts{nullptr};
+  const rosidl_service_type_support_t * srv_ts{nullptr};
+  test_msgs__msg__BasicTypes message;
+  std::chrono::seconds timeout{10};
+};
+
+TEST_F(CLASSNAME(BenchmarkMatchingLatency, RMW_IMPLEMENTATION), matching_latency) {
+  const std::vector<size_t> endpoint_counts =
+    env_list("RMW_ZENOH_BENCHMARK_ENDPOINTS", {0, 10, 100, 1000, 5000});
+  const size_t repetitions = env_size("RMW_ZENOH_BENCHMARK_REPETITIONS", 10);
+  timeout = std::chrono::seconds(env_size("RMW_ZENOH_BENCHMARK_TIMEOUT", 10));
+
+  const char * mode = std::getenv("RMW_ZENOH_MODE");
+  if (!mode || !*mode) {
+    mode = "peer";
+  }
+
+  printf("mode,endpoints,measurement,min_ms,median_ms,p90_ms,max_ms,timeouts");
+  if (PerfCounters::enabled()) {
+    for (int counter = 0; counter < PerfCounters::kCounterCount; ++counter) {
+      printf(",%s", PerfCounters::counter_name(counter));
+    }
+    printf(",cpu_us");
+  }
+  printf("\n");
+  size_t topic_id = 0;
+  for (size_t endpoints : endpoint_counts) {
+    add_background_endpoints(endpoints);
+    ASSERT_FALSE(HasFatalFailure());
+
+    Latencies subscription;
+    Latencies publisher;
+    Latencies service;
+    Latencies graph;
+    for (size_t i = 0; i < repetitions; ++i) {
+      // Every measurement gets names of its own, so nothing is left over from the previous one
+      std::string id = std::to_string(topic_id++);
+      measure(subscription, [&]() {return measure_subscription("/matching/subscription_" + id);});
+      measure(publisher, [&]() {return measure_publisher("/matching/publisher_" + id);});
+      measure(service, [&]() {return measure_service("/matching/service_" + id);});
+      if (!graph.unsupported) {
+        measure(graph, [&]() {return measure_graph("/matching/graph_" + id, graph.unsupported);});
+      }
+    }
+
+    subscription.print(mode, endpoints, "subscription");
+    publisher.print(mode, endpoints, "publisher");
+    service.print(mode, endpoints, "service");
+    graph.print(mode, endpoints, "graph");
+    fflush(stdout);
+
+    // A latency that is never measured is a regression in itself
+    for (const Latencies * latencies : {&subscription, &publisher, &service}) {
+      EXPECT_TRUE(
+        std::any_of(
+          latencies->values.begin(), latencies->values.end(),
+          [](double value) {return value >= 0;})) << "no match within the timeout";
+    }
+  }
+}
@@ -0,0 +1,292 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PERF_COUNTERS_HPP_
+#define PERF_COUNTERS_HPP_
+
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// Hardware performance counters and scheduling statistics of the threads of the process.
+/*
+ * Counts instructions, cycles, cache misses and branch misses with perf_event_open, and context
+ * switches and CPU time from /proc, for every thread that exists when start() is called (threads
+ * created later are not counted). Counters the kernel does not allow (see
+ * /proc/sys/kernel/perf_event_paranoid) or the CPU does not have read as -1.
+ *
+ * The benchmarks only collect them if RMW_ZENOH_BENCHMARK_PERF is set to 1, see enabled().
+ */
+class PerfCounters
+{
+public:
+  enum Counter
+  {
+    kInstructions,
+    kCycles,
+    kCacheMisses,
+    kBranchMisses,
+    kHardwareCounters,
+    kContextSwitches = kHardwareCounters,
+    kCounterCount
+  };
+
+  struct Thread
+  {
+    int tid = 0;
+    std::string name;
+    int64_t counts[kCounterCount] = {-1, -1, -1, -1, -1};
+    double cpu_seconds = 0;
+  };
+
+  static bool enabled()
+  {
+    const char * value = std::getenv("RMW_ZENOH_BENCHMARK_PERF");
+    return value && std::strcmp(value, "1") == 0;
+  }
+
+  static const char * counter_name(int counter)
+  {
+    static const char * names[kCounterCount] = {
+      "instructions", "cycles", "cache_misses", "branch_misses", "context_switches"};
+    return names[counter];
+  }
+
+  PerfCounters() = default;
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters & operator=(const PerfCounters &) = delete;
+
+  ~PerfCounters()
+  {
+    close_all();
+  }
+
+  // Open and start the counters of the threads of the process
+  void start()
+  {
+    close_all();
+    threads_.clear();
+    for (int tid : thread_ids()) {
+      Open open;
+      open.thread.tid = tid;
+      open.thread.name = read_thread_name(tid);
+      for (int counter = 0; counter < kHardwareCounters; ++counter) {
+        open.fds[counter] = open_counter(tid, counter);
+      }
+      read_scheduling(tid, open.context_switches, open.cpu_ticks);
+      threads_.push_back(open);
+    }
+    for (Open & open : threads_) {
+      for (int fd : open.fds) {
+        if (fd >= 0) {
+          ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+          ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+      }
+    }
+  }
+
+  // Stop the counters, and return the counts of every thread since start()
+  std::vector<Thread> stop()
+  {
+    std::vector<Thread> threads;
+    for (Open & open : threads_) {
+      for (int counter = 0; counter < kHardwareCounters; ++counter) {
+        open.thread.counts[counter] = read_counter(open.fds[counter]);
+      }
+      int64_t context_switches = 0;
+      int64_t cpu_ticks = 0;
+      if (read_scheduling(open.thread.tid, context_switches, cpu_ticks)) {
+        open.thread.counts[kContextSwitches] = context_switches - open.context_switches;
+        open.thread.cpu_seconds =
+          static_cast<double>(cpu_ticks - open.cpu_ticks) / static_cast<double>(ticks_per_s());
+      }
+      threads.push_back(open.thread);
+    }
+    close_all();
+    return threads;
+  }
+
+  // Sum of the counts of the threads (-1 for the counters no thread could count)
+  static Thread total(const std::vector<Thread> & threads)
+  {
+    Thread total;
+    total.name = "total";
+    for (const Thread & thread : threads) {
+      for (int counter = 0; counter < kCounterCount; ++counter) {
+        if (thread.counts[counter] >= 0) {
+          total.counts[counter] = std::max<int64_t>(total.counts[counter], 0) +
+            thread.counts[counter];
+        }
+      }
+      total.cpu_seconds += thread.cpu_seconds;
+    }
+    return total;
+  }
+
+  // The counts divided by a number of operations, as the members of a JSON object
+  static std::string per_operation_json(const Thread & thread, double operations)
+  {
+    std::ostringstream json;
+    for (int counter = 0; counter < kCounterCount; ++counter) {
+      json << "\"" << counter_name(counter) << "\": ";
+      if (thread.counts[counter] < 0 || operations <= 0) {
+        json << "null";
+      } else {
+        json << static_cast<double>(thread.counts[counter]) / operations;
+      }
+      json << ", ";
+    }
+    json << "\"cpu_us\": " << (operations > 0 ? thread.cpu_seconds * 1e6 / operations : 0);
+    return json.str();
+  }
+
+private:
+  struct Open
+  {
+    Thread thread;
+    int fds[kHardwareCounters] = {-1, -1, -1, -1};
+    int64_t context_switches = 0;
+    int64_t cpu_ticks = 0;
+  };
+
+  static std::vector<int> thread_ids()
+  {
+    std::vector<int> tids;
+    DIR * dir = opendir("/proc/self/task");
+    if (!dir) {
+      return tids;
+    }
+    while (struct dirent * entry = readdir(dir)) {
+      if (entry->d_name[0] != '.') {
+        tids.push_back(std::atoi(entry->d_name));
+      }
+    }
+    closedir(dir);
+    return tids;
+  }
+
+  static std::string read_thread_name(int tid)
+  {
+    std::ifstream comm("/proc/self/task/" + std::to_string(tid) + "/comm");
+    std::string name;
+    std::getline(comm, name);
+    return name;
+  }
+
+  static long ticks_per_s()  // NOLINT
+  {
+    return sysconf(_SC_CLK_TCK);
+  }
+
+  // Context switches (voluntary or not) and CPU time of a thread
+  static bool read_scheduling(int tid, int64_t & context_switches, int64_t & cpu_ticks)
+  {
+    std::string task = "/proc/self/task/" + std::to_string(tid);
+    std::ifstream status(task + "/status");
+    std::string line;
+    context_switches = 0;
+    while (std::getline(status, line)) {
+      if (line.find("ctxt_switches:") != std::string::npos) {
+        context_switches += std::strtoll(line.substr(line.find(':') + 1).c_str(), nullptr, 10);
+      }
+    }
+
+    std::ifstream stat(task + "/stat");
+    std::string contents;
+    if (!std::getline(stat, contents)) {
+      return false;
+    }
+    // The name may contain spaces, but is in parentheses. utime and stime are the 12th and 13th
+    // fields after it.
+    std::istringstream fields(contents.substr(contents.rfind(')') + 2));
+    std::string field;
+    int64_t utime = 0;
+    int64_t stime = 0;
+    for (int i = 0; i < 13 && fields >> field; ++i) {
+      if (i == 11) {
+        utime = std::strtoll(field.c_str(), nullptr, 10);
+      } else if (i == 12) {
+        stime = std::strtoll(field.c_str(), nullptr, 10);
+      }
+    }
+    cpu_ticks = utime + stime;
+    return true;
+  }
+
+  static int open_counter(int tid, int counter)
+  {
+    static const uint64_t configs[kHardwareCounters] = {
+      PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_BRANCH_MISSES};
+
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[counter];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // When there are more counters than the CPU has, they take turns, and are scaled up after
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0));
+  }
+
+  static int64_t read_counter(int fd)
+  {
+    if (fd < 0) {
+      return -1;
+    }
+    uint64_t values[3] = {0, 0, 0};  // Value, time enabled, time running
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd, values, sizeof(values)) != static_cast<ssize_t>(sizeof(values))) {
+      return -1;
+    }
+    if (values[2] == 0) {
+      return values[1] == 0 ? 0 : -1;
+    }
+    return static_cast<int64_t>(
+      static_cast<double>(values[0]) * static_cast<double>(values[1]) /
+      static_cast<double>(values[2]));
+  }
+
+  void close_all()
+  {
+    for (Open & open : threads_) {
+      for (int & fd : open.fds) {
+        if (fd >= 0) {
+          close(fd);
+          fd = -1;
+        }
+      }
+    }
+  }
+
+  std::vector<Open> threads_;
+};
+
+#endif  // PERF_COUNTERS_HPP_
@@ -0,0 +1,326 @@
+#!/usr/bin/env python3
+# Copyright 2020 Open Source Robotics Foundation, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Multi-process scale test of rmw_zenoh_cpp on one host.
+
+Launches scale_worker processes following a topology, against a local zenohd router (client mode)
+or as a peer mesh, collects the latency and throughput every worker saw along with the CPU used by
+the router, and prints a consolidated report. With --scale, the topology is run again with its
+process and topic counts multiplied by every factor, to find where it stops scaling. With --perf,
+the workers also count instructions, cycles, cache misses, branch misses, context switches and CPU
+time per thread, and the report has them per message sent or received.
+
+Topologies:
+  fan-in    every topic has --publishers publishers and --subscribers subscribers (8 and 1)
+  fan-out   same, with 1 publisher and 8 subscribers by default
+  pipeline  a publisher, --stages - 1 relays and --subscribers subscribers chained per topic
+  FILE      a JSON file: {"workers": [{"role": "pub", "topic": "/a", "count": 4, "rate": 100,
+            "size": 1024}, {"role": "relay", "topic": "/a", "output_topic": "/b"}, ...]}
+"""
+
+import argparse
+import json
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import time
+
+DEFAULT_COUNTS = {
+    'fan-in': (8, 1),
+    'fan-out': (1, 8),
+    'pipeline': (1, 1),
+}
+
+
+def expand_topology(args, scale):
+    """Return the workers of the topology, with its counts multiplied by scale."""
+    if args.topology not in DEFAULT_COUNTS:
+        with open(args.topology) as topology_file:
+            description = json.load(topology_file)
+        workers = []
+        for entry in description['workers']:
+            for _ in range(entry.get('count', 1) * scale):
+                worker = dict(entry)
+                worker.pop('count', None)
+                workers.append(worker)
+        return workers
+
+    default_publishers, default_subscribers = DEFAULT_COUNTS[args.topology]
+    publishers = args.publishers or default_publishers
+    subscribers = args.subscribers or default_subscribers
+    workers = []
+    for t in range(args.topics * scale):
+        if args.topology == 'pipeline':
+            stages = ['/scale/chain_%d/stage_%d' % (t, s) for s in range(args.stages)]
+            workers.append({'role': 'pub', 'topic': stages[0]})
+            for s in range(1, args.stages):
+                workers.append(
+                    {'role': 'relay', 'topic': stages[s - 1], 'output_topic': stages[s]})
+            workers += [{'role': 'sub', 'topic': stages[-1]}] * subscribers
+        else:
+            topic = '/scale/topic_%d' % t
+            workers += [{'role': 'pub', 'topic': topic}] * publishers
+            workers += [{'role': 'sub', 'topic': topic}] * subscribers
+    return workers
+
+
+def cpu_ticks(pid):
+    """Return the user and system CPU time of a process, in clock ticks."""
+    try:
+        with open('/proc/%d/stat' % pid) as stat:
+            # The command may contain spaces, but is in parentheses
+            fields = stat.read().rsplit(')', 1)[1].split()
+        return int(fields[11]) + int(fields[12])
+    except (OSError, IndexError, ValueError):
+        return None
+
+
+def sleep_until(deadline):
+    delay = deadline - time.time()
+    if delay > 0:
+        time.sleep(delay)
+
+
+def run_step(args, scale, env):
+    """Run the topology once, and return the reports of its workers and the router CPU."""
+    workers = expand_topology(args, scale)
+    start_at = time.time() + args.startup + 0.01 * len(workers)
+    processes = []
+    for i, worker in enumerate(workers):
+        command = [
+            args.worker,
+            '--role', worker['role'],
+            '--topic', worker['topic'],
+            '--name', 'worker_%d' % i,
+            '--rate', str(worker.get('rate', args.rate)),
+            '--size', str(worker.get('size', args.size)),
+            '--start-at', str(int(start_at * 1e9)),
+            '--warmup', str(args.warmup),
+            '--duration', str(args.duration),
+        ]
+        if worker.get('output_topic'):
+            command += ['--output-topic', worker['output_topic']]
+        if args.perf:
+            command += ['--perf', '1']
+        processes.append(subprocess.Popen(
+            command, env=env, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+            universal_newlines=True))
+
+    router_cpu = None
+    if args.router_process:
+        sleep_until(start_at + args.warmup)
+        begin = cpu_ticks(args.router_process.pid)
+        sleep_until(start_at + args.duration)
+        end = cpu_ticks(args.router_process.pid)
+        if begin is not None and end is not None:
+            router_cpu = (end - begin) / os.sysconf('SC_CLK_TCK') / (args.duration - args.warmup)
+
+    reports = []
+    failures = 0
+    deadline = start_at + args.duration + 30
+    for process in processes:
+        try:
+            output, _ = process.communicate(timeout=max(deadline - time.time(), 1))
+        except subprocess.TimeoutExpired:
+            process.kill()
+            output, _ = process.communicate()
+        lines = [line for line in output.splitlines() if line.startswith('{')]
+        if process.returncode != 0 or not lines:
+            failures += 1
+            continue
+        reports.append(json.loads(lines[-1]))
+    return workers, reports, failures, router_cpu
+
+
+PERF_COUNTERS = [
+    'instructions', 'cycles', 'cache_misses', 'branch_misses', 'context_switches', 'cpu_us']
+
+
+def perf_per_message(reports):
+    """Return the counts of the workers per message they sent or received, or None."""
+    totals = {}
+    messages = 0
+    for report in reports:
+        if 'perf' not in report:
+            continue
+        weight = report['sent'] + report['received']
+        messages += weight
+        for counter in PERF_COUNTERS:
+            value = report['perf']['per_message'][counter]
+            if value is not None:
+                totals[counter] = totals.get(counter, 0.0) + value * weight
+    if not messages:
+        return None
+    return {counter: totals[counter] / messages if counter in totals else None
+            for counter in PERF_COUNTERS}
+
+
+def summarize(scale, workers, reports, failures, router_cpu):
+    """Consolidate the reports of the workers of a step."""
+    # Messages offered on every topic, by its publishers and relays
+    offered = {}
+    for report in reports:
+        if report['role'] != 'sub':
+            topic = report['output_topic'] or report['topic']
+            offered[topic] = offered.get(topic, 0) + report['sent']
+
+    subscribers = [report for report in reports if report['role'] == 'sub']
+    delivery = [
+        report['received'] / offered[report['topic']]
+        for report in subscribers if offered.get(report['topic'])]
+    window = max([report['window_s'] for report in reports] or [1])
+    return {
+        'scale': scale,
+        'processes': len(workers),
+        'topics': len(({worker['topic'] for worker in workers} |
+                       {worker.get('output_topic') for worker in workers}) - {None}),
+        'failed_processes': failures,
+        'offered_msgs_per_s': sum(offered.values()) / window,
+        'received_msgs_per_s': sum(report['received'] for report in subscribers) / window,
+        'received_bytes_per_s':
+            sum(report['received_bytes'] for report in subscribers) / window,
+        'delivery_min': min(delivery) if delivery else 0.0,
+        'delivery_mean': statistics.mean(delivery) if delivery else 0.0,
+        'out_of_order': sum(report['out_of_order'] for report in subscribers),
+        'latency_p50_ms_median':
+            statistics.median([r['latency_us']['p50'] for r in subscribers] or [0]) / 1e3,
+        'latency_p99_ms_max': max([r['latency_us']['p99'] for r in subscribers] or [0]) / 1e3,
+        'latency_max_ms': max([r['latency_us']['max'] for r in subscribers] or [0]) / 1e3,
+        'worker_cpu_cores': sum(report['cpu_s'] for report in reports) / window,
+        'router_cpu_cores': router_cpu,
+        'perf_per_message': perf_per_message(reports),
+    }
+
+
+def scaled(args, summary):
+    """Whether a step kept up with its load."""
+    return (summary['failed_processes'] == 0 and
+            summary['delivery_min'] >= args.min_delivery and
+            summary['latency_p99_ms_max'] <= args.max_p99_ms)
+
+
+def print_report(args, summaries):
+    columns = [
+        ('scale', '%5d'), ('processes', '%9d'), ('topics', '%6d'),
+        ('received_msgs_per_s', '%19.0f'), ('delivery_min', '%12.4f'),
+        ('latency_p50_ms_median', '%21.3f'), ('latency_p99_ms_max', '%18.3f'),
+        ('worker_cpu_cores', '%16.2f'), ('router_cpu_cores', '%16s'),
+    ]
+    print('  '.join(name for name, _ in columns))
+    for summary in summaries:
+        cells = []
+        for name, style in columns:
+            value = summary[name]
+            if value is None:
+                value = '-'
+            elif name == 'router_cpu_cores':
+                value = '%.2f' % value
+            cells.append(style % value)
+        print('  '.join(cells))
+
+    for summary in summaries:
+        if not scaled(args, summary):
+            print('stops scaling at x%d: %d processes on %d topics' % (
+                summary['scale'], summary['processes'], summary['topics']))
+            break
+    else:
+        print('kept up at every scale')
+
+    if args.perf:
+        print()
+        print('per message: scale  ' + '  '.join('%16s' % counter for counter in PERF_COUNTERS))
+        for summary in summaries:
+            perf = summary['perf_per_message'] or {}
+            print('             %5d  ' % summary['scale'] + '  '.join(
+                '%16s' % ('-' if perf.get(counter) is None else '%.1f' % perf[counter])
+                for counter in PERF_COUNTERS))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--worker', default=shutil.which('scale_worker') or os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), 'scale_worker'),
+        help='path to the scale_worker executable')
+    parser.add_argument('--topology', default='fan-in',
+                        help='fan-in, fan-out, pipeline or a JSON file')
+    parser.add_argument('--publishers', type=int, default=0, help='publishers per topic')
+    parser.add_argument('--subscribers', type=int, default=0, help='subscribers per topic')
+    parser.add_argument('--topics', type=int, default=1, help='topics (or pipelines)')
+    parser.add_argument('--stages', type=int, default=3, help='topics per pipeline')
+    parser.add_argument('--rate', type=float, default=100.0, help='messages per second')
+    parser.add_argument('--size', type=int, default=256, help='payload bytes')
+    parser.add_argument('--duration', type=float, default=20.0, help='seconds per step')
+    parser.add_argument('--warmup', type=float, default=5.0, help='seconds not counted')
+    parser.add_argument('--startup', type=float, default=3.0,
+                        help='seconds given to the processes to start and discover each other')
+    parser.add_argument('--scale', default='1', help='comma separated scale factors')
+    parser.add_argument('--mode', choices=['client', 'peer'], default='client',
+                        help='client: through a local router, peer: as a peer mesh')
+    parser.add_argument('--router', default='zenohd', help='router executable (client mode)')
+    parser.add_argument('--router-port', type=int, default=7447)
+    parser.add_argument('--min-delivery', type=float, default=0.99,
+                        help='fraction of the messages every subscriber must receive')
+    parser.add_argument('--max-p99-ms', type=float, default=50.0,
+                        help='99th percentile latency no subscriber may exceed')
+    parser.add_argument('--perf', action='store_true',
+                        help='collect hardware counters and scheduling statistics per message')
+    parser.add_argument('--report', help='write the consolidated report to this JSON file')
+    args = parser.parse_args()
+
+    if not os.access(args.worker, os.X_OK):
+        parser.error('scale_worker not found at %s (use --worker)' % args.worker)
+
+    env = dict(os.environ)
+    env['RMW_ZENOH_MODE'] = args.mode
+    args.router_process = None
+    if args.mode == 'client':
+        locator = 'tcp/127.0.0.1:%d' % args.router_port
+        env['RMW_ZENOH_SESSION_LOCATOR'] = locator
+        args.router_process = subprocess.Popen(
+            [args.router, '-l', locator], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        time.sleep(1)
+        if args.router_process.poll() is not None:
+            sys.exit('router %s exited' % args.router)
+
+    summaries = []
+    reports = []
+    try:
+        for scale in [int(factor) for factor in args.scale.split(',')]:
+            workers, step_reports, failures, router_cpu = run_step(args, scale, env)
+            summaries.append(summarize(scale, workers, step_reports, failures, router_cpu))
+            reports.append({'scale': scale, 'workers': step_reports})
+    finally:
+        if args.router_process:
+            args.router_process.terminate()
+            args.router_process.wait()
+
+    print_report(args, summaries)
+    if args.report:
+        with open(args.report, 'w') as report_file:
+            json.dump({
+                'topology': args.topology,
+                'mode': args.mode,
+                'summaries': summaries,
+                'steps': reports,
+            }, report_file, indent=2)
+    return 0 if all(scaled(args, summary) for summary in summaries) else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
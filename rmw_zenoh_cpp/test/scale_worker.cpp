@@ -0,0 +1,348 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Worker process of the scale test (see scale_test.py): publishes, subscribes to, or relays a
+// topic for a while, and prints what it saw as one JSON object.
+//
+//   scale_worker --role pub|sub|relay --topic TOPIC [--output-topic TOPIC] [--name NAME]
+//                [--rate HZ] [--size BYTES] [--start-at NS] [--warmup S] [--duration S]
+//                [--perf 0|1]
+//
+// Messages carry the system time they were first published at, the sequence number and the ID of
+// their publisher, so latencies are end to end across relays (all workers run on one host).
+// Publishers start at --start-at (nanoseconds since the epoch, so every worker starts together
+// once discovery is done), and everything is counted from --warmup seconds after it until
+// --duration seconds after it. With --perf 1, the hardware counters and scheduling statistics of
+// its threads over that time are added, per thread and per message sent or received.
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/rmw.h"
+#include "rmw/error_handling.h"
+
+#include "rosidl_runtime_c/primitives_sequence_functions.h"
+
+#include "test_msgs/msg/unbounded_sequences.h"
+
+#include "./perf_counters.hpp"
+
+namespace
+{
+
+struct Options
+{
+  std::string role;
+  std::string topic;
+  std::string output_topic;
+  std::string name = "worker";
+  double rate = 100;
+  size_t size = 256;
+  int64_t start_at = 0;
+  double warmup = 2;
+  double duration = 10;
+  bool perf = false;
+};
+
+// Fields of the int64_values of a message
+enum Field
+{
+  kTimestamp,
+  kSequence,
+  kPublisher,
+  kFieldCount
+};
+
+// Latencies kept for the percentiles, at most (an hour at 1 kHz)
+constexpr size_t kMaxLatencies = 3600 * 1000;
+
+constexpr std::chrono::microseconds kPollPeriod{100};
+
+int64_t now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool parse(int argc, char ** argv, Options & options)
+{
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string flag(argv[i]);
+    const char * value = argv[i + 1];
+    if (flag == "--role") {
+      options.role = value;
+    } else if (flag == "--topic") {
+      options.topic = value;
+    } else if (flag == "--output-topic") {
+      options.output_topic = value;
+    } else if (flag == "--name") {
+      options.name = value;
+    } else if (flag == "--rate") {
+      options.rate = std::strtod(value, nullptr);
+    } else if (flag == "--size") {
+      options.size = std::strtoull(value, nullptr, 10);
+    } else if (flag == "--start-at") {
+      options.start_at = std::strtoll(value, nullptr, 10);
+    } else if (flag == "--warmup") {
+      options.warmup = std::strtod(value, nullptr);
+    } else if (flag == "--duration") {
+      options.duration = std::strtod(value, nullptr);
+    } else if (flag == "--perf") {
+      options.perf = std::strcmp(value, "1") == 0;
+    } else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (options.role != "pub" && options.role != "sub" && options.role != "relay") {
+    fprintf(stderr, "--role must be pub, sub or relay\n");
+    return false;
+  }
+  if (options.topic.empty() || (options.role == "relay" && options.output_topic.empty())) {
+    fprintf(stderr, "--topic (and --output-topic for relays) must be given\n");
+    return false;
+  }
+  if (options.rate <= 0 || options.duration <= options.warmup) {
+    fprintf(stderr, "--rate must be positive, and --duration longer than --warmup\n");
+    return false;
+  }
+  if (options.start_at == 0) {
+    options.start_at = now_ns();
+  }
+  return true;
+}
+
+double percentile(const std::vector<double> & sorted, double p)
+{
+  if (sorted.empty()) {
+    return 0;
+  }
+  return sorted[static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5)];
+}
+
+double cpu_seconds()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+         static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  Options options;
+  if (!parse(argc, argv, options)) {
+    return 2;
+  }
+
+  rmw_init_options_t init_options = rmw_get_zero_initialized_init_options();
+  rmw_context_t context = rmw_get_zero_initialized_context();
+  if (rmw_init_options_init(&init_options, rcutils_get_default_allocator()) != RMW_RET_OK) {
+    fprintf(stderr, "failed to initialize options: %s\n", rmw_get_error_string().str);
+    return 1;
+  }
+  init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+  if (rmw_init(&init_options, &context) != RMW_RET_OK) {
+    fprintf(stderr, "failed to initialize: %s\n", rmw_get_error_string().str);
+    return 1;
+  }
+  rmw_node_t * node = rmw_create_node(&context, options.name.c_str(), "/scale", 0, false);
+  if (!node) {
+    fprintf(stderr, "failed to create node: %s\n", rmw_get_error_string().str);
+    return 1;
+  }
+
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, UnboundedSequences);
+  rmw_qos_profile_t qos = rmw_qos_profile_default;
+  qos.depth = 100;
+
+  rmw_publisher_t * pub = nullptr;
+  rmw_subscription_t * sub = nullptr;
+  if (options.role != "sub") {
+    rmw_publisher_options_t publisher_options = rmw_get_default_publisher_options();
+    const std::string & topic = options.role == "relay" ? options.output_topic : options.topic;
+    pub = rmw_create_publisher(node, ts, topic.c_str(), &qos, &publisher_options);
+  }
+  if (options.role != "pub") {
+    rmw_subscription_options_t subscription_options = rmw_get_default_subscription_options();
+    sub = rmw_create_subscription(node, ts, options.topic.c_str(), &qos, &subscription_options);
+  }
+  if ((options.role != "sub" && !pub) || (options.role != "pub" && !sub)) {
+    fprintf(stderr, "failed to create endpoints: %s\n", rmw_get_error_string().str);
+    return 1;
+  }
+
+  test_msgs__msg__UnboundedSequences message;
+  test_msgs__msg__UnboundedSequences__init(&message);
+  rosidl_runtime_c__int64__Sequence__init(&message.int64_values, kFieldCount);
+  rosidl_runtime_c__uint8__Sequence__init(&message.uint8_values, options.size);
+
+  const int64_t window_begin = options.start_at + static_cast<int64_t>(options.warmup * 1e9);
+  const int64_t window_end = options.start_at + static_cast<int64_t>(options.duration * 1e9);
+  auto in_window = [&](int64_t timestamp) {
+      return timestamp >= window_begin && timestamp < window_end;
+    };
+
+  // Sent in the window, and received in it (by the timestamp they were first published at)
+  size_t sent = 0;
+  size_t send_failures = 0;
+  size_t received = 0;
+  size_t received_bytes = 0;
+  size_t out_of_order = 0;
+  std::vector<double> latencies_us;
+  std::vector<std::pair<int64_t, int64_t>> last_sequences;  // Publisher ID, sequence number
+
+  const int64_t publisher_id = static_cast<int64_t>(getpid());
+  int64_t sequence = 0;
+
+  // Wait for the start, so every worker is discovered before anything is published
+  std::this_thread::sleep_for(std::chrono::nanoseconds(std::max<int64_t>(
+      options.start_at - now_ns(), 0)));
+  const double cpu_at_start = cpu_seconds();
+  PerfCounters perf;
+  if (options.perf) {
+    perf.start();
+  }
+
+  const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(1.0 / options.rate));
+  auto next_publish = std::chrono::steady_clock::now();
+
+  // Subscriptions keep taking for a second after the end, for what is still in flight
+  while (now_ns() < window_end + (sub ? 1000000000 : 0)) {
+    if (options.role == "pub" && std::chrono::steady_clock::now() >= next_publish) {
+      int64_t timestamp = now_ns();
+      message.int64_values.data[kTimestamp] = timestamp;
+      message.int64_values.data[kSequence] = sequence++;
+      message.int64_values.data[kPublisher] = publisher_id;
+      if (rmw_publish(pub, &message, nullptr) != RMW_RET_OK) {
+        rmw_reset_error();
+        send_failures += in_window(timestamp) ? 1 : 0;
+      } else if (in_window(timestamp)) {
+        ++sent;
+      }
+      next_publish += period;
+    }
+
+    bool took = false;
+    while (sub && rmw_take(sub, &message, &took, nullptr) == RMW_RET_OK && took) {
+      if (message.int64_values.size < kFieldCount) {
+        continue;
+      }
+      int64_t timestamp = message.int64_values.data[kTimestamp];
+      if (!in_window(timestamp)) {
+        continue;
+      }
+
+      if (pub) {
+        // Relays forward the message as it is, so its timestamp is the one of the first publisher
+        if (rmw_publish(pub, &message, nullptr) != RMW_RET_OK) {
+          rmw_reset_error();
+          ++send_failures;
+        } else {
+          ++sent;
+        }
+      }
+
+      ++received;
+      received_bytes += message.uint8_values.size;
+      if (latencies_us.size() < kMaxLatencies) {
+        latencies_us.push_back(static_cast<double>(now_ns() - timestamp) / 1e3);
+      }
+
+      int64_t id = message.int64_values.data[kPublisher];
+      int64_t number = message.int64_values.data[kSequence];
+      auto last = std::find_if(
+        last_sequences.begin(), last_sequences.end(),
+        [id](const std::pair<int64_t, int64_t> & entry) {return entry.first == id;});
+      if (last == last_sequences.end()) {
+        last_sequences.emplace_back(id, number);
+      } else {
+        out_of_order += number <= last->second ? 1 : 0;
+        last->second = std::max(last->second, number);
+      }
+    }
+    rmw_reset_error();
+
+    std::this_thread::sleep_for(
+      options.role == "pub" ?
+      std::min<std::chrono::steady_clock::duration>(
+        next_publish - std::chrono::steady_clock::now(), kPollPeriod) :
+      kPollPeriod);
+  }
+  const double cpu = cpu_seconds() - cpu_at_start;
+  std::vector<PerfCounters::Thread> perf_threads;
+  if (options.perf) {
+    perf_threads = perf.stop();
+  }
+
+  std::sort(latencies_us.begin(), latencies_us.end());
+  const double window = options.duration - options.warmup;
+  printf(
+    "{\"name\": \"%s\", \"role\": \"%s\", \"topic\": \"%s\", \"output_topic\": \"%s\", "
+    "\"publisher_id\": %lld, \"rate\": %.1f, \"size\": %zu, \"window_s\": %.3f, "
+    "\"sent\": %zu, \"send_failures\": %zu, \"received\": %zu, \"received_bytes\": %zu, "
+    "\"out_of_order\": %zu, \"publishers_seen\": %zu, "
+    "\"latency_us\": {\"min\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, "
+    "\"max\": %.1f}, \"cpu_s\": %.3f",
+    options.name.c_str(), options.role.c_str(), options.topic.c_str(),
+    options.output_topic.c_str(), static_cast<long long>(publisher_id), options.rate,  // NOLINT
+    options.size, window, sent, send_failures, received, received_bytes, out_of_order,
+    last_sequences.size(), percentile(latencies_us, 0), percentile(latencies_us, 0.5),
+    percentile(latencies_us, 0.9), percentile(latencies_us, 0.99), percentile(latencies_us, 1),
+    cpu);
+  if (options.perf) {
+    const double messages = static_cast<double>(sent + received);
+    printf(
+      ", \"perf\": {\"per_message\": {%s}, \"threads\": [",
+      PerfCounters::per_operation_json(PerfCounters::total(perf_threads), messages).c_str());
+    for (size_t i = 0; i < perf_threads.size(); ++i) {
+      printf(
+        "%s{\"tid\": %d, \"name\": \"%s\", %s}", i > 0 ? ", " : "", perf_threads[i].tid,
+        perf_threads[i].name.c_str(),
+        PerfCounters::per_operation_json(perf_threads[i], messages).c_str());
+    }
+    printf("]}");
+  }
+  printf("}\n");
+  fflush(stdout);
+
+  test_msgs__msg__UnboundedSequences__fini(&message);
+  if (sub) {
+    rmw_destroy_subscription(node, sub);
+  }
+  if (pub) {
+    rmw_destroy_publisher(node, pub);
+  }
+  rmw_destroy_node(node);
+  rmw_shutdown(&context);
+  rmw_context_fini(&context);
+  rmw_init_options_fini(&init_options);
+  return 0;
+}
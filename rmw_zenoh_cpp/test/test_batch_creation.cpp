@@ -0,0 +1,190 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <string>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/rmw.h"
+#include "rmw/error_handling.h"
+
+#include "test_msgs/msg/basic_types.h"
+
+#include "rmw_zenoh_common_cpp/rmw_zenoh_extensions.h"
+
+#include "impl/pubsub_impl.hpp"
+
+#ifdef RMW_IMPLEMENTATION
+# define CLASSNAME_(NAME, SUFFIX) NAME ## __ ## SUFFIX
+# define CLASSNAME(NAME, SUFFIX) CLASSNAME_(NAME, SUFFIX)
+#else
+# define CLASSNAME(NAME, SUFFIX) NAME
+#endif
+
+// Subscriptions and publishers created in one pass, all or none
+class CLASSNAME (TestBatchCreation, RMW_IMPLEMENTATION) : public ::testing::Test
+{
+protected:
+  static constexpr size_t kCount = 4;
+
+  void SetUp() override
+  {
+    rmw_ret_t ret = rmw_init_options_init(&init_options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", init_options.enclave);
+    ret = rmw_init(&init_options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    node = rmw_create_node(&context, "my_test_node", "/my_test_ns", 0, false);
+    ASSERT_NE(nullptr, node) << rcutils_get_error_string().str;
+
+    for (size_t i = 0; i < kCount; ++i) {
+      subscription_requests[i] = rmw_zenoh_subscription_request_t{
+        ts, topic_names[i], &rmw_qos_profile_default, &subscription_options};
+      publisher_requests[i] = rmw_zenoh_publisher_request_t{
+        ts, topic_names[i], &rmw_qos_profile_default, &publisher_options};
+    }
+  }
+
+  void TearDown() override
+  {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_node(node)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_shutdown(&context)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_context_fini(&context)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_init_options_fini(&init_options)) << rmw_get_error_string().str;
+  }
+
+  // Whether any subscription is registered on the topic
+  bool subscribed(const char * topic_name)
+  {
+    std::lock_guard<std::mutex> lock(sub_callback_mutex);
+    return rmw_subscription_data_t::zn_topic_to_sub_data.count(topic_name) > 0;
+  }
+
+  rmw_init_options_t init_options{rmw_get_zero_initialized_init_options()};
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+  rmw_node_t * node{nullptr};
+  const rosidl_message_type_support_t * ts{
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes)};
+  const char * topic_names[kCount] = {"/batch_a", "/batch_b", "/batch_a", "/batch_c"};
+  rmw_subscription_options_t subscription_options{rmw_get_default_subscription_options()};
+  rmw_publisher_options_t publisher_options{rmw_get_default_publisher_options()};
+  rmw_zenoh_subscription_request_t subscription_requests[kCount];
+  rmw_zenoh_publisher_request_t publisher_requests[kCount];
+};
+
+constexpr size_t CLASSNAME(TestBatchCreation, RMW_IMPLEMENTATION)::kCount;
+
+TEST_F(CLASSNAME(TestBatchCreation, RMW_IMPLEMENTATION), creates_all) {
+  rmw_subscription_t * subscriptions[kCount] = {};
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_zenoh_create_subscriptions(node, subscription_requests, kCount, subscriptions)) <<
+    rmw_get_error_string().str;
+  rmw_publisher_t * publishers[kCount] = {};
+  ASSERT_EQ(
+    RMW_RET_OK, rmw_zenoh_create_publishers(node, publisher_requests, kCount, publishers)) <<
+    rmw_get_error_string().str;
+
+  for (size_t i = 0; i < kCount; ++i) {
+    ASSERT_NE(nullptr, subscriptions[i]);
+    EXPECT_STREQ(topic_names[i], subscriptions[i]->topic_name);
+    EXPECT_STREQ(rmw_get_implementation_identifier(), subscriptions[i]->implementation_identifier);
+    ASSERT_NE(nullptr, publishers[i]);
+    EXPECT_STREQ(topic_names[i], publishers[i]->topic_name);
+    EXPECT_STREQ(rmw_get_implementation_identifier(), publishers[i]->implementation_identifier);
+  }
+  EXPECT_TRUE(subscribed("/batch_a"));
+
+  for (size_t i = 0; i < kCount; ++i) {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, subscriptions[i])) <<
+      rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, publishers[i])) <<
+      rmw_get_error_string().str;
+  }
+  EXPECT_FALSE(subscribed("/batch_a"));
+
+  // Nothing to create
+  EXPECT_EQ(RMW_RET_OK, rmw_zenoh_create_subscriptions(node, nullptr, 0, nullptr));
+  EXPECT_EQ(RMW_RET_OK, rmw_zenoh_create_publishers(node, nullptr, 0, nullptr));
+}
+
+TEST_F(CLASSNAME(TestBatchCreation, RMW_IMPLEMENTATION), rolls_back_subscriptions) {
+  // The last one fails, after the others were created
+  subscription_requests[kCount - 1].topic_name = "";
+  rmw_subscription_t * subscriptions[kCount] = {};
+  EXPECT_EQ(
+    RMW_RET_ERROR,
+    rmw_zenoh_create_subscriptions(node, subscription_requests, kCount, subscriptions));
+  EXPECT_NE(
+    std::string::npos, std::string(rmw_get_error_string().str).find("topic is empty string"));
+  rmw_reset_error();
+
+  // Destroyed, and nulled
+  for (size_t i = 0; i < kCount; ++i) {
+    EXPECT_EQ(nullptr, subscriptions[i]) << i;
+  }
+  EXPECT_FALSE(subscribed("/batch_a"));
+  EXPECT_FALSE(subscribed("/batch_b"));
+
+  // The topics can be subscribed to again
+  subscription_requests[kCount - 1].topic_name = topic_names[kCount - 1];
+  ASSERT_EQ(
+    RMW_RET_OK,
+    rmw_zenoh_create_subscriptions(node, subscription_requests, kCount, subscriptions)) <<
+    rmw_get_error_string().str;
+  for (size_t i = 0; i < kCount; ++i) {
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, subscriptions[i])) <<
+      rmw_get_error_string().str;
+  }
+}
+
+TEST_F(CLASSNAME(TestBatchCreation, RMW_IMPLEMENTATION), rolls_back_publishers) {
+  publisher_requests[kCount - 1].type_support = nullptr;
+  rmw_publisher_t * publishers[kCount] = {};
+  EXPECT_EQ(
+    RMW_RET_ERROR, rmw_zenoh_create_publishers(node, publisher_requests, kCount, publishers));
+  rmw_reset_error();
+  for (size_t i = 0; i < kCount; ++i) {
+    EXPECT_EQ(nullptr, publishers[i]) << i;
+  }
+}
+
+TEST_F(CLASSNAME(TestBatchCreation, RMW_IMPLEMENTATION), checks_the_implementation) {
+  rmw_subscription_t * subscriptions[kCount] = {};
+  rmw_publisher_t * publishers[kCount] = {};
+  const char * implementation_identifier = node->implementation_identifier;
+  node->implementation_identifier = "not-an-rmw-implementation-identifier";
+  EXPECT_EQ(
+    RMW_RET_INCORRECT_RMW_IMPLEMENTATION,
+    rmw_zenoh_create_subscriptions(node, subscription_requests, kCount, subscriptions));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INCORRECT_RMW_IMPLEMENTATION,
+    rmw_zenoh_create_publishers(node, publisher_requests, kCount, publishers));
+  rmw_reset_error();
+  node->implementation_identifier = implementation_identifier;
+
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT,
+    rmw_zenoh_create_subscriptions(nullptr, subscription_requests, kCount, subscriptions));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_zenoh_create_publishers(node, nullptr, kCount, publishers));
+  rmw_reset_error();
+}
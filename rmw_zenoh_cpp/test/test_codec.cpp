@@ -0,0 +1,249 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "impl/codec.hpp"
+#include "impl/receive_buffer_pool.hpp"
+#include "impl/sample_header.hpp"
+
+using rmw_zenoh_common_cpp::Codec;
+using rmw_zenoh_common_cpp::PayloadEncoder;
+using rmw_zenoh_common_cpp::ReceiveBufferPool;
+using rmw_zenoh_common_cpp::ReceiveBufferPtr;
+using rmw_zenoh_common_cpp::SampleHeader;
+
+namespace
+{
+std::vector<unsigned char> random_bytes(size_t length, unsigned int seed)
+{
+  std::mt19937 engine(seed);
+  std::vector<unsigned char> bytes(length);
+  for (auto & byte : bytes) {
+    byte = static_cast<unsigned char>(engine());
+  }
+  return bytes;
+}
+
+// Something that compresses like a message: text, runs, and repeats far apart
+std::vector<unsigned char> compressible_bytes(size_t length)
+{
+  std::vector<unsigned char> bytes(length);
+  const char text[] = "frame_id: base_link, stamp: 1234567, ";
+  for (size_t i = 0; i < length; ++i) {
+    bytes[i] = i % 4096 < 1024 ? 0 : static_cast<unsigned char>(text[i % (sizeof(text) - 1)]);
+  }
+  return bytes;
+}
+
+std::vector<unsigned char> encode(const Codec * codec, const std::vector<unsigned char> & raw)
+{
+  std::vector<unsigned char> encoded(codec->max_encoded_size(raw.size()));
+  size_t length = codec->encode(raw.data(), raw.size(), encoded.data(), encoded.size());
+  encoded.resize(length);
+  return encoded;
+}
+
+// A sample on the wire: header, then payload
+std::vector<unsigned char> make_sample(
+  uint8_t codec, uint32_t raw_length, const std::vector<unsigned char> & payload)
+{
+  SampleHeader header{};
+  header.version = rmw_zenoh_common_cpp::kSampleHeaderVersion;
+  header.codec = codec;
+  header.raw_length = raw_length;
+  std::vector<unsigned char> sample(rmw_zenoh_common_cpp::sample_header_size(0));
+  rmw_zenoh_common_cpp::write_sample_header(header, sample.data());
+  sample.insert(sample.end(), payload.begin(), payload.end());
+  return sample;
+}
+
+class TestDecodeSample : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    pool = ReceiveBufferPool::create(ReceiveBufferPool::Options{false});
+    ASSERT_NE(nullptr, pool);
+  }
+
+  void TearDown() override
+  {
+    pool->release();
+  }
+
+  ReceiveBufferPtr decode(const std::vector<unsigned char> & sample)
+  {
+    SampleHeader header;
+    return rmw_zenoh_common_cpp::decode_sample(
+      sample.data(), sample.size(), *pool, "/test", header);
+  }
+
+  ReceiveBufferPool * pool;
+};
+}  // namespace
+
+TEST(TestCodec, lz_is_registered) {
+  const Codec * codec = rmw_zenoh_common_cpp::find_codec(rmw_zenoh_common_cpp::kCodecLz);
+  ASSERT_NE(nullptr, codec);
+  EXPECT_EQ(codec, rmw_zenoh_common_cpp::find_codec(std::string("lz")));
+  EXPECT_EQ(nullptr, rmw_zenoh_common_cpp::find_codec(rmw_zenoh_common_cpp::kCodecNone));
+  EXPECT_EQ(nullptr, rmw_zenoh_common_cpp::find_codec(std::string("none")));
+  EXPECT_FALSE(rmw_zenoh_common_cpp::register_codec(codec));
+}
+
+TEST(TestCodec, lz_round_trips) {
+  const Codec * codec = rmw_zenoh_common_cpp::find_codec(rmw_zenoh_common_cpp::kCodecLz);
+  ASSERT_NE(nullptr, codec);
+
+  std::vector<std::vector<unsigned char>> inputs = {
+    {},
+    {42},
+    std::vector<unsigned char>(12, 7),
+    std::vector<unsigned char>(13, 7),
+    std::vector<unsigned char>(100000, 0),  // One long run
+    compressible_bytes(300),
+    compressible_bytes(200000),  // Repeats further apart than the largest offset
+    random_bytes(5000, 1),
+  };
+  for (const auto & raw : inputs) {
+    std::vector<unsigned char> encoded = encode(codec, raw);
+    ASSERT_GT(encoded.size(), 0u) << raw.size() << " bytes";
+    EXPECT_LE(encoded.size(), codec->max_encoded_size(raw.size()));
+    EXPECT_LE(raw.size(), codec->max_decoded_size(encoded.size()));
+
+    std::vector<unsigned char> decoded(raw.size());
+    ASSERT_TRUE(codec->decode(encoded.data(), encoded.size(), decoded.data(), decoded.size()));
+    EXPECT_EQ(raw, decoded) << raw.size() << " bytes";
+  }
+}
+
+TEST(TestCodec, lz_compresses) {
+  const Codec * codec = rmw_zenoh_common_cpp::find_codec(rmw_zenoh_common_cpp::kCodecLz);
+  ASSERT_NE(nullptr, codec);
+
+  std::vector<unsigned char> raw = compressible_bytes(64 * 1024);
+  EXPECT_LT(encode(codec, raw).size(), raw.size() / 4);
+}
+
+TEST(TestCodec, lz_fails_on_small_output) {
+  const Codec * codec = rmw_zenoh_common_cpp::find_codec(rmw_zenoh_common_cpp::kCodecLz);
+  ASSERT_NE(nullptr, codec);
+
+  std::vector<unsigned char> raw = random_bytes(1000, 2);
+  std::vector<unsigned char> out(raw.size() / 2);
+  EXPECT_EQ(0u, codec->encode(raw.data(), raw.size(), out.data(), out.size()));
+}
+
+TEST(TestCodec, lz_rejects_malformed_input) {
+  const Codec * codec = rmw_zenoh_common_cpp::find_codec(rmw_zenoh_common_cpp::kCodecLz);
+  ASSERT_NE(nullptr, codec);
+
+  std::vector<unsigned char> raw = compressible_bytes(10000);
+  std::vector<unsigned char> encoded = encode(codec, raw);
+  std::vector<unsigned char> decoded(raw.size() + 1);
+
+  // Truncated at every length
+  for (size_t length = 0; length < encoded.size(); length += 7) {
+    EXPECT_FALSE(codec->decode(encoded.data(), length, decoded.data(), raw.size())) << length;
+  }
+
+  // Decoding to more or less than it holds
+  EXPECT_FALSE(codec->decode(encoded.data(), encoded.size(), decoded.data(), raw.size() - 1));
+  EXPECT_FALSE(codec->decode(encoded.data(), encoded.size(), decoded.data(), raw.size() + 1));
+
+  // A match before the start of the output
+  const unsigned char bad_offset[] = {0x10, 'a', 0x02, 0x00, 0x10, 'b'};
+  EXPECT_FALSE(codec->decode(bad_offset, sizeof(bad_offset), decoded.data(), 7));
+  const unsigned char zero_offset[] = {0x10, 'a', 0x00, 0x00, 0x10, 'b'};
+  EXPECT_FALSE(codec->decode(zero_offset, sizeof(zero_offset), decoded.data(), 7));
+}
+
+TEST(TestCodec, encoder_skips_small_and_incompressible_samples) {
+  const Codec * codec = rmw_zenoh_common_cpp::find_codec(rmw_zenoh_common_cpp::kCodecLz);
+  ASSERT_NE(nullptr, codec);
+  PayloadEncoder encoder(codec, 512, 0.9);
+
+  std::vector<unsigned char> small = compressible_bytes(511);
+  EXPECT_EQ(0u, encoder.encode(small.data(), small.size(), 8));
+
+  std::vector<unsigned char> raw = compressible_bytes(4096);
+  size_t length = encoder.encode(raw.data(), raw.size(), 8);
+  ASSERT_GT(length, 0u);
+  std::vector<unsigned char> decoded(raw.size());
+  ASSERT_TRUE(codec->decode(encoder.buffer() + 8, length, decoded.data(), decoded.size()));
+  EXPECT_EQ(raw, decoded);
+
+  // After every failure, the samples skipped double: 1, then 2
+  std::vector<unsigned char> noise = random_bytes(4096, 3);
+  EXPECT_EQ(0u, encoder.encode(noise.data(), noise.size(), 8));  // Fails
+  EXPECT_EQ(0u, encoder.encode(raw.data(), raw.size(), 8));  // Skipped
+  EXPECT_EQ(0u, encoder.encode(noise.data(), noise.size(), 8));  // Fails
+  EXPECT_EQ(0u, encoder.encode(raw.data(), raw.size(), 8));  // Skipped
+  EXPECT_EQ(0u, encoder.encode(raw.data(), raw.size(), 8));  // Skipped
+  EXPECT_GT(encoder.encode(raw.data(), raw.size(), 8), 0u);
+}
+
+TEST_F(TestDecodeSample, decodes_plain_and_encoded_samples) {
+  const Codec * codec = rmw_zenoh_common_cpp::find_codec(rmw_zenoh_common_cpp::kCodecLz);
+  ASSERT_NE(nullptr, codec);
+  std::vector<unsigned char> raw = compressible_bytes(3000);
+
+  ReceiveBufferPtr plain = decode(
+    make_sample(rmw_zenoh_common_cpp::kCodecNone, static_cast<uint32_t>(raw.size()), raw));
+  ASSERT_TRUE(plain);
+  ASSERT_EQ(raw.size(), plain->size());
+  EXPECT_EQ(0, memcmp(raw.data(), plain->data(), raw.size()));
+
+  ReceiveBufferPtr encoded = decode(
+    make_sample(
+      rmw_zenoh_common_cpp::kCodecLz, static_cast<uint32_t>(raw.size()), encode(codec, raw)));
+  ASSERT_TRUE(encoded);
+  ASSERT_EQ(raw.size(), encoded->size());
+  EXPECT_EQ(0, memcmp(raw.data(), encoded->data(), raw.size()));
+}
+
+TEST_F(TestDecodeSample, drops_malformed_samples) {
+  std::vector<unsigned char> raw = compressible_bytes(3000);
+
+  // Plain payload shorter than its header says
+  EXPECT_FALSE(
+    decode(
+      make_sample(
+        rmw_zenoh_common_cpp::kCodecNone, static_cast<uint32_t>(raw.size() + 1), raw)));
+
+  // Unknown codec
+  EXPECT_FALSE(decode(make_sample(200, static_cast<uint32_t>(raw.size()), raw)));
+
+  // Too short for a header
+  std::vector<unsigned char> sample = make_sample(rmw_zenoh_common_cpp::kCodecNone, 0, {});
+  sample.pop_back();
+  EXPECT_FALSE(decode(sample));
+}
+
+TEST_F(TestDecodeSample, drops_samples_claiming_more_than_their_payload_decodes_to) {
+  const Codec * codec = rmw_zenoh_common_cpp::find_codec(rmw_zenoh_common_cpp::kCodecLz);
+  ASSERT_NE(nullptr, codec);
+
+  // A few bytes claiming to decode to 4 GiB must not get a buffer of that size
+  std::vector<unsigned char> payload = {0x10, 'a'};
+  ASSERT_LT(codec->max_decoded_size(payload.size()), 0xffffffffu);
+  EXPECT_FALSE(decode(make_sample(rmw_zenoh_common_cpp::kCodecLz, 0xffffffffu, payload)));
+  EXPECT_EQ(0u, pool->bytes_in_use());
+}
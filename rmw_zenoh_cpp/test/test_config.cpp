@@ -0,0 +1,258 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "impl/config.hpp"
+
+using rmw_zenoh_common_cpp::Config;
+using rmw_zenoh_common_cpp::ServiceConfig;
+using rmw_zenoh_common_cpp::ThreadConfig;
+using rmw_zenoh_common_cpp::TopicConfig;
+using rmw_zenoh_common_cpp::TopicPriority;
+
+namespace
+{
+class ConfigTest : public ::testing::Test
+{
+protected:
+  void TearDown() override
+  {
+    if (!path_.empty()) {
+      unlink(path_.c_str());
+    }
+  }
+
+  // Write a config file and load it
+  bool load(const std::string & contents)
+  {
+    if (path_.empty()) {
+      char path[] = "/tmp/test_config_XXXXXX";
+      int fd = mkstemp(path);
+      EXPECT_NE(-1, fd);
+      close(fd);
+      path_ = path;
+    }
+    FILE * file = fopen(path_.c_str(), "w");
+    EXPECT_NE(nullptr, file);
+    fputs(contents.c_str(), file);
+    fclose(file);
+
+    config = Config();
+    error.clear();
+    return config.load(path_.c_str(), error);
+  }
+
+  // Whether a single line is rejected, with the line number in the error
+  bool rejects(const std::string & line)
+  {
+    if (load("# comment\n" + line + "\n")) {
+      return false;
+    }
+    EXPECT_NE(std::string::npos, error.find(path_ + ":2: ")) << error;
+    return true;
+  }
+
+  std::string path_;
+  Config config;
+  std::string error;
+};
+
+TEST_F(ConfigTest, MissingFile)
+{
+  EXPECT_FALSE(config.load("/nonexistent/rmw_zenoh.conf", error));
+  EXPECT_EQ("could not open /nonexistent/rmw_zenoh.conf", error);
+}
+
+TEST_F(ConfigTest, ParsesSectionsNamesAndKeys)
+{
+  ASSERT_TRUE(
+    load(
+      "# Settings\n"
+      "\n"
+      "session rate_limit=1000000 burst=5000 rx_overload_delay=2.5 rx_overload_bytes=4096\n"
+      "  topic   /map codec=lz codec_min_size=0 codec_max_ratio=0.5 delta=true  # Big\n"
+      "topic /map keyframe_interval=100 rate_limit=250 burst=10 rate_limit_mode=block\n"
+      "topic /map key=header.frame_id history=5 history_duration=100 reorder_window=20\n"
+      "topic /map latency_budget=30.5 latency_window=2000 deduplicate=true priority=high\n"
+      "service /plan_path request_timeout=500\n"
+      "thread read cpus=0,2-3 policy=fifo priority=80 name=zn_rx\n"
+      "thread lease policy=other\n")) << error;
+
+  EXPECT_EQ(1000000u, config.session().rate_limit);
+  EXPECT_EQ(5000u, config.session().burst);
+  EXPECT_DOUBLE_EQ(2.5, config.session().rx_overload_delay);
+  EXPECT_EQ(4096u, config.session().rx_overload_bytes);
+
+  TopicConfig map = config.topic("/map");
+  EXPECT_EQ("lz", map.codec);
+  EXPECT_EQ(0u, map.codec_min_size);
+  EXPECT_DOUBLE_EQ(0.5, map.codec_max_ratio);
+  EXPECT_TRUE(map.delta);
+  EXPECT_EQ(100u, map.keyframe_interval);
+  EXPECT_EQ(250u, map.rate_limit);
+  EXPECT_EQ(10u, map.burst);
+  EXPECT_TRUE(map.rate_limit_block);
+  EXPECT_EQ("header.frame_id", map.key);
+  EXPECT_EQ(5u, map.history);
+  EXPECT_EQ(100u, map.history_duration);
+  EXPECT_EQ(20u, map.reorder_window);
+  EXPECT_DOUBLE_EQ(30.5, map.latency_budget);
+  EXPECT_EQ(2000u, map.latency_window);
+  EXPECT_TRUE(map.deduplicate);
+  EXPECT_EQ(TopicPriority::kHigh, map.priority);
+
+  // Topics without settings get the defaults
+  TopicConfig other = config.topic("/other");
+  EXPECT_EQ("none", other.codec);
+  EXPECT_EQ(512u, other.codec_min_size);
+  EXPECT_FALSE(other.delta);
+  EXPECT_EQ(TopicPriority::kNormal, other.priority);
+
+  EXPECT_EQ(500u, config.service("/plan_path").request_timeout);
+  EXPECT_EQ(0u, config.service("/map").request_timeout);
+
+  const ThreadConfig * read = config.thread("read");
+  ASSERT_NE(nullptr, read);
+  EXPECT_EQ((std::vector<int>{0, 2, 3}), read->cpus);
+  EXPECT_EQ("fifo", read->policy);
+  EXPECT_EQ(80, read->priority);
+  EXPECT_EQ("zn_rx", read->name);
+  const ThreadConfig * lease = config.thread("lease");
+  ASSERT_NE(nullptr, lease);
+  EXPECT_TRUE(lease->cpus.empty());
+  EXPECT_EQ(0, lease->priority);
+  EXPECT_EQ(nullptr, config.thread("session"));
+}
+
+TEST_F(ConfigTest, MatchesInFileOrder)
+{
+  ASSERT_TRUE(
+    load(
+      "topic * codec=lz codec_min_size=100\n"
+      "topic /robot/* codec=none\n"
+      "topic /robot/scan codec_min_size=5\n"
+      "topic /exact codec=zstd\n"
+      "topic /ex* codec_min_size=7\n"
+      "topic * delta=true\n"
+      "topic /exact codec_min_size=9\n"
+      "service /plan* request_timeout=100\n"
+      "service /plan_path request_timeout=200\n"
+      "service /plan_* request_timeout=300\n")) << error;
+
+  // Every matching line applies, later ones over earlier ones
+  TopicConfig scan = config.topic("/robot/scan");
+  EXPECT_EQ("none", scan.codec);
+  EXPECT_EQ(5u, scan.codec_min_size);
+  EXPECT_TRUE(scan.delta);
+
+  // A prefix matches the names starting with it, and only those
+  TopicConfig robot = config.topic("/robot");
+  EXPECT_EQ("lz", robot.codec);
+  EXPECT_EQ(100u, robot.codec_min_size);
+  EXPECT_EQ("none", config.topic("/robot/").codec);
+  EXPECT_EQ("lz", config.topic("/robots").codec);
+
+  // An exact name does not match longer names, and does not win over later prefixes
+  TopicConfig exact = config.topic("/exact");
+  EXPECT_EQ("zstd", exact.codec);
+  EXPECT_EQ(9u, exact.codec_min_size);
+  TopicConfig longer = config.topic("/exactly");
+  EXPECT_EQ("lz", longer.codec);
+  EXPECT_EQ(7u, longer.codec_min_size);
+
+  EXPECT_EQ(300u, config.service("/plan_path").request_timeout);
+  EXPECT_EQ(100u, config.service("/plans").request_timeout);
+  EXPECT_EQ(0u, config.service("/other").request_timeout);
+}
+
+TEST_F(ConfigTest, RejectsMalformedLines)
+{
+  EXPECT_TRUE(rejects("subscription /map codec=lz"));
+  EXPECT_TRUE(rejects("topic"));
+  EXPECT_TRUE(rejects("topic /map codec"));
+  EXPECT_TRUE(rejects("topic /map =lz"));
+  EXPECT_TRUE(rejects("topic /map compression=lz"));
+  EXPECT_TRUE(rejects("session /name rate_limit=1"));
+  EXPECT_TRUE(rejects("service /plan_path timeout=500"));
+  EXPECT_FALSE(rejects("topic /map"));
+}
+
+TEST_F(ConfigTest, RejectsInvalidValues)
+{
+  // Numbers
+  EXPECT_TRUE(rejects("topic /map codec_min_size=-1"));
+  EXPECT_TRUE(rejects("topic /map codec_min_size=12kB"));
+  EXPECT_TRUE(rejects("topic /map rate_limit=99999999999999999999"));
+  EXPECT_TRUE(rejects("topic /map keyframe_interval=0"));
+  EXPECT_TRUE(rejects("topic /map latency_window=0"));
+  EXPECT_TRUE(rejects("service /plan_path request_timeout=-5"));
+  EXPECT_TRUE(rejects("topic /map delta=yes"));
+  EXPECT_TRUE(rejects("topic /map rate_limit_mode=queue"));
+  EXPECT_TRUE(rejects("topic /map priority=urgent"));
+  EXPECT_TRUE(rejects("topic /map codec="));
+  EXPECT_TRUE(rejects("topic /map key="));
+
+  // Doubles must be finite, and ratios positive
+  for (const char * value : {"nan", "NAN", "inf", "-inf", "infinity", "1e999", "-0.5", "0", "x"}) {
+    EXPECT_TRUE(rejects(std::string("topic /map codec_max_ratio=") + value)) << value;
+  }
+  for (const char * value : {"nan", "inf", "-1", "1e999"}) {
+    EXPECT_TRUE(rejects(std::string("topic /map latency_budget=") + value)) << value;
+    EXPECT_TRUE(rejects(std::string("session rx_overload_delay=") + value)) << value;
+  }
+  EXPECT_FALSE(rejects("topic /map codec_max_ratio=1e-3 latency_budget=0"));
+
+  // CPU lists
+  for (const char * value :
+    {"", "a", "-1", "3-1", "1-", "-", "1,,2", "1,", "0-1024", "1024", "0-99999999999"})
+  {
+    EXPECT_TRUE(rejects(std::string("thread read cpus=") + value)) << value;
+  }
+  EXPECT_FALSE(rejects("thread read cpus=0-3,7,5-5"));
+
+  EXPECT_TRUE(rejects("thread read policy=batch"));
+  EXPECT_TRUE(rejects("thread read priority=-1"));
+  EXPECT_TRUE(rejects("thread read name="));
+}
+
+TEST_F(ConfigTest, ChecksPrioritiesAgainstThePolicy)
+{
+  EXPECT_TRUE(load("thread read policy=fifo priority=1\n")) << error;
+  EXPECT_TRUE(load("thread read policy=rr priority=99\n")) << error;
+  EXPECT_TRUE(load("thread read policy=other priority=0\n")) << error;
+
+  // The policy and priority may come from different lines
+  EXPECT_TRUE(load("thread read priority=50\nthread lease cpus=1\nthread read policy=fifo\n")) <<
+    error;
+  EXPECT_EQ(50, config.thread("read")->priority);
+
+  for (const char * line : {
+      "thread read policy=fifo", "thread read policy=fifo priority=0",
+      "thread read policy=rr priority=100", "thread read policy=other priority=10",
+      "thread read priority=10"})
+  {
+    EXPECT_FALSE(load(std::string(line) + "\n")) << line;
+    EXPECT_NE(std::string::npos, error.find(": thread read: priority ")) << error;
+  }
+}
+
+}  // namespace
@@ -0,0 +1,270 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/rmw.h"
+#include "rmw/error_handling.h"
+
+#include "rosidl_typesupport_cpp/message_type_support.hpp"
+#include "rosidl_typesupport_cpp/service_type_support.hpp"
+
+#include "test_msgs/msg/basic_types.hpp"
+#include "test_msgs/srv/basic_types.hpp"
+
+#include "rmw_zenoh_common_cpp/coro.hpp"
+
+#include "./config.hpp"
+
+#ifdef RMW_IMPLEMENTATION
+# define CLASSNAME_(NAME, SUFFIX) NAME ## __ ## SUFFIX
+# define CLASSNAME(NAME, SUFFIX) CLASSNAME_(NAME, SUFFIX)
+#else
+# define CLASSNAME(NAME, SUFFIX) NAME
+#endif
+
+namespace coro = rmw_zenoh_common_cpp::coro;
+
+using BasicTypes = test_msgs::msg::BasicTypes;
+using BasicTypesSrv = test_msgs::srv::BasicTypes;
+
+namespace
+{
+constexpr std::chrono::seconds kTimeout{5};
+
+coro::Task<> call(
+  coro::Client<BasicTypesSrv> & client, BasicTypesSrv::Request request,
+  std::promise<coro::Result<BasicTypesSrv::Response>> & done)
+{
+  done.set_value(co_await client.call(request));
+}
+
+coro::Task<> next(
+  coro::Subscription<BasicTypes> & subscription,
+  std::promise<coro::Result<BasicTypes>> & done)
+{
+  done.set_value(co_await subscription.next());
+}
+
+// Completes once the coroutines spawned before it on a single threaded executor have suspended
+coro::Task<> mark(std::promise<void> & done)
+{
+  done.set_value();
+  co_return;
+}
+}  // namespace
+
+// Calls and messages awaited by coroutines, resumed on a thread running the executor
+class CLASSNAME (TestCoro, RMW_IMPLEMENTATION) : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rmw_ret_t ret = rmw_init_options_init(&init_options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", init_options.enclave);
+    ret = rmw_init(&init_options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    node = rmw_create_node(&context, "my_test_node", "/my_test_ns", 0, false);
+    ASSERT_NE(nullptr, node) << rcutils_get_error_string().str;
+
+    runner = std::thread([this]() {executor.run();});
+  }
+
+  void TearDown() override
+  {
+    executor.stop();
+    runner.join();
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_node(node)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_shutdown(&context)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_context_fini(&context)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_init_options_fini(&init_options)) << rmw_get_error_string().str;
+  }
+
+  // Wait for the coroutines spawned so far to run until they suspend
+  void settle()
+  {
+    std::promise<void> done;
+    coro::spawn(executor, mark(done));
+    ASSERT_EQ(std::future_status::ready, done.get_future().wait_for(kTimeout));
+  }
+
+  rmw_client_t * create_client(const char * service_name)
+  {
+    return rmw_create_client(
+      node, rosidl_typesupport_cpp::get_service_type_support_handle<BasicTypesSrv>(),
+      service_name, &rmw_qos_profile_services_default);
+  }
+
+  rmw_subscription_t * create_subscription(const char * topic_name)
+  {
+    rmw_subscription_options_t options = rmw_get_default_subscription_options();
+    return rmw_create_subscription(
+      node, rosidl_typesupport_cpp::get_message_type_support_handle<BasicTypes>(),
+      topic_name, &rmw_qos_profile_default, &options);
+  }
+
+  rmw_init_options_t init_options{rmw_get_zero_initialized_init_options()};
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+  rmw_node_t * node{nullptr};
+  coro::Executor executor;
+  std::thread runner;
+};
+
+TEST_F(CLASSNAME(TestCoro, RMW_IMPLEMENTATION), call_completes_with_the_response) {
+  rmw_service_t * service = rmw_create_service(
+    node, rosidl_typesupport_cpp::get_service_type_support_handle<BasicTypesSrv>(),
+    "/coro_calls", &rmw_qos_profile_services_default);
+  ASSERT_NE(nullptr, service) << rmw_get_error_string().str;
+  rmw_client_t * client = create_client("/coro_calls");
+  ASSERT_NE(nullptr, client) << rmw_get_error_string().str;
+  std::this_thread::sleep_for(rmw_intraprocess_discovery_delay);
+
+  // Answers with the request's int32_value plus one
+  std::atomic<bool> serving{true};
+  std::thread server([service, &serving]() {
+      while (serving) {
+        BasicTypesSrv::Request request;
+        rmw_service_info_t header;
+        bool taken = false;
+        if (rmw_take_request(service, &header, &request, &taken) == RMW_RET_OK && taken) {
+          BasicTypesSrv::Response response;
+          response.int32_value = request.int32_value + 1;
+          rmw_send_response(service, &header.request_id, &response);
+        } else {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      }
+    });
+
+  {
+    coro::Client<BasicTypesSrv> coro_client(client, executor);
+    ASSERT_EQ(RMW_RET_OK, coro_client.status());
+
+    BasicTypesSrv::Request request;
+    request.int32_value = 41;
+    std::promise<coro::Result<BasicTypesSrv::Response>> done;
+    std::future<coro::Result<BasicTypesSrv::Response>> result = done.get_future();
+    coro::spawn(executor, call(coro_client, request, done));
+    ASSERT_EQ(std::future_status::ready, result.wait_for(kTimeout));
+    coro::Result<BasicTypesSrv::Response> response = result.get();
+    EXPECT_EQ(RMW_RET_OK, response.ret);
+    EXPECT_EQ(42, response.value.int32_value);
+    EXPECT_EQ(0u, coro_client.in_flight());
+  }
+
+  serving = false;
+  server.join();
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_client(node, client)) << rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_service(node, service)) << rmw_get_error_string().str;
+}
+
+TEST_F(CLASSNAME(TestCoro, RMW_IMPLEMENTATION), next_completes_with_the_message) {
+  rmw_subscription_t * subscription = create_subscription("/coro_messages");
+  ASSERT_NE(nullptr, subscription) << rmw_get_error_string().str;
+  rmw_publisher_options_t options = rmw_get_default_publisher_options();
+  rmw_publisher_t * publisher = rmw_create_publisher(
+    node, rosidl_typesupport_cpp::get_message_type_support_handle<BasicTypes>(),
+    "/coro_messages", &rmw_qos_profile_default, &options);
+  ASSERT_NE(nullptr, publisher) << rmw_get_error_string().str;
+  std::this_thread::sleep_for(rmw_intraprocess_discovery_delay);
+
+  {
+    coro::Subscription<BasicTypes> coro_subscription(subscription, executor);
+    ASSERT_EQ(RMW_RET_OK, coro_subscription.status());
+
+    std::promise<coro::Result<BasicTypes>> done;
+    std::future<coro::Result<BasicTypes>> result = done.get_future();
+    coro::spawn(executor, next(coro_subscription, done));
+    settle();
+
+    BasicTypes message;
+    message.int64_value = 1234;
+    EXPECT_EQ(RMW_RET_OK, rmw_publish(publisher, &message, nullptr)) << rmw_get_error_string().str;
+    ASSERT_EQ(std::future_status::ready, result.wait_for(kTimeout));
+    coro::Result<BasicTypes> received = result.get();
+    EXPECT_EQ(RMW_RET_OK, received.ret);
+    EXPECT_EQ(1234, received.value.int64_value);
+  }
+
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, publisher)) << rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, subscription)) <<
+    rmw_get_error_string().str;
+}
+
+TEST_F(CLASSNAME(TestCoro, RMW_IMPLEMENTATION), destruction_resumes_with_an_error) {
+  // Nothing answers, and nothing is published
+  rmw_client_t * client = create_client("/coro_unanswered");
+  ASSERT_NE(nullptr, client) << rmw_get_error_string().str;
+  rmw_subscription_t * subscription = create_subscription("/coro_silent");
+  ASSERT_NE(nullptr, subscription) << rmw_get_error_string().str;
+
+  auto coro_client = std::make_unique<coro::Client<BasicTypesSrv>>(client, executor);
+  ASSERT_EQ(RMW_RET_OK, coro_client->status());
+  std::promise<coro::Result<BasicTypesSrv::Response>> call_done;
+  std::future<coro::Result<BasicTypesSrv::Response>> call_result = call_done.get_future();
+  coro::spawn(executor, call(*coro_client, BasicTypesSrv::Request(), call_done));
+
+  auto coro_subscription = std::make_unique<coro::Subscription<BasicTypes>>(
+    subscription, executor);
+  ASSERT_EQ(RMW_RET_OK, coro_subscription->status());
+  std::promise<coro::Result<BasicTypes>> next_done;
+  std::future<coro::Result<BasicTypes>> next_result = next_done.get_future();
+  coro::spawn(executor, next(*coro_subscription, next_done));
+
+  settle();
+  EXPECT_EQ(1u, coro_client->in_flight());
+  EXPECT_EQ(std::future_status::timeout, call_result.wait_for(std::chrono::milliseconds(0)));
+  EXPECT_EQ(std::future_status::timeout, next_result.wait_for(std::chrono::milliseconds(0)));
+
+  coro_client.reset();
+  ASSERT_EQ(std::future_status::ready, call_result.wait_for(kTimeout));
+  EXPECT_EQ(RMW_RET_ERROR, call_result.get().ret);
+
+  coro_subscription.reset();
+  ASSERT_EQ(std::future_status::ready, next_result.wait_for(kTimeout));
+  EXPECT_EQ(RMW_RET_ERROR, next_result.get().ret);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, subscription)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_client(node, client)) << rmw_get_error_string().str;
+}
+
+TEST_F(CLASSNAME(TestCoro, RMW_IMPLEMENTATION), calls_complete_with_the_client_status) {
+  // A client without data, so its response callback cannot be set
+  rmw_client_t client;
+  client.implementation_identifier = rmw_get_implementation_identifier();
+  client.data = nullptr;
+  client.service_name = "/coro_broken";
+  coro::Client<BasicTypesSrv> coro_client(&client, executor);
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, coro_client.status());
+  rmw_reset_error();
+
+  std::promise<coro::Result<BasicTypesSrv::Response>> done;
+  std::future<coro::Result<BasicTypesSrv::Response>> result = done.get_future();
+  coro::spawn(executor, call(coro_client, BasicTypesSrv::Request(), done));
+  ASSERT_EQ(std::future_status::ready, result.wait_for(kTimeout));
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, result.get().ret);
+  EXPECT_EQ(0u, coro_client.in_flight());
+}
@@ -0,0 +1,329 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "impl/delta.hpp"
+#include "impl/receive_buffer_pool.hpp"
+#include "impl/sample_header.hpp"
+
+using rmw_zenoh_common_cpp::DeltaEncoder;
+using rmw_zenoh_common_cpp::DeltaStreams;
+using rmw_zenoh_common_cpp::ReceiveBufferPool;
+using rmw_zenoh_common_cpp::ReceiveBufferPtr;
+using rmw_zenoh_common_cpp::SampleHeader;
+
+namespace
+{
+using Bytes = std::vector<unsigned char>;
+
+Bytes random_bytes(size_t length, unsigned int seed)
+{
+  std::mt19937 engine(seed);
+  Bytes bytes(length);
+  for (auto & byte : bytes) {
+    byte = static_cast<unsigned char>(engine());
+  }
+  return bytes;
+}
+
+Bytes encode(const Bytes & prev, const Bytes & next)
+{
+  Bytes delta(2 * next.size() + 32);
+  size_t length = rmw_zenoh_common_cpp::encode_delta(
+    prev.data(), prev.size(), next.data(), next.size(), delta.data(), delta.size());
+  delta.resize(length);
+  return delta;
+}
+
+bool decode(const Bytes & prev, const Bytes & delta, Bytes & next)
+{
+  size_t length;
+  if (!rmw_zenoh_common_cpp::read_delta_target_length(
+      delta.data(), delta.size(), prev.size(), length))
+  {
+    return false;
+  }
+  next.resize(length);
+  return rmw_zenoh_common_cpp::decode_delta(
+    prev.data(), prev.size(), delta.data(), delta.size(), next.data(), next.size());
+}
+
+class TestDeltaStreams : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    pool = ReceiveBufferPool::create(ReceiveBufferPool::Options{false});
+    ASSERT_NE(nullptr, pool);
+    memset(gid, 1, sizeof(gid));
+  }
+
+  void TearDown() override
+  {
+    pool->release();
+  }
+
+  ReceiveBufferPtr apply(uint64_t sequence, bool delta, const Bytes & payload, bool & request)
+  {
+    SampleHeader header{};
+    header.version = rmw_zenoh_common_cpp::kSampleHeaderVersion;
+    header.flags = rmw_zenoh_common_cpp::kSampleFlagStream;
+    if (delta) {
+      header.flags |= rmw_zenoh_common_cpp::kSampleFlagDelta;
+    }
+    memcpy(header.gid, gid, sizeof(gid));
+    header.sequence = sequence;
+
+    ReceiveBufferPtr buffer = pool->acquire(payload.size());
+    EXPECT_TRUE(static_cast<bool>(buffer));
+    if (!payload.empty()) {
+      memcpy(buffer->data(), payload.data(), payload.size());
+    }
+    return streams.apply(header, buffer, *pool, "/test", request);
+  }
+
+  static Bytes bytes_of(const ReceiveBufferPtr & buffer)
+  {
+    return Bytes(buffer->data(), buffer->data() + buffer->size());
+  }
+
+  ReceiveBufferPool * pool;
+  DeltaStreams streams;
+  uint8_t gid[rmw_zenoh_common_cpp::kSampleGidSize];
+};
+}  // namespace
+
+TEST(TestDelta, round_trips) {
+  Bytes base = random_bytes(1000, 1);
+  Bytes changed = base;
+  changed[0] ^= 1;
+  changed[500] ^= 1;
+  changed[502] ^= 1;  // Absorbed into the run of byte 500
+  changed[999] ^= 1;
+  Bytes grown = base;
+  grown.resize(1500, 0);  // Zeros past the previous message are still sent
+  Bytes shrunk(base.begin(), base.begin() + 300);
+
+  struct Case
+  {
+    Bytes prev;
+    Bytes next;
+  };
+  std::vector<Case> cases = {
+    {base, base},
+    {base, changed},
+    {base, grown},
+    {base, shrunk},
+    {base, {}},
+    {{}, base},
+    {{}, {}},
+    {base, random_bytes(1000, 2)},
+  };
+  for (const auto & c : cases) {
+    Bytes delta = encode(c.prev, c.next);
+    ASSERT_GT(delta.size(), 0u);
+    Bytes decoded;
+    ASSERT_TRUE(decode(c.prev, delta, decoded)) << c.prev.size() << " -> " << c.next.size();
+    EXPECT_EQ(c.next, decoded) << c.prev.size() << " -> " << c.next.size();
+  }
+
+  // Few changes make a small delta
+  EXPECT_LT(encode(base, changed).size(), 20u);
+  EXPECT_LT(encode(base, base).size(), 10u);
+}
+
+TEST(TestDelta, encode_fails_on_small_output) {
+  Bytes prev = random_bytes(100, 1);
+  Bytes next = random_bytes(100, 2);
+  Bytes delta(50);
+  EXPECT_EQ(
+    0u, rmw_zenoh_common_cpp::encode_delta(
+      prev.data(), prev.size(), next.data(), next.size(), delta.data(), delta.size()));
+  EXPECT_EQ(
+    0u, rmw_zenoh_common_cpp::encode_delta(
+      prev.data(), prev.size(), next.data(), next.size(), delta.data(), 0));
+}
+
+TEST(TestDelta, decode_rejects_malformed_deltas) {
+  Bytes prev = random_bytes(100, 1);
+  Bytes next = prev;
+  next[10] ^= 0xff;
+  next[90] ^= 0xff;
+  Bytes delta = encode(prev, next);
+  ASSERT_GT(delta.size(), 0u);
+
+  Bytes out(next.size());
+  // Truncated
+  for (size_t length = 0; length < delta.size(); ++length) {
+    EXPECT_FALSE(
+      rmw_zenoh_common_cpp::decode_delta(
+        prev.data(), prev.size(), delta.data(), length, out.data(), out.size())) << length;
+  }
+  // Target length other than the one in the delta
+  EXPECT_FALSE(
+    rmw_zenoh_common_cpp::decode_delta(
+      prev.data(), prev.size(), delta.data(), delta.size(), out.data(), out.size() - 1));
+  // Trailing bytes
+  Bytes trailing = delta;
+  trailing.push_back(0);
+  EXPECT_FALSE(decode(prev, trailing, out));
+  // Empty run, runs past the target length, and an unterminated varint
+  EXPECT_FALSE(decode(prev, {4, 0, 0, 4, 1, 2, 3, 4}, out));
+  EXPECT_FALSE(decode(prev, {4, 5, 0}, out));
+  EXPECT_FALSE(decode(prev, {4, 0, 5, 1, 2, 3, 4, 5}, out));
+  EXPECT_FALSE(decode(prev, {0x80, 0x80}, out));
+}
+
+TEST(TestDelta, target_length_is_bounded_by_the_delta) {
+  Bytes prev(16, 7);
+  size_t length;
+
+  // Unchanged bytes only come from the previous message, changed bytes from the delta
+  Bytes delta = {20, 16, 4, 1, 2, 3, 4};
+  ASSERT_TRUE(
+    rmw_zenoh_common_cpp::read_delta_target_length(
+      delta.data(), delta.size(), prev.size(), length));
+  EXPECT_EQ(20u, length);
+
+  // A huge target length from the wire (2^62)
+  Bytes huge = {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x40, 0, 1, 1};
+  EXPECT_FALSE(
+    rmw_zenoh_common_cpp::read_delta_target_length(
+      huge.data(), huge.size(), prev.size(), length));
+  Bytes long_run = {21, 21, 0};
+  EXPECT_FALSE(
+    rmw_zenoh_common_cpp::read_delta_target_length(
+      long_run.data(), long_run.size(), prev.size(), length));
+
+  // Deltas the encoder makes always satisfy the bound, even with zeros past the previous message
+  Bytes next(1000, 0);
+  Bytes encoded = encode(prev, next);
+  ASSERT_TRUE(
+    rmw_zenoh_common_cpp::read_delta_target_length(
+      encoded.data(), encoded.size(), prev.size(), length));
+  EXPECT_EQ(next.size(), length);
+}
+
+TEST(TestDeltaEncoder, sends_deltas_between_keyframes) {
+  DeltaEncoder encoder(3);
+  const size_t header_room = rmw_zenoh_common_cpp::kMaxSampleHeaderSize;
+  Bytes prev = random_bytes(1000, 1);
+  EXPECT_FALSE(encoder.has_last_sample());
+
+  std::vector<bool> deltas;
+  uint8_t gid[rmw_zenoh_common_cpp::kSampleGidSize] = {};
+  for (uint64_t i = 1; i <= 7; ++i) {
+    Bytes sample = prev;
+    sample[i] ^= 0xff;
+    SampleHeader header{};
+    size_t delta_length = encoder.encode(sample.data(), sample.size(), header_room, header);
+
+    EXPECT_TRUE(header.flags & rmw_zenoh_common_cpp::kSampleFlagStream);
+    EXPECT_EQ(delta_length > 0, (header.flags & rmw_zenoh_common_cpp::kSampleFlagDelta) != 0);
+    EXPECT_EQ(i, header.sequence);
+    if (i == 1) {
+      memcpy(gid, header.gid, sizeof(gid));
+    }
+    EXPECT_EQ(0, memcmp(gid, header.gid, sizeof(gid)));
+    deltas.push_back(delta_length > 0);
+
+    if (delta_length > 0) {
+      Bytes delta(
+        encoder.buffer() + header_room, encoder.buffer() + header_room + delta_length);
+      Bytes decoded;
+      ASSERT_TRUE(decode(prev, delta, decoded));
+      EXPECT_EQ(sample, decoded);
+    }
+    EXPECT_EQ(sample, encoder.last_sample());
+    prev = sample;
+  }
+  EXPECT_EQ((std::vector<bool>{false, true, true, false, true, true, false}), deltas);
+
+  SampleHeader keyframe = encoder.keyframe_header();
+  EXPECT_EQ(7u, keyframe.sequence);
+  EXPECT_EQ(prev.size(), keyframe.raw_length);
+  EXPECT_EQ(rmw_zenoh_common_cpp::kSampleFlagStream, keyframe.flags);
+}
+
+TEST(TestDeltaEncoder, sends_unrelated_samples_as_keyframes) {
+  DeltaEncoder encoder(100);
+  SampleHeader header{};
+  Bytes first = random_bytes(100, 1);
+  Bytes second = random_bytes(100, 2);
+  EXPECT_EQ(0u, encoder.encode(first.data(), first.size(), 0, header));
+  header = SampleHeader{};
+  EXPECT_EQ(0u, encoder.encode(second.data(), second.size(), 0, header));
+  EXPECT_FALSE(header.flags & rmw_zenoh_common_cpp::kSampleFlagDelta);
+  EXPECT_EQ(2u, header.sequence);
+}
+
+TEST_F(TestDeltaStreams, applies_deltas_to_keyframes) {
+  Bytes first = random_bytes(1000, 1);
+  Bytes second = first;
+  second[10] ^= 1;
+  second.resize(1100, 3);
+  bool request = true;
+
+  ReceiveBufferPtr message = apply(1, false, first, request);
+  ASSERT_TRUE(static_cast<bool>(message));
+  EXPECT_EQ(first, bytes_of(message));
+  EXPECT_FALSE(request);
+
+  message = apply(2, true, encode(first, second), request);
+  ASSERT_TRUE(static_cast<bool>(message));
+  EXPECT_EQ(second, bytes_of(message));
+  EXPECT_FALSE(request);
+
+  // Duplicates and stale keyframes are dropped
+  EXPECT_FALSE(apply(2, true, encode(first, second), request));
+  EXPECT_FALSE(apply(1, false, first, request));
+  EXPECT_FALSE(request);
+}
+
+TEST_F(TestDeltaStreams, requests_keyframes_for_deltas_without_base) {
+  Bytes first = random_bytes(100, 1);
+  Bytes second = first;
+  second[0] ^= 1;
+  bool request = false;
+
+  // Joined late
+  EXPECT_FALSE(apply(5, true, encode(first, second), request));
+  EXPECT_TRUE(request);
+  // Requests are throttled
+  EXPECT_FALSE(apply(6, true, encode(first, second), request));
+  EXPECT_FALSE(request);
+
+  // A keyframe recovers the stream, a gap loses it again
+  EXPECT_TRUE(apply(6, false, first, request));
+  EXPECT_TRUE(apply(7, true, encode(first, second), request));
+  EXPECT_FALSE(apply(9, true, encode(second, first), request));
+  EXPECT_FALSE(request);
+}
+
+TEST_F(TestDeltaStreams, drops_deltas_claiming_more_than_they_decode_to) {
+  Bytes first = random_bytes(100, 1);
+  bool request = false;
+  ASSERT_TRUE(apply(1, false, first, request));
+
+  // Target length of 2^40, without the bytes for it
+  Bytes huge = {0x80, 0x80, 0x80, 0x80, 0x80, 0x20, 0, 1, 1};
+  EXPECT_FALSE(apply(2, true, huge, request));
+  EXPECT_TRUE(request);
+  EXPECT_LT(pool->bytes_in_use(), 4096u);
+}
@@ -0,0 +1,260 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <fastcdr/Cdr.h>
+#include <fastcdr/FastBuffer.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "rcutils/allocator.h"
+
+#include "rosidl_runtime_c/primitives_sequence_functions.h"
+#include "rosidl_runtime_c/string_functions.h"
+#include "rosidl_typesupport_cpp/message_type_support.hpp"
+
+#include "sensor_msgs/msg/image.h"
+#include "sensor_msgs/msg/image.hpp"
+
+#include "rmw_zenoh_common_cpp/MessageTypeSupport.hpp"
+
+#include "impl/direct_dispatch.hpp"
+#include "impl/receive_buffer_pool.hpp"
+#include "impl/type_support_common.hpp"
+
+using rmw_zenoh_common_cpp::DirectDispatcher;
+using rmw_zenoh_common_cpp::MessageTypeSupport;
+using rmw_zenoh_common_cpp::ReceiveBufferPool;
+using rmw_zenoh_common_cpp::ReceiveBufferPtr;
+
+namespace
+{
+// What the callback saw
+struct Calls
+{
+  std::atomic<int> count{0};
+  const void * message = nullptr;
+  uint32_t width = 0;
+  bool data_matches = false;
+  bool in_sample = false;
+  bool in_callback = false;
+
+  // The sample being dispatched, and the dispatcher
+  const ReceiveBufferPtr * sample = nullptr;
+  const DirectDispatcher * dispatcher = nullptr;
+
+  // Set to make the callback wait for release
+  std::atomic<bool> block{false};
+  std::atomic<bool> entered{false};
+  std::atomic<bool> release{false};
+};
+
+void on_image(const void * ros_message, void * user_data)
+{
+  auto * calls = static_cast<Calls *>(user_data);
+  auto * image = static_cast<const sensor_msgs__msg__Image *>(ros_message);
+  calls->message = ros_message;
+  calls->width = image->width;
+  calls->data_matches = image->data.size == 256;
+  for (size_t i = 0; calls->data_matches && i < image->data.size; ++i) {
+    calls->data_matches = image->data.data[i] == static_cast<uint8_t>(i);
+  }
+  const unsigned char * first = image->data.data;
+  const unsigned char * begin = (*calls->sample)->data();
+  calls->in_sample = first >= begin && first + image->data.size <= begin + (*calls->sample)->size();
+  calls->in_callback = calls->dispatcher->in_callback();
+
+  calls->entered = true;
+  while (calls->block && !calls->release) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ++calls->count;
+}
+
+class DirectDispatchTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    const rosidl_message_type_support_t * type_supports =
+      ROSIDL_GET_MSG_TYPE_SUPPORT(sensor_msgs, msg, Image);
+    const rosidl_message_type_support_t * type_support =
+      get_message_typesupport_handle(type_supports, RMW_ZENOH_CPP_TYPESUPPORT_C);
+    ASSERT_NE(nullptr, type_support);
+    callbacks = static_cast<const message_type_support_callbacks_t *>(type_support->data);
+    type_support_.reset(
+      new MessageTypeSupport(
+        callbacks,
+        rmw_zenoh_common_cpp::get_introspection_type_support(type_supports, type_support)));
+    ASSERT_TRUE(type_support_->canLoanMessages());
+    dispatcher.reset(
+      new DirectDispatcher(
+        type_support_.get(), callbacks, "/images", rcutils_get_default_allocator()));
+    calls.sample = &sample;
+    calls.dispatcher = dispatcher.get();
+
+    pool = ReceiveBufferPool::create(ReceiveBufferPool::Options{false});
+    ASSERT_NE(nullptr, pool);
+
+    // Serialize an image into a receive buffer, as if it had been received
+    sensor_msgs__msg__Image image;
+    ASSERT_TRUE(sensor_msgs__msg__Image__init(&image));
+    ASSERT_TRUE(rosidl_runtime_c__String__assign(&image.encoding, "mono8"));
+    image.width = 16;
+    image.height = 16;
+    ASSERT_TRUE(rosidl_runtime_c__uint8__Sequence__init(&image.data, 256));
+    for (size_t i = 0; i < image.data.size; ++i) {
+      image.data.data[i] = static_cast<uint8_t>(i);
+    }
+    eprosima::fastcdr::FastBuffer buffer;
+    eprosima::fastcdr::Cdr ser(
+      buffer, eprosima::fastcdr::Cdr::DEFAULT_ENDIAN, eprosima::fastcdr::Cdr::DDS_CDR);
+    ASSERT_TRUE(type_support_->serializeROSmessage(&image, ser, callbacks));
+    sensor_msgs__msg__Image__fini(&image);
+    sample = pool->acquire(ser.getSerializedDataLength());
+    memcpy(sample->data(), buffer.getBuffer(), sample->size());
+  }
+
+  void TearDown() override
+  {
+    sample.reset();
+    dispatcher.reset();
+    if (pool) {
+      pool->release();
+    }
+  }
+
+  const message_type_support_callbacks_t * callbacks{nullptr};
+  std::unique_ptr<MessageTypeSupport> type_support_;
+  std::unique_ptr<DirectDispatcher> dispatcher;
+  ReceiveBufferPool * pool{nullptr};
+  ReceiveBufferPtr sample;
+  Calls calls;
+};
+
+TEST_F(DirectDispatchTest, DeserializesIntoTheCallersMessage)
+{
+  sensor_msgs__msg__Image image;
+  ASSERT_TRUE(sensor_msgs__msg__Image__init(&image));
+  EXPECT_FALSE(dispatcher->active());
+
+  // Nothing is called without a callback
+  dispatcher->dispatch(sample);
+  EXPECT_EQ(0, calls.count);
+
+  ASSERT_TRUE(dispatcher->set(on_image, &image, &calls));
+  EXPECT_TRUE(dispatcher->active());
+  dispatcher->dispatch(sample);
+  dispatcher->dispatch(sample);
+  EXPECT_EQ(2, calls.count);
+  EXPECT_EQ(&image, calls.message);
+  EXPECT_EQ(16u, calls.width);
+  EXPECT_TRUE(calls.data_matches);
+  EXPECT_STREQ("mono8", image.encoding.data);
+  // A copy, owned by the caller
+  EXPECT_FALSE(calls.in_sample);
+
+  ASSERT_TRUE(dispatcher->set(nullptr, nullptr, nullptr));
+  EXPECT_FALSE(dispatcher->active());
+  dispatcher->dispatch(sample);
+  EXPECT_EQ(2, calls.count);
+  sensor_msgs__msg__Image__fini(&image);
+}
+
+TEST_F(DirectDispatchTest, BorrowsMessagesViewingTheSample)
+{
+  ASSERT_TRUE(dispatcher->set(on_image, nullptr, &calls));
+  dispatcher->dispatch(sample);
+  EXPECT_EQ(1, calls.count);
+  EXPECT_NE(nullptr, calls.message);
+  EXPECT_EQ(16u, calls.width);
+  EXPECT_TRUE(calls.data_matches);
+  EXPECT_TRUE(calls.in_sample);
+
+  // The borrowed message is kept from one call to the next
+  const void * borrowed = calls.message;
+  dispatcher->dispatch(sample);
+  EXPECT_EQ(2, calls.count);
+  EXPECT_EQ(borrowed, calls.message);
+
+  // Switching to a message of the caller's frees it
+  sensor_msgs__msg__Image image;
+  ASSERT_TRUE(sensor_msgs__msg__Image__init(&image));
+  ASSERT_TRUE(dispatcher->set(on_image, &image, &calls));
+  dispatcher->dispatch(sample);
+  EXPECT_EQ(&image, calls.message);
+  ASSERT_TRUE(dispatcher->set(nullptr, nullptr, nullptr));
+  sensor_msgs__msg__Image__fini(&image);
+}
+
+TEST_F(DirectDispatchTest, OnlyLoanableTypesAreBorrowed)
+{
+  const rosidl_message_type_support_t * type_supports =
+    rosidl_typesupport_cpp::get_message_type_support_handle<sensor_msgs::msg::Image>();
+  const rosidl_message_type_support_t * type_support =
+    get_message_typesupport_handle(type_supports, RMW_ZENOH_CPP_TYPESUPPORT_CPP);
+  ASSERT_NE(nullptr, type_support);
+  MessageTypeSupport cpp_type_support(
+    static_cast<const message_type_support_callbacks_t *>(type_support->data),
+    rmw_zenoh_common_cpp::get_introspection_type_support(type_supports, type_support));
+  DirectDispatcher cpp_dispatcher(
+    &cpp_type_support, type_support->data, "/images", rcutils_get_default_allocator());
+
+  EXPECT_FALSE(cpp_dispatcher.set(on_image, nullptr, &calls));
+  EXPECT_FALSE(cpp_dispatcher.active());
+  sensor_msgs::msg::Image image;
+  EXPECT_TRUE(cpp_dispatcher.set(on_image, &image, &calls));
+  EXPECT_TRUE(cpp_dispatcher.set(nullptr, nullptr, nullptr));
+}
+
+TEST_F(DirectDispatchTest, ClearingWaitsForTheCallInProgress)
+{
+  ASSERT_TRUE(dispatcher->set(on_image, nullptr, &calls));
+  calls.block = true;
+  std::thread receiver([this]() {dispatcher->dispatch(sample);});
+  while (!calls.entered) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // The callback can tell it is in a call, other threads are not
+  EXPECT_TRUE(calls.in_callback);
+  EXPECT_FALSE(dispatcher->in_callback());
+
+  std::atomic<bool> cleared{false};
+  std::thread clearer([this, &cleared]() {
+      EXPECT_TRUE(dispatcher->set(nullptr, nullptr, nullptr));
+      cleared = true;
+    });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(cleared);
+  EXPECT_EQ(0, calls.count);
+
+  calls.release = true;
+  clearer.join();
+  EXPECT_TRUE(cleared);
+  EXPECT_EQ(1, calls.count);
+  receiver.join();
+
+  // No call starts once cleared
+  dispatcher->dispatch(sample);
+  EXPECT_EQ(1, calls.count);
+  EXPECT_FALSE(dispatcher->in_callback());
+}
+
+}  // namespace
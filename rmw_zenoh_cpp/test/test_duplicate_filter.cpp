@@ -0,0 +1,156 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include "impl/duplicate_filter.hpp"
+#include "impl/sample_header.hpp"
+
+using rmw_zenoh_common_cpp::DuplicateFilter;
+using rmw_zenoh_common_cpp::SampleHeader;
+using rmw_zenoh_common_cpp::SampleSequencer;
+
+namespace
+{
+constexpr uint64_t kWindow = DuplicateFilter::kWindow;
+
+class TestDuplicateFilter : public ::testing::Test
+{
+protected:
+  // Header of a sample of publisher number publisher, with a sequence number
+  static SampleHeader header(uint8_t publisher, uint64_t sequence)
+  {
+    SampleHeader header;
+    memset(&header, 0, sizeof(header));
+    header.flags = rmw_zenoh_common_cpp::kSampleFlagSequence;
+    memset(header.publisher_gid, publisher, sizeof(header.publisher_gid));
+    header.publisher_sequence = sequence;
+    return header;
+  }
+
+  bool duplicate(uint8_t publisher, uint64_t sequence)
+  {
+    return filter.duplicate(header(publisher, sequence));
+  }
+
+  DuplicateFilter filter;
+};
+
+TEST_F(TestDuplicateFilter, drops_samples_received_twice)
+{
+  EXPECT_FALSE(duplicate(1, 1));
+  EXPECT_FALSE(duplicate(1, 2));
+  EXPECT_TRUE(duplicate(1, 2));
+  EXPECT_TRUE(duplicate(1, 1));
+  EXPECT_FALSE(duplicate(1, 3));
+  EXPECT_EQ(2u, filter.duplicates());
+}
+
+TEST_F(TestDuplicateFilter, tracks_publishers_apart)
+{
+  EXPECT_FALSE(duplicate(1, 1));
+  EXPECT_FALSE(duplicate(2, 1));
+  EXPECT_TRUE(duplicate(2, 1));
+  EXPECT_EQ(2u, filter.publisher_count());
+}
+
+TEST_F(TestDuplicateFilter, takes_reordered_samples_within_the_window)
+{
+  EXPECT_FALSE(duplicate(1, 10));
+  EXPECT_FALSE(duplicate(1, 5));
+  EXPECT_FALSE(duplicate(1, 7));
+  EXPECT_TRUE(duplicate(1, 5));
+  EXPECT_FALSE(duplicate(1, 1));
+  EXPECT_EQ(1u, filter.duplicates());
+}
+
+TEST_F(TestDuplicateFilter, window_slides_with_the_newest_sample)
+{
+  for (uint64_t sequence = 1; sequence <= 10; ++sequence) {
+    EXPECT_FALSE(duplicate(1, sequence));
+  }
+
+  // Slides the window past 1 to 5, and over the bits of 1025 to 1028
+  const uint64_t newest = kWindow + 5;
+  EXPECT_FALSE(duplicate(1, newest));
+
+  // Too far behind to be told apart from duplicates
+  EXPECT_TRUE(duplicate(1, 5));
+  EXPECT_TRUE(duplicate(1, 1));
+
+  // Still in the window: received before, or skipped by the slide
+  EXPECT_TRUE(duplicate(1, 6));
+  EXPECT_TRUE(duplicate(1, 10));
+  EXPECT_FALSE(duplicate(1, 11));
+  EXPECT_FALSE(duplicate(1, newest - 1));
+  EXPECT_TRUE(duplicate(1, newest - 1));
+}
+
+TEST_F(TestDuplicateFilter, bits_wrap_around_the_window)
+{
+  // The bit of every sequence number is reused a window later
+  for (uint64_t sequence = 1; sequence <= 3 * kWindow; ++sequence) {
+    ASSERT_FALSE(duplicate(1, sequence)) << sequence;
+  }
+  for (uint64_t sequence = 2 * kWindow + 1; sequence <= 3 * kWindow; ++sequence) {
+    ASSERT_TRUE(duplicate(1, sequence)) << sequence;
+  }
+  EXPECT_TRUE(duplicate(1, 2 * kWindow));
+  EXPECT_EQ(kWindow + 1, filter.duplicates());
+}
+
+TEST_F(TestDuplicateFilter, jumps_past_the_window_start_over)
+{
+  EXPECT_FALSE(duplicate(1, 1));
+  EXPECT_FALSE(duplicate(1, 2));
+
+  // Sequence numbers lost by the thousands (a publisher sending while unreachable)
+  const uint64_t newest = 10 * kWindow;
+  EXPECT_FALSE(duplicate(1, newest));
+  EXPECT_FALSE(duplicate(1, newest - kWindow + 1));
+  EXPECT_FALSE(duplicate(1, newest - kWindow + 2));
+  EXPECT_TRUE(duplicate(1, newest - kWindow));
+}
+
+TEST(TestSampleSequencer, stamps_consecutive_sequence_numbers)
+{
+  SampleSequencer sequencer;
+  SampleHeader first;
+  memset(&first, 0, sizeof(first));
+  sequencer.stamp(first);
+  SampleHeader second;
+  memset(&second, 0, sizeof(second));
+  sequencer.stamp(second);
+
+  EXPECT_NE(0, first.flags & rmw_zenoh_common_cpp::kSampleFlagSequence);
+  EXPECT_EQ(1u, first.publisher_sequence);
+  EXPECT_EQ(2u, second.publisher_sequence);
+  EXPECT_EQ(0, memcmp(first.publisher_gid, second.publisher_gid, sizeof(first.publisher_gid)));
+
+  // Another publisher gets a GID of its own
+  SampleSequencer other;
+  SampleHeader header;
+  memset(&header, 0, sizeof(header));
+  other.stamp(header);
+  EXPECT_NE(0, memcmp(first.publisher_gid, header.publisher_gid, sizeof(header.publisher_gid)));
+
+  DuplicateFilter filter;
+  EXPECT_FALSE(filter.duplicate(first));
+  EXPECT_FALSE(filter.duplicate(second));
+  EXPECT_FALSE(filter.duplicate(header));
+  EXPECT_TRUE(filter.duplicate(first));
+}
+}  // namespace
@@ -0,0 +1,225 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#include "rcutils/allocator.h"
+
+#include "impl/entity_arena.hpp"
+
+using rmw_zenoh_common_cpp::EntityArena;
+
+namespace
+{
+constexpr size_t kChunkSize = 16 * 1024;
+constexpr size_t kMaxPooledSize = 4 * 1024;
+constexpr size_t kAlignment = alignof(std::max_align_t);
+
+// Allocator that counts the chunks taken from it, and can be made to fail
+struct CountingAllocator
+{
+  size_t allocations = 0;
+  size_t deallocations = 0;
+  std::vector<size_t> sizes;
+  bool failing = false;
+
+  static void * allocate(size_t size, void * state)
+  {
+    auto * self = static_cast<CountingAllocator *>(state);
+    if (self->failing) {
+      return nullptr;
+    }
+    ++self->allocations;
+    self->sizes.push_back(size);
+    return malloc(size);
+  }
+
+  static void deallocate(void * pointer, void * state)
+  {
+    if (pointer) {
+      ++static_cast<CountingAllocator *>(state)->deallocations;
+    }
+    free(pointer);
+  }
+
+  rcutils_allocator_t get()
+  {
+    rcutils_allocator_t allocator = rcutils_get_default_allocator();
+    allocator.allocate = allocate;
+    allocator.deallocate = deallocate;
+    allocator.state = this;
+    return allocator;
+  }
+
+  size_t live() const {return allocations - deallocations;}
+};
+
+bool aligned(const void * block)
+{
+  return reinterpret_cast<uintptr_t>(block) % kAlignment == 0;
+}
+
+class EntityArenaTest : public ::testing::Test
+{
+protected:
+  CountingAllocator counter;
+};
+
+TEST_F(EntityArenaTest, CarvesBlocksOutOfChunks)
+{
+  EntityArena arena(counter.get());
+  EXPECT_EQ(0u, counter.allocations);
+
+  // Blocks are rounded up to the alignment and laid out one after the other
+  auto * first = static_cast<unsigned char *>(arena.allocate(1));
+  ASSERT_NE(nullptr, first);
+  EXPECT_TRUE(aligned(first));
+  EXPECT_EQ(1u, counter.allocations);
+  unsigned char * previous = first;
+  for (size_t size : {kAlignment, kAlignment + 1, 3 * kAlignment}) {
+    auto * block = static_cast<unsigned char *>(arena.allocate(size));
+    ASSERT_NE(nullptr, block);
+    EXPECT_TRUE(aligned(block));
+    EXPECT_GE(block, previous + kAlignment);
+    previous = block;
+  }
+  EXPECT_EQ(first + 4 * kAlignment, previous);
+  EXPECT_EQ(1u, counter.allocations);
+
+  // A chunk holds kChunkSize bytes of blocks, then a new one is taken
+  size_t used = 7 * kAlignment;
+  while (used + kMaxPooledSize <= kChunkSize) {
+    ASSERT_NE(nullptr, arena.allocate(kMaxPooledSize));
+    used += kMaxPooledSize;
+  }
+  EXPECT_EQ(1u, counter.allocations);
+  ASSERT_NE(nullptr, arena.allocate(kMaxPooledSize));
+  EXPECT_EQ(2u, counter.allocations);
+  EXPECT_GT(counter.sizes.back(), kChunkSize);
+
+  // Blocks are writable all the way through
+  memset(first, 0xff, 1);
+}
+
+TEST_F(EntityArenaTest, ReusesBlocksPerSizeClass)
+{
+  EntityArena arena(counter.get());
+  void * small = arena.allocate(2 * kAlignment);
+  void * medium = arena.allocate(4 * kAlignment);
+  void * wall = arena.allocate(kAlignment);
+  ASSERT_NE(nullptr, small);
+  ASSERT_NE(nullptr, medium);
+  ASSERT_NE(nullptr, wall);
+
+  // Freed blocks go back to the free list of their size class, and are taken last in first out
+  arena.deallocate(small, 2 * kAlignment);
+  arena.deallocate(medium, 4 * kAlignment);
+  EXPECT_EQ(medium, arena.allocate(3 * kAlignment + 1));
+  EXPECT_EQ(small, arena.allocate(2 * kAlignment - 1));
+
+  // A size class without free blocks carves a new one
+  void * fresh = arena.allocate(2 * kAlignment);
+  EXPECT_NE(small, fresh);
+  EXPECT_NE(medium, fresh);
+
+  // Create/destroy cycles do not grow the arena
+  for (int i = 0; i < 10000; ++i) {
+    void * block = arena.allocate(5 * kAlignment);
+    ASSERT_NE(nullptr, block);
+    arena.deallocate(block, 5 * kAlignment);
+  }
+  EXPECT_EQ(1u, counter.allocations);
+
+  // Strings are blocks of their length plus one
+  char * name = arena.strdup("/my_test_ns/my_topic");
+  ASSERT_NE(nullptr, name);
+  EXPECT_STREQ("/my_test_ns/my_topic", name);
+  arena.deallocate_string(name);
+  EXPECT_EQ(name, arena.strdup("/my_test_ns/other"));
+  arena.deallocate_string(nullptr);
+  arena.deallocate(nullptr, kAlignment);
+}
+
+TEST_F(EntityArenaTest, LargeBlocksGetTheirOwnChunk)
+{
+  EntityArena arena(counter.get());
+  void * small = arena.allocate(kAlignment);
+  ASSERT_NE(nullptr, small);
+  EXPECT_EQ(1u, counter.allocations);
+
+  void * large = arena.allocate(kMaxPooledSize + 1);
+  ASSERT_NE(nullptr, large);
+  EXPECT_TRUE(aligned(large));
+  EXPECT_EQ(2u, counter.allocations);
+  EXPECT_GT(counter.sizes.back(), kMaxPooledSize + 1);
+  EXPECT_LT(counter.sizes.back(), kChunkSize);
+  memset(large, 0, kMaxPooledSize + 1);
+
+  // Not reused, and not given back before the arena is destroyed
+  arena.deallocate(large, kMaxPooledSize + 1);
+  EXPECT_EQ(0u, counter.deallocations);
+  void * again = arena.allocate(kMaxPooledSize + 1);
+  EXPECT_NE(nullptr, again);
+  EXPECT_EQ(3u, counter.allocations);
+
+  // Small blocks keep being carved out of the pooled chunk
+  auto * next = static_cast<unsigned char *>(arena.allocate(kAlignment));
+  EXPECT_EQ(static_cast<unsigned char *>(small) + kAlignment, next);
+  EXPECT_EQ(3u, counter.allocations);
+
+  // Exactly kMaxPooledSize is still pooled
+  arena.allocate(kMaxPooledSize);
+  EXPECT_EQ(3u, counter.allocations);
+}
+
+TEST_F(EntityArenaTest, TeardownHandsBackChunksWithLiveBlocks)
+{
+  {
+    EntityArena arena(counter.get());
+    std::set<void *> blocks;
+    for (int i = 0; i < 2000; ++i) {
+      void * block = arena.allocate(static_cast<size_t>(1 + i % 200));
+      ASSERT_NE(nullptr, block);
+      EXPECT_TRUE(blocks.insert(block).second);
+    }
+    ASSERT_NE(nullptr, arena.allocate(10000));
+    EXPECT_LT(counter.allocations, 30u);
+    EXPECT_EQ(0u, counter.deallocations);
+  }
+  // One deallocation per chunk, whatever the number of blocks still live
+  EXPECT_EQ(counter.allocations, counter.deallocations);
+  EXPECT_EQ(0u, counter.live());
+}
+
+TEST_F(EntityArenaTest, OutOfMemory)
+{
+  EntityArena arena(counter.get());
+  counter.failing = true;
+  EXPECT_EQ(nullptr, arena.allocate(kAlignment));
+  EXPECT_EQ(nullptr, arena.allocate(kMaxPooledSize + 1));
+  EXPECT_EQ(nullptr, arena.strdup("name"));
+
+  // Recovers once memory is available again
+  counter.failing = false;
+  EXPECT_NE(nullptr, arena.allocate(kAlignment));
+  EXPECT_EQ(1u, counter.allocations);
+}
+
+}  // namespace
@@ -0,0 +1,184 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "impl/history_ring.hpp"
+
+using rmw_zenoh_common_cpp::HistoryQuery;
+using rmw_zenoh_common_cpp::HistoryRing;
+
+namespace
+{
+class TestHistoryRing : public ::testing::Test
+{
+protected:
+  // Keep a sample carrying its number, published at timestamp
+  static void push(HistoryRing & ring, int64_t timestamp, unsigned char number)
+  {
+    ring.push(timestamp, &number, 1);
+  }
+
+  // Numbers of the samples answering a query, in the order of the replies
+  static std::vector<int> numbers(
+    const HistoryRing & ring, const HistoryQuery & query, int64_t now)
+  {
+    std::vector<int> numbers;
+    for (const auto & reply : ring.query(query, now)) {
+      int64_t timestamp;
+      uint64_t sequence;
+      EXPECT_TRUE(
+        rmw_zenoh_common_cpp::read_history_reply_header(
+          reply.data(), reply.size(), timestamp, sequence));
+      EXPECT_EQ(rmw_zenoh_common_cpp::kHistoryReplyHeaderSize + 1, reply.size());
+      numbers.push_back(reply.back());
+    }
+    return numbers;
+  }
+
+  static HistoryQuery range(int64_t since, int64_t until, size_t last = 0)
+  {
+    HistoryQuery query;
+    query.since = since;
+    query.until = until;
+    query.last = last;
+    return query;
+  }
+};
+
+TEST(TestHistoryQuery, round_trips_through_the_predicate)
+{
+  HistoryQuery query;
+  EXPECT_EQ("", rmw_zenoh_common_cpp::format_history_query(query));
+
+  query.last = 5;
+  query.since = 1000;
+  query.until = 2000;
+  std::string predicate = rmw_zenoh_common_cpp::format_history_query(query);
+  EXPECT_EQ("last=5&since=1000&until=2000", predicate);
+
+  HistoryQuery parsed;
+  ASSERT_TRUE(rmw_zenoh_common_cpp::parse_history_query(predicate, parsed));
+  EXPECT_EQ(5u, parsed.last);
+  EXPECT_EQ(1000, parsed.since);
+  EXPECT_EQ(2000, parsed.until);
+
+  ASSERT_TRUE(rmw_zenoh_common_cpp::parse_history_query("until=7", parsed));
+  EXPECT_EQ(0u, parsed.last);
+  EXPECT_EQ(0, parsed.since);
+  EXPECT_EQ(7, parsed.until);
+
+  ASSERT_TRUE(rmw_zenoh_common_cpp::parse_history_query("", parsed));
+  EXPECT_EQ(0u, parsed.last);
+  EXPECT_EQ(0, parsed.until);
+}
+
+TEST(TestHistoryQuery, rejects_malformed_predicates)
+{
+  HistoryQuery query;
+  EXPECT_FALSE(rmw_zenoh_common_cpp::parse_history_query("last", query));
+  EXPECT_FALSE(rmw_zenoh_common_cpp::parse_history_query("last=", query));
+  EXPECT_FALSE(rmw_zenoh_common_cpp::parse_history_query("last=-1", query));
+  EXPECT_FALSE(rmw_zenoh_common_cpp::parse_history_query("last=5x", query));
+  EXPECT_FALSE(rmw_zenoh_common_cpp::parse_history_query("first=5", query));
+  EXPECT_FALSE(
+    rmw_zenoh_common_cpp::parse_history_query("since=99999999999999999999", query));
+}
+
+TEST(TestHistoryReply, round_trips_the_header)
+{
+  unsigned char header[rmw_zenoh_common_cpp::kHistoryReplyHeaderSize];
+  rmw_zenoh_common_cpp::write_history_reply_header(1234567890123, 42, header);
+
+  int64_t timestamp = 0;
+  uint64_t sequence = 0;
+  ASSERT_TRUE(
+    rmw_zenoh_common_cpp::read_history_reply_header(
+      header, sizeof(header), timestamp, sequence));
+  EXPECT_EQ(1234567890123, timestamp);
+  EXPECT_EQ(42u, sequence);
+
+  EXPECT_FALSE(
+    rmw_zenoh_common_cpp::read_history_reply_header(
+      header, sizeof(header) - 1, timestamp, sequence));
+}
+
+TEST_F(TestHistoryRing, keeps_the_last_depth_samples)
+{
+  HistoryRing ring(3, 0);
+  for (int i = 1; i <= 5; ++i) {
+    push(ring, i * 10, static_cast<unsigned char>(i));
+  }
+  EXPECT_EQ(3u, ring.size());
+  EXPECT_EQ(std::vector<int>({3, 4, 5}), numbers(ring, HistoryQuery(), 50));
+
+  // Sequence numbers keep counting the samples that were overwritten
+  auto replies = ring.query(HistoryQuery(), 50);
+  ASSERT_EQ(3u, replies.size());
+  int64_t timestamp;
+  uint64_t sequence;
+  ASSERT_TRUE(
+    rmw_zenoh_common_cpp::read_history_reply_header(
+      replies[0].data(), replies[0].size(), timestamp, sequence));
+  EXPECT_EQ(30, timestamp);
+  EXPECT_EQ(2u, sequence);
+}
+
+TEST_F(TestHistoryRing, answers_ranges_and_last)
+{
+  HistoryRing ring(10, 0);
+  for (int i = 1; i <= 6; ++i) {
+    push(ring, i * 10, static_cast<unsigned char>(i));
+  }
+
+  // Both ends are included
+  EXPECT_EQ(std::vector<int>({2, 3, 4}), numbers(ring, range(20, 40), 60));
+  EXPECT_EQ(std::vector<int>({3, 4, 5, 6}), numbers(ring, range(25, 0), 60));
+  EXPECT_EQ(std::vector<int>({1, 2}), numbers(ring, range(0, 29), 60));
+  EXPECT_EQ(std::vector<int>({4, 5}), numbers(ring, range(20, 50, 2), 60));
+  EXPECT_EQ(std::vector<int>({5, 6}), numbers(ring, range(0, 0, 2), 60));
+  EXPECT_TRUE(numbers(ring, range(70, 0), 60).empty());
+}
+
+TEST_F(TestHistoryRing, drops_samples_older_than_max_age)
+{
+  HistoryRing ring(10, 25);
+  for (int i = 1; i <= 6; ++i) {
+    push(ring, i * 10, static_cast<unsigned char>(i));
+  }
+  EXPECT_EQ(3u, ring.size());
+  EXPECT_EQ(std::vector<int>({4, 5, 6}), numbers(ring, HistoryQuery(), 60));
+
+  // Queries leave out the samples that aged out since the last push
+  EXPECT_EQ(std::vector<int>({6}), numbers(ring, HistoryQuery(), 80));
+  EXPECT_TRUE(numbers(ring, HistoryQuery(), 100).empty());
+}
+
+TEST_F(TestHistoryRing, searches_the_ring_when_the_clock_goes_back)
+{
+  HistoryRing ring(10, 0);
+  push(ring, 100, 1);
+  push(ring, 110, 2);
+  push(ring, 50, 3);  // The system clock was set back
+  push(ring, 60, 4);
+  push(ring, 120, 5);
+
+  EXPECT_EQ(std::vector<int>({1, 2, 5}), numbers(ring, range(100, 0), 120));
+  EXPECT_EQ(std::vector<int>({3, 4}), numbers(ring, range(0, 99), 120));
+  EXPECT_EQ(std::vector<int>({4, 5}), numbers(ring, range(0, 0, 2), 120));
+}
+}  // namespace
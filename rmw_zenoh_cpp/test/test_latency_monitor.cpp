@@ -0,0 +1,121 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "impl/latency_monitor.hpp"
+
+using rmw_zenoh_common_cpp::LatencyMonitor;
+
+namespace
+{
+constexpr int64_t kUs = 1000;
+constexpr int64_t kMs = 1000 * kUs;
+constexpr int64_t kS = 1000 * kMs;
+
+TEST(TestLatencyMonitor, percentiles_are_within_a_sixteenth)
+{
+  LatencyMonitor monitor(kS, kS);
+  for (int64_t i = 1; i <= 1000; ++i) {
+    monitor.record(i * kMs / 10, 0);
+  }
+  EXPECT_EQ(1000u, monitor.count(0));
+
+  // Percentiles are rounded up to the limit of their bucket
+  int64_t p99 = monitor.percentile(0.99, 0);
+  EXPECT_GE(p99, 99 * kMs);
+  EXPECT_LE(p99, 99 * kMs + 99 * kMs / 16);
+  int64_t median = monitor.percentile(0.5, 0);
+  EXPECT_GE(median, 50 * kMs);
+  EXPECT_LE(median, 50 * kMs + 50 * kMs / 16);
+
+  // Never over the highest latency recorded
+  EXPECT_EQ(100 * kMs, monitor.percentile(1.0, 0));
+  EXPECT_EQ(100 * kMs, monitor.max_latency());
+}
+
+TEST(TestLatencyMonitor, counts_small_latencies_to_the_microsecond)
+{
+  LatencyMonitor monitor(kS, kS);
+  EXPECT_EQ(0, monitor.percentile(0.99, 0));
+
+  for (int64_t us = 1; us <= 10; ++us) {
+    monitor.record(us * kUs, 0);
+  }
+  EXPECT_EQ(5 * kUs + kUs, monitor.percentile(0.5, 0));
+  EXPECT_EQ(10 * kUs, monitor.percentile(0.99, 0));
+
+  // Samples stamped ahead of the take count as no latency at all
+  LatencyMonitor ahead(kS, kS);
+  ahead.record(-5 * kMs, 0);
+  EXPECT_EQ(0, ahead.percentile(0.99, 0));
+}
+
+TEST(TestLatencyMonitor, p99_ignores_one_sample_in_a_hundred)
+{
+  LatencyMonitor monitor(10 * kMs, kS);
+  for (int i = 0; i < 99; ++i) {
+    EXPECT_FALSE(monitor.record(kMs, 0));
+  }
+  EXPECT_FALSE(monitor.record(50 * kMs, 0));
+  EXPECT_FALSE(monitor.breached());
+  EXPECT_EQ(1u, monitor.over_budget());
+  EXPECT_LE(monitor.percentile(0.99, 0), kMs + kMs / 16);
+
+  // A second one in 101 is at the 99th percentile
+  EXPECT_TRUE(monitor.record(50 * kMs, 0));
+  EXPECT_TRUE(monitor.breached());
+  EXPECT_EQ(1u, monitor.breaches());
+  EXPECT_GE(monitor.percentile(0.99, 0), 50 * kMs);
+
+  // Staying over the budget is the same breach
+  EXPECT_FALSE(monitor.record(50 * kMs, 0));
+  EXPECT_EQ(1u, monitor.breaches());
+  EXPECT_EQ(3u, monitor.over_budget());
+}
+
+TEST(TestLatencyMonitor, window_slides_slice_by_slice)
+{
+  // Slices of 100 ms
+  LatencyMonitor monitor(10 * kMs, kS);
+  for (int i = 0; i < 10; ++i) {
+    monitor.record(50 * kMs, 0);
+  }
+  EXPECT_TRUE(monitor.breached());
+  for (int i = 0; i < 10; ++i) {
+    monitor.record(kMs, 950 * kMs);
+  }
+  EXPECT_EQ(20u, monitor.count(950 * kMs));
+  EXPECT_GE(monitor.percentile(0.99, 950 * kMs), 50 * kMs);
+
+  // The slice of the first samples leaves the window a window after it started
+  EXPECT_EQ(20u, monitor.count(999 * kMs));
+  EXPECT_EQ(10u, monitor.count(kS));
+  EXPECT_LE(monitor.percentile(0.99, kS), kMs + kMs / 16);
+
+  // Back under the budget with the next sample, and breached again by later ones
+  EXPECT_FALSE(monitor.record(kMs, kS));
+  EXPECT_FALSE(monitor.breached());
+  for (int i = 0; i < 10; ++i) {
+    monitor.record(50 * kMs, kS);
+  }
+  EXPECT_TRUE(monitor.breached());
+  EXPECT_EQ(2u, monitor.breaches());
+
+  // A gap longer than the window empties it
+  EXPECT_EQ(0u, monitor.count(10 * kS));
+  EXPECT_EQ(0, monitor.percentile(0.99, 10 * kS));
+}
+}  // namespace
@@ -0,0 +1,240 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/rmw.h"
+#include "rmw/error_handling.h"
+
+#include "rosidl_runtime_c/primitives_sequence_functions.h"
+#include "rosidl_runtime_c/string_functions.h"
+#include "rosidl_typesupport_cpp/message_type_support.hpp"
+
+#include "sensor_msgs/msg/image.h"
+#include "test_msgs/msg/basic_types.hpp"
+
+#include "rmw_zenoh_common_cpp/rmw_context_impl.hpp"
+
+#include "impl/pubsub_impl.hpp"
+#include "impl/receive_buffer_pool.hpp"
+
+#include "./config.hpp"
+
+#ifdef RMW_IMPLEMENTATION
+# define CLASSNAME_(NAME, SUFFIX) NAME ## __ ## SUFFIX
+# define CLASSNAME(NAME, SUFFIX) CLASSNAME_(NAME, SUFFIX)
+#else
+# define CLASSNAME(NAME, SUFFIX) NAME
+#endif
+
+// Loaned takes of C images, whose data is left pointing into the receive buffer of the sample
+class CLASSNAME (TestLoanedMessages, RMW_IMPLEMENTATION) : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rmw_ret_t ret = rmw_init_options_init(&init_options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", init_options.enclave);
+    ret = rmw_init(&init_options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    node = rmw_create_node(&context, "my_test_node", "/my_test_ns", 0, false);
+    ASSERT_NE(nullptr, node) << rcutils_get_error_string().str;
+
+    rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+    pub = rmw_create_publisher(node, ts, topic_name, &rmw_qos_profile_default, &pub_options);
+    ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+    rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+    sub = rmw_create_subscription(node, ts, topic_name, &rmw_qos_profile_default, &sub_options);
+    ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
+    std::this_thread::sleep_for(rmw_intraprocess_discovery_delay);
+
+    ASSERT_TRUE(sensor_msgs__msg__Image__init(&image));
+    ASSERT_TRUE(rosidl_runtime_c__String__assign(&image.encoding, "mono8"));
+    image.height = 16;
+    image.width = 64;
+    image.step = 64;
+    ASSERT_TRUE(rosidl_runtime_c__uint8__Sequence__init(&image.data, 16 * 64));
+    for (size_t i = 0; i < image.data.size; ++i) {
+      image.data.data[i] = static_cast<uint8_t>(i * 7);
+    }
+  }
+
+  void TearDown() override
+  {
+    sensor_msgs__msg__Image__fini(&image);
+    if (sub) {
+      EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub)) << rmw_get_error_string().str;
+    }
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, pub)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_node(node)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_shutdown(&context)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_context_fini(&context)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_init_options_fini(&init_options)) << rmw_get_error_string().str;
+  }
+
+  // Publish the image and take it on loan, waiting up to a second for it
+  sensor_msgs__msg__Image * publish_and_take()
+  {
+    rmw_ret_t ret = rmw_publish(pub, &image, nullptr);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    for (int i = 0; i < 100; ++i) {
+      void * loaned = nullptr;
+      bool taken = false;
+      ret = rmw_take_loaned_message(sub, &loaned, &taken, nullptr);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+      if (taken) {
+        return static_cast<sensor_msgs__msg__Image *>(loaned);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return nullptr;
+  }
+
+  // The receive buffer a loaned message is pinning (empty if it pins none)
+  rmw_zenoh_common_cpp::ReceiveBufferPtr loaned_buffer(void * loaned)
+  {
+    auto * subscription_data = static_cast<rmw_subscription_data_t *>(sub->data);
+    std::lock_guard<std::mutex> lock(subscription_data->loaned_messages_mutex_);
+    auto it = subscription_data->loaned_messages_.find(loaned);
+    return it == subscription_data->loaned_messages_.end() ?
+           rmw_zenoh_common_cpp::ReceiveBufferPtr() : it->second.buffer;
+  }
+
+  size_t rx_bytes_in_use() const
+  {
+    return context.impl->rx_buffer_pool->bytes_in_use();
+  }
+
+  rmw_init_options_t init_options{rmw_get_zero_initialized_init_options()};
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+  rmw_node_t * node{nullptr};
+  rmw_publisher_t * pub{nullptr};
+  rmw_subscription_t * sub{nullptr};
+  const char * const topic_name = "/loaned_images";
+  const rosidl_message_type_support_t * ts{ROSIDL_GET_MSG_TYPE_SUPPORT(sensor_msgs, msg, Image)};
+  sensor_msgs__msg__Image image;
+};
+
+TEST_F(CLASSNAME(TestLoanedMessages, RMW_IMPLEMENTATION), c_messages_can_be_loaned) {
+  // Without RMW_ZENOH_SERIALIZATION_PLANS set
+  EXPECT_TRUE(sub->can_loan_messages);
+
+  // C++ messages cannot point into the receive buffers
+  rmw_subscription_options_t options = rmw_get_default_subscription_options();
+  rmw_subscription_t * cpp_sub = rmw_create_subscription(
+    node, rosidl_typesupport_cpp::get_message_type_support_handle<test_msgs::msg::BasicTypes>(),
+    "/loaned_basic_types", &rmw_qos_profile_default, &options);
+  ASSERT_NE(nullptr, cpp_sub) << rmw_get_error_string().str;
+  EXPECT_FALSE(cpp_sub->can_loan_messages);
+  void * loaned = nullptr;
+  bool taken = false;
+  EXPECT_EQ(RMW_RET_UNSUPPORTED, rmw_take_loaned_message(cpp_sub, &loaned, &taken, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, cpp_sub)) << rmw_get_error_string().str;
+}
+
+TEST_F(CLASSNAME(TestLoanedMessages, RMW_IMPLEMENTATION), sequences_view_the_sample_buffer) {
+  sensor_msgs__msg__Image * loaned = publish_and_take();
+  ASSERT_NE(nullptr, loaned);
+  EXPECT_STREQ("mono8", loaned->encoding.data);
+  EXPECT_EQ(64u, loaned->width);
+  ASSERT_EQ(image.data.size, loaned->data.size);
+  for (size_t i = 0; i < image.data.size; ++i) {
+    ASSERT_EQ(image.data.data[i], loaned->data.data[i]) << i;
+  }
+
+  // Not a copy: the data lies inside the receive buffer of the sample
+  rmw_zenoh_common_cpp::ReceiveBufferPtr buffer = loaned_buffer(loaned);
+  ASSERT_TRUE(static_cast<bool>(buffer));
+  const unsigned char * first = reinterpret_cast<const unsigned char *>(loaned->data.data);
+  EXPECT_GE(first, buffer->data());
+  EXPECT_LE(first + loaned->data.size, buffer->data() + buffer->size());
+  buffer.reset();
+
+  EXPECT_EQ(RMW_RET_OK, rmw_return_loaned_message_from_subscription(sub, loaned)) <<
+    rmw_get_error_string().str;
+}
+
+TEST_F(CLASSNAME(TestLoanedMessages, RMW_IMPLEMENTATION), buffer_is_pinned_until_returned) {
+  sensor_msgs__msg__Image * loaned = publish_and_take();
+  ASSERT_NE(nullptr, loaned);
+  size_t capacity = loaned_buffer(loaned)->capacity();
+
+  // The queue is empty, so the loan is all that holds on to a receive buffer
+  EXPECT_EQ(capacity, rx_bytes_in_use());
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(capacity, rx_bytes_in_use());
+  EXPECT_EQ(image.data.data[100], loaned->data.data[100]);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_return_loaned_message_from_subscription(sub, loaned)) <<
+    rmw_get_error_string().str;
+  EXPECT_EQ(0u, rx_bytes_in_use());
+
+  // A message cannot be returned twice
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_return_loaned_message_from_subscription(sub, loaned));
+  rmw_reset_error();
+}
+
+TEST_F(CLASSNAME(TestLoanedMessages, RMW_IMPLEMENTATION), return_checks_its_arguments) {
+  sensor_msgs__msg__Image * loaned = publish_and_take();
+  ASSERT_NE(nullptr, loaned);
+
+  // Not loaned by this subscription
+  sensor_msgs__msg__Image foreign;
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_return_loaned_message_from_subscription(sub, &foreign));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_return_loaned_message_from_subscription(sub, nullptr));
+  rmw_reset_error();
+  EXPECT_EQ(
+    RMW_RET_INVALID_ARGUMENT, rmw_return_loaned_message_from_subscription(nullptr, loaned));
+  rmw_reset_error();
+
+  const char * implementation_identifier = sub->implementation_identifier;
+  sub->implementation_identifier = "not-an-rmw-implementation-identifier";
+  EXPECT_EQ(
+    RMW_RET_INCORRECT_RMW_IMPLEMENTATION,
+    rmw_return_loaned_message_from_subscription(sub, loaned));
+  rmw_reset_error();
+  sub->implementation_identifier = implementation_identifier;
+
+  EXPECT_EQ(RMW_RET_OK, rmw_return_loaned_message_from_subscription(sub, loaned)) <<
+    rmw_get_error_string().str;
+}
+
+TEST_F(CLASSNAME(TestLoanedMessages, RMW_IMPLEMENTATION), loans_are_freed_with_the_subscription) {
+  sensor_msgs__msg__Image * first = publish_and_take();
+  ASSERT_NE(nullptr, first);
+  sensor_msgs__msg__Image * second = publish_and_take();
+  ASSERT_NE(nullptr, second);
+  EXPECT_GT(rx_bytes_in_use(), 0u);
+
+  // Never returned: destroying the subscription frees both (leaks would show under a leak
+  // checker) and unpins their buffers
+  EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub)) << rmw_get_error_string().str;
+  sub = nullptr;
+  EXPECT_EQ(0u, rx_bytes_in_use());
+}
@@ -0,0 +1,110 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "impl/config.hpp"
+#include "impl/overload_detector.hpp"
+
+using rmw_zenoh_common_cpp::OverloadDetector;
+using rmw_zenoh_common_cpp::TopicPriority;
+
+namespace
+{
+constexpr int64_t kMs = 1000000;
+constexpr int64_t kSlice = OverloadDetector::kSlice;
+
+TEST(TestOverloadDetector, sheds_by_priority_as_bytes_in_use_grow)
+{
+  OverloadDetector detector(0, 1000);
+  EXPECT_FALSE(detector.shed(TopicPriority::kLow, 999, 0));
+  EXPECT_EQ(0, detector.level());
+
+  EXPECT_TRUE(detector.shed(TopicPriority::kLow, 1000, 0));
+  EXPECT_FALSE(detector.shed(TopicPriority::kNormal, 1000, 0));
+  EXPECT_EQ(1, detector.level());
+
+  EXPECT_TRUE(detector.shed(TopicPriority::kLow, 2000, 0));
+  EXPECT_TRUE(detector.shed(TopicPriority::kNormal, 2000, 0));
+  EXPECT_EQ(2, detector.level());
+
+  // High priority samples are never shed, and do not update the level
+  EXPECT_FALSE(detector.shed(TopicPriority::kHigh, 1000000, 0));
+  EXPECT_FALSE(detector.shed(TopicPriority::kHigh, 0, 0));
+  EXPECT_EQ(2, detector.level());
+}
+
+TEST(TestOverloadDetector, recovers_with_hysteresis)
+{
+  OverloadDetector detector(0, 1000);
+  EXPECT_TRUE(detector.shed(TopicPriority::kNormal, 2000, 0));
+
+  // Normal priority samples are shed until the load is under 0.8 * 2
+  EXPECT_TRUE(detector.shed(TopicPriority::kNormal, 1700, 0));
+  EXPECT_FALSE(detector.shed(TopicPriority::kNormal, 1500, 0));
+  EXPECT_EQ(1, detector.level());
+
+  // And low priority ones until it is under 0.8
+  EXPECT_TRUE(detector.shed(TopicPriority::kLow, 900, 0));
+  EXPECT_TRUE(detector.shed(TopicPriority::kLow, 800, 0));
+  EXPECT_FALSE(detector.shed(TopicPriority::kLow, 799, 0));
+  EXPECT_EQ(0, detector.level());
+
+  // From level 2 straight down to 0
+  EXPECT_TRUE(detector.shed(TopicPriority::kNormal, 2500, 0));
+  EXPECT_FALSE(detector.shed(TopicPriority::kLow, 100, 0));
+  EXPECT_EQ(0, detector.level());
+}
+
+TEST(TestOverloadDetector, queue_delay_counts_for_one_or_two_slices)
+{
+  OverloadDetector detector(10 * kMs, 0);
+  detector.record_delay(15 * kMs, 0);
+  EXPECT_TRUE(detector.shed(TopicPriority::kLow, 0, 0));
+  EXPECT_FALSE(detector.shed(TopicPriority::kNormal, 0, 0));
+
+  // The delay of the previous slice still counts
+  EXPECT_TRUE(detector.shed(TopicPriority::kLow, 0, kSlice + kSlice / 2));
+
+  // But not once a slice went by without it
+  EXPECT_FALSE(detector.shed(TopicPriority::kLow, 0, 2 * kSlice + kSlice / 2));
+  EXPECT_EQ(0, detector.level());
+
+  detector.record_delay(25 * kMs, 3 * kSlice);
+  EXPECT_TRUE(detector.shed(TopicPriority::kNormal, 0, 3 * kSlice));
+
+  // A slice with no samples taken in it counts as no delay
+  EXPECT_FALSE(detector.shed(TopicPriority::kLow, 0, 5 * kSlice + kSlice / 2));
+}
+
+TEST(TestOverloadDetector, takes_the_higher_of_both_loads)
+{
+  OverloadDetector detector(10 * kMs, 1000);
+  detector.record_delay(5 * kMs, 0);
+  EXPECT_FALSE(detector.shed(TopicPriority::kLow, 500, 0));
+  EXPECT_TRUE(detector.shed(TopicPriority::kLow, 1000, 0));
+
+  detector.record_delay(20 * kMs, 0);
+  EXPECT_TRUE(detector.shed(TopicPriority::kNormal, 0, 0));
+}
+
+TEST(TestOverloadDetector, watches_nothing_without_thresholds)
+{
+  OverloadDetector detector(0, 0);
+  detector.record_delay(1000 * kMs, 0);
+  EXPECT_FALSE(detector.shed(TopicPriority::kLow, 1000000000, 0));
+  EXPECT_EQ(0, detector.level());
+}
+}  // namespace
@@ -14,9 +14,15 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
 #include "osrf_testing_tools_cpp/memory_tools/gtest_quickstart.hpp"
 
 #include "rcutils/allocator.h"
+#include "rcutils/env.h"
 #include "rcutils/strdup.h"
 
 #include "rmw/rmw.h"
@@ -24,6 +30,8 @@
 
 #include "test_msgs/msg/basic_types.h"
 
+#include "rmw_zenoh_common_cpp/rmw_zenoh_extensions.h"
+
 #include "./config.hpp"
 #include "./testing_macros.hpp"
 
@@ -96,6 +104,142 @@ TEST_F(CLASSNAME(TestPublisher, RMW_IMPLEMENTATION), create_and_destroy_native)
   EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
 }
 
+TEST_F(CLASSNAME(TestPublisher, RMW_IMPLEMENTATION), publish_over_rate_limit) {
+  rmw_zenoh_publisher_options_t zenoh_options{};
+  zenoh_options.rate_limit = 1;
+  zenoh_options.burst = 1;
+  zenoh_options.rate_limit_mode = RMW_ZENOH_RATE_LIMIT_DROP;
+  rmw_publisher_options_t options = rmw_get_default_publisher_options();
+  options.rmw_specific_publisher_payload = &zenoh_options;
+  constexpr char topic_name[] = "/test";
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+  rmw_publisher_t * pub =
+    rmw_create_publisher(node, ts, topic_name, &rmw_qos_profile_default, &options);
+  ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+
+  // The first message empties the bucket, the second one is dropped
+  test_msgs__msg__BasicTypes msg{};
+  rmw_ret_t ret = rmw_publish(pub, &msg, nullptr);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  ret = rmw_publish(pub, &msg, nullptr);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+
+  rmw_zenoh_publisher_shaping_stats_t stats;
+  ret = rmw_zenoh_get_publisher_shaping_stats(pub, &stats);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(1u, stats.dropped_messages);
+  EXPECT_LT(0u, stats.dropped_bytes);
+
+  ret = rmw_zenoh_get_publisher_shaping_stats(pub, nullptr);
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, ret);
+  rmw_reset_error();
+
+  ret = rmw_destroy_publisher(node, pub);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+}
+
+// Publishes /delta_test as deltas, through a config file given to rmw_init
+class CLASSNAME (TestPublisherDelta, RMW_IMPLEMENTATION)
+  : public CLASSNAME(TestPublisher, RMW_IMPLEMENTATION)
+{
+protected:
+  using Base = CLASSNAME(TestPublisher, RMW_IMPLEMENTATION);
+
+  void SetUp() override
+  {
+    {
+      std::ofstream config(config_file);
+      config << "topic /delta_test delta=true keyframe_interval=100\n";
+    }
+    ASSERT_TRUE(rcutils_set_env("RMW_ZENOH_CONFIG_FILE", config_file));
+    Base::SetUp();
+    ASSERT_TRUE(rcutils_set_env("RMW_ZENOH_CONFIG_FILE", nullptr));
+  }
+
+  void TearDown() override
+  {
+    Base::TearDown();
+    std::remove(config_file);
+  }
+
+  // Take a message, waiting up to a second for one
+  bool take(rmw_subscription_t * sub, test_msgs__msg__BasicTypes & msg)
+  {
+    for (int i = 0; i < 100; ++i) {
+      bool taken = false;
+      rmw_ret_t ret = rmw_take(sub, &msg, &taken, nullptr);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+      if (taken) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+  }
+
+  const char * const config_file = "test_publisher_delta.config";
+};
+
+TEST_F(CLASSNAME(TestPublisherDelta, RMW_IMPLEMENTATION), publish_deltas_over_rate_limit) {
+  // Room for one message (52 bytes serialized) at a time, refilled within 100 ms
+  rmw_zenoh_publisher_options_t zenoh_options{};
+  zenoh_options.rate_limit = 1000;
+  zenoh_options.burst = 80;
+  zenoh_options.rate_limit_mode = RMW_ZENOH_RATE_LIMIT_DROP;
+  rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+  pub_options.rmw_specific_publisher_payload = &zenoh_options;
+  constexpr char topic_name[] = "/delta_test";
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+  rmw_publisher_t * pub =
+    rmw_create_publisher(node, ts, topic_name, &rmw_qos_profile_default, &pub_options);
+  ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+  rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+  rmw_subscription_t * sub =
+    rmw_create_subscription(node, ts, topic_name, &rmw_qos_profile_default, &sub_options);
+  ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
+  std::this_thread::sleep_for(rmw_intraprocess_discovery_delay);
+
+  // The first message is a keyframe, the next ones are deltas
+  test_msgs__msg__BasicTypes msg{};
+  test_msgs__msg__BasicTypes taken_msg{};
+  msg.int32_value = 1;
+  rmw_ret_t ret = rmw_publish(pub, &msg, nullptr);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  ASSERT_TRUE(take(sub, taken_msg));
+  EXPECT_EQ(1, taken_msg.int32_value);
+
+  // The second message empties the bucket again, so the third one is dropped
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  msg.int32_value = 2;
+  ret = rmw_publish(pub, &msg, nullptr);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  msg.int32_value = 3;
+  ret = rmw_publish(pub, &msg, nullptr);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  ASSERT_TRUE(take(sub, taken_msg));
+  EXPECT_EQ(2, taken_msg.int32_value);
+
+  rmw_zenoh_publisher_shaping_stats_t stats;
+  ret = rmw_zenoh_get_publisher_shaping_stats(pub, &stats);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(1u, stats.dropped_messages);
+
+  // The delta after the dropped message is still against the last message sent
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  msg.int32_value = 4;
+  ret = rmw_publish(pub, &msg, nullptr);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  ASSERT_TRUE(take(sub, taken_msg));
+  EXPECT_EQ(4, taken_msg.int32_value);
+
+  ret = rmw_destroy_subscription(node, sub);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  ret = rmw_destroy_publisher(node, pub);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+}
+
 TEST_F(CLASSNAME(TestPublisher, RMW_IMPLEMENTATION), create_with_bad_arguments) {
   rmw_publisher_options_t options = rmw_get_default_publisher_options();
   constexpr char topic_name[] = "/test";
@@ -266,3 +410,33 @@ TEST_F(CLASSNAME(TestPublisherUse, RMW_IMPLEMENTATION), count_matched_subscripti
   EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, ret);
   rmw_reset_error();
 }
+
+TEST_F(CLASSNAME(TestPublisherUse, RMW_IMPLEMENTATION), publish_with_allocation) {
+  rmw_publisher_allocation_t allocation{nullptr, nullptr};
+  rmw_ret_t ret = rmw_init_publisher_allocation(ts, nullptr, &allocation);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_NE(nullptr, allocation.data);
+
+  test_msgs__msg__BasicTypes msg{};
+  ret = rmw_publish(pub, &msg, &allocation);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+
+  ret = rmw_fini_publisher_allocation(&allocation);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(nullptr, allocation.data);
+}
+
+TEST_F(CLASSNAME(TestPublisherUse, RMW_IMPLEMENTATION), init_publisher_allocation_with_bad_args) {
+  rmw_publisher_allocation_t allocation{nullptr, nullptr};
+  rmw_ret_t ret = rmw_init_publisher_allocation(nullptr, nullptr, &allocation);
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, ret);
+  rmw_reset_error();
+
+  ret = rmw_init_publisher_allocation(ts, nullptr, nullptr);
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, ret);
+  rmw_reset_error();
+
+  ret = rmw_fini_publisher_allocation(&allocation);
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, ret);
+  rmw_reset_error();
+}
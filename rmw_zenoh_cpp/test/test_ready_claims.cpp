@@ -0,0 +1,101 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "impl/ready_claims.hpp"
+
+using rmw_zenoh_common_cpp::ReadyClaims;
+
+TEST(TestReadyClaims, hands_out_one_claim_per_item) {
+  ReadyClaims claims;
+  EXPECT_FALSE(claims.unclaimed());
+  EXPECT_FALSE(claims.claim());
+
+  claims.set_available(2);
+  EXPECT_TRUE(claims.unclaimed());
+  EXPECT_TRUE(claims.claim());
+  EXPECT_TRUE(claims.unclaimed());
+  EXPECT_TRUE(claims.claim());
+  EXPECT_FALSE(claims.unclaimed());
+  EXPECT_FALSE(claims.claim());
+
+  // A take gives back a claim along with the item
+  claims.set_available(1);
+  claims.release();
+  EXPECT_FALSE(claims.unclaimed());
+  claims.set_available(0);
+  claims.release();
+  EXPECT_FALSE(claims.unclaimed());
+
+  // Releasing without a claim does nothing
+  claims.release();
+  claims.set_available(1);
+  EXPECT_TRUE(claims.claim());
+  EXPECT_FALSE(claims.claim());
+}
+
+TEST(TestReadyClaims, claims_lapse_without_takes) {
+  ReadyClaims claims;
+  claims.set_available(1);
+  ASSERT_TRUE(claims.claim());
+  EXPECT_FALSE(claims.unclaimed());
+
+  // The waiter never takes, so the item wakes someone else once the claim lapses
+  std::this_thread::sleep_for(ReadyClaims::kClaimLifetime + std::chrono::milliseconds(50));
+  EXPECT_TRUE(claims.unclaimed());
+  EXPECT_TRUE(claims.claim());
+  EXPECT_FALSE(claims.claim());
+}
+
+TEST(TestReadyClaims, new_claims_keep_the_others_alive) {
+  ReadyClaims claims;
+  claims.set_available(2);
+  ASSERT_TRUE(claims.claim());
+
+  // Claims lapse together, a lifetime after the last one was made
+  std::this_thread::sleep_for(ReadyClaims::kClaimLifetime * 3 / 4);
+  ASSERT_TRUE(claims.claim());
+  std::this_thread::sleep_for(ReadyClaims::kClaimLifetime / 2);
+  EXPECT_FALSE(claims.unclaimed());
+  std::this_thread::sleep_for(ReadyClaims::kClaimLifetime);
+  EXPECT_TRUE(claims.unclaimed());
+}
+
+TEST(TestReadyClaims, concurrent_waiters_claim_each_item_once) {
+  ReadyClaims claims;
+  claims.set_available(3);
+
+  std::atomic<size_t> claimed{0};
+  std::vector<std::thread> waiters;
+  for (int i = 0; i < 8; ++i) {
+    waiters.emplace_back(
+      [&]() {
+        for (int j = 0; j < 100; ++j) {
+          if (claims.claim()) {
+            ++claimed;
+          }
+        }
+      });
+  }
+  for (auto & waiter : waiters) {
+    waiter.join();
+  }
+  EXPECT_EQ(3u, claimed.load());
+}
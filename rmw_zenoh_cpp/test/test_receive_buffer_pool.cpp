@@ -0,0 +1,208 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "impl/receive_buffer_pool.hpp"
+
+using rmw_zenoh_common_cpp::ReceiveBuffer;
+using rmw_zenoh_common_cpp::ReceiveBufferPool;
+using rmw_zenoh_common_cpp::ReceiveBufferPtr;
+
+namespace
+{
+class TestReceiveBufferPool : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    pool = ReceiveBufferPool::create(ReceiveBufferPool::Options{false});
+    ASSERT_NE(nullptr, pool);
+  }
+
+  void TearDown() override
+  {
+    if (pool) {
+      pool->release();
+    }
+  }
+
+  ReceiveBufferPool * pool;
+};
+
+TEST_F(TestReceiveBufferPool, rounds_sizes_up_to_their_size_class)
+{
+  const size_t sizes[][2] = {
+    {0, 256}, {1, 256}, {256, 256}, {257, 512}, {1000, 1024}, {4096, 4096}, {100000, 131072}};
+  for (const auto & size : sizes) {
+    ReceiveBufferPtr buffer = pool->acquire(size[0]);
+    ASSERT_TRUE(static_cast<bool>(buffer)) << size[0];
+    EXPECT_EQ(size[0], buffer->size()) << size[0];
+    EXPECT_EQ(size[1], buffer->capacity()) << size[0];
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(buffer->data()) % 64) << size[0];
+  }
+
+  // The largest size class, and one-off allocations past it
+  const size_t max_size = ReceiveBufferPool::max_pooled_size();
+  ReceiveBufferPtr largest = pool->acquire(max_size);
+  ASSERT_TRUE(static_cast<bool>(largest));
+  EXPECT_EQ(max_size, largest->capacity());
+  ReceiveBufferPtr oversized = pool->acquire(max_size + 1);
+  ASSERT_TRUE(static_cast<bool>(oversized));
+  EXPECT_EQ(max_size + 1, oversized->capacity());
+
+  // Resizing stays within the capacity
+  ReceiveBufferPtr buffer = pool->acquire(300);
+  buffer->resize(512);
+  EXPECT_EQ(512u, buffer->size());
+  buffer->resize(10);
+  EXPECT_EQ(10u, buffer->size());
+}
+
+TEST_F(TestReceiveBufferPool, counts_the_capacity_in_use)
+{
+  EXPECT_EQ(0u, pool->bytes_in_use());
+
+  ReceiveBufferPtr small = pool->acquire(100);
+  ReceiveBufferPtr medium = pool->acquire(3000);
+  ReceiveBufferPtr oversized = pool->acquire(ReceiveBufferPool::max_pooled_size() + 10);
+  EXPECT_EQ(256u + 4096u + ReceiveBufferPool::max_pooled_size() + 10, pool->bytes_in_use());
+
+  oversized.reset();
+  EXPECT_EQ(256u + 4096u, pool->bytes_in_use());
+  ReceiveBufferPtr copy = small;
+  small.reset();
+  EXPECT_EQ(256u + 4096u, pool->bytes_in_use());
+  copy.reset();
+  medium.reset();
+  EXPECT_EQ(0u, pool->bytes_in_use());
+}
+
+TEST_F(TestReceiveBufferPool, fans_out_a_buffer_by_reference)
+{
+  ReceiveBufferPtr buffer = pool->acquire(64);
+  ReceiveBuffer * raw = buffer.get();
+  buffer->set_source_timestamp(42);
+  memset(buffer->data(), 0xab, 64);
+
+  // Every subscription queue on a topic shares the same buffer
+  std::vector<ReceiveBufferPtr> queues(4, buffer);
+  for (const ReceiveBufferPtr & queued : queues) {
+    EXPECT_EQ(raw, queued.get());
+  }
+  ReceiveBufferPtr moved = std::move(buffer);
+  EXPECT_FALSE(static_cast<bool>(buffer));
+  EXPECT_EQ(raw, moved.get());
+  moved.reset();
+
+  queues.resize(1);
+  EXPECT_EQ(256u, pool->bytes_in_use());
+  EXPECT_EQ(0xab, queues[0]->data()[63]);
+  EXPECT_EQ(42, queues[0]->source_timestamp());
+
+  // Dropping the last reference hands the buffer back to be reused, with its metadata reset
+  queues.clear();
+  EXPECT_EQ(0u, pool->bytes_in_use());
+  ReceiveBufferPtr reused = pool->acquire(200);
+  EXPECT_EQ(raw, reused.get());
+  EXPECT_EQ(0, reused->source_timestamp());
+}
+
+TEST_F(TestReceiveBufferPool, buffers_released_on_another_thread_return_to_the_pool)
+{
+  ReceiveBufferPtr buffer = pool->acquire(1000);
+  ReceiveBuffer * raw = buffer.get();
+
+  // Dropped by a thread that never took buffers from the pool: back to the shared free list
+  std::thread taker([&buffer]() {buffer.reset();});
+  taker.join();
+  EXPECT_EQ(0u, pool->bytes_in_use());
+
+  // Where a thread with an empty cache finds it
+  ReceiveBuffer * refilled = nullptr;
+  std::thread receiver(
+    [this, &refilled]() {
+      ReceiveBufferPtr buffer = pool->acquire(1000);
+      refilled = buffer.get();
+    });
+  receiver.join();
+  EXPECT_EQ(raw, refilled);
+  EXPECT_EQ(0u, pool->bytes_in_use());
+}
+
+TEST_F(TestReceiveBufferPool, many_threads_share_the_pool)
+{
+  std::vector<std::thread> threads;
+  std::vector<ReceiveBufferPtr> handed_over(8);
+  for (size_t t = 0; t < handed_over.size(); ++t) {
+    threads.emplace_back(
+      [this, t, &handed_over]() {
+        for (size_t i = 0; i < 1000; ++i) {
+          ReceiveBufferPtr buffer = pool->acquire(100 + (i % 5) * 1000);
+          ASSERT_TRUE(static_cast<bool>(buffer));
+          buffer->data()[0] = static_cast<unsigned char>(t);
+          if (i % 100 == 0) {
+            handed_over[t] = buffer;  // Dropped later, on the main thread
+          }
+        }
+      });
+  }
+  for (std::thread & thread : threads) {
+    thread.join();
+  }
+  EXPECT_GT(pool->bytes_in_use(), 0u);
+  for (size_t t = 0; t < handed_over.size(); ++t) {
+    EXPECT_EQ(t, handed_over[t]->data()[0]);
+  }
+  handed_over.clear();
+  EXPECT_EQ(0u, pool->bytes_in_use());
+}
+
+TEST_F(TestReceiveBufferPool, buffers_outlive_the_release_of_the_pool)
+{
+  ReceiveBufferPtr pooled = pool->acquire(500);
+  ReceiveBufferPtr oversized = pool->acquire(ReceiveBufferPool::max_pooled_size() + 1);
+  ReceiveBufferPtr spare = pool->acquire(500);
+  spare.reset();  // Left in the thread cache
+
+  // The owner lets go with samples still queued: the pool stays until they are dropped
+  pool->release();
+  memset(pooled->data(), 1, pooled->size());
+  EXPECT_EQ(512u + ReceiveBufferPool::max_pooled_size() + 1, pool->bytes_in_use());
+
+  oversized.reset();
+  EXPECT_EQ(512u, pool->bytes_in_use());
+  pooled.reset();  // The pool is deleted here (leaks would show under a leak checker)
+  pool = nullptr;
+}
+
+TEST_F(TestReceiveBufferPool, reserves_buffers_up_front)
+{
+  EXPECT_TRUE(pool->reserve(2000, 3));
+  EXPECT_FALSE(pool->reserve(ReceiveBufferPool::max_pooled_size() + 1, 1));
+  EXPECT_EQ(0u, pool->bytes_in_use());
+
+  std::vector<ReceiveBufferPtr> buffers;
+  for (int i = 0; i < 3; ++i) {
+    buffers.push_back(pool->acquire(2048));
+    ASSERT_TRUE(static_cast<bool>(buffers.back()));
+  }
+  EXPECT_EQ(3u * 2048u, pool->bytes_in_use());
+}
+}  // namespace
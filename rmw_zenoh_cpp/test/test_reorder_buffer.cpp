@@ -0,0 +1,125 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "impl/receive_buffer_pool.hpp"
+#include "impl/reorder_buffer.hpp"
+
+using rmw_zenoh_common_cpp::ReceiveBufferPool;
+using rmw_zenoh_common_cpp::ReceiveBufferPtr;
+using rmw_zenoh_common_cpp::ReorderBuffer;
+
+namespace
+{
+class TestReorderBuffer : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    pool = ReceiveBufferPool::create(ReceiveBufferPool::Options{false});
+    ASSERT_NE(nullptr, pool);
+  }
+
+  void TearDown() override
+  {
+    pool->release();
+  }
+
+  // Hold a sample carrying its number, with the number as its instance too
+  bool push(ReorderBuffer & buffer, uint32_t number, int64_t timestamp, int64_t now)
+  {
+    ReceiveBufferPtr sample = pool->acquire(sizeof(number));
+    EXPECT_TRUE(static_cast<bool>(sample));
+    memcpy(sample->data(), &number, sizeof(number));
+    return buffer.push(std::move(sample), number, timestamp, now);
+  }
+
+  // Numbers of the samples due at now, in the order they are released
+  static std::vector<uint32_t> pop_all(ReorderBuffer & buffer, int64_t now)
+  {
+    std::vector<uint32_t> numbers;
+    ReceiveBufferPtr sample;
+    uint64_t instance;
+    while (buffer.pop(now, sample, instance)) {
+      uint32_t number;
+      memcpy(&number, sample->data(), sizeof(number));
+      EXPECT_EQ(instance, number);
+      numbers.push_back(number);
+    }
+    return numbers;
+  }
+
+  ReceiveBufferPool * pool;
+};
+
+TEST_F(TestReorderBuffer, holds_samples_for_the_window)
+{
+  ReorderBuffer buffer(100);
+  EXPECT_TRUE(push(buffer, 1, 1000, 0));
+  EXPECT_TRUE(push(buffer, 2, 1010, 30));
+  EXPECT_EQ(2u, buffer.size());
+
+  EXPECT_TRUE(pop_all(buffer, 99).empty());
+  EXPECT_EQ(std::vector<uint32_t>({1}), pop_all(buffer, 100));
+  EXPECT_TRUE(pop_all(buffer, 129).empty());
+  EXPECT_EQ(std::vector<uint32_t>({2}), pop_all(buffer, 130));
+  EXPECT_TRUE(buffer.empty());
+}
+
+TEST_F(TestReorderBuffer, releases_samples_in_timestamp_order)
+{
+  ReorderBuffer buffer(100);
+  EXPECT_TRUE(push(buffer, 3, 1030, 0));
+  EXPECT_TRUE(push(buffer, 1, 1010, 10));
+  EXPECT_TRUE(push(buffer, 4, 1040, 20));
+  EXPECT_TRUE(push(buffer, 2, 1020, 30));
+
+  // Each deadline that runs out releases the earliest sample held
+  EXPECT_EQ(std::vector<uint32_t>({1, 2}), pop_all(buffer, 110));
+  EXPECT_EQ(std::vector<uint32_t>({3, 4}), pop_all(buffer, 130));
+  EXPECT_EQ(0u, buffer.late_samples());
+}
+
+TEST_F(TestReorderBuffer, keeps_arrival_order_for_equal_timestamps)
+{
+  ReorderBuffer buffer(100);
+  EXPECT_TRUE(push(buffer, 1, 1000, 0));
+  EXPECT_TRUE(push(buffer, 2, 1000, 0));
+  EXPECT_TRUE(push(buffer, 3, 1000, 0));
+  EXPECT_EQ(std::vector<uint32_t>({1, 2, 3}), pop_all(buffer, 100));
+}
+
+TEST_F(TestReorderBuffer, turns_away_samples_stamped_before_the_last_release)
+{
+  ReorderBuffer buffer(100);
+  EXPECT_TRUE(push(buffer, 2, 1020, 0));
+  EXPECT_EQ(std::vector<uint32_t>({2}), pop_all(buffer, 100));
+
+  // Delayed by more than the window
+  EXPECT_FALSE(push(buffer, 1, 1010, 110));
+  EXPECT_EQ(1u, buffer.late_samples());
+  EXPECT_TRUE(buffer.empty());
+
+  // The same timestamp as the last release can still be put in order
+  EXPECT_TRUE(push(buffer, 3, 1020, 120));
+  EXPECT_TRUE(push(buffer, 4, 1030, 120));
+  EXPECT_EQ(std::vector<uint32_t>({3, 4}), pop_all(buffer, 220));
+  EXPECT_EQ(1u, buffer.late_samples());
+}
+}  // namespace
@@ -0,0 +1,259 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+#include "rcutils/time.h"
+
+#include "rmw/rmw.h"
+#include "rmw/error_handling.h"
+
+#include "test_msgs/srv/basic_types.h"
+
+#include "rmw_zenoh_common_cpp/rmw_context_impl.hpp"
+#include "rmw_zenoh_common_cpp/rmw_zenoh_extensions.h"
+
+#include "impl/client_impl.hpp"
+#include "impl/receive_buffer_pool.hpp"
+#include "impl/request_metadata.hpp"
+#include "impl/service_impl.hpp"
+
+#include "./config.hpp"
+
+#ifdef RMW_IMPLEMENTATION
+# define CLASSNAME_(NAME, SUFFIX) NAME ## __ ## SUFFIX
+# define CLASSNAME(NAME, SUFFIX) CLASSNAME_(NAME, SUFFIX)
+#else
+# define CLASSNAME(NAME, SUFFIX) NAME
+#endif
+
+using rmw_zenoh_common_cpp::RequestMetadata;
+using rmw_zenoh_common_cpp::ReceiveBufferPtr;
+using rmw_zenoh_common_cpp::kRequestMetadataSize;
+
+// Deadlines given to requests by clients, and the requests rmw_take_request skips
+class CLASSNAME (TestRequestDeadlines, RMW_IMPLEMENTATION) : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rmw_ret_t ret = rmw_init_options_init(&init_options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", init_options.enclave);
+    ret = rmw_init(&init_options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    node = rmw_create_node(&context, "my_test_node", "/my_test_ns", 0, false);
+    ASSERT_NE(nullptr, node) << rcutils_get_error_string().str;
+
+    const rosidl_service_type_support_t * ts =
+      ROSIDL_GET_SRV_TYPE_SUPPORT(test_msgs, srv, BasicTypes);
+    service = rmw_create_service(node, ts, service_name, &rmw_qos_profile_services_default);
+    ASSERT_NE(nullptr, service) << rmw_get_error_string().str;
+    client = rmw_create_client(node, ts, service_name, &rmw_qos_profile_services_default);
+    ASSERT_NE(nullptr, client) << rmw_get_error_string().str;
+    std::this_thread::sleep_for(rmw_intraprocess_discovery_delay);
+
+    ASSERT_TRUE(test_msgs__srv__BasicTypes_Request__init(&request));
+  }
+
+  void TearDown() override
+  {
+    test_msgs__srv__BasicTypes_Request__fini(&request);
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_client(node, client)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_service(node, service)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_node(node)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_shutdown(&context)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_context_fini(&context)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_init_options_fini(&init_options)) << rmw_get_error_string().str;
+  }
+
+  rmw_service_data_t * service_data()
+  {
+    return static_cast<rmw_service_data_t *>(service->data);
+  }
+
+  int64_t request_timeout()
+  {
+    return static_cast<rmw_client_data_t *>(client->data)->request_timeout_.load();
+  }
+
+  // Send the request and wait up to a second for the server to queue it (without taking it)
+  void send_and_wait()
+  {
+    size_t queued = queue_size();
+    int64_t sequence_id = 0;
+    ASSERT_EQ(RMW_RET_OK, rmw_send_request(client, &request, &sequence_id)) <<
+      rmw_get_error_string().str;
+    for (int i = 0; i < 100 && queue_size() == queued; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(queued + 1, queue_size());
+  }
+
+  size_t queue_size()
+  {
+    std::lock_guard<std::mutex> lock(service_data()->request_queue_mutex_);
+    return service_data()->zn_request_message_queue_.size();
+  }
+
+  // Metadata of the request that will be taken next
+  RequestMetadata next_metadata()
+  {
+    std::lock_guard<std::mutex> lock(service_data()->request_queue_mutex_);
+    const ReceiveBufferPtr & next = service_data()->zn_request_message_queue_.back();
+    RequestMetadata metadata{0, 0};
+    EXPECT_TRUE(
+      rmw_zenoh_common_cpp::read_request_metadata(next->data(), next->size(), metadata));
+    return metadata;
+  }
+
+  // Queue a request as if it had been received, to be taken next
+  void push_request(const unsigned char * bytes, size_t length)
+  {
+    ReceiveBufferPtr buffer = context.impl->rx_buffer_pool->acquire(length);
+    ASSERT_TRUE(static_cast<bool>(buffer));
+    memcpy(buffer->data(), bytes, length);
+    std::lock_guard<std::mutex> lock(service_data()->request_queue_mutex_);
+    service_data()->zn_request_message_queue_.push_back(std::move(buffer));
+    service_data()->ready_claims_.set_available(service_data()->zn_request_message_queue_.size());
+  }
+
+  uint64_t expired_requests()
+  {
+    uint64_t count = 0;
+    EXPECT_EQ(RMW_RET_OK, rmw_zenoh_get_service_expired_requests(service, &count));
+    return count;
+  }
+
+  rmw_init_options_t init_options{rmw_get_zero_initialized_init_options()};
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+  rmw_node_t * node{nullptr};
+  rmw_service_t * service{nullptr};
+  rmw_client_t * client{nullptr};
+  const char * const service_name = "/request_deadlines";
+  test_msgs__srv__BasicTypes_Request request;
+};
+
+TEST_F(CLASSNAME(TestRequestDeadlines, RMW_IMPLEMENTATION), timeouts_give_deadlines) {
+  // No request_timeout in the configuration
+  EXPECT_EQ(0, request_timeout());
+  send_and_wait();
+  EXPECT_EQ(0, next_metadata().deadline);
+
+  EXPECT_EQ(RMW_RET_OK, rmw_zenoh_set_client_request_timeout(client, rmw_time_t{2, 500000000}));
+  EXPECT_EQ(2500000000, request_timeout());
+  rcutils_time_point_value_t before = 0;
+  ASSERT_EQ(RCUTILS_RET_OK, rcutils_system_time_now(&before));
+  send_and_wait();
+  rcutils_time_point_value_t after = 0;
+  ASSERT_EQ(RCUTILS_RET_OK, rcutils_system_time_now(&after));
+  int64_t deadline = next_metadata().deadline;
+  EXPECT_GE(deadline, before + 2500000000);
+  EXPECT_LE(deadline, after + 2500000000);
+}
+
+TEST_F(CLASSNAME(TestRequestDeadlines, RMW_IMPLEMENTATION), infinite_timeouts_have_no_deadline) {
+  EXPECT_EQ(RMW_RET_OK, rmw_zenoh_set_client_request_timeout(client, rmw_time_t{1, 0}));
+  EXPECT_EQ(1000000000, request_timeout());
+
+  // RMW_DURATION_INFINITE would overflow when added to the current time
+  EXPECT_EQ(
+    RMW_RET_OK, rmw_zenoh_set_client_request_timeout(client, rmw_time_t{9223372036, 854775807}));
+  EXPECT_EQ(0, request_timeout());
+  send_and_wait();
+  EXPECT_EQ(0, next_metadata().deadline);
+
+  EXPECT_EQ(
+    RMW_RET_OK, rmw_zenoh_set_client_request_timeout(client, rmw_time_t{UINT64_MAX, UINT64_MAX}));
+  EXPECT_EQ(0, request_timeout());
+
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, rmw_zenoh_set_client_request_timeout(nullptr, {1, 0}));
+  rmw_reset_error();
+}
+
+TEST_F(CLASSNAME(TestRequestDeadlines, RMW_IMPLEMENTATION), expired_requests_are_skipped) {
+  EXPECT_EQ(RMW_RET_OK, rmw_zenoh_set_client_request_timeout(client, rmw_time_t{0, 1}));
+  send_and_wait();
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  rmw_service_info_t request_header;
+  bool taken = true;
+  EXPECT_EQ(RMW_RET_OK, rmw_take_request(service, &request_header, &request, &taken)) <<
+    rmw_get_error_string().str;
+  EXPECT_FALSE(taken);
+  EXPECT_EQ(1u, expired_requests());
+  EXPECT_EQ(0u, queue_size());
+}
+
+TEST_F(CLASSNAME(TestRequestDeadlines, RMW_IMPLEMENTATION), skips_to_the_next_live_request) {
+  request.int32_value = 42;
+  send_and_wait();
+
+  // An expired copy of the live request, then a request too short to have metadata, are taken
+  // first
+  std::vector<unsigned char> expired;
+  {
+    std::lock_guard<std::mutex> lock(service_data()->request_queue_mutex_);
+    const ReceiveBufferPtr & live = service_data()->zn_request_message_queue_.back();
+    expired.assign(live->data(), live->data() + live->size());
+  }
+  ASSERT_GE(expired.size(), kRequestMetadataSize);
+  rmw_zenoh_common_cpp::write_request_metadata(
+    RequestMetadata{1, 7}, expired.data() + expired.size() - kRequestMetadataSize);
+  push_request(expired.data(), expired.size());
+  const unsigned char truncated[kRequestMetadataSize - 1] = {};
+  push_request(truncated, sizeof(truncated));
+  ASSERT_EQ(3u, queue_size());
+
+  request.int32_value = 0;
+  rmw_service_info_t request_header;
+  bool taken = false;
+  EXPECT_EQ(RMW_RET_OK, rmw_take_request(service, &request_header, &request, &taken)) <<
+    rmw_get_error_string().str;
+  EXPECT_TRUE(taken);
+  EXPECT_EQ(42, request.int32_value);
+  EXPECT_NE(7, request_header.request_id.sequence_number);
+  // Truncated requests are dropped, but only expired ones are counted
+  EXPECT_EQ(1u, expired_requests());
+  EXPECT_EQ(0u, queue_size());
+}
+
+TEST_F(CLASSNAME(TestRequestDeadlines, RMW_IMPLEMENTATION), checks_the_implementation) {
+  const char * client_identifier = client->implementation_identifier;
+  client->implementation_identifier = "not-an-rmw-implementation-identifier";
+  EXPECT_EQ(
+    RMW_RET_INCORRECT_RMW_IMPLEMENTATION,
+    rmw_zenoh_set_client_request_timeout(client, rmw_time_t{1, 0}));
+  rmw_reset_error();
+  client->implementation_identifier = client_identifier;
+  EXPECT_EQ(0, request_timeout());
+
+  const char * service_identifier = service->implementation_identifier;
+  service->implementation_identifier = "not-an-rmw-implementation-identifier";
+  uint64_t count = 0;
+  EXPECT_EQ(
+    RMW_RET_INCORRECT_RMW_IMPLEMENTATION, rmw_zenoh_get_service_expired_requests(service, &count));
+  rmw_reset_error();
+  service->implementation_identifier = service_identifier;
+}
@@ -0,0 +1,112 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "impl/request_metadata.hpp"
+
+using rmw_zenoh_common_cpp::RequestMetadata;
+using rmw_zenoh_common_cpp::kRequestMetadataSize;
+
+namespace
+{
+constexpr int64_t kMaxInt64 = std::numeric_limits<int64_t>::max();
+constexpr uint64_t kMaxUint64 = std::numeric_limits<uint64_t>::max();
+
+TEST(RequestMetadataTest, TrailerRoundTrips)
+{
+  // The trailer goes after the CDR, which is left alone
+  std::vector<unsigned char> message(5 + kRequestMetadataSize, 0xab);
+  RequestMetadata written{1700000000123456789, 42};
+  rmw_zenoh_common_cpp::write_request_metadata(written, message.data() + 5);
+  for (size_t i = 0; i < 5; ++i) {
+    EXPECT_EQ(0xab, message[i]);
+  }
+
+  RequestMetadata read{0, 0};
+  ASSERT_TRUE(rmw_zenoh_common_cpp::read_request_metadata(message.data(), message.size(), read));
+  EXPECT_EQ(written.deadline, read.deadline);
+  EXPECT_EQ(written.sequence_id, read.sequence_id);
+
+  // No deadline, and the extremes of both fields
+  for (const RequestMetadata & metadata : {
+      RequestMetadata{0, 0}, RequestMetadata{kMaxInt64, -1}, RequestMetadata{-1, kMaxInt64}})
+  {
+    rmw_zenoh_common_cpp::write_request_metadata(metadata, message.data() + 5);
+    ASSERT_TRUE(
+      rmw_zenoh_common_cpp::read_request_metadata(message.data(), message.size(), read));
+    EXPECT_EQ(metadata.deadline, read.deadline);
+    EXPECT_EQ(metadata.sequence_id, read.sequence_id);
+  }
+}
+
+TEST(RequestMetadataTest, TruncatedMessagesHaveNoTrailer)
+{
+  std::vector<unsigned char> message(kRequestMetadataSize, 0);
+  RequestMetadata metadata{7, 7};
+  EXPECT_TRUE(
+    rmw_zenoh_common_cpp::read_request_metadata(message.data(), kRequestMetadataSize, metadata));
+  EXPECT_EQ(0, metadata.deadline);
+  EXPECT_EQ(0, metadata.sequence_id);
+  for (size_t length = 0; length < kRequestMetadataSize; ++length) {
+    EXPECT_FALSE(
+      rmw_zenoh_common_cpp::read_request_metadata(message.data(), length, metadata)) << length;
+  }
+}
+
+TEST(RequestMetadataTest, ExpiresPastTheDeadline)
+{
+  EXPECT_FALSE(rmw_zenoh_common_cpp::request_expired(RequestMetadata{0, 1}, kMaxInt64));
+  EXPECT_FALSE(rmw_zenoh_common_cpp::request_expired(RequestMetadata{1000, 1}, 999));
+  EXPECT_FALSE(rmw_zenoh_common_cpp::request_expired(RequestMetadata{1000, 1}, 1000));
+  EXPECT_TRUE(rmw_zenoh_common_cpp::request_expired(RequestMetadata{1000, 1}, 1001));
+}
+
+TEST(RequestMetadataTest, TimeoutsTooLongHaveNoDeadline)
+{
+  EXPECT_EQ(0, rmw_zenoh_common_cpp::request_timeout_ns(0, 0));
+  EXPECT_EQ(1, rmw_zenoh_common_cpp::request_timeout_ns(0, 1));
+  EXPECT_EQ(2500000000, rmw_zenoh_common_cpp::request_timeout_ns(2, 500000000));
+  // Nanoseconds past a second are carried over
+  EXPECT_EQ(3000000000, rmw_zenoh_common_cpp::request_timeout_ns(1, 2000000000));
+
+  constexpr uint64_t kMaxSec = rmw_zenoh_common_cpp::kMaxRequestTimeoutSec;
+  EXPECT_EQ(
+    static_cast<int64_t>(kMaxSec - 1) * 1000000000,
+    rmw_zenoh_common_cpp::request_timeout_ns(kMaxSec - 1, 0));
+  EXPECT_EQ(0, rmw_zenoh_common_cpp::request_timeout_ns(kMaxSec, 0));
+  EXPECT_EQ(0, rmw_zenoh_common_cpp::request_timeout_ns(kMaxSec - 1, 1000000000));
+  EXPECT_EQ(0, rmw_zenoh_common_cpp::request_timeout_ns(0, kMaxSec * 1000000000));
+  // RMW_DURATION_INFINITE
+  EXPECT_EQ(0, rmw_zenoh_common_cpp::request_timeout_ns(9223372036, 854775807));
+  EXPECT_EQ(0, rmw_zenoh_common_cpp::request_timeout_ns(kMaxUint64, kMaxUint64));
+  EXPECT_EQ(0, rmw_zenoh_common_cpp::request_timeout_ns(0, kMaxUint64));
+}
+
+TEST(RequestMetadataTest, DeadlinesDoNotOverflow)
+{
+  const int64_t now = 1700000000000000000;
+  EXPECT_EQ(0, rmw_zenoh_common_cpp::request_deadline(now, 0));
+  EXPECT_EQ(0, rmw_zenoh_common_cpp::request_deadline(now, -1));
+  EXPECT_EQ(now + 500000000, rmw_zenoh_common_cpp::request_deadline(now, 500000000));
+  EXPECT_EQ(kMaxInt64, rmw_zenoh_common_cpp::request_deadline(now, kMaxInt64 - now));
+  EXPECT_EQ(0, rmw_zenoh_common_cpp::request_deadline(now, kMaxInt64 - now + 1));
+  EXPECT_EQ(0, rmw_zenoh_common_cpp::request_deadline(now, kMaxInt64));
+}
+
+}  // namespace
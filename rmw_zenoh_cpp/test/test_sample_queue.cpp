@@ -0,0 +1,161 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "impl/receive_buffer_pool.hpp"
+#include "impl/sample_queue.hpp"
+
+using rmw_zenoh_common_cpp::ReceiveBufferPool;
+using rmw_zenoh_common_cpp::ReceiveBufferPtr;
+using rmw_zenoh_common_cpp::SampleQueue;
+
+namespace
+{
+class TestSampleQueue : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    pool = ReceiveBufferPool::create(ReceiveBufferPool::Options{false});
+    ASSERT_NE(nullptr, pool);
+  }
+
+  void TearDown() override
+  {
+    pool->release();
+  }
+
+  // A sample carrying its number
+  ReceiveBufferPtr sample(uint32_t number)
+  {
+    ReceiveBufferPtr buffer = pool->acquire(sizeof(number));
+    EXPECT_TRUE(static_cast<bool>(buffer));
+    memcpy(buffer->data(), &number, sizeof(number));
+    return buffer;
+  }
+
+  static uint32_t number_of(const ReceiveBufferPtr & buffer)
+  {
+    uint32_t number;
+    memcpy(&number, buffer->data(), sizeof(number));
+    return number;
+  }
+
+  // Numbers of the samples left in the queue, in the order they are taken
+  static std::vector<uint32_t> take_all(SampleQueue & queue)
+  {
+    std::vector<uint32_t> numbers;
+    while (!queue.empty()) {
+      ReceiveBufferPtr buffer = queue.pop();
+      EXPECT_TRUE(static_cast<bool>(buffer));
+      if (!buffer) {
+        break;
+      }
+      numbers.push_back(number_of(buffer));
+    }
+    EXPECT_FALSE(queue.pop());
+    EXPECT_EQ(0u, queue.size());
+    return numbers;
+  }
+
+  ReceiveBufferPool * pool;
+};
+}  // namespace
+
+TEST_F(TestSampleQueue, keeps_the_last_samples_of_the_topic) {
+  SampleQueue queue(3);
+  EXPECT_FALSE(queue.keyed());
+  EXPECT_FALSE(queue.pop());
+  EXPECT_EQ(0u, queue.instance_count());
+
+  EXPECT_TRUE(queue.push(sample(1), 1));
+  EXPECT_TRUE(queue.push(sample(2), 2));
+  EXPECT_TRUE(queue.push(sample(3), 3));
+  EXPECT_FALSE(queue.push(sample(4), 4));
+  EXPECT_EQ(3u, queue.size());
+  EXPECT_EQ(1u, queue.instance_count());
+  EXPECT_EQ((std::vector<uint32_t>{2, 3, 4}), take_all(queue));
+
+  // A depth of 0 keeps one sample
+  SampleQueue minimal(0);
+  EXPECT_EQ(1u, minimal.depth());
+  EXPECT_TRUE(minimal.push(sample(1), 0));
+  EXPECT_FALSE(minimal.push(sample(2), 0));
+  EXPECT_EQ((std::vector<uint32_t>{2}), take_all(minimal));
+}
+
+TEST_F(TestSampleQueue, keyed_queue_keeps_the_last_samples_of_every_instance) {
+  SampleQueue queue(2, true);
+  EXPECT_TRUE(queue.keyed());
+
+  // A chatty instance does not push out a quiet one
+  EXPECT_TRUE(queue.push(sample(1), 7));
+  for (uint32_t number = 2; number <= 10; ++number) {
+    EXPECT_EQ(number <= 3, queue.push(sample(number), 8));
+  }
+  EXPECT_EQ(3u, queue.size());
+  EXPECT_EQ(2u, queue.instance_count());
+
+  // Taken in arrival order across instances
+  EXPECT_TRUE(queue.push(sample(11), 7));
+  EXPECT_EQ((std::vector<uint32_t>{1, 9, 10, 11}), take_all(queue));
+  EXPECT_EQ(0u, queue.instance_count());
+}
+
+TEST_F(TestSampleQueue, keyed_queue_takes_interleaved_instances_in_arrival_order) {
+  SampleQueue queue(3, true);
+  EXPECT_TRUE(queue.push(sample(1), 1));
+  EXPECT_TRUE(queue.push(sample(2), 2));
+  EXPECT_TRUE(queue.push(sample(3), 1));
+  EXPECT_TRUE(queue.push(sample(4), 3));
+  EXPECT_TRUE(queue.push(sample(5), 2));
+
+  ReceiveBufferPtr first = queue.pop();
+  ASSERT_TRUE(static_cast<bool>(first));
+  EXPECT_EQ(1u, number_of(first));
+
+  // Instance 1 is refilled past its depth after its oldest sample was taken
+  EXPECT_TRUE(queue.push(sample(6), 1));
+  EXPECT_TRUE(queue.push(sample(7), 1));
+  EXPECT_FALSE(queue.push(sample(8), 1));
+  EXPECT_EQ((std::vector<uint32_t>{2, 4, 5, 6, 7, 8}), take_all(queue));
+}
+
+TEST_F(TestSampleQueue, keyed_queue_compacts_discarded_samples) {
+  SampleQueue queue(1, true);
+
+  // Enough discarded samples of one instance to compact the arrival order many times over, around
+  // samples of other instances that must keep their place
+  EXPECT_TRUE(queue.push(sample(1), 1));
+  for (uint32_t number = 2; number < 1000; ++number) {
+    queue.push(sample(number), 2);
+    if (number == 500) {
+      EXPECT_TRUE(queue.push(sample(100000), 3));
+    }
+  }
+  EXPECT_EQ(3u, queue.size());
+  EXPECT_EQ((std::vector<uint32_t>{1, 100000, 999}), take_all(queue));
+
+  // Still in order once emptied
+  for (uint32_t number = 0; number < 1000; ++number) {
+    queue.push(sample(number), number % 4);
+  }
+  EXPECT_EQ((std::vector<uint32_t>{996, 997, 998, 999}), take_all(queue));
+  EXPECT_EQ(0u, pool->bytes_in_use());
+}
@@ -0,0 +1,165 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include "impl/shaping.hpp"
+
+using rmw_zenoh_common_cpp::PublisherShaper;
+using rmw_zenoh_common_cpp::TokenBucket;
+
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+
+namespace
+{
+class TestShaping : public ::testing::Test
+{
+protected:
+  // Start of every test's clock, far from the real current time on purpose
+  const TokenBucket::Clock::time_point t0 = TokenBucket::Clock::time_point(std::chrono::hours(1));
+};
+
+TEST_F(TestShaping, bucket_starts_with_a_burst)
+{
+  TokenBucket bucket(1000, 500, t0);
+  EXPECT_TRUE(bucket.try_consume(300, t0));
+  EXPECT_TRUE(bucket.try_consume(200, t0));
+  EXPECT_FALSE(bucket.try_consume(1, t0));
+
+  // One second worth of rate by default
+  TokenBucket one_second(1000, 0, t0);
+  EXPECT_TRUE(one_second.try_consume(1000, t0));
+  EXPECT_FALSE(one_second.try_consume(1, t0));
+}
+
+TEST_F(TestShaping, bucket_refills_at_the_rate_up_to_the_burst)
+{
+  TokenBucket bucket(1000, 500, t0);
+  EXPECT_TRUE(bucket.try_consume(500, t0));
+
+  EXPECT_FALSE(bucket.try_consume(150, t0 + milliseconds(100)));
+  EXPECT_TRUE(bucket.try_consume(100, t0 + milliseconds(100)));
+  EXPECT_FALSE(bucket.try_consume(1, t0 + milliseconds(100)));
+
+  // Idle for long: no more than the burst
+  EXPECT_TRUE(bucket.try_consume(500, t0 + milliseconds(10000)));
+  EXPECT_FALSE(bucket.try_consume(1, t0 + milliseconds(10000)));
+
+  // Refunds are capped by the burst too
+  bucket.refund(300);
+  bucket.refund(300);
+  EXPECT_TRUE(bucket.try_consume(500, t0 + milliseconds(10000)));
+  EXPECT_FALSE(bucket.try_consume(1, t0 + milliseconds(10000)));
+}
+
+TEST_F(TestShaping, messages_over_the_burst_leave_a_full_bucket_in_debt)
+{
+  TokenBucket bucket(1000, 500, t0);
+  EXPECT_TRUE(bucket.try_consume(100, t0));
+  EXPECT_FALSE(bucket.try_consume(800, t0));
+
+  EXPECT_TRUE(bucket.try_consume(800, t0 + milliseconds(100)));
+  EXPECT_FALSE(bucket.try_consume(1, t0 + milliseconds(350)));
+  EXPECT_TRUE(bucket.try_consume(100, t0 + milliseconds(500)));
+}
+
+TEST_F(TestShaping, consuming_into_debt_tells_how_long_to_wait)
+{
+  TokenBucket bucket(1000, 500, t0);
+  EXPECT_EQ(nanoseconds(0), bucket.consume(500, t0));
+  EXPECT_EQ(milliseconds(200), bucket.consume(200, t0));
+  EXPECT_EQ(milliseconds(300), bucket.consume(100, t0));
+
+  // The debt is paid back at the rate
+  EXPECT_EQ(milliseconds(100), bucket.consume(100, t0 + milliseconds(300)));
+}
+
+TEST_F(TestShaping, drop_mode_counts_dropped_messages)
+{
+  PublisherShaper shaper(1000, 500, nullptr, PublisherShaper::Mode::kDrop, t0);
+  nanoseconds wait;
+  EXPECT_TRUE(shaper.admit(500, t0, wait));
+  EXPECT_EQ(nanoseconds(0), wait);
+  EXPECT_FALSE(shaper.admit(40, t0, wait));
+  EXPECT_FALSE(shaper.admit(60, t0 + milliseconds(50), wait));
+  EXPECT_TRUE(shaper.admit(100, t0 + milliseconds(100), wait));
+
+  EXPECT_EQ(2u, shaper.dropped_messages.load());
+  EXPECT_EQ(100u, shaper.dropped_bytes.load());
+  EXPECT_EQ(0u, shaper.delayed_messages.load());
+}
+
+TEST_F(TestShaping, block_mode_holds_messages_back)
+{
+  PublisherShaper shaper(1000, 500, nullptr, PublisherShaper::Mode::kBlock, t0);
+  nanoseconds wait;
+  EXPECT_TRUE(shaper.admit(500, t0, wait));
+  EXPECT_EQ(nanoseconds(0), wait);
+  EXPECT_TRUE(shaper.admit(250, t0, wait));
+  EXPECT_EQ(milliseconds(250), wait);
+  EXPECT_TRUE(shaper.admit(250, t0 + milliseconds(250), wait));
+  EXPECT_EQ(milliseconds(250), wait);
+
+  EXPECT_EQ(0u, shaper.dropped_messages.load());
+  EXPECT_EQ(2u, shaper.delayed_messages.load());
+  EXPECT_EQ(500000000u, shaper.delay_ns.load());
+}
+
+TEST_F(TestShaping, session_bucket_is_shared_by_its_publishers)
+{
+  TokenBucket session(1000, 1000, t0);
+  PublisherShaper first(0, 0, &session, PublisherShaper::Mode::kDrop, t0);
+  PublisherShaper second(0, 0, &session, PublisherShaper::Mode::kDrop, t0);
+
+  nanoseconds wait;
+  EXPECT_TRUE(first.admit(700, t0, wait));
+  EXPECT_FALSE(second.admit(400, t0, wait));
+  EXPECT_TRUE(second.admit(300, t0, wait));
+  EXPECT_FALSE(first.admit(1, t0, wait));
+  EXPECT_EQ(1u, first.dropped_messages.load());
+  EXPECT_EQ(1u, second.dropped_messages.load());
+}
+
+TEST_F(TestShaping, publisher_budget_is_refunded_when_the_session_drops)
+{
+  TokenBucket session(1000, 1000, t0);
+  EXPECT_TRUE(session.try_consume(800, t0));  // Taken by other publishers
+
+  PublisherShaper shaper(1000, 500, &session, PublisherShaper::Mode::kDrop, t0);
+  nanoseconds wait;
+  EXPECT_FALSE(shaper.admit(400, t0, wait));
+
+  // The publisher still has its whole burst, and the session 400 bytes by now
+  EXPECT_TRUE(shaper.admit(400, t0 + milliseconds(200), wait));
+  EXPECT_FALSE(shaper.admit(100, t0 + milliseconds(200), wait));
+}
+
+TEST_F(TestShaping, block_mode_waits_for_both_budgets)
+{
+  TokenBucket session(500, 1000, t0);
+  PublisherShaper shaper(2000, 500, &session, PublisherShaper::Mode::kBlock, t0);
+
+  nanoseconds wait;
+  EXPECT_TRUE(shaper.admit(1000, t0, wait));
+  // The publisher is 500 bytes in debt (250 ms), the session is not
+  EXPECT_EQ(milliseconds(250), wait);
+  EXPECT_TRUE(shaper.admit(200, t0, wait));
+  // The session is now the slowest to pay back: 200 bytes at 500 per second, against 700 bytes
+  // at 2000 per second for the publisher
+  EXPECT_EQ(milliseconds(400), wait);
+  EXPECT_EQ(2u, shaper.delayed_messages.load());
+}
+}  // namespace
@@ -0,0 +1,409 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Soak test: cycles the creation and destruction of nodes, publishers, subscriptions, clients and
+// services under a steady message load, samples the resource usage of the process, and fails if
+// any of it keeps growing.
+//
+// It runs for RMW_ZENOH_SOAK_DURATION seconds (60 by default, use hours to catch slow leaks; 10
+// under colcon test), sampling every RMW_ZENOH_SOAK_SAMPLE_PERIOD seconds (2 by default).
+// The samples are printed as CSV, to plot them.
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/rmw.h"
+#include "rmw/error_handling.h"
+
+#include "test_msgs/msg/basic_types.h"
+#include "test_msgs/srv/basic_types.h"
+
+#include "./testing_macros.hpp"
+
+#ifdef RMW_IMPLEMENTATION
+# define CLASSNAME_(NAME, SUFFIX) NAME ## __ ## SUFFIX
+# define CLASSNAME(NAME, SUFFIX) CLASSNAME_(NAME, SUFFIX)
+#else
+# define CLASSNAME(NAME, SUFFIX) NAME
+#endif
+
+namespace
+{
+
+/// COUNTING ALLOCATOR =========================================================
+// Default allocator that keeps count of the bytes it has outstanding, in a header in front of
+// every block
+std::atomic<int64_t> allocated_bytes{0};
+
+constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+void * counting_allocate(size_t size, void *)
+{
+  auto * block = static_cast<unsigned char *>(std::malloc(kHeaderSize + size));
+  if (!block) {
+    return nullptr;
+  }
+  *reinterpret_cast<size_t *>(block) = size;
+  allocated_bytes += static_cast<int64_t>(size);
+  return block + kHeaderSize;
+}
+
+void counting_deallocate(void * pointer, void *)
+{
+  if (!pointer) {
+    return;
+  }
+  auto * block = static_cast<unsigned char *>(pointer) - kHeaderSize;
+  allocated_bytes -= static_cast<int64_t>(*reinterpret_cast<size_t *>(block));
+  std::free(block);
+}
+
+void * counting_reallocate(void * pointer, size_t size, void * state)
+{
+  if (!pointer) {
+    return counting_allocate(size, state);
+  }
+  auto * block = static_cast<unsigned char *>(pointer) - kHeaderSize;
+  size_t old_size = *reinterpret_cast<size_t *>(block);
+  auto * new_block = static_cast<unsigned char *>(std::realloc(block, kHeaderSize + size));
+  if (!new_block) {
+    return nullptr;
+  }
+  *reinterpret_cast<size_t *>(new_block) = size;
+  allocated_bytes += static_cast<int64_t>(size) - static_cast<int64_t>(old_size);
+  return new_block + kHeaderSize;
+}
+
+void * counting_zero_allocate(size_t count, size_t size, void * state)
+{
+  void * pointer = counting_allocate(count * size, state);
+  if (pointer) {
+    std::memset(pointer, 0, count * size);
+  }
+  return pointer;
+}
+
+rcutils_allocator_t get_counting_allocator()
+{
+  rcutils_allocator_t allocator = rcutils_get_default_allocator();
+  allocator.allocate = counting_allocate;
+  allocator.deallocate = counting_deallocate;
+  allocator.reallocate = counting_reallocate;
+  allocator.zero_allocate = counting_zero_allocate;
+  allocator.state = nullptr;
+  return allocator;
+}
+
+/// RESOURCE USAGE =============================================================
+struct Usage
+{
+  double seconds;  // Since the start of the run
+  double rss_bytes;
+  double allocated_bytes;
+  double threads;
+  double fds;
+};
+
+// Number of entries in a /proc directory (other than . and ..)
+double count_entries(const char * path)
+{
+  DIR * dir = opendir(path);
+  if (!dir) {
+    return -1;
+  }
+  double count = 0;
+  while (struct dirent * entry = readdir(dir)) {
+    if (entry->d_name[0] != '.') {
+      ++count;
+    }
+  }
+  closedir(dir);
+  return count;
+}
+
+double resident_bytes()
+{
+  std::ifstream statm("/proc/self/statm");
+  size_t size = 0;
+  size_t resident = 0;
+  if (!(statm >> size >> resident)) {
+    return -1;
+  }
+  return static_cast<double>(resident) * static_cast<double>(sysconf(_SC_PAGESIZE));
+}
+
+Usage sample_usage(double seconds)
+{
+  Usage usage;
+  usage.seconds = seconds;
+  usage.rss_bytes = resident_bytes();
+  usage.allocated_bytes = static_cast<double>(allocated_bytes.load());
+  // The directory itself is open while its entries are counted
+  usage.threads = count_entries("/proc/self/task");
+  usage.fds = count_entries("/proc/self/fd") - 1;
+  return usage;
+}
+
+// Growth of a quantity over the samples, from the least squares line through them (so a one-off
+// spike or a burst of garbage at the end of the run counts for little)
+double growth(const std::vector<Usage> & samples, double Usage::* quantity)
+{
+  double n = static_cast<double>(samples.size());
+  double mean_t = 0;
+  double mean_y = 0;
+  for (const Usage & usage : samples) {
+    mean_t += usage.seconds / n;
+    mean_y += usage.*quantity / n;
+  }
+  double covariance = 0;
+  double variance = 0;
+  for (const Usage & usage : samples) {
+    covariance += (usage.seconds - mean_t) * (usage.*quantity - mean_y);
+    variance += (usage.seconds - mean_t) * (usage.seconds - mean_t);
+  }
+  if (variance == 0) {
+    return 0;
+  }
+  return covariance / variance * (samples.back().seconds - samples.front().seconds);
+}
+
+double env_seconds(const char * name, double default_value)
+{
+  const char * value = std::getenv(name);
+  if (!value || !*value) {
+    return default_value;
+  }
+  double seconds = std::strtod(value, nullptr);
+  return seconds > 0 ? seconds : default_value;
+}
+
+}  // namespace
+
+class CLASSNAME (TestSoak, RMW_IMPLEMENTATION) : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rmw_ret_t ret = rmw_init_options_init(&init_options, get_counting_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", init_options.enclave);
+    ret = rmw_init(&init_options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+  }
+
+  void TearDown() override
+  {
+    rmw_ret_t ret = rmw_shutdown(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_context_fini(&context);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_init_options_fini(&init_options);
+    EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  }
+
+  // Publish on, and take from, a topic of its own until stop is set
+  void run_load(std::atomic<bool> & stop, size_t & published, size_t & taken)
+  {
+    rmw_node_t * node = rmw_create_node(&context, "soak_load", "/soak", 0, false);
+    ASSERT_NE(nullptr, node) << rmw_get_error_string().str;
+
+    const rosidl_message_type_support_t * ts =
+      ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+    rmw_publisher_options_t publisher_options = rmw_get_default_publisher_options();
+    rmw_publisher_t * pub = rmw_create_publisher(
+      node, ts, "/soak/load", &rmw_qos_profile_default, &publisher_options);
+    ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+    rmw_subscription_options_t subscription_options = rmw_get_default_subscription_options();
+    rmw_subscription_t * sub = rmw_create_subscription(
+      node, ts, "/soak/load", &rmw_qos_profile_default, &subscription_options);
+    ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
+
+    test_msgs__msg__BasicTypes message;
+    ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&message));
+    while (!stop) {
+      message.int64_value = static_cast<int64_t>(published);
+      if (rmw_publish(pub, &message, nullptr) == RMW_RET_OK) {
+        ++published;
+      } else {
+        rmw_reset_error();
+      }
+
+      bool took = true;
+      while (took) {
+        took = false;
+        if (rmw_take(sub, &message, &took, nullptr) != RMW_RET_OK) {
+          rmw_reset_error();
+          break;
+        }
+        taken += took ? 1 : 0;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    test_msgs__msg__BasicTypes__fini(&message);
+
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, pub)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_node(node)) << rmw_get_error_string().str;
+  }
+
+  // Create a node with a publisher, a subscription, a client and a service, exchange a message
+  // and a request with them, and destroy them all again. Every cycle uses names of its own, so
+  // state kept per name has to be released too.
+  void run_cycle(size_t cycle)
+  {
+    std::string name = "soak_" + std::to_string(cycle);
+    std::string topic = "/soak/" + name;
+
+    rmw_node_t * node = rmw_create_node(&context, name.c_str(), "/soak", 0, false);
+    ASSERT_NE(nullptr, node) << rmw_get_error_string().str;
+
+    const rosidl_message_type_support_t * msg_ts =
+      ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+    rmw_publisher_options_t publisher_options = rmw_get_default_publisher_options();
+    rmw_publisher_t * pub = rmw_create_publisher(
+      node, msg_ts, topic.c_str(), &rmw_qos_profile_default, &publisher_options);
+    ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+    rmw_subscription_options_t subscription_options = rmw_get_default_subscription_options();
+    rmw_subscription_t * sub = rmw_create_subscription(
+      node, msg_ts, topic.c_str(), &rmw_qos_profile_default, &subscription_options);
+    ASSERT_NE(nullptr, sub) << rmw_get_error_string().str;
+
+    const rosidl_service_type_support_t * srv_ts =
+      ROSIDL_GET_SRV_TYPE_SUPPORT(test_msgs, srv, BasicTypes);
+    rmw_service_t * service =
+      rmw_create_service(node, srv_ts, topic.c_str(), &rmw_qos_profile_services_default);
+    ASSERT_NE(nullptr, service) << rmw_get_error_string().str;
+    rmw_client_t * client =
+      rmw_create_client(node, srv_ts, topic.c_str(), &rmw_qos_profile_services_default);
+    ASSERT_NE(nullptr, client) << rmw_get_error_string().str;
+
+    // Whether the exchanges get through depends on discovery, which is not what is under test
+    test_msgs__msg__BasicTypes message;
+    ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&message));
+    EXPECT_EQ(RMW_RET_OK, rmw_publish(pub, &message, nullptr)) << rmw_get_error_string().str;
+
+    test_msgs__srv__BasicTypes_Request request;
+    ASSERT_TRUE(test_msgs__srv__BasicTypes_Request__init(&request));
+    test_msgs__srv__BasicTypes_Response response;
+    ASSERT_TRUE(test_msgs__srv__BasicTypes_Response__init(&response));
+    int64_t sequence_id = 0;
+    EXPECT_EQ(RMW_RET_OK, rmw_send_request(client, &request, &sequence_id)) <<
+      rmw_get_error_string().str;
+
+    bool took_message = false;
+    bool took_response = false;
+    SLEEP_AND_RETRY_UNTIL(std::chrono::milliseconds(1), std::chrono::milliseconds(100)) {
+      bool taken = false;
+      if (!took_message && rmw_take(sub, &message, &taken, nullptr) == RMW_RET_OK) {
+        took_message = taken;
+      }
+      rmw_service_info_t request_header;
+      taken = false;
+      if (rmw_take_request(service, &request_header, &request, &taken) == RMW_RET_OK && taken) {
+        rmw_send_response(service, &request_header.request_id, &response);
+      }
+      rmw_service_info_t response_header;
+      taken = false;
+      if (rmw_take_response(client, &response_header, &response, &taken) == RMW_RET_OK) {
+        took_response = taken;
+      }
+      rmw_reset_error();
+      if (took_message && took_response) {
+        break;
+      }
+    }
+
+    test_msgs__srv__BasicTypes_Response__fini(&response);
+    test_msgs__srv__BasicTypes_Request__fini(&request);
+    test_msgs__msg__BasicTypes__fini(&message);
+
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_client(node, client)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_service(node, service)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, sub)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, pub)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_node(node)) << rmw_get_error_string().str;
+  }
+
+  rmw_init_options_t init_options{rmw_get_zero_initialized_init_options()};
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+};
+
+TEST_F(CLASSNAME(TestSoak, RMW_IMPLEMENTATION), cycle_entities_under_load) {
+  const double duration = env_seconds("RMW_ZENOH_SOAK_DURATION", 60);
+  const double sample_period = env_seconds("RMW_ZENOH_SOAK_SAMPLE_PERIOD", 2);
+
+  std::atomic<bool> stop{false};
+  size_t published = 0;
+  size_t taken = 0;
+  std::thread load([&]() {run_load(stop, published, taken);});
+
+  std::vector<Usage> samples;
+  auto start = std::chrono::steady_clock::now();
+  auto next_sample = start;
+  size_t cycles = 0;
+  printf("seconds,cycles,rss_bytes,allocated_bytes,threads,fds\n");
+  while (!HasFatalFailure()) {
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - start).count();
+    if (now >= next_sample) {
+      Usage usage = sample_usage(seconds);
+      samples.push_back(usage);
+      printf(
+        "%.1f,%zu,%.0f,%.0f,%.0f,%.0f\n", usage.seconds, cycles, usage.rss_bytes,
+        usage.allocated_bytes, usage.threads, usage.fds);
+      fflush(stdout);
+      next_sample += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(sample_period));
+    }
+    if (seconds >= duration) {
+      break;
+    }
+    run_cycle(cycles++);
+  }
+
+  stop = true;
+  load.join();
+  ASSERT_FALSE(HasFatalFailure());
+  EXPECT_GT(published, 0u);
+  EXPECT_GT(taken, 0u);
+
+  // Caches, pools and arenas fill up during the first fifth of the run
+  samples.erase(samples.begin(), samples.begin() + samples.size() / 5);
+  ASSERT_GE(samples.size(), 3u) << "run too short to tell a trend";
+
+  const Usage & first = samples.front();
+  EXPECT_LT(growth(samples, &Usage::rss_bytes), 4.0 * 1024 * 1024 + 0.05 * first.rss_bytes) <<
+    "resident memory keeps growing";
+  EXPECT_LT(growth(samples, &Usage::allocated_bytes), 64.0 * 1024) <<
+    "memory from the context allocator keeps growing";
+  EXPECT_LT(growth(samples, &Usage::threads), 0.5) << "threads keep being added";
+  EXPECT_LT(growth(samples, &Usage::fds), 0.5) << "file descriptors keep being opened";
+}
@@ -281,3 +281,20 @@ TEST_F(CLASSNAME(TestSubscriptionUse, RMW_IMPLEMENTATION), count_matched_publish
   EXPECT_EQ(RMW_RET_INCORRECT_RMW_IMPLEMENTATION, ret);
   rmw_reset_error();
 }
+
+TEST_F(CLASSNAME(TestSubscriptionUse, RMW_IMPLEMENTATION), take_with_allocation) {
+  rmw_subscription_allocation_t allocation{nullptr, nullptr};
+  rmw_ret_t ret = rmw_init_subscription_allocation(ts, nullptr, &allocation);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_NE(nullptr, allocation.data);
+
+  bool taken = true;
+  test_msgs__msg__BasicTypes msg{};
+  ret = rmw_take(sub, &msg, &taken, &allocation);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_FALSE(taken);
+
+  ret = rmw_fini_subscription_allocation(&allocation);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(nullptr, allocation.data);
+}
@@ -0,0 +1,304 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rmw_zenoh_common_cpp/trace_format.hpp"
+
+#include "impl/trace_recorder.hpp"
+
+using rmw_zenoh_common_cpp::TraceEvent;
+using rmw_zenoh_common_cpp::TraceReader;
+using rmw_zenoh_common_cpp::TraceRecord;
+using rmw_zenoh_common_cpp::TraceRecorder;
+
+namespace
+{
+class TraceTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    char path[] = "/tmp/test_trace_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_NE(-1, fd);
+    close(fd);
+    path_ = path;
+    recorder.reset(TraceRecorder::open(path_.c_str()));
+    ASSERT_NE(nullptr, recorder);
+  }
+
+  void TearDown() override
+  {
+    recorder.reset();
+    unlink(path_.c_str());
+  }
+
+  // Write the trace out, and read every record of it back
+  std::vector<TraceRecord> read_back()
+  {
+    recorder.reset();
+    std::vector<TraceRecord> records;
+    TraceReader reader;
+    std::string error;
+    EXPECT_TRUE(reader.open(path_.c_str(), error)) << error;
+    TraceRecord record;
+    while (reader.next(record, error)) {
+      records.push_back(record);
+    }
+    EXPECT_EQ("", error);
+    return records;
+  }
+
+  std::vector<unsigned char> bytes() const
+  {
+    std::vector<unsigned char> bytes;
+    FILE * file = fopen(path_.c_str(), "rb");
+    EXPECT_NE(nullptr, file);
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+      bytes.push_back(static_cast<unsigned char>(c));
+    }
+    fclose(file);
+    return bytes;
+  }
+
+  void write(const std::vector<unsigned char> & bytes) const
+  {
+    FILE * file = fopen(path_.c_str(), "wb");
+    ASSERT_NE(nullptr, file);
+    ASSERT_EQ(bytes.size(), fwrite(bytes.data(), 1, bytes.size(), file));
+    fclose(file);
+  }
+
+  std::string path_;
+  std::unique_ptr<TraceRecorder> recorder;
+  // Entities are only told apart by their addresses
+  int node = 0;
+  int publisher = 0;
+  int subscription = 0;
+  int client = 0;
+};
+
+TEST_F(TraceTest, Header)
+{
+  // Opened in SetUp()
+  int64_t after = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  EXPECT_TRUE(read_back().empty());
+
+  std::vector<unsigned char> header = bytes();
+  ASSERT_EQ(rmw_zenoh_common_cpp::kTraceHeaderSize, header.size());
+  EXPECT_EQ(0, memcmp(header.data(), "RZTR", 4));
+  uint16_t version;
+  memcpy(&version, header.data() + 4, sizeof(version));
+  EXPECT_EQ(rmw_zenoh_common_cpp::kTraceVersion, version);
+  EXPECT_EQ(0, header[6]);
+  EXPECT_EQ(0, header[7]);
+  int64_t start;
+  memcpy(&start, header.data() + 8, sizeof(start));
+  EXPECT_GE(after, start);
+  EXPECT_LT(after - 60000000000, start);
+
+  TraceReader reader;
+  std::string error;
+  ASSERT_TRUE(reader.open(path_.c_str(), error)) << error;
+  EXPECT_EQ(start, reader.start());
+}
+
+TEST_F(TraceTest, CreateRecordsHaveNames)
+{
+  recorder->create(TraceEvent::kCreateNode, &node, nullptr, "/my_test_ns/my_test_node");
+  recorder->create(TraceEvent::kCreatePublisher, &publisher, &node, "/chatter");
+  recorder->create(TraceEvent::kCreateSubscription, &subscription, &node, "");
+  recorder->create(TraceEvent::kCreateClient, &client, &node, nullptr);
+  recorder->record(TraceEvent::kPublish, &publisher, 128);
+  recorder->destroy(TraceEvent::kDestroyPublisher, &publisher);
+  // Forgotten once destroyed, like entities that were never recorded
+  recorder->record(TraceEvent::kPublish, &publisher, 64);
+  // Names are cut to what their length can hold
+  std::string long_name(UINT16_MAX + 10, 'x');
+  recorder->create(TraceEvent::kCreateService, &publisher, &node, long_name.c_str());
+
+  std::vector<TraceRecord> records = read_back();
+  ASSERT_EQ(8u, records.size());
+
+  EXPECT_EQ(TraceEvent::kCreateNode, records[0].event);
+  EXPECT_EQ(1u, records[0].entity);
+  EXPECT_EQ(0u, records[0].value);
+  EXPECT_EQ("/my_test_ns/my_test_node", records[0].name);
+
+  EXPECT_EQ(TraceEvent::kCreatePublisher, records[1].event);
+  EXPECT_EQ(2u, records[1].entity);
+  EXPECT_EQ(1u, records[1].value);
+  EXPECT_EQ("/chatter", records[1].name);
+
+  EXPECT_EQ(TraceEvent::kCreateSubscription, records[2].event);
+  EXPECT_EQ(3u, records[2].entity);
+  EXPECT_EQ(1u, records[2].value);
+  EXPECT_EQ("", records[2].name);
+
+  EXPECT_EQ(TraceEvent::kCreateClient, records[3].event);
+  EXPECT_EQ(4u, records[3].entity);
+  EXPECT_EQ("", records[3].name);
+
+  // The records after an empty name are read from the right place
+  EXPECT_EQ(TraceEvent::kPublish, records[4].event);
+  EXPECT_EQ(2u, records[4].entity);
+  EXPECT_EQ(128u, records[4].value);
+  EXPECT_EQ("", records[4].name);
+
+  EXPECT_EQ(TraceEvent::kDestroyPublisher, records[5].event);
+  EXPECT_EQ(2u, records[5].entity);
+  EXPECT_EQ(0u, records[5].value);
+
+  EXPECT_EQ(TraceEvent::kPublish, records[6].event);
+  EXPECT_EQ(0u, records[6].entity);
+  EXPECT_EQ(64u, records[6].value);
+
+  // A new entity at the address of a destroyed one gets a new ID
+  EXPECT_EQ(TraceEvent::kCreateService, records[7].event);
+  EXPECT_EQ(5u, records[7].entity);
+  EXPECT_EQ(1u, records[7].value);
+  EXPECT_EQ(std::string(UINT16_MAX, 'x'), records[7].name);
+
+  for (size_t i = 1; i < records.size(); ++i) {
+    EXPECT_LE(records[i - 1].time, records[i].time) << i;
+  }
+}
+
+TEST_F(TraceTest, WaitsAreRecordedWhenTheyReturn)
+{
+  recorder->create(TraceEvent::kCreateNode, &node, nullptr, "/node");
+  recorder->create(TraceEvent::kCreateSubscription, &subscription, &node, "/chatter");
+  int64_t wait_start = recorder->now();
+  recorder->record(TraceEvent::kTake, &subscription, 32);
+  recorder->record(
+    TraceEvent::kWait, nullptr, static_cast<uint64_t>(recorder->now() - wait_start), wait_start);
+  recorder->record(TraceEvent::kTake, &subscription, 16);
+
+  std::vector<TraceRecord> records = read_back();
+  ASSERT_EQ(5u, records.size());
+  EXPECT_EQ(TraceEvent::kTake, records[2].event);
+  EXPECT_EQ(TraceEvent::kWait, records[3].event);
+  EXPECT_EQ(TraceEvent::kTake, records[4].event);
+
+  // In the order they were recorded, not of their times
+  EXPECT_EQ(0u, records[3].entity);
+  EXPECT_EQ(wait_start, records[3].time);
+  EXPECT_LT(records[3].time, records[2].time);
+  EXPECT_LE(records[2].time, records[4].time);
+  EXPECT_LE(static_cast<uint64_t>(records[2].time - wait_start), records[3].value);
+}
+
+TEST_F(TraceTest, FlushWritesTheBufferedRecords)
+{
+  recorder->create(TraceEvent::kCreateNode, &node, nullptr, "/node");
+  EXPECT_EQ(0u, bytes().size());
+  recorder->flush();
+  EXPECT_EQ(
+    rmw_zenoh_common_cpp::kTraceHeaderSize + rmw_zenoh_common_cpp::kTraceRecordSize + 2 + 5,
+    bytes().size());
+}
+
+TEST_F(TraceTest, TruncatedFilesAreErrors)
+{
+  recorder->create(TraceEvent::kCreateNode, &node, nullptr, "/node");
+  recorder->record(TraceEvent::kPublish, &node, 8);
+  recorder->create(TraceEvent::kCreatePublisher, &publisher, &node, "/chatter");
+  ASSERT_EQ(3u, read_back().size());
+  const std::vector<unsigned char> complete = bytes();
+
+  // Cut in the fixed part of a record, in the length of a name, and in a name
+  const size_t fixed = rmw_zenoh_common_cpp::kTraceRecordSize;
+  const size_t third = complete.size() - (fixed + 2 + 8);
+  for (size_t size : {third + 1, third + fixed - 1, third + fixed + 1, complete.size() - 1}) {
+    SCOPED_TRACE("cut to " + std::to_string(size) + " bytes");
+    write(std::vector<unsigned char>(complete.begin(), complete.begin() + size));
+
+    TraceReader reader;
+    std::string error;
+    ASSERT_TRUE(reader.open(path_.c_str(), error)) << error;
+    TraceRecord record;
+    EXPECT_TRUE(reader.next(record, error));
+    EXPECT_EQ("/node", record.name);
+    EXPECT_TRUE(reader.next(record, error));
+    EXPECT_EQ(TraceEvent::kPublish, record.event);
+    EXPECT_FALSE(reader.next(record, error));
+    EXPECT_EQ(path_ + " is truncated: record 3 ends after " + std::to_string(size - third) +
+      " bytes", error);
+  }
+
+  // Cut between records, which is the end of the trace
+  write(std::vector<unsigned char>(complete.begin(), complete.begin() + third));
+  TraceReader reader;
+  std::string error;
+  ASSERT_TRUE(reader.open(path_.c_str(), error)) << error;
+  TraceRecord record;
+  EXPECT_TRUE(reader.next(record, error));
+  EXPECT_TRUE(reader.next(record, error));
+  EXPECT_FALSE(reader.next(record, error));
+  EXPECT_EQ("", error);
+}
+
+TEST_F(TraceTest, OpenChecksTheHeader)
+{
+  ASSERT_EQ(0u, read_back().size());
+  const std::vector<unsigned char> header = bytes();
+  std::string error;
+
+  {
+    TraceReader reader;
+    EXPECT_FALSE(reader.open("/nonexistent/trace.rztr", error));
+    EXPECT_EQ("cannot open /nonexistent/trace.rztr", error);
+  }
+
+  write(std::vector<unsigned char>(header.begin(), header.end() - 1));
+  {
+    TraceReader reader;
+    EXPECT_FALSE(reader.open(path_.c_str(), error));
+    EXPECT_EQ(path_ + " is not an rmw_zenoh trace", error);
+  }
+
+  std::vector<unsigned char> other_magic = header;
+  other_magic[0] = 'X';
+  write(other_magic);
+  {
+    TraceReader reader;
+    EXPECT_FALSE(reader.open(path_.c_str(), error));
+    EXPECT_EQ(path_ + " is not an rmw_zenoh trace", error);
+  }
+
+  std::vector<unsigned char> other_version = header;
+  other_version[4] += 1;
+  write(other_version);
+  {
+    TraceReader reader;
+    EXPECT_FALSE(reader.open(path_.c_str(), error));
+    EXPECT_EQ(path_ + " is a trace of version 2 instead of 1", error);
+  }
+}
+
+}  // namespace
@@ -0,0 +1,525 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/rmw.h"
+#include "rmw/error_handling.h"
+
+#include "rosidl_runtime_c/message_type_support_struct.h"
+#include "rosidl_typesupport_cpp/message_type_support.hpp"
+#include "rosidl_typesupport_introspection_c/field_types.h"
+#include "rosidl_typesupport_introspection_c/identifier.h"
+#include "rosidl_typesupport_introspection_c/message_introspection.h"
+#include "rosidl_typesupport_introspection_cpp/identifier.hpp"
+
+#include "test_msgs/msg/arrays.h"
+#include "test_msgs/msg/basic_types.h"
+#include "test_msgs/msg/basic_types.hpp"
+#include "test_msgs/msg/bounded_sequences.h"
+#include "test_msgs/msg/bounded_sequences.hpp"
+#include "test_msgs/msg/nested.h"
+#include "test_msgs/msg/nested.hpp"
+#include "test_msgs/msg/strings.h"
+#include "test_msgs/msg/strings.hpp"
+#include "test_msgs/msg/w_strings.h"
+#include "test_msgs/msg/w_strings.hpp"
+
+#include "impl/pubsub_impl.hpp"
+#include "impl/type_hash.hpp"
+
+#include "./config.hpp"
+
+#ifdef RMW_IMPLEMENTATION
+# define CLASSNAME_(NAME, SUFFIX) NAME ## __ ## SUFFIX
+# define CLASSNAME(NAME, SUFFIX) CLASSNAME_(NAME, SUFFIX)
+#else
+# define CLASSNAME(NAME, SUFFIX) NAME
+#endif
+
+using rmw_zenoh_common_cpp::message_type_hash;
+using rmw_zenoh_common_cpp::message_type_name;
+
+namespace
+{
+const rosidl_message_type_support_t * introspection_c(
+  const rosidl_message_type_support_t * type_supports)
+{
+  const rosidl_message_type_support_t * introspection =
+    get_message_typesupport_handle(type_supports, rosidl_typesupport_introspection_c__identifier);
+  EXPECT_NE(nullptr, introspection);
+  return introspection;
+}
+
+template<typename MessageT>
+const rosidl_message_type_support_t * introspection_cpp()
+{
+  const rosidl_message_type_support_t * introspection = get_message_typesupport_handle(
+    rosidl_typesupport_cpp::get_message_type_support_handle<MessageT>(),
+    rosidl_typesupport_introspection_cpp::typesupport_identifier);
+  EXPECT_NE(nullptr, introspection);
+  return introspection;
+}
+
+// A copy of the C introspection type support of a type, whose fields can be edited to describe
+// another version of it
+class EditedType
+{
+public:
+  explicit EditedType(const rosidl_message_type_support_t * introspection)
+  : type_support_(*introspection)
+  {
+    auto * original =
+      static_cast<const rosidl_typesupport_introspection_c__MessageMembers *>(introspection->data);
+    fields_.assign(original->members_, original->members_ + original->member_count_);
+    members_ = *original;
+    members_.members_ = fields_.data();
+    type_support_.data = &members_;
+  }
+
+  EditedType(const EditedType &) = delete;
+  EditedType & operator=(const EditedType &) = delete;
+
+  rosidl_typesupport_introspection_c__MessageMember & field(const char * name)
+  {
+    for (auto & field : fields_) {
+      if (strcmp(field.name_, name) == 0) {
+        return field;
+      }
+    }
+    ADD_FAILURE() << "no field " << name;
+    return fields_.front();
+  }
+
+  std::vector<rosidl_typesupport_introspection_c__MessageMember> & fields()
+  {
+    return fields_;
+  }
+
+  uint64_t hash() const
+  {
+    return message_type_hash(&type_support_);
+  }
+
+  const rosidl_message_type_support_t * get() const
+  {
+    return &type_support_;
+  }
+
+private:
+  std::vector<rosidl_typesupport_introspection_c__MessageMember> fields_;
+  rosidl_typesupport_introspection_c__MessageMembers members_;
+  rosidl_message_type_support_t type_support_;
+};
+
+template<typename MessageT>
+void check_languages(const rosidl_message_type_support_t * c_type_supports, const char * name)
+{
+  const rosidl_message_type_support_t * c = introspection_c(c_type_supports);
+  const rosidl_message_type_support_t * cpp = introspection_cpp<MessageT>();
+  ASSERT_TRUE(c && cpp);
+  EXPECT_EQ(name, message_type_name(c));
+  EXPECT_EQ(name, message_type_name(cpp));
+  EXPECT_NE(0u, message_type_hash(c));
+  EXPECT_EQ(message_type_hash(c), message_type_hash(cpp));
+}
+}  // namespace
+
+TEST(TestTypeHash, languages_hash_the_same) {
+  check_languages<test_msgs::msg::BasicTypes>(
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes), "test_msgs/msg/BasicTypes");
+  check_languages<test_msgs::msg::BoundedSequences>(
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BoundedSequences),
+    "test_msgs/msg/BoundedSequences");
+  check_languages<test_msgs::msg::Nested>(
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Nested), "test_msgs/msg/Nested");
+  check_languages<test_msgs::msg::Strings>(
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Strings), "test_msgs/msg/Strings");
+  check_languages<test_msgs::msg::WStrings>(
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, WStrings), "test_msgs/msg/WStrings");
+
+  // Without introspection there is no hash, and no check
+  EXPECT_EQ(0u, message_type_hash(nullptr));
+}
+
+TEST(TestTypeHash, types_hash_differently) {
+  uint64_t basic_types = message_type_hash(
+    introspection_c(ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes)));
+  uint64_t arrays = message_type_hash(
+    introspection_c(ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Arrays)));
+  uint64_t strings = message_type_hash(
+    introspection_c(ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Strings)));
+  EXPECT_NE(basic_types, arrays);
+  EXPECT_NE(basic_types, strings);
+  EXPECT_NE(arrays, strings);
+}
+
+TEST(TestTypeHash, field_names_and_order_count) {
+  const rosidl_message_type_support_t * basic_types =
+    introspection_c(ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes));
+  ASSERT_NE(nullptr, basic_types);
+
+  // An unedited copy hashes the same
+  EXPECT_EQ(message_type_hash(basic_types), EditedType(basic_types).hash());
+
+  EditedType renamed(basic_types);
+  renamed.field("int32_value").name_ = "int32_count";
+  EXPECT_NE(message_type_hash(basic_types), renamed.hash());
+
+  EditedType reordered(basic_types);
+  ASSERT_LE(2u, reordered.fields().size());
+  std::swap(reordered.fields()[0], reordered.fields()[1]);
+  EXPECT_NE(message_type_hash(basic_types), reordered.hash());
+}
+
+TEST(TestTypeHash, field_types_count) {
+  const rosidl_message_type_support_t * basic_types =
+    introspection_c(ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes));
+  ASSERT_NE(nullptr, basic_types);
+
+  EditedType unsigned_field(basic_types);
+  ASSERT_EQ(
+    rosidl_typesupport_introspection_c__ROS_TYPE_INT32,
+    unsigned_field.field("int32_value").type_id_);
+  unsigned_field.field("int32_value").type_id_ =
+    rosidl_typesupport_introspection_c__ROS_TYPE_UINT32;
+  EXPECT_NE(message_type_hash(basic_types), unsigned_field.hash());
+
+  // Same width, another type
+  EditedType float_field(basic_types);
+  float_field.field("int32_value").type_id_ = rosidl_typesupport_introspection_c__ROS_TYPE_FLOAT;
+  EXPECT_NE(message_type_hash(basic_types), float_field.hash());
+  EXPECT_NE(unsigned_field.hash(), float_field.hash());
+}
+
+TEST(TestTypeHash, bounds_count) {
+  const rosidl_message_type_support_t * strings =
+    introspection_c(ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Strings));
+  const rosidl_message_type_support_t * arrays =
+    introspection_c(ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Arrays));
+  const rosidl_message_type_support_t * bounded_sequences =
+    introspection_c(ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BoundedSequences));
+  ASSERT_TRUE(strings && arrays && bounded_sequences);
+
+  // String bounds
+  EditedType longer_string(strings);
+  ASSERT_EQ(22u, longer_string.field("bounded_string_value").string_upper_bound_);
+  longer_string.field("bounded_string_value").string_upper_bound_ = 23;
+  EXPECT_NE(message_type_hash(strings), longer_string.hash());
+
+  EditedType bounded_string(strings);
+  ASSERT_EQ(0u, bounded_string.field("string_value").string_upper_bound_);
+  bounded_string.field("string_value").string_upper_bound_ = 22;
+  EXPECT_NE(message_type_hash(strings), bounded_string.hash());
+
+  // Array sizes
+  EditedType longer_array(arrays);
+  ASSERT_TRUE(longer_array.field("int32_values").is_array_);
+  ASSERT_EQ(3u, longer_array.field("int32_values").array_size_);
+  longer_array.field("int32_values").array_size_ = 4;
+  EXPECT_NE(message_type_hash(arrays), longer_array.hash());
+
+  EditedType not_an_array(arrays);
+  not_an_array.field("int32_values").is_array_ = false;
+  EXPECT_NE(message_type_hash(arrays), not_an_array.hash());
+
+  // Sequence bounds
+  EditedType longer_sequence(bounded_sequences);
+  ASSERT_TRUE(longer_sequence.field("int32_values").is_upper_bound_);
+  ASSERT_EQ(3u, longer_sequence.field("int32_values").array_size_);
+  longer_sequence.field("int32_values").array_size_ = 4;
+  EXPECT_NE(message_type_hash(bounded_sequences), longer_sequence.hash());
+
+  // int32[3] and int32[<=3]
+  EditedType fixed_array(bounded_sequences);
+  fixed_array.field("int32_values").is_upper_bound_ = false;
+  EXPECT_NE(message_type_hash(bounded_sequences), fixed_array.hash());
+}
+
+TEST(TestTypeHash, nested_types_count) {
+  const rosidl_message_type_support_t * nested =
+    introspection_c(ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Nested));
+  const rosidl_message_type_support_t * basic_types =
+    introspection_c(ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes));
+  const rosidl_message_type_support_t * strings =
+    introspection_c(ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Strings));
+  ASSERT_TRUE(nested && basic_types && strings);
+
+  // A change deep in the nested type
+  EditedType edited_basic_types(basic_types);
+  edited_basic_types.field("float64_value").name_ = "float64_count";
+  EditedType edited_field(nested);
+  ASSERT_NE(nullptr, edited_field.field("basic_types_value").members_);
+  edited_field.field("basic_types_value").members_ = edited_basic_types.get();
+  EXPECT_NE(message_type_hash(nested), edited_field.hash());
+
+  // Another nested type
+  EditedType other_type(nested);
+  other_type.field("basic_types_value").members_ = strings;
+  EXPECT_NE(message_type_hash(nested), other_type.hash());
+  EXPECT_NE(edited_field.hash(), other_type.hash());
+
+  // An unedited copy of the nested type is the same type
+  EditedType copied_basic_types(basic_types);
+  EditedType copied_field(nested);
+  copied_field.field("basic_types_value").members_ = copied_basic_types.get();
+  EXPECT_EQ(message_type_hash(nested), copied_field.hash());
+}
+
+// Publishers and subscriptions of different types on a topic
+class CLASSNAME (TestTypeMismatch, RMW_IMPLEMENTATION) : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    rmw_ret_t ret = rmw_init_options_init(&init_options, rcutils_get_default_allocator());
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+    ASSERT_STREQ("/", init_options.enclave);
+    ret = rmw_init(&init_options, &context);
+    ASSERT_EQ(RMW_RET_OK, ret) << rcutils_get_error_string().str;
+    node = rmw_create_node(&context, "my_test_node", "/my_test_ns", 0, false);
+    ASSERT_NE(nullptr, node) << rcutils_get_error_string().str;
+
+    rmw_publisher_options_t pub_options = rmw_get_default_publisher_options();
+    basic_types_pub = rmw_create_publisher(
+      node, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes), topic_name,
+      &rmw_qos_profile_default, &pub_options);
+    ASSERT_NE(nullptr, basic_types_pub) << rmw_get_error_string().str;
+    arrays_pub = rmw_create_publisher(
+      node, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Arrays), topic_name,
+      &rmw_qos_profile_default, &pub_options);
+    ASSERT_NE(nullptr, arrays_pub) << rmw_get_error_string().str;
+
+    rmw_subscription_options_t sub_options = rmw_get_default_subscription_options();
+    basic_types_sub = rmw_create_subscription(
+      node, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes), topic_name,
+      &rmw_qos_profile_default, &sub_options);
+    ASSERT_NE(nullptr, basic_types_sub) << rmw_get_error_string().str;
+    cpp_basic_types_sub = rmw_create_subscription(
+      node, rosidl_typesupport_cpp::get_message_type_support_handle<test_msgs::msg::BasicTypes>(),
+      topic_name, &rmw_qos_profile_default, &sub_options);
+    ASSERT_NE(nullptr, cpp_basic_types_sub) << rmw_get_error_string().str;
+    strings_sub = rmw_create_subscription(
+      node, ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, Strings), topic_name,
+      &rmw_qos_profile_default, &sub_options);
+    ASSERT_NE(nullptr, strings_sub) << rmw_get_error_string().str;
+
+    ret = rmw_subscription_event_init(
+      &strings_event, strings_sub, RMW_EVENT_REQUESTED_QOS_INCOMPATIBLE);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    ret = rmw_subscription_event_init(
+      &basic_types_event, basic_types_sub, RMW_EVENT_REQUESTED_QOS_INCOMPATIBLE);
+    ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+    wait_set = rmw_create_wait_set(&context, 1);
+    ASSERT_NE(nullptr, wait_set) << rmw_get_error_string().str;
+    std::this_thread::sleep_for(rmw_intraprocess_discovery_delay);
+
+    ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&basic_types));
+    basic_types.int32_value = 42;
+    ASSERT_TRUE(test_msgs__msg__Arrays__init(&arrays));
+  }
+
+  void TearDown() override
+  {
+    test_msgs__msg__Arrays__fini(&arrays);
+    test_msgs__msg__BasicTypes__fini(&basic_types);
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_wait_set(wait_set)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_event_fini(&basic_types_event)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_event_fini(&strings_event)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, strings_sub)) <<
+      rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, cpp_basic_types_sub)) <<
+      rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_subscription(node, basic_types_sub)) <<
+      rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, arrays_pub)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_publisher(node, basic_types_pub)) <<
+      rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_destroy_node(node)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_shutdown(&context)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_context_fini(&context)) << rmw_get_error_string().str;
+    EXPECT_EQ(RMW_RET_OK, rmw_init_options_fini(&init_options)) << rmw_get_error_string().str;
+  }
+
+  // Take a message, waiting up to a second for it
+  bool take(rmw_subscription_t * sub, void * message)
+  {
+    for (int i = 0; i < 100; ++i) {
+      bool taken = false;
+      rmw_ret_t ret = rmw_take(sub, message, &taken, nullptr);
+      EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+      if (taken) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+  }
+
+  // Whether a subscription has nothing to take
+  bool nothing_to_take(rmw_subscription_t * sub, void * message)
+  {
+    bool taken = true;
+    EXPECT_EQ(RMW_RET_OK, rmw_take(sub, message, &taken, nullptr)) << rmw_get_error_string().str;
+    return !taken;
+  }
+
+  // Whether a wait on the event finds it raised, waiting for up to timeout_ms
+  bool raised(rmw_event_t * event, int timeout_ms)
+  {
+    void * events_storage[1] = {event};
+    rmw_events_t events{1, events_storage};
+    rmw_subscriptions_t subscriptions{0, nullptr};
+    rmw_guard_conditions_t guard_conditions{0, nullptr};
+    rmw_services_t services{0, nullptr};
+    rmw_clients_t clients{0, nullptr};
+    rmw_time_t timeout{0, static_cast<uint64_t>(timeout_ms) * 1000000};
+    rmw_ret_t ret = rmw_wait(
+      &subscriptions, &guard_conditions, &services, &clients, &events, wait_set, &timeout);
+    EXPECT_TRUE(ret == RMW_RET_OK || ret == RMW_RET_TIMEOUT) << rmw_get_error_string().str;
+    EXPECT_EQ(ret == RMW_RET_OK, events_storage[0] != nullptr);
+    return ret == RMW_RET_OK;
+  }
+
+  rmw_requested_qos_incompatible_event_status_t take_event(rmw_event_t * event)
+  {
+    rmw_requested_qos_incompatible_event_status_t status{};
+    bool taken = false;
+    EXPECT_EQ(RMW_RET_OK, rmw_take_event(event, &status, &taken)) << rmw_get_error_string().str;
+    EXPECT_TRUE(taken);
+    EXPECT_EQ(RMW_QOS_POLICY_INVALID, status.last_policy_kind);
+    return status;
+  }
+
+  rmw_init_options_t init_options{rmw_get_zero_initialized_init_options()};
+  rmw_context_t context{rmw_get_zero_initialized_context()};
+  rmw_node_t * node{nullptr};
+  rmw_publisher_t * basic_types_pub{nullptr};
+  rmw_publisher_t * arrays_pub{nullptr};
+  rmw_subscription_t * basic_types_sub{nullptr};
+  rmw_subscription_t * cpp_basic_types_sub{nullptr};
+  rmw_subscription_t * strings_sub{nullptr};
+  rmw_event_t strings_event{rmw_get_zero_initialized_event()};
+  rmw_event_t basic_types_event{rmw_get_zero_initialized_event()};
+  rmw_wait_set_t * wait_set{nullptr};
+  const char * const topic_name = "/type_hash";
+  test_msgs__msg__BasicTypes basic_types;
+  test_msgs__msg__Arrays arrays;
+};
+
+TEST_F(CLASSNAME(TestTypeMismatch, RMW_IMPLEMENTATION), subscriptions_tag_their_type) {
+  auto * strings_data = static_cast<rmw_subscription_data_t *>(strings_sub->data);
+  auto * basic_types_data = static_cast<rmw_subscription_data_t *>(basic_types_sub->data);
+  auto * cpp_basic_types_data = static_cast<rmw_subscription_data_t *>(cpp_basic_types_sub->data);
+  EXPECT_NE(0u, basic_types_data->type_hash_);
+  EXPECT_EQ(basic_types_data->type_hash_, cpp_basic_types_data->type_hash_);
+  EXPECT_NE(basic_types_data->type_hash_, strings_data->type_hash_);
+}
+
+TEST_F(CLASSNAME(TestTypeMismatch, RMW_IMPLEMENTATION), mismatched_samples_are_dropped) {
+  // Nothing is raised before a foreign type shows up
+  EXPECT_FALSE(raised(&strings_event, 0));
+  EXPECT_EQ(0, take_event(&strings_event).total_count);
+
+  ASSERT_EQ(RMW_RET_OK, rmw_publish(basic_types_pub, &basic_types, nullptr)) <<
+    rmw_get_error_string().str;
+
+  // Both languages of the type take the sample
+  test_msgs__msg__BasicTypes c_taken;
+  ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&c_taken));
+  EXPECT_TRUE(take(basic_types_sub, &c_taken));
+  EXPECT_EQ(42, c_taken.int32_value);
+  test_msgs__msg__BasicTypes__fini(&c_taken);
+  test_msgs::msg::BasicTypes cpp_taken;
+  EXPECT_TRUE(take(cpp_basic_types_sub, &cpp_taken));
+  EXPECT_EQ(42, cpp_taken.int32_value);
+
+  // The sample was handled for every subscription at once, so the Strings subscription has
+  // dropped it by now rather than queueing it
+  test_msgs__msg__Strings strings;
+  ASSERT_TRUE(test_msgs__msg__Strings__init(&strings));
+  EXPECT_TRUE(nothing_to_take(strings_sub, &strings));
+  auto * strings_data = static_cast<rmw_subscription_data_t *>(strings_sub->data);
+  {
+    std::lock_guard<std::mutex> lock(strings_data->message_queue_mutex_);
+    EXPECT_EQ(0u, strings_data->zn_message_queue_.size());
+  }
+
+  EXPECT_TRUE(raised(&strings_event, 0));
+  rmw_requested_qos_incompatible_event_status_t status = take_event(&strings_event);
+  EXPECT_EQ(1, status.total_count);
+  EXPECT_EQ(1, status.total_count_change);
+  EXPECT_FALSE(raised(&strings_event, 0));
+  EXPECT_FALSE(raised(&basic_types_event, 0));
+
+  test_msgs__msg__Strings__fini(&strings);
+}
+
+TEST_F(CLASSNAME(TestTypeMismatch, RMW_IMPLEMENTATION), raised_once_per_foreign_type) {
+  test_msgs__msg__BasicTypes c_taken;
+  ASSERT_TRUE(test_msgs__msg__BasicTypes__init(&c_taken));
+  test_msgs__msg__Strings strings;
+  ASSERT_TRUE(test_msgs__msg__Strings__init(&strings));
+
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(RMW_RET_OK, rmw_publish(basic_types_pub, &basic_types, nullptr)) <<
+      rmw_get_error_string().str;
+    EXPECT_TRUE(take(basic_types_sub, &c_taken));
+  }
+  EXPECT_TRUE(nothing_to_take(strings_sub, &strings));
+  rmw_requested_qos_incompatible_event_status_t status = take_event(&strings_event);
+  EXPECT_EQ(1, status.total_count);
+  EXPECT_EQ(1, status.total_count_change);
+
+  // More samples of the same foreign type are dropped without raising the event again
+  ASSERT_EQ(RMW_RET_OK, rmw_publish(basic_types_pub, &basic_types, nullptr)) <<
+    rmw_get_error_string().str;
+  EXPECT_TRUE(take(basic_types_sub, &c_taken));
+  EXPECT_TRUE(nothing_to_take(strings_sub, &strings));
+  EXPECT_FALSE(raised(&strings_event, 0));
+  status = take_event(&strings_event);
+  EXPECT_EQ(1, status.total_count);
+  EXPECT_EQ(0, status.total_count_change);
+
+  // Another foreign type raises it again, for both subscriptions it is foreign to. No
+  // subscription takes the Arrays, so they are dropped before being decoded at all.
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(RMW_RET_OK, rmw_publish(arrays_pub, &arrays, nullptr)) <<
+      rmw_get_error_string().str;
+  }
+  EXPECT_TRUE(raised(&strings_event, 1000));
+  EXPECT_TRUE(raised(&basic_types_event, 1000));
+  status = take_event(&strings_event);
+  EXPECT_EQ(2, status.total_count);
+  EXPECT_EQ(1, status.total_count_change);
+  status = take_event(&basic_types_event);
+  EXPECT_EQ(1, status.total_count);
+  EXPECT_EQ(1, status.total_count_change);
+  EXPECT_TRUE(nothing_to_take(strings_sub, &strings));
+  EXPECT_TRUE(nothing_to_take(basic_types_sub, &c_taken));
+
+  test_msgs__msg__Strings__fini(&strings);
+  test_msgs__msg__BasicTypes__fini(&c_taken);
+}
@@ -0,0 +1,421 @@
+// Copyright 2020 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Replays traces of rmw calls (recorded with RMW_ZENOH_TRACE_FILE, see trace_format.hpp) against
+// the middleware, and prints how the replay went as one JSON object.
+//
+//   trace_replay [--speed X] FILE...
+//
+// The traces of several processes are merged into one replay by the times they were recorded at,
+// so a whole system can be replayed from one process (the processes must have run on one host).
+// Every entity is recreated on its node with the name it was recorded with, and calls are made at
+// their recorded times, --speed times faster. Messages are test_msgs/UnboundedSequences with as
+// many uint8_values as the recorded message had bytes, and requests and responses are
+// test_msgs/BasicTypes with as long a string_value, so the traffic has the recorded sizes whatever
+// the recorded types were. Responses are sent to the oldest request their service took and has
+// not answered yet (a response with none to answer counts as an empty take). Waits are not
+// replayed: the takes they led to are.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rcutils/allocator.h"
+#include "rcutils/strdup.h"
+
+#include "rmw/rmw.h"
+#include "rmw/error_handling.h"
+
+#include "rosidl_runtime_c/primitives_sequence_functions.h"
+#include "rosidl_runtime_c/string_functions.h"
+
+#include "test_msgs/msg/unbounded_sequences.h"
+#include "test_msgs/srv/basic_types.h"
+
+#include "rmw_zenoh_common_cpp/trace_format.hpp"
+
+using rmw_zenoh_common_cpp::TraceEvent;
+using rmw_zenoh_common_cpp::TraceReader;
+using rmw_zenoh_common_cpp::TraceRecord;
+
+namespace
+{
+
+struct Options
+{
+  double speed = 1;
+  std::vector<std::string> files;
+};
+
+// A record, at its time since the epoch, with the entity keyed by its file
+struct Event
+{
+  int64_t time;
+  uint64_t entity;
+  TraceRecord record;
+};
+
+struct Entity
+{
+  TraceEvent kind;  // Creation event
+  void * handle;
+  uint64_t node;
+
+  // Requests taken and not answered yet, oldest first (services only)
+  std::deque<rmw_request_id_t> requests;
+};
+
+uint64_t entity_key(size_t file, uint32_t id)
+{
+  return (static_cast<uint64_t>(file) << 32) | id;
+}
+
+bool parse(int argc, char ** argv, Options & options)
+{
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+      options.speed = std::strtod(argv[++i], nullptr);
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return false;
+    } else {
+      options.files.push_back(argv[i]);
+    }
+  }
+  if (options.files.empty() || options.speed <= 0) {
+    fprintf(stderr, "usage: trace_replay [--speed X] FILE...\n");
+    return false;
+  }
+  return true;
+}
+
+// Read every trace, and merge their records by time. Waits are left out.
+bool load(const Options & options, std::vector<Event> & events, size_t & waits)
+{
+  for (size_t file = 0; file < options.files.size(); ++file) {
+    TraceReader reader;
+    std::string error;
+    if (!reader.open(options.files[file].c_str(), error)) {
+      fprintf(stderr, "%s\n", error.c_str());
+      return false;
+    }
+    Event event;
+    while (reader.next(event.record, error)) {
+      if (event.record.event == TraceEvent::kWait) {
+        ++waits;
+        continue;
+      }
+      event.time = reader.start() + event.record.time;
+      event.entity = entity_key(file, event.record.entity);
+      if (rmw_zenoh_common_cpp::trace_event_creates(event.record.event) &&
+        event.record.event != TraceEvent::kCreateNode)
+      {
+        // The node of the entity is in the same file
+        event.record.value = entity_key(file, static_cast<uint32_t>(event.record.value));
+      }
+      events.push_back(event);
+    }
+    if (!error.empty()) {
+      // What was recorded before the record cut short is still replayed
+      fprintf(stderr, "%s\n", error.c_str());
+    }
+  }
+  std::stable_sort(
+    events.begin(), events.end(),
+    [](const Event & a, const Event & b) {return a.time < b.time;});
+  return true;
+}
+
+// Size a sequence of bytes or a string to the recorded size of a payload
+void resize(rosidl_runtime_c__uint8__Sequence & sequence, uint64_t size)
+{
+  if (sequence.size != size) {
+    rosidl_runtime_c__uint8__Sequence__fini(&sequence);
+    rosidl_runtime_c__uint8__Sequence__init(&sequence, size);
+  }
+}
+
+void resize(rosidl_runtime_c__String & string, uint64_t size)
+{
+  if (string.size != size) {
+    std::string value(size, 'x');
+    rosidl_runtime_c__String__assignn(&string, value.c_str(), value.size());
+  }
+}
+
+void * create(rmw_node_t * node, const TraceRecord & record)
+{
+  const rosidl_message_type_support_t * msg_ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, UnboundedSequences);
+  const rosidl_service_type_support_t * srv_ts =
+    ROSIDL_GET_SRV_TYPE_SUPPORT(test_msgs, srv, BasicTypes);
+  rmw_qos_profile_t qos = rmw_qos_profile_default;
+  qos.depth = 100;
+
+  switch (record.event) {
+    case TraceEvent::kCreatePublisher: {
+        rmw_publisher_options_t options = rmw_get_default_publisher_options();
+        return rmw_create_publisher(node, msg_ts, record.name.c_str(), &qos, &options);
+      }
+    case TraceEvent::kCreateSubscription: {
+        rmw_subscription_options_t options = rmw_get_default_subscription_options();
+        return rmw_create_subscription(node, msg_ts, record.name.c_str(), &qos, &options);
+      }
+    case TraceEvent::kCreateClient:
+      return rmw_create_client(
+        node, srv_ts, record.name.c_str(), &rmw_qos_profile_services_default);
+    case TraceEvent::kCreateService:
+      return rmw_create_service(
+        node, srv_ts, record.name.c_str(), &rmw_qos_profile_services_default);
+    default:
+      return nullptr;
+  }
+}
+
+rmw_ret_t destroy(rmw_node_t * node, const Entity & entity)
+{
+  switch (entity.kind) {
+    case TraceEvent::kCreatePublisher:
+      return rmw_destroy_publisher(node, static_cast<rmw_publisher_t *>(entity.handle));
+    case TraceEvent::kCreateSubscription:
+      return rmw_destroy_subscription(node, static_cast<rmw_subscription_t *>(entity.handle));
+    case TraceEvent::kCreateClient:
+      return rmw_destroy_client(node, static_cast<rmw_client_t *>(entity.handle));
+    case TraceEvent::kCreateService:
+      return rmw_destroy_service(node, static_cast<rmw_service_t *>(entity.handle));
+    default:
+      return rmw_destroy_node(static_cast<rmw_node_t *>(entity.handle));
+  }
+}
+
+double percentile(const std::vector<double> & sorted, double p)
+{
+  if (sorted.empty()) {
+    return 0;
+  }
+  return sorted[static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5)];
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  Options options;
+  if (!parse(argc, argv, options)) {
+    return 2;
+  }
+
+  std::vector<Event> events;
+  size_t waits = 0;
+  if (!load(options, events, waits)) {
+    return 1;
+  }
+
+  rmw_init_options_t init_options = rmw_get_zero_initialized_init_options();
+  rmw_context_t context = rmw_get_zero_initialized_context();
+  if (rmw_init_options_init(&init_options, rcutils_get_default_allocator()) != RMW_RET_OK) {
+    fprintf(stderr, "failed to initialize options: %s\n", rmw_get_error_string().str);
+    return 1;
+  }
+  init_options.enclave = rcutils_strdup("/", rcutils_get_default_allocator());
+  if (rmw_init(&init_options, &context) != RMW_RET_OK) {
+    fprintf(stderr, "failed to initialize: %s\n", rmw_get_error_string().str);
+    return 1;
+  }
+
+  test_msgs__msg__UnboundedSequences message;
+  test_msgs__msg__UnboundedSequences__init(&message);
+  test_msgs__srv__BasicTypes_Request request;
+  test_msgs__srv__BasicTypes_Request__init(&request);
+  test_msgs__srv__BasicTypes_Response response;
+  test_msgs__srv__BasicTypes_Response__init(&response);
+
+  std::map<uint64_t, Entity> entities;
+  auto node_of = [&entities](const Entity & entity) -> rmw_node_t * {
+      auto node = entities.find(entity.node);
+      return node == entities.end() ? nullptr : static_cast<rmw_node_t *>(node->second.handle);
+    };
+
+  // Calls replayed, per event
+  std::vector<size_t> replayed(static_cast<size_t>(TraceEvent::kWait) + 1, 0);
+  size_t failures = 0;
+  size_t empty_takes = 0;
+  std::vector<double> lateness_us;
+  lateness_us.reserve(events.size());
+
+  const auto replay_start = std::chrono::steady_clock::now();
+  for (const Event & event : events) {
+    const TraceRecord & record = event.record;
+    const auto at = replay_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::nanoseconds(event.time - events.front().time) / options.speed);
+    std::this_thread::sleep_until(at);
+    lateness_us.push_back(
+      std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - at).count());
+
+    rmw_ret_t ret = RMW_RET_OK;
+    bool taken = true;
+    rmw_service_info_t info;
+
+    if (rmw_zenoh_common_cpp::trace_event_creates(record.event)) {
+      Entity entity{record.event, nullptr, record.value, {}};
+      if (record.event == TraceEvent::kCreateNode) {
+        // The name is fully qualified
+        size_t slash = record.name.rfind('/');
+        std::string name = record.name.substr(slash + 1);
+        std::string namespace_ = slash == 0 || slash == std::string::npos ?
+          "/" : record.name.substr(0, slash);
+        entity.handle = rmw_create_node(&context, name.c_str(), namespace_.c_str(), 0, false);
+      } else if (rmw_node_t * node = node_of(entity)) {
+        entity.handle = create(node, record);
+      }
+      if (entity.handle) {
+        entities[event.entity] = entity;
+      } else {
+        ret = RMW_RET_ERROR;
+      }
+    } else {
+      auto it = entities.find(event.entity);
+      if (it == entities.end()) {
+        // Created before the trace started, or its creation failed
+        ++failures;
+        continue;
+      }
+      Entity & entity = it->second;
+
+      switch (record.event) {
+        case TraceEvent::kPublish:
+          resize(message.uint8_values, record.value);
+          ret = rmw_publish(static_cast<rmw_publisher_t *>(entity.handle), &message, nullptr);
+          break;
+        case TraceEvent::kTake:
+          ret = rmw_take(
+            static_cast<rmw_subscription_t *>(entity.handle), &message, &taken, nullptr);
+          break;
+        case TraceEvent::kSendRequest: {
+            int64_t sequence_id;
+            resize(request.string_value, record.value);
+            ret = rmw_send_request(
+              static_cast<rmw_client_t *>(entity.handle), &request, &sequence_id);
+            break;
+          }
+        case TraceEvent::kTakeRequest:
+          ret = rmw_take_request(
+            static_cast<rmw_service_t *>(entity.handle), &info, &request, &taken);
+          if (ret == RMW_RET_OK && taken) {
+            entity.requests.push_back(info.request_id);
+          }
+          break;
+        case TraceEvent::kSendResponse:
+          if (entity.requests.empty()) {
+            // The request it answered was not taken in the replay
+            taken = false;
+            break;
+          }
+          resize(response.string_value, record.value);
+          ret = rmw_send_response(
+            static_cast<rmw_service_t *>(entity.handle), &entity.requests.front(), &response);
+          entity.requests.pop_front();
+          break;
+        case TraceEvent::kTakeResponse:
+          ret = rmw_take_response(
+            static_cast<rmw_client_t *>(entity.handle), &info, &response, &taken);
+          break;
+        case TraceEvent::kDestroyNode:
+          // Along with whatever is left on it
+          for (auto child = entities.begin(); child != entities.end(); ) {
+            if (child->second.kind != TraceEvent::kCreateNode &&
+              child->second.node == event.entity)
+            {
+              destroy(node_of(child->second), child->second);
+              child = entities.erase(child);
+            } else {
+              ++child;
+            }
+          }
+          ret = destroy(nullptr, entity);
+          entities.erase(event.entity);
+          break;
+        case TraceEvent::kDestroyPublisher:
+        case TraceEvent::kDestroySubscription:
+        case TraceEvent::kDestroyClient:
+        case TraceEvent::kDestroyService:
+          ret = destroy(node_of(entity), entity);
+          entities.erase(it);
+          break;
+        default:
+          ret = RMW_RET_ERROR;
+          break;
+      }
+    }
+
+    if (ret != RMW_RET_OK) {
+      rmw_reset_error();
+      ++failures;
+    } else if (!taken) {
+      ++empty_takes;
+    } else {
+      ++replayed[static_cast<size_t>(record.event)];
+    }
+  }
+  const double duration =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - replay_start).count();
+
+  auto count = [&replayed](TraceEvent first, TraceEvent last) {
+      size_t total = 0;
+      for (size_t i = static_cast<size_t>(first); i <= static_cast<size_t>(last); ++i) {
+        total += replayed[i];
+      }
+      return total;
+    };
+  auto calls = [&replayed](TraceEvent event) {return replayed[static_cast<size_t>(event)];};
+
+  std::sort(lateness_us.begin(), lateness_us.end());
+  printf(
+    "{\"files\": %zu, \"records\": %zu, \"skipped_waits\": %zu, \"speed\": %.3f, "
+    "\"duration_s\": %.3f, \"created\": %zu, \"destroyed\": %zu, \"published\": %zu, "
+    "\"taken\": %zu, \"requests_sent\": %zu, \"requests_taken\": %zu, \"responses_sent\": %zu, "
+    "\"responses_taken\": %zu, \"empty_takes\": %zu, \"failures\": %zu, "
+    "\"lateness_us\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f}}\n",
+    options.files.size(), events.size(), waits, options.speed, duration,
+    count(TraceEvent::kCreateNode, TraceEvent::kCreateService),
+    count(TraceEvent::kDestroyNode, TraceEvent::kDestroyService),
+    calls(TraceEvent::kPublish), calls(TraceEvent::kTake), calls(TraceEvent::kSendRequest),
+    calls(TraceEvent::kTakeRequest), calls(TraceEvent::kSendResponse),
+    calls(TraceEvent::kTakeResponse), empty_takes, failures, percentile(lateness_us, 0.5),
+    percentile(lateness_us, 0.9), percentile(lateness_us, 0.99), percentile(lateness_us, 1));
+  fflush(stdout);
+
+  // Entities first, then their nodes
+  for (int nodes = 0; nodes < 2; ++nodes) {
+    for (const auto & entry : entities) {
+      if ((entry.second.kind == TraceEvent::kCreateNode) == (nodes == 1)) {
+        destroy(node_of(entry.second), entry.second);
+      }
+    }
+  }
+  test_msgs__srv__BasicTypes_Response__fini(&response);
+  test_msgs__srv__BasicTypes_Request__fini(&request);
+  test_msgs__msg__UnboundedSequences__fini(&message);
+  rmw_shutdown(&context);
+  rmw_context_fini(&context);
+  rmw_init_options_fini(&init_options);
+  return 0;
+}
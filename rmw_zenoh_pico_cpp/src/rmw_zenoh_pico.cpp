@@ -46,8 +46,13 @@ zn_properties_t * configure_connection_mode(rmw_context_t * context)
 void configure_session(zn_session_t * session)
 {
   // Start the read session session lease loops
+  rmw_zenoh_common_threads_begin();
   znp_start_read_task(session);
+  rmw_zenoh_common_threads_end("read");
+
+  rmw_zenoh_common_threads_begin();
   znp_start_lease_task(session);
+  rmw_zenoh_common_threads_end("lease");
 }
 
 const char *
@@ -105,7 +110,9 @@ rmw_init(const rmw_init_options_t * options, rmw_context_t * context)
       return RMW_RET_ERROR;
     }
 
+    rmw_zenoh_common_threads_begin();
     zn_session_t * session = zn_open(config);
+    rmw_zenoh_common_threads_end("session");
 
     if (session == nullptr) {
       RMW_SET_ERROR_MSG("failed to create Zenoh session when starting context");
@@ -114,6 +121,10 @@ rmw_init(const rmw_init_options_t * options, rmw_context_t * context)
     } else {
       context_impl->session = session;
       context_impl->is_shutdown = false;
+      context_impl->rx_buffer_pool = nullptr;
+      context_impl->config = nullptr;
+      context_impl->session_bucket = nullptr;
+      context_impl->rx_overload = nullptr;
     }
 
     // CLEANUP IF PASSED =========================================================
@@ -121,6 +132,7 @@ rmw_init(const rmw_init_options_t * options, rmw_context_t * context)
     clean_when_fail.release();
 
     configure_session(context_impl->session);
+    ret = rmw_zenoh_common_init_post(context, eclipse_zenoh_identifier);
   }
   return ret;
 }
@@ -295,6 +307,142 @@ rmw_destroy_publisher(
     eclipse_zenoh_identifier);
 }
 
+/// CREATE SUBSCRIPTIONS =======================================================
+// Create the subscriptions of a node in one pass (see rmw_zenoh_extensions.h)
+rmw_ret_t
+rmw_zenoh_create_subscriptions(
+  const rmw_node_t * node,
+  const rmw_zenoh_subscription_request_t * requests,
+  size_t count,
+  rmw_subscription_t ** subscriptions)
+{
+  return rmw_zenoh_common_create_subscriptions(
+    node,
+    requests,
+    count,
+    subscriptions,
+    eclipse_zenoh_identifier);
+}
+
+/// CREATE PUBLISHERS ==========================================================
+// Create the publishers of a node in one pass (see rmw_zenoh_extensions.h)
+rmw_ret_t
+rmw_zenoh_create_publishers(
+  const rmw_node_t * node,
+  const rmw_zenoh_publisher_request_t * requests,
+  size_t count,
+  rmw_publisher_t ** publishers)
+{
+  return rmw_zenoh_common_create_publishers(
+    node,
+    requests,
+    count,
+    publishers,
+    eclipse_zenoh_identifier);
+}
+
+/// ZENOH EXTENSIONS ===========================================================
+// The extensions that take an entity check that it was created by this implementation
+rmw_ret_t
+rmw_zenoh_get_publisher_shaping_stats(
+  const rmw_publisher_t * publisher,
+  rmw_zenoh_publisher_shaping_stats_t * stats)
+{
+  return rmw_zenoh_common_get_publisher_shaping_stats(
+    publisher,
+    stats,
+    eclipse_zenoh_identifier);
+}
+
+rmw_ret_t
+rmw_zenoh_query_history(
+  const rmw_node_t * node,
+  const char * topic_name,
+  const rmw_zenoh_history_query_t * query,
+  rmw_time_t timeout,
+  rmw_zenoh_history_t * history)
+{
+  return rmw_zenoh_common_query_history(
+    node,
+    topic_name,
+    query,
+    timeout,
+    history,
+    eclipse_zenoh_identifier);
+}
+
+rmw_ret_t
+rmw_zenoh_get_subscription_latency(
+  const rmw_subscription_t * subscription,
+  rmw_zenoh_subscription_latency_t * latency)
+{
+  return rmw_zenoh_common_get_subscription_latency(
+    subscription,
+    latency,
+    eclipse_zenoh_identifier);
+}
+
+rmw_ret_t
+rmw_zenoh_get_subscription_losses(
+  const rmw_subscription_t * subscription,
+  rmw_zenoh_subscription_losses_t * losses)
+{
+  return rmw_zenoh_common_get_subscription_losses(
+    subscription,
+    losses,
+    eclipse_zenoh_identifier);
+}
+
+rmw_ret_t
+rmw_zenoh_set_subscription_callback(
+  const rmw_subscription_t * subscription,
+  rmw_zenoh_subscription_callback_t callback,
+  void * ros_message,
+  void * user_data)
+{
+  return rmw_zenoh_common_set_subscription_callback(
+    subscription,
+    callback,
+    ros_message,
+    user_data,
+    eclipse_zenoh_identifier);
+}
+
+rmw_ret_t
+rmw_zenoh_set_client_response_callback(
+  const rmw_client_t * client,
+  rmw_zenoh_client_response_callback_t callback,
+  void * user_data)
+{
+  return rmw_zenoh_common_set_client_response_callback(
+    client,
+    callback,
+    user_data,
+    eclipse_zenoh_identifier);
+}
+
+rmw_ret_t
+rmw_zenoh_set_client_request_timeout(
+  const rmw_client_t * client,
+  rmw_time_t timeout)
+{
+  return rmw_zenoh_common_set_client_request_timeout(
+    client,
+    timeout,
+    eclipse_zenoh_identifier);
+}
+
+rmw_ret_t
+rmw_zenoh_get_service_expired_requests(
+  const rmw_service_t * service,
+  uint64_t * count)
+{
+  return rmw_zenoh_common_get_service_expired_requests(
+    service,
+    count,
+    eclipse_zenoh_identifier);
+}
+
 rmw_ret_t
 rmw_publisher_get_actual_qos(
   const rmw_publisher_t * publisher,
@@ -347,6 +495,44 @@ rmw_take(
     eclipse_zenoh_identifier);
 }
 
+rmw_ret_t
+rmw_init_publisher_allocation(
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  rmw_publisher_allocation_t * allocation)
+{
+  return rmw_zenoh_common_init_publisher_allocation(
+    type_support,
+    message_bounds,
+    allocation,
+    eclipse_zenoh_identifier);
+}
+
+rmw_ret_t
+rmw_fini_publisher_allocation(rmw_publisher_allocation_t * allocation)
+{
+  return rmw_zenoh_common_fini_publisher_allocation(allocation, eclipse_zenoh_identifier);
+}
+
+rmw_ret_t
+rmw_init_subscription_allocation(
+  const rosidl_message_type_support_t * type_support,
+  const rosidl_runtime_c__Sequence__bound * message_bounds,
+  rmw_subscription_allocation_t * allocation)
+{
+  return rmw_zenoh_common_init_subscription_allocation(
+    type_support,
+    message_bounds,
+    allocation,
+    eclipse_zenoh_identifier);
+}
+
+rmw_ret_t
+rmw_fini_subscription_allocation(rmw_subscription_allocation_t * allocation)
+{
+  return rmw_zenoh_common_fini_subscription_allocation(allocation, eclipse_zenoh_identifier);
+}
+
 rmw_ret_t
 rmw_subscription_event_init(
   rmw_event_t * event,
@@ -377,6 +563,21 @@ rmw_take_with_info(
     eclipse_zenoh_identifier);
 }
 
+rmw_ret_t
+rmw_take_loaned_message(
+  const rmw_subscription_t * subscription,
+  void ** loaned_message,
+  bool * taken,
+  rmw_subscription_allocation_t * allocation)
+{
+  return rmw_zenoh_common_take_loaned_message(
+    subscription,
+    loaned_message,
+    taken,
+    allocation,
+    eclipse_zenoh_identifier);
+}
+
 rmw_ret_t
 rmw_take_loaned_message_with_info(
   const rmw_subscription_t * subscription,
@@ -390,7 +591,8 @@ rmw_take_loaned_message_with_info(
     loaned_message,
     taken,
     message_info,
-    allocation);
+    allocation,
+    eclipse_zenoh_identifier);
 }
 
 rmw_client_t *
@@ -570,5 +772,6 @@ rmw_return_loaned_message_from_subscription(
 {
   return rmw_zenoh_common_return_loaned_message_from_subscription(
     subscription,
-    loaned_message);
+    loaned_message,
+    eclipse_zenoh_identifier);
 }
@@ -24,6 +24,8 @@
 
 #include "test_msgs/msg/basic_types.h"
 
+#include "rmw_zenoh_common_cpp/rmw_zenoh_extensions.h"
+
 #include "./config.hpp"
 #include "./testing_macros.hpp"
 
@@ -96,6 +98,41 @@ TEST_F(CLASSNAME(TestPublisher, RMW_IMPLEMENTATION), create_and_destroy_native)
   EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
 }
 
+TEST_F(CLASSNAME(TestPublisher, RMW_IMPLEMENTATION), publish_over_rate_limit) {
+  rmw_zenoh_publisher_options_t zenoh_options{};
+  zenoh_options.rate_limit = 1;
+  zenoh_options.burst = 1;
+  zenoh_options.rate_limit_mode = RMW_ZENOH_RATE_LIMIT_DROP;
+  rmw_publisher_options_t options = rmw_get_default_publisher_options();
+  options.rmw_specific_publisher_payload = &zenoh_options;
+  constexpr char topic_name[] = "/test";
+  const rosidl_message_type_support_t * ts =
+    ROSIDL_GET_MSG_TYPE_SUPPORT(test_msgs, msg, BasicTypes);
+  rmw_publisher_t * pub =
+    rmw_create_publisher(node, ts, topic_name, &rmw_qos_profile_default, &options);
+  ASSERT_NE(nullptr, pub) << rmw_get_error_string().str;
+
+  // The first message empties the bucket, the second one is dropped
+  test_msgs__msg__BasicTypes msg{};
+  rmw_ret_t ret = rmw_publish(pub, &msg, nullptr);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  ret = rmw_publish(pub, &msg, nullptr);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+
+  rmw_zenoh_publisher_shaping_stats_t stats;
+  ret = rmw_zenoh_get_publisher_shaping_stats(pub, &stats);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(1u, stats.dropped_messages);
+  EXPECT_LT(0u, stats.dropped_bytes);
+
+  ret = rmw_zenoh_get_publisher_shaping_stats(pub, nullptr);
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, ret);
+  rmw_reset_error();
+
+  ret = rmw_destroy_publisher(node, pub);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+}
+
 TEST_F(CLASSNAME(TestPublisher, RMW_IMPLEMENTATION), create_with_bad_arguments) {
   rmw_publisher_options_t options = rmw_get_default_publisher_options();
   constexpr char topic_name[] = "/test";
@@ -266,3 +303,33 @@ TEST_F(CLASSNAME(TestPublisherUse, RMW_IMPLEMENTATION), count_matched_subscripti
   EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, ret);
   rmw_reset_error();
 }
+
+TEST_F(CLASSNAME(TestPublisherUse, RMW_IMPLEMENTATION), publish_with_allocation) {
+  rmw_publisher_allocation_t allocation{nullptr, nullptr};
+  rmw_ret_t ret = rmw_init_publisher_allocation(ts, nullptr, &allocation);
+  ASSERT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_NE(nullptr, allocation.data);
+
+  test_msgs__msg__BasicTypes msg{};
+  ret = rmw_publish(pub, &msg, &allocation);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+
+  ret = rmw_fini_publisher_allocation(&allocation);
+  EXPECT_EQ(RMW_RET_OK, ret) << rmw_get_error_string().str;
+  EXPECT_EQ(nullptr, allocation.data);
+}
+
+TEST_F(CLASSNAME(TestPublisherUse, RMW_IMPLEMENTATION), init_publisher_allocation_with_bad_args) {
+  rmw_publisher_allocation_t allocation{nullptr, nullptr};
+  rmw_ret_t ret = rmw_init_publisher_allocation(nullptr, nullptr, &allocation);
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, ret);
+  rmw_reset_error();
+
+  ret = rmw_init_publisher_allocation(ts, nullptr, nullptr);
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, ret);
+  rmw_reset_error();
+
+  ret = rmw_fini_publisher_allocation(&allocation);
+  EXPECT_EQ(RMW_RET_INVALID_ARGUMENT, ret);
+  rmw_reset_error();
+}